@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# Test loading files via the PACS database loader.
+#
+# Note: requires a reachable PostgreSQL instance. Provide connection parameters via DCMA_TEST_PACS_DB, e.g.,
+#       DCMA_TEST_PACS_DB='host=localhost dbname=postgres user=postgres'. No tables are needed because the filter query
+#       synthesizes the metadata records directly. The test is skipped if no database is provided or if the binary was
+#       compiled without PostgreSQL support.
+if [ -z "${DCMA_TEST_PACS_DB:-}" ] ; then
+    printf 'DCMA_TEST_PACS_DB not provided. Skipping test.\n'
+    exit 0
+fi
+if ! "${DCMA_BIN}" -h 2>&1 | grep -q 'database-parameters' ; then
+    printf 'PostgreSQL support not available. Skipping test.\n'
+    exit 0
+fi
+
+# Generate a query that selects more files than will fit in a single cursor fetch, so batching is exercised.
+{
+    printf 'SELECT * FROM ( VALUES\n'
+    first=1
+    for i in $(seq 1 100) ; do
+        for f in MR_continents.dcm MR_mosaic.dcm MR_fuzzy_noise.dcm ; do
+            [ "${first}" == "1" ] || printf ',\n'
+            first=0
+            printf "  ('%s', 'MR', NULL::text, NULL::text)" "${TEST_FILES_ROOT}/${f}"
+        done
+    done
+    printf '\n) AS t(StoreFullPathName, Modality, FrameOfReferenceUID, dt) ;\n'
+} > query.sql
+
+"${DCMA_BIN}" \
+  -v \
+  -d "${DCMA_TEST_PACS_DB}" \
+  -f query.sql \
+  -o DroverDebug |
+  grep 'Image_Array 0 has 300 image slices' |
+  `# Ensure the output stream is not empty. ` \
+  grep .
+
+# Multi-statement queries cannot be streamed, but should still be loaded.
+printf 'SELECT 1 ; %s' "$(cat query.sql)" > query_multi.sql
+"${DCMA_BIN}" \
+  -v \
+  -d "${DCMA_TEST_PACS_DB}" \
+  -f query_multi.sql \
+  -o DroverDebug |
+  grep 'Image_Array 0 has 300 image slices' |
+  grep .
+
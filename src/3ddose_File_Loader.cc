@@ -3,16 +3,19 @@
 // This program loads ASCII DOSXYZnrc 3ddose files.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <exception>
-#include <fstream>
 #include <numeric>
 #include <list>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>    
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <cstdlib>            //Needed for exit() calls.
@@ -24,6 +27,7 @@
 
 #include "Structs.h"
 #include "Imebra_Shim.h"      //Needed for Collate_Image_Arrays().
+#include "Mapped_File.h"
 
 
 bool Load_From_3ddose_Files( Drover &DICOM_data,
@@ -50,21 +54,15 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
     //
     if(Filenames.empty()) return true;
 
-    const auto extract_separated_numbers = [](const std::string &in) -> std::vector<double> {
-            // This rountine extracts numerical function parameters.
-            auto split = SplitStringToVector(in, ' ', 'd');
-            split = SplitVector(split, '\t', 'd');
-
-            std::vector<double> numbers;
-            for(const auto &w : split){
-               try{
-                   const auto x = std::stod(w);
-                   numbers.emplace_back(x);
-               }catch(const std::exception &){ }
-            }
-            return numbers;
+    // Parses the leading number in a token, ignoring any trailing characters.
+    const auto parse_leading_number = [](std::string_view token, double &x) -> bool {
+        return (Parse_Number(token.data(), token.data() + token.size(), x) != nullptr);
     };
 
+    // Files larger than this are split and parsed concurrently.
+    const size_t parallel_parse_threshold = 4UL * 1024UL * 1024UL;
+    const size_t min_chunk_bytes = 1024UL * 1024UL;
+
     size_t i = 0;
     const size_t N = Filenames.size();
 
@@ -77,12 +75,11 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
         try{
             //////////////////////////////////////////////////////////////
             // Attempt to load the file.
-            std::fstream FI(Filename.c_str(), std::ios::in);
-            if(!FI.good()){
-                throw std::runtime_error("Unable to read file.");
-            }
+            mapped_file mf(Filename);
+            const auto contents = mf.view();
+            const char *pos = contents.data();
+            const char *end = pos + contents.size();
 
-            bool dims_known = false;
             long int N_x = -1;
             long int N_y = -1;
             long int N_z = -1;
@@ -91,123 +88,57 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
             std::vector<double> spatial_y;
             std::vector<double> spatial_z;
 
-            std::vector<double> doses;
-
-/*
-            try{
-                double shtl;
-                FI >> N_x >> N_y >> N_z;
-                for(long int i = 0; i <= N_x; ++i){ // Intentionally reads N_x+1 values.
-                    FI >> shtl;
-                    spatial_x.emplace_back(shtl);
-                }
-                for(long int i = 0; i <= N_x; ++i){ // Intentionally reads N_y+1 values.
-                    FI >> shtl;
-                    spatial_x.emplace_back(shtl);
-                }
-                for(long int i = 0; i <= N_x; ++i){ // Intentionally reads N_z+1 values.
-                    FI >> shtl;
-                    spatial_x.emplace_back(shtl);
-                }
-                while(!FI.eof()){
-                    FI >> shtl;
-                    doses.emplace_back(shtl);
-                }
-            }catch(const std::exception &){ }
-            FI.close();
-*/            
-            std::string aline;
-            while(!FI.eof()){
-                std::getline(FI, aline);
-
-                // Ignore comments.
-                const auto hash_pos = aline.find_first_of('#');
-                if(hash_pos != std::string::npos){
-                    aline = aline.substr(0, hash_pos);
-                }
-
-                // Extract all numbers separated by whitespace.
-                const auto numbers = extract_separated_numbers(aline);
-                if(numbers.empty()) continue;
-
-                // If the matrix dimensions are not yet known, seek this info before reading any other information.
-                //
-                // Dimensional consistency is the only way to validate 3ddose files, so we use the dimensions to ensure
-                // the correct amount of data has been received at the end.
-                //
-                // Since there is no 3ddose file header or magic numbers we have to ruthlessly reject files that do
-                // not immediately present sane dimensions.
-                if(!dims_known){
-                    if(numbers.size() != 3) throw std::runtime_error("Dimensions not understood.");
-
-                    N_x = static_cast<long int>(numbers.at(0));
-                    N_y = static_cast<long int>(numbers.at(1));
-                    N_z = static_cast<long int>(numbers.at(2));
-                    if((N_x <= 0) || (N_y <= 0) || (N_z <= 0)){
-                        throw std::runtime_error("Dimensions invalid.");
+            // If the matrix dimensions are not yet known, seek this info before reading any other information.
+            //
+            // Dimensional consistency is the only way to validate 3ddose files, so we use the dimensions to ensure
+            // the correct amount of data has been received at the end.
+            //
+            // Since there is no 3ddose file header or magic numbers we have to ruthlessly reject files that do
+            // not immediately present sane dimensions.
+            {
+                std::vector<double> numbers;
+                while(numbers.empty() && (pos != end)){
+                    text_cursor tc(Next_Text_Line(pos, end, '#'));
+                    double x;
+                    for(auto token = tc.next_token(); !token.empty(); token = tc.next_token()){
+                        if(parse_leading_number(token, x)) numbers.emplace_back(x);
                     }
-                    dims_known = true;
-                    continue;
-
-                // Attempt to parse spatial information.
-                }else if( dims_known 
-                      && (static_cast<long int>(spatial_x.size()) != (N_x + 1)) ){
-
-                    for(const auto &n : numbers){
-                        if(!std::isfinite(n)) continue;
-                    }
-                    spatial_x.insert( std::end(spatial_x), std::begin(numbers), std::end(numbers) );
-
-                }else if( dims_known 
-                      && (static_cast<long int>(spatial_x.size()) == (N_x + 1))
-                      && (static_cast<long int>(spatial_y.size()) != (N_y + 1)) ){
-
-                    for(const auto &n : numbers){
-                        if(!std::isfinite(n)) continue;
-                    }
-                    spatial_y.insert( std::end(spatial_y), std::begin(numbers), std::end(numbers) );
+                }
+                if(numbers.size() != 3) throw std::runtime_error("Dimensions not understood.");
 
-                }else if( dims_known 
-                      && (static_cast<long int>(spatial_x.size()) == (N_x + 1))
-                      && (static_cast<long int>(spatial_y.size()) == (N_y + 1))
-                      && (static_cast<long int>(spatial_z.size()) != (N_z + 1)) ){
+                N_x = static_cast<long int>(numbers.at(0));
+                N_y = static_cast<long int>(numbers.at(1));
+                N_z = static_cast<long int>(numbers.at(2));
+                if((N_x <= 0) || (N_y <= 0) || (N_z <= 0)){
+                    throw std::runtime_error("Dimensions invalid.");
+                }
+            }
 
-                    for(const auto &n : numbers){
-                        if(!std::isfinite(n)) continue;
-                    }
-                    spatial_z.insert( std::end(spatial_z), std::begin(numbers), std::end(numbers) );
-
-                // Continue reading in all dose and trailing dose uncertainties.
-                //
-                // If the final number of voxels differs from the stated dimensions, then this file is not valid.
-                }else if( dims_known 
-                      && (static_cast<long int>(spatial_x.size()) == (N_x + 1))
-                      && (static_cast<long int>(spatial_y.size()) == (N_y + 1))
-                      && (static_cast<long int>(spatial_z.size()) == (N_z + 1)) ){
-                    for(const auto &n : numbers){
-                        if(!std::isfinite(n)) continue;
+            // Attempt to parse spatial information. Comments are ignored, as are tokens that are not numbers.
+            text_cursor line;
+            const auto next_header_number = [&](double &x) -> bool {
+                while(true){
+                    for(auto token = line.next_token(); !token.empty(); token = line.next_token()){
+                        if(parse_leading_number(token, x)) return true;
                     }
-
-                    // Append the doses.
-                    doses.insert( std::end(doses), std::begin(numbers), std::end(numbers) );
-
-                // Unexpected scenario.
-                }else{
-                    FUNCWARN("Unable to read 3ddose file.");
-                    return false;
+                    if(pos == end) return false;
+                    line = text_cursor(Next_Text_Line(pos, end, '#'));
+                }
+            };
+            for(auto [boundaries, N_boundaries] : { std::make_pair(&spatial_x, N_x + 1),
+                                                    std::make_pair(&spatial_y, N_y + 1),
+                                                    std::make_pair(&spatial_z, N_z + 1) }){
+                double x;
+                while(static_cast<long int>(boundaries->size()) < N_boundaries){
+                    if(!next_header_number(x)) throw std::runtime_error("Unable to read voxel boundaries.");
+                    boundaries->emplace_back(x);
                 }
-
             }
-            FI.close();
 
-            // Validate that the file has been fully read.
-            if( (static_cast<long int>(doses.size()) != (N_x * N_y * N_z))   // Dose data only.
-            &&  (static_cast<long int>(doses.size()) != (N_x * N_y * N_z * 2L)) ){  // Dose data and uncertainties.
-                throw std::runtime_error("Unable to read file.");
-            }
-            if( static_cast<long int>(doses.size()) == (N_x * N_y * N_z * 2L) ){
-                doses.resize( static_cast<size_t>(N_x * N_y * N_z) );
-            }
+            // All dose and trailing dose uncertainties follow. Since the remainder of the current line was stripped of
+            // comments, the raw text is resumed from the current position.
+            const char *dose_begin = (line.pos == nullptr) ? pos : line.pos;
+            const std::string_view dose_text(dose_begin, static_cast<size_t>(end - dose_begin));
 
             //--------------------------------------------------------
             // Construct an Image_Array to hold the dose data.
@@ -296,6 +227,7 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
             const std::string Modality = "RTDOSE";
 
             loaded_imgs_storage.emplace_back();
+            std::vector<planar_image<float,double>*> img_ptrs;
             for(long int img_index = 0; img_index < NumberOfImages; ++img_index){
                 const std::string SOPInstanceUID = Generate_Random_String_of_Length(6);
 
@@ -343,13 +275,7 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
                 out->imagecoll.images.back().init_buffer(NumberOfRows, NumberOfColumns, NumberOfChannels);
                 out->imagecoll.images.back().init_spatial(VoxelWidth, VoxelHeight, SliceThickness, ImageAnchor, ImagePosition);
 
-                for(long int y = 0; y < N_y; ++y){
-                    for(long int x = 0; x < N_x; ++x){
-                        const auto index = (N_x * N_y * img_index) + (N_x * y) + x;
-
-                        out->imagecoll.images.back().reference(y, x, 0L) = doses.at(index);
-                    }
-                }
+                img_ptrs.emplace_back( &(out->imagecoll.images.back()) );
 
                 ImagePosition += ImageOrientationOrtho * SpacingBetweenSlices;
                 ++InstanceNumber;
@@ -357,6 +283,71 @@ bool Load_From_3ddose_Files( Drover &DICOM_data,
                 loaded_imgs_storage.back().push_back( std::move( out ) );
             }
 
+            //--------------------------------------------------------
+            // Read the doses directly into the images.
+            //
+            // If the final number of voxels differs from the stated dimensions, then this file is not valid.
+            const auto N_voxels = N_x * N_y * N_z;
+            const auto store_dose = [&](long int index, double x) -> void {
+                const auto img_index = index / (N_x * N_y);
+                const auto y = (index / N_x) % N_y;
+                const auto x_index = index % N_x;
+                img_ptrs[img_index]->reference(y, x_index, 0L) = static_cast<float>(x);
+                return;
+            };
+
+            bool doses_read = false;
+            if(dose_text.find('#') == std::string_view::npos){
+                // Doses are stored sequentially, so each chunk can be parsed independently once the number of values
+                // that precede it is known. Uncertainties, which trail the doses, are not parsed.
+                const auto chunks = (dose_text.size() < parallel_parse_threshold)
+                                  ? std::vector<std::string_view>{ dose_text }
+                                  : Split_Text_At_Whitespace(dose_text, Default_Parse_Chunk_Count(), min_chunk_bytes);
+                const auto N_chunks = chunks.size();
+
+                std::vector<long int> offsets(N_chunks + 1, 0L);
+                Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+                    offsets[n + 1] = static_cast<long int>(Count_Text_Tokens(chunks[n]));
+                });
+                std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+
+                if( (offsets.back() == N_voxels)         // Dose data only.
+                ||  (offsets.back() == (N_voxels * 2L)) ){  // Dose data and uncertainties.
+                    std::vector<char> chunk_ok(N_chunks, 1);
+                    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+                        text_cursor tc(chunks[n]);
+                        for(auto index = offsets[n]; (index < offsets[n + 1]) && (index < N_voxels); ++index){
+                            const auto token = tc.next_token();
+                            double x;
+                            if(Parse_Number(token.data(), token.data() + token.size(), x) != (token.data() + token.size())){
+                                chunk_ok[n] = 0;
+                                return;
+                            }
+                            store_dose(index, x);
+                        }
+                    });
+                    doses_read = std::all_of(std::begin(chunk_ok), std::end(chunk_ok), [](char ok){ return (ok != 0); });
+                }
+            }
+            if(!doses_read){
+                // Comments or non-numeric tokens are present, so parse sequentially with the header's rules.
+                long int index = 0;
+                const char *p = dose_begin;
+                while(p != end){
+                    text_cursor tc(Next_Text_Line(p, end, '#'));
+                    double x;
+                    for(auto token = tc.next_token(); !token.empty(); token = tc.next_token()){
+                        if(!parse_leading_number(token, x)) continue;
+                        if(index < N_voxels) store_dose(index, x);
+                        ++index;
+                    }
+                }
+                if( (index != N_voxels)
+                &&  (index != (N_voxels * 2L)) ){
+                    throw std::runtime_error("Unable to read file.");
+                }
+            }
+
             //Collate each group of images into a single set, if possible. Also stuff the correct contour data in the same set.
             for(auto &loaded_img_set : loaded_imgs_storage){
                 if(loaded_img_set.empty()) continue;
@@ -1,7 +1,19 @@
 //Colour_Maps.cc - A part of DICOMautomaton 2017. Written by hal clark.
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include "Colour_Maps.h"
 #include "YgorMath.h"
@@ -17922,5 +17934,161 @@ std::optional<ClampedColourRGB> Colour_from_name(const std::string& n){
 }
 
 
+colour_map_lut::colour_map_lut( const std::function<ClampedColourRGB(double)> &colour_map,
+                                long int N_entries ){
+    if(!colour_map){
+        throw std::invalid_argument("No colour map provided");
+    }
+    if(N_entries < 2){
+        throw std::invalid_argument("Colour map lookup table must have at least two entries");
+    }
+
+    const auto scale = static_cast<double>(std::numeric_limits<uint8_t>::max());
+    this->R.reserve(N_entries);
+    this->G.reserve(N_entries);
+    this->B.reserve(N_entries);
+    for(long int i = 0; i < N_entries; ++i){
+        const auto x = static_cast<double>(i) / static_cast<double>(N_entries - 1);
+        const auto c = colour_map(x);
+        this->R.push_back( static_cast<float>(std::clamp(c.R, 0.0, 1.0) * scale) );
+        this->G.push_back( static_cast<float>(std::clamp(c.G, 0.0, 1.0) * scale) );
+        this->B.push_back( static_cast<float>(std::clamp(c.B, 0.0, 1.0) * scale) );
+    }
+}
+
+long int
+colour_map_lut::size() const {
+    return static_cast<long int>(this->R.size());
+}
+
+template <long int C>
+void
+colour_map_lut::map_packed( const float *in,
+                            long int N,
+                            long int in_stride,
+                            const colour_lut_window &window,
+                            uint8_t *out ) const {
+    static_assert((C == 3) || (C == 4), "Only RGB and RGBA outputs are supported");
+
+    if(!std::isfinite(window.low) || !std::isfinite(window.high)){
+        throw std::invalid_argument("Window bounds must be finite");
+    }
+
+    const auto last = static_cast<int32_t>(this->R.size()) - 1;
+    const auto t_max = static_cast<float>(last);
+    const auto f_low = static_cast<float>(window.low);
+    const auto f_high = static_cast<float>(window.high);
+
+    // A degenerate window is a step at the lower bound. Both cases are blended arithmetically to avoid branching.
+    const bool is_step = !(window.low < window.high);
+    const auto scale = (is_step) ? 0.0f
+                                 : static_cast<float>( static_cast<double>(last) / (window.high - window.low) );
+    const auto ramp_weight = (is_step) ? 0.0f : 1.0f;
+
+    // Special colours, indexed by class. Class 0 means the value is interpolated from the table.
+    std::array<std::array<uint8_t,4>, 4> special;
+    special[1] = window.below_colour.value_or(window.nan_colour);
+    special[2] = window.above_colour.value_or(window.nan_colour);
+    special[3] = window.nan_colour;
+    const int32_t below_class = (window.below_colour) ? 1 : 0;
+    const int32_t above_class = (window.above_colour) ? 2 : 0;
+
+    // Values are processed in blocks. The first loop computes table positions without branching so it can be
+    // vectorized, and the second interpolates the table and writes the packed output.
+    constexpr long int block = 256;
+    std::array<int32_t, block> idx;
+    std::array<float, block> frac;
+    std::array<int32_t, block> cls;
+    for(long int b = 0; b < N; b += block){
+        const auto b_N = std::min(block, N - b);
+        const float *src = in + b * in_stride;
+
+        for(long int i = 0; i < b_N; ++i){
+            const float v = src[i * in_stride];
+
+            // Non-finite values are detected via the exponent bits and replaced before any floating-point comparisons
+            // so that the compiler is free to evaluate every lane unconditionally.
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            const bool finite = ((bits & 0x7f800000u) != 0x7f800000u);
+            const float v_f = finite ? v : f_low;
+
+            const bool below = (v_f < f_low);
+            const bool above = (f_high < v_f);
 
+            const float d = v_f - f_low;
+            const float t_ramp = d * scale;
+            const float t_step = (0.0f < d) ? t_max : 0.0f;
+            const float t = std::min(std::max(ramp_weight * t_ramp + (1.0f - ramp_weight) * t_step, 0.0f), t_max);
+            const auto i0 = std::min(static_cast<int32_t>(t), last - 1);
+
+            idx[i] = i0;
+            frac[i] = t - static_cast<float>(i0);
+            cls[i] = (!finite) ? 3
+                               : (below ? below_class
+                                        : (above ? above_class : 0));
+        }
+
+        uint8_t *dst = out + b * C;
+        const float *R_p = this->R.data();
+        const float *G_p = this->G.data();
+        const float *B_p = this->B.data();
+        for(long int i = 0; i < b_N; ++i){
+            const auto i0 = idx[i];
+            const auto f = frac[i];
+            dst[i * C + 0] = static_cast<uint8_t>( R_p[i0] + f * (R_p[i0 + 1] - R_p[i0]) );
+            dst[i * C + 1] = static_cast<uint8_t>( G_p[i0] + f * (G_p[i0 + 1] - G_p[i0]) );
+            dst[i * C + 2] = static_cast<uint8_t>( B_p[i0] + f * (B_p[i0 + 1] - B_p[i0]) );
+            if constexpr (C == 4) dst[i * C + 3] = std::numeric_limits<uint8_t>::max();
+        }
+
+        for(long int i = 0; i < b_N; ++i){
+            if(cls[i] != 0) std::memcpy(dst + i * C, special[cls[i]].data(), C);
+        }
+    }
+    return;
+}
+
+void
+colour_map_lut::map_rgb( const float *in,
+                         long int N,
+                         long int in_stride,
+                         const colour_lut_window &window,
+                         uint8_t *out_rgb ) const {
+    this->map_packed<3>(in, N, in_stride, window, out_rgb);
+    return;
+}
+
+void
+colour_map_lut::map_rgba( const float *in,
+                          long int N,
+                          long int in_stride,
+                          const colour_lut_window &window,
+                          uint8_t *out_rgba ) const {
+    this->map_packed<4>(in, N, in_stride, window, out_rgba);
+    return;
+}
+
+std::shared_ptr<const colour_map_lut>
+Colour_Map_LUT( const std::function<ClampedColourRGB(double)> &colour_map,
+                long int N_entries ){
+
+    // Only plain functions can be identified reliably, so other callables get a private table.
+    using colour_map_fn_t = ClampedColourRGB(*)(double);
+    const auto fn = colour_map.target<colour_map_fn_t>();
+    if( (fn == nullptr) || (*fn == nullptr) ){
+        return std::make_shared<const colour_map_lut>(colour_map, N_entries);
+    }
+
+    static std::mutex m;
+    static std::map<std::pair<colour_map_fn_t, long int>, std::shared_ptr<const colour_map_lut>> luts;
+
+    const auto key = std::make_pair(*fn, N_entries);
+    std::lock_guard<std::mutex> lock(m);
+    auto &lut = luts[key];
+    if(lut == nullptr){
+        lut = std::make_shared<const colour_map_lut>(colour_map, N_entries);
+    }
+    return lut;
+}
 
@@ -2,8 +2,13 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 
 struct ClampedColourRGB {
@@ -46,3 +51,63 @@ ClampedColourRGB ColourMap_Composite_50_90_100_107_110(double y);
 //This function takes a named colour and map it to a colour specified in terms of R,G,B all within [0,1].
 std::optional<ClampedColourRGB> Colour_from_name(const std::string& n);
 
+
+//Batch evaluation of colour maps.
+//
+// A colour map is sampled once into a table with a fixed number of entries and the table is linearly interpolated,
+// so whole rows of pixels can be mapped without evaluating the colour map for each pixel.
+
+// Describes how pixel values are mapped onto the colour map.
+struct colour_lut_window {
+    // Values in [low,high] are mapped linearly onto the colour map. If high <= low the window degenerates to a step at
+    // 'low', where values above 'low' are mapped to the top of the colour map and all others to the bottom.
+    double low  = 0.0;
+    double high = 1.0;
+
+    // Colour for NaNs and infinities.
+    std::array<uint8_t,4> nan_colour = {{ 0, 0, 0, 255 }};
+
+    // Colours for finite values outside [low,high]. If not provided, values are clamped to the nearest end of the map.
+    std::optional<std::array<uint8_t,4>> below_colour;
+    std::optional<std::array<uint8_t,4>> above_colour;
+};
+
+class colour_map_lut {
+  private:
+    // Separate channels, pre-scaled to [0,255].
+    std::vector<float> R;
+    std::vector<float> G;
+    std::vector<float> B;
+
+    template <long int C>
+    void map_packed( const float *in,
+                     long int N,
+                     long int in_stride,
+                     const colour_lut_window &window,
+                     uint8_t *out ) const;
+
+  public:
+    colour_map_lut( const std::function<ClampedColourRGB(double)> &colour_map,
+                    long int N_entries = 4096 );
+
+    long int size() const;
+
+    // Maps 'N' values read with the given stride into packed 8-bit RGB (3 bytes per value) or RGBA (4 bytes per value).
+    void map_rgb( const float *in,
+                  long int N,
+                  long int in_stride,
+                  const colour_lut_window &window,
+                  uint8_t *out_rgb ) const;
+
+    void map_rgba( const float *in,
+                   long int N,
+                   long int in_stride,
+                   const colour_lut_window &window,
+                   uint8_t *out_rgba ) const;
+};
+
+// Returns a table for the given colour map. Tables for the built-in colour map functions are built once and shared.
+std::shared_ptr<const colour_map_lut>
+Colour_Map_LUT( const std::function<ClampedColourRGB(double)> &colour_map,
+                long int N_entries = 4096 );
+
@@ -8,14 +8,19 @@
 #include <map>
 #include <cmath>
 #include <any>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 #ifdef DCMA_USE_CGAL
 #else
     #error "Attempted to compile without CGAL support, which is required."
 #endif
 
-//#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/Cartesian.h>
+#include <CGAL/Simple_cartesian.h>
 #include <CGAL/Polygon_2.h>
 #include <CGAL/Polygon_with_holes_2.h>
 #include <CGAL/Polygon_set_2.h>
@@ -27,6 +32,193 @@
 #include "Contour_Boolean_Operations.h"
 
 
+// Applies a Boolean operation in-place, i.e., L = f(L, R).
+template <class Polygon_set_2>
+static void Apply_Set_Operation(Polygon_set_2 &L,
+                                const Polygon_set_2 &R,
+                                ContourBooleanMethod op){
+    if(op == ContourBooleanMethod::noop){
+        //Intentionally do nothing here.
+    }else if(op == ContourBooleanMethod::join){
+        L.join(R);
+    }else if(op == ContourBooleanMethod::intersection){
+        L.intersection(R);
+    }else if(op == ContourBooleanMethod::difference){
+        L.difference(R);
+    }else if(op == ContourBooleanMethod::symmetric_difference){
+        L.symmetric_difference(R);
+    }else{
+        throw std::logic_error("Requested Boolean operation is not supported.");
+    }
+    return;
+}
+
+// Reduces the sets pairwise, in a balanced tree, using an associative operation.
+template <class Polygon_set_2>
+static Polygon_set_2 Reduce_Balanced(std::vector<Polygon_set_2> sets,
+                                     ContourBooleanMethod op){
+    if(sets.empty()) return Polygon_set_2();
+    while(1 < sets.size()){
+        std::vector<Polygon_set_2> next;
+        next.reserve(sets.size() / 2 + 1);
+        for(size_t i = 0; (i + 1) < sets.size(); i += 2){
+            Apply_Set_Operation(sets[i], sets[i + 1], op);
+            next.emplace_back(std::move(sets[i]));
+        }
+        if((sets.size() % 2) == 1) next.emplace_back(std::move(sets.back()));
+        sets.swap(next);
+    }
+    return std::move(sets.front());
+}
+
+
+template <class Kernel>
+static contour_collection<double>
+ContourBoolean_Using_Kernel(const std::function<vec3<double>(vec3<double>)> &R3_v_to_R2_P_basis,
+                            const std::function<vec3<double>(vec3<double>)> &R2_P_basis_to_R3_v,
+                            const std::list<std::reference_wrapper<contour_of_points<double>>> &A,
+                            const std::list<std::reference_wrapper<contour_of_points<double>>> &B,
+                            ContourBooleanMethod op,
+                            ContourBooleanMethod construction_op,
+                            const ContourBooleanOpts &opts){
+
+    using Point_2 = typename Kernel::Point_2;
+    using Polygon_2 = CGAL::Polygon_2<Kernel>;
+    using Polygon_with_holes_2 = CGAL::Polygon_with_holes_2<Kernel>;
+    using Polygon_set_2 = CGAL::Polygon_set_2<Kernel>;
+
+    // Extract the common metadata from all contours in both A and B sets. Store it for later.
+    std::list<std::reference_wrapper<contour_of_points<double>>> all;
+    all.insert(all.end(), A.begin(), A.end());
+    all.insert(all.end(), B.begin(), B.end());
+    auto common_metadata = contour_collection<double>().get_common_metadata( { }, { std::ref(all) } );
+
+    // Convert a contour into CGAL style by projecting onto the plane and expressing in the new basis.
+    const auto to_cgal = [&](const contour_of_points<double> &c) -> Polygon_2 {
+        //Express in the planar basis (with z'=0 everywhere).
+        contour_of_points<double> projected;
+        projected.closed = true;
+        for(const auto &v : c.points){
+            projected.points.emplace_back(R3_v_to_R2_P_basis(v));
+        }
+
+        //Ensure that the contour is counter-clockwise (as per the CGAL requirement for outer-boundary polygons).
+        if(!projected.Is_Counter_Clockwise()) projected.Reorient_Counter_Clockwise();
+
+        Polygon_2 poly;
+        for(const auto &v : projected.points){
+            poly.push_back(Point_2(v.x,v.y));
+        }
+
+        // Snap vertices to a regular grid, if requested, discarding vertices that collapse onto their predecessor.
+        const auto ds = opts.snap_spacing;
+        if( (0.0 < ds) && std::isfinite(ds) ){
+            Polygon_2 snapped;
+            for(const auto &v : projected.points){
+                const Point_2 s(std::round(v.x / ds) * ds, std::round(v.y / ds) * ds);
+                if( (snapped.size() != 0) && (*std::prev(snapped.vertices_end()) == s) ) continue;
+                snapped.push_back(s);
+            }
+            while( (2 < snapped.size()) && (*snapped.vertices_begin() == *std::prev(snapped.vertices_end())) ){
+                snapped.erase(std::prev(snapped.vertices_end()));
+            }
+            if( (2 < snapped.size())
+            &&  snapped.is_simple()
+            &&  snapped.is_counterclockwise_oriented() ){
+                poly = snapped;
+            }
+        }
+        return poly;
+    };
+
+    // Construct a set from the contours.
+    const auto build_set = [&](const std::list<std::reference_wrapper<contour_of_points<double>>> &cops) -> Polygon_set_2 {
+        if(!opts.balanced){
+            Polygon_set_2 out;
+            bool first_contour = true;
+            for(const auto &c_ref : cops){
+                const auto poly = to_cgal(c_ref.get());
+                if(first_contour){
+                    first_contour = false;
+                    out.join(poly);
+                }else{
+                    Apply_Set_Operation(out, Polygon_set_2(poly), construction_op);
+                }
+            }
+            return out;
+        }
+
+        std::vector<Polygon_set_2> sets;
+        sets.reserve(cops.size());
+        for(const auto &c_ref : cops){
+            sets.emplace_back(to_cgal(c_ref.get()));
+        }
+        if(sets.empty()) return Polygon_set_2();
+
+        // As with incremental construction, the first contour passes through and the rest are ignored.
+        if(construction_op == ContourBooleanMethod::noop) return std::move(sets.front());
+
+        if( (construction_op == ContourBooleanMethod::join)
+        ||  (construction_op == ContourBooleanMethod::intersection)
+        ||  (construction_op == ContourBooleanMethod::symmetric_difference) ){
+            return Reduce_Balanced(std::move(sets), construction_op);
+
+        }else if(construction_op == ContourBooleanMethod::difference){
+            // Successive differences remove the union of all subsequent contours from the first.
+            Polygon_set_2 out = std::move(sets.front());
+            sets.erase(sets.begin());
+            if(!sets.empty()){
+                out.difference( Reduce_Balanced(std::move(sets), ContourBooleanMethod::join) );
+            }
+            return out;
+        }
+        throw std::logic_error("Requested Boolean operation is not supported.");
+    };
+
+    const auto A_set = build_set(A);
+    const auto B_set = build_set(B);
+
+    // Perform the selected Boolean operation.
+    Polygon_set_2 C_set;
+    C_set.join(A_set);
+    Apply_Set_Operation(C_set, B_set, op);
+
+    // Convert each contour back to the DICOMautomaton coordinate system using the orthonormal basis.
+    contour_collection<double> out;
+    if(C_set.number_of_polygons_with_holes() != 0){
+        std::list<Polygon_with_holes_2> pwhl;
+        C_set.polygons_with_holes(std::back_inserter(pwhl));
+
+        for(auto &pwh : pwhl){
+            //If necessary, remove polygon holes by 'seaming' the contours.
+            // Otherwise there are no holes to seam.
+            //
+            // Note: The following connect_holes routine fails with CGAL 4.10-1 (Arch Linux)
+            //       when using CGAL::Exact_predicates_inexact_constructions_kernel. Beware if you add kernels.
+            std::list<Point_2> p2l;
+            connect_holes(pwh,std::back_inserter(p2l));
+
+            if(p2l.empty()) continue;
+            out.contours.emplace_back();
+            for(auto &p2 : p2l){
+                const vec3<double> proj(CGAL::to_double(p2.x()), CGAL::to_double(p2.y()), 0.0);
+                const auto v = R2_P_basis_to_R3_v(proj);
+                out.contours.back().points.emplace_back(v);
+            }
+            //The outer boundary of all CGAL contours with holes are oriented clockwise.
+            // Flip them around as per normal positive orientation in DICOMautomaton.
+            out.contours.back().points.reverse();
+
+            //Attach the common metadata.
+            out.contours.back().closed = true;
+            out.contours.back().metadata = common_metadata;
+        }
+    }
+
+    return out;
+}
+
+
 // Because ROI contours are 2D planar contours embedded in R^3, an explicit projection plane must be provided. Contours
 // are projected on the plane, an orthonormal basis is created, the projected contours are expressed in the basis, and
 // the Boolean operations are performed. Note that the outgoing contours remain projected onto the provided plane.
@@ -48,12 +240,15 @@
 // Note: The number of contours this routine can potentially return are [0,inf] depending on the operation and inputs --
 //       even when holes are converted to seams.
 //
+// Note: This routine does not modify shared state, so it can be invoked concurrently for different planes.
+//
 contour_collection<double>
 ContourBoolean(plane<double> p,
                std::list<std::reference_wrapper<contour_of_points<double>>> A,
                std::list<std::reference_wrapper<contour_of_points<double>>> B,
                ContourBooleanMethod op,
-               ContourBooleanMethod construction_op){
+               ContourBooleanMethod construction_op,
+               const ContourBooleanOpts &opts){
 
     // Identify an orthonormal set that spans the 2D plane. Store them for later projection.
     const auto pi = std::acos(-1.0);
@@ -95,142 +290,12 @@ ContourBoolean(plane<double> p,
         return actual;
     };
 
-    // Extract the common metadata from all contours in both A and B sets. Store it for later.
-    std::list<std::reference_wrapper<contour_of_points<double>>> all;
-    all.insert(all.end(), A.begin(), A.end());
-    all.insert(all.end(), B.begin(), B.end());
-    auto common_metadata = contour_collection<double>().get_common_metadata( { }, { std::ref(all) } );
-
-
-    using Kernel = CGAL::Simple_cartesian<double>;
-    using Point_2 = Kernel::Point_2;
-    using Polygon_2 = CGAL::Polygon_2<Kernel>;
-    using Polygon_with_holes_2 = CGAL::Polygon_with_holes_2<Kernel>;
-    using Polygon_set_2 = CGAL::Polygon_set_2<Kernel>;
-
-    bool first_contour;
-
-    // Convert the A set of contours into CGAL style by projecting onto the plane and expressing in the new basis.
-    Polygon_set_2 A_set;
-    first_contour = true;
-    for(auto &c_ref : A){
-        //Express in the planar basis (with z'=0 everywhere).
-        contour_of_points<double> projected;
-        projected.closed = true;
-        for(auto &v : c_ref.get().points){
-            projected.points.emplace_back(R3_v_to_R2_P_basis(v));
-        }
-
-        //Ensure that the contour is counter-clockwise (as per the CGAL requirement for outer-boundary polygons).
-        if(!projected.Is_Counter_Clockwise()) projected.Reorient_Counter_Clockwise();
-
-        //Insert in the CGAL polygon set.
-        Polygon_2 A_cgal;
-        for(auto &v : projected.points){
-            A_cgal.push_back(Point_2(v.x,v.y));
-        }
-        if(first_contour){
-            first_contour = false;
-            A_set.join(A_cgal);
-        }else if(construction_op == ContourBooleanMethod::join){
-            A_set.join(A_cgal);
-        }else if(construction_op == ContourBooleanMethod::intersection){
-            A_set.intersection(A_cgal);
-        }else if(construction_op == ContourBooleanMethod::difference){
-            A_set.difference(A_cgal);
-        }else if(construction_op == ContourBooleanMethod::symmetric_difference){
-            A_set.symmetric_difference(A_cgal);
-        }else{
-            throw std::logic_error("Requested Boolean operation is not supported.");
-        }
-    }
-
-    // Convert the B set of contours into CGAL style by projecting onto the plane and expressing in the new basis.
-    Polygon_set_2 B_set;
-    first_contour = true;
-    for(auto &c_ref : B){
-        //Express in the planar basis (with z'=0 everywhere).
-        contour_of_points<double> projected;
-        projected.closed = true;
-        for(auto &v : c_ref.get().points){
-            projected.points.emplace_back(R3_v_to_R2_P_basis(v));
-        }
-
-        //Ensure that the contour is counter-clockwise (as per the CGAL requirement for outer-boundary polygons).
-        if(!projected.Is_Counter_Clockwise()) projected.Reorient_Counter_Clockwise();
-
-        //Insert in the CGAL polygon set.
-        Polygon_2 B_cgal;
-        for(auto &v : projected.points){
-            B_cgal.push_back(Point_2(v.x,v.y));
-        }
-        if(first_contour){
-            first_contour = false;
-            B_set.join(B_cgal);
-        }else if(construction_op == ContourBooleanMethod::join){
-            B_set.join(B_cgal);
-        }else if(construction_op == ContourBooleanMethod::intersection){
-            B_set.intersection(B_cgal);
-        }else if(construction_op == ContourBooleanMethod::difference){
-            B_set.difference(B_cgal);
-        }else if(construction_op == ContourBooleanMethod::symmetric_difference){
-            B_set.symmetric_difference(B_cgal);
-        }else{
-            throw std::logic_error("Requested Boolean operation is not supported.");
-        }
-    }
-
-
-    // Perform the selected Boolean operation.
-    Polygon_set_2 C_set;
-    C_set.join(A_set);
-    if(op == ContourBooleanMethod::noop){
-        //Intentionally do nothing here.
-    }else if(op == ContourBooleanMethod::join){
-        C_set.join(B_set);
-    }else if(op == ContourBooleanMethod::intersection){
-        C_set.intersection(B_set);
-    }else if(op == ContourBooleanMethod::difference){
-        C_set.difference(B_set);
-    }else if(op == ContourBooleanMethod::symmetric_difference){
-        C_set.symmetric_difference(B_set);
-    }else{
-        throw std::logic_error("Requested Boolean operation is not supported.");
-    }
-
-    // Convert each contour back to the DICOMautomaton coordinate system using the orthonormal basis.
-    contour_collection<double> out;
-    if(C_set.number_of_polygons_with_holes() != 0){
-        std::list<Polygon_with_holes_2> pwhl;
-        C_set.polygons_with_holes(std::back_inserter(pwhl));
-
-        for(auto &pwh : pwhl){
-            //If necessary, remove polygon holes by 'seaming' the contours.
-            // Otherwise there are no holes to seam.
-            //
-            // Note: The following connect_holes routine fails with CGAL 4.10-1 (Arch Linux)
-            //       when using CGAL::Exact_predicates_inexact_constructions_kernel. Beware if you switch kernels.
-            std::list<Point_2> p2l;
-            connect_holes(pwh,std::back_inserter(p2l));
-
-            if(p2l.empty()) continue;
-            out.contours.emplace_back();
-            for(auto &p2 : p2l){
-                const vec3<double> proj(p2.x(), p2.y(), 0.0);
-                const auto v = R2_P_basis_to_R3_v(proj);
-                out.contours.back().points.emplace_back(v);
-            }
-            //The outer boundary of all CGAL contours with holes are oriented clockwise.
-            // Flip them around as per normal positive orientation in DICOMautomaton.
-            out.contours.back().points.reverse();
-
-            //Attach the common metadata.
-            out.contours.back().closed = true;
-            out.contours.back().metadata = common_metadata;
-        }
+    if(opts.kernel == ContourBooleanKernel::exact){
+        return ContourBoolean_Using_Kernel<CGAL::Exact_predicates_exact_constructions_kernel>(
+                   R3_v_to_R2_P_basis, R2_P_basis_to_R3_v, A, B, op, construction_op, opts );
     }
-
-    return out;
+    return ContourBoolean_Using_Kernel<CGAL::Simple_cartesian<double>>(
+               R3_v_to_R2_P_basis, R2_P_basis_to_R3_v, A, B, op, construction_op, opts );
 }               
 
 
@@ -20,6 +20,27 @@ typedef enum {
 } ContourBooleanMethod;
 
 
+// Arithmetic used for the Boolean operations.
+enum class ContourBooleanKernel {
+    inexact,  // CGAL::Simple_cartesian<double>. Fast, but may fail or misbehave for degenerate inputs.
+    exact,    // Exact predicates and exact constructions. Robust, but slower.
+};
+
+struct ContourBooleanOpts {
+    ContourBooleanKernel kernel = ContourBooleanKernel::inexact;
+
+    // Vertices are snapped to a square grid with this spacing (in the plane's basis; DICOM units) before the operation.
+    // Snapping merges nearly-coincident vertices and edges, which otherwise cause the inexact kernel to struggle.
+    // Contours that would become degenerate or self-intersecting after snapping are used unsnapped.
+    // Zero disables snapping.
+    double snap_spacing = 0.0;
+
+    // Whether to build the A and B sets with a balanced tree of pairwise set operations instead of incrementally
+    // adding one contour at a time. Both produce the same sets, but the balanced tree avoids repeatedly operating on an
+    // ever-growing set, which is much faster for many contours.
+    bool balanced = true;
+};
+
 // Because ROI contours are 2D planar contours embedded in R^3, an explicit projection plane must be provided. Contours
 // are projected on the plane, an orthonormal basis is created, the projected contours are expressed in the basis, and
 // the Boolean operations are performed. Note that the outgoing contours remain projected onto the provided plane.
@@ -51,6 +72,7 @@ ContourBoolean(plane<double> p,
                std::list<std::reference_wrapper<contour_of_points<double>>> A,
                std::list<std::reference_wrapper<contour_of_points<double>>> B,
                ContourBooleanMethod op,
-               ContourBooleanMethod construction_op = ContourBooleanMethod::join);
+               ContourBooleanMethod construction_op = ContourBooleanMethod::join,
+               const ContourBooleanOpts &opts = ContourBooleanOpts());
 
 
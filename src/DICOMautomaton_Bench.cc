@@ -0,0 +1,564 @@
+//DICOMautomaton_Bench.cc - A part of DICOMautomaton 2020. Written by hal clark.
+//
+// This program times a selection of computationally-intensive routines using synthetic inputs of configurable size.
+// Results are emitted as JSON so that runs from different commits can be compared to catch performance regressions.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>            //Needed for exit() calls.
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <numeric>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>            //Needed for std::pair.
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "YgorArguments.h"    //Needed for ArgumentHandler class.
+#include "YgorFilesDirs.h"    //Needed for Does_File_Exist_And_Can_Be_Read(...), etc..
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+
+#include "Structs.h"
+#include "Regex_Selectors.h"
+#include "File_Loader.h"
+#include "Operation_Dispatcher.h"
+
+
+// Parameters shared by all benchmarks.
+struct bench_params {
+    long int size = 32;          // Rows, columns, and number of images for scalable image inputs.
+    long int tps_size = 8;       // Rows and columns of the images used to derive TPS-RPM point clouds.
+    boost::filesystem::path work_dir;
+    std::string FilenameLex;
+};
+
+// A single benchmark. The setup stage is not timed; it prepares the Drover that the timed stage operates on. Both
+// stages are performed afresh for every repetition so that the timed stage always sees identical inputs.
+struct bench_case {
+    std::string name;
+    std::string desc;
+    std::map<std::string, std::string> params;
+
+    std::list<OperationArgPkg> setup;
+    std::list<OperationArgPkg> timed;
+
+    // If provided, replaces the timed operations.
+    std::function<bool(Drover &, const bench_params &)> timed_func;
+};
+
+struct bench_result {
+    std::string status; // "ok", "failed", or "skipped".
+    std::vector<double> samples; // Wall time in seconds for each timed repetition.
+};
+
+
+static OperationArgPkg
+Make_Op(const std::string &name,
+        const std::list<std::pair<std::string, std::string>> &args){
+    OperationArgPkg op(name);
+    for(const auto &a : args){
+        if(!op.insert(a.first, a.second)){
+            throw std::invalid_argument(std::string("Duplicate argument '") + a.first + "' for operation '" + name + "'");
+        }
+    }
+    return op;
+}
+
+static OperationArgPkg
+Make_Synthetic_Images(long int rows,
+                      long int cols,
+                      long int imgs,
+                      const std::string &voxel_val,
+                      const std::string &stiple_val,
+                      const std::string &metadata = ""){
+    auto op = Make_Op("GenerateSyntheticImages", { { "NumberOfImages",  std::to_string(imgs) },
+                                                   { "NumberOfRows",    std::to_string(rows) },
+                                                   { "NumberOfColumns", std::to_string(cols) },
+                                                   { "VoxelValue",      voxel_val },
+                                                   { "StipleValue",     stiple_val } });
+    if(!metadata.empty()) op.insert("Metadata", metadata);
+    return op;
+}
+
+static std::list<bench_case>
+Build_Bench_Cases(const bench_params &bp){
+    std::list<bench_case> out;
+    const auto N = bp.size;
+    const auto N_str = std::to_string(N);
+    const std::map<std::string, std::string> scaled_params = { { "rows", N_str },
+                                                               { "columns", N_str },
+                                                               { "images", N_str } };
+
+    // Generators.
+    out.emplace_back();
+    out.back().name = "generate_synthetic";
+    out.back().desc = "Generate a stipled synthetic image array.";
+    out.back().params = scaled_params;
+    out.back().timed.emplace_back( Make_Synthetic_Images(N, N, N, "0.0", "1.0") );
+
+    out.emplace_back();
+    out.back().name = "generate_sphere";
+    out.back().desc = "Generate the (fixed-size) virtual sphere image array.";
+    out.back().timed.emplace_back( Make_Op("GenerateVirtualDataImageSphereV1", {}) );
+
+    out.emplace_back();
+    out.back().name = "generate_perfusion";
+    out.back().desc = "Generate the (fixed-size) virtual perfusion time series and contours.";
+    out.back().timed.emplace_back( Make_Op("GenerateVirtualDataPerfusionV1", {}) );
+
+    // Loading.
+    {
+        const auto archive = (bp.work_dir / "load_archive.xml.gz").string();
+        out.emplace_back();
+        out.back().name = "load_archive";
+        out.back().desc = "Load a serialized archive containing a synthetic image array.";
+        out.back().params = scaled_params;
+        out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "0.0", "1.0") );
+        out.back().setup.emplace_back( Make_Op("BoostSerializeDrover", { { "Filename", archive },
+                                                                        { "Components", "images" } }) );
+        out.back().timed_func = [archive](Drover &DICOM_data, const bench_params &bp) -> bool {
+            Drover loaded;
+            std::map<std::string, std::string> InvocationMetadata;
+            std::list<boost::filesystem::path> Paths = { archive };
+            const bool ok = Load_Files(loaded, InvocationMetadata, bp.FilenameLex, Paths);
+            DICOM_data = loaded;
+            return ok;
+        };
+    }
+
+    // Marching cubes.
+    out.emplace_back();
+    out.back().name = "marching_cubes";
+    out.back().desc = "Extract a surface mesh from the virtual sphere image array.";
+    out.back().setup.emplace_back( Make_Op("GenerateVirtualDataImageSphereV1", {}) );
+    out.back().timed.emplace_back( Make_Op("ConvertImageToMeshes", { { "Lower", "0.5" },
+                                                                    { "Method", "marching" } }) );
+
+    // Gamma index.
+    out.emplace_back();
+    out.back().name = "gamma";
+    out.back().desc = "Compare two stipled synthetic image arrays using the gamma index.";
+    out.back().params = scaled_params;
+    out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "1.0", "2.0") );
+    out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "2.0", "1.0") );
+    out.back().setup.emplace_back( Make_Op("ContourWholeImages", { { "ROILabel", "everything" } }) );
+    out.back().timed.emplace_back( Make_Op("ComparePixels", { { "ImageSelection", "first" },
+                                                             { "ReferenceImageSelection", "last" },
+                                                             { "Method", "gamma-index" },
+                                                             { "DTAMax", "5.0" } }) );
+
+    // Neighbourhood reduction.
+    out.emplace_back();
+    out.back().name = "reduce_neighbourhood";
+    out.back().desc = "Apply a spherical median filter to a stipled synthetic image array.";
+    out.back().params = scaled_params;
+    out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "0.0", "1.0") );
+    out.back().setup.emplace_back( Make_Op("ContourWholeImages", { { "ROILabel", "everything" } }) );
+    out.back().timed.emplace_back( Make_Op("ReduceNeighbourhood", { { "Neighbourhood", "spherical" },
+                                                                   { "Reduction", "median" },
+                                                                   { "MaxDistance", "2.0" } }) );
+
+    // Dose-volume histograms.
+    out.emplace_back();
+    out.back().name = "dvh";
+    out.back().desc = "Extract a dose-volume histogram from a stipled synthetic dose array.";
+    out.back().params = scaled_params;
+    out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "1.0", "2.0", "Modality@RTDOSE") );
+    out.back().setup.emplace_back( Make_Op("ContourWholeImages", { { "ROILabel", "everything" } }) );
+    out.back().timed.emplace_back( Make_Op("ExtractImageHistograms", { { "dDose", "0.01" } }) );
+
+    out.emplace_back();
+    out.back().name = "dvh_perfusion";
+    out.back().desc = "Extract histograms for the contours of the (fixed-size) virtual perfusion data.";
+    out.back().setup.emplace_back( Make_Op("GenerateVirtualDataPerfusionV1", {}) );
+    out.back().timed.emplace_back( Make_Op("ExtractImageHistograms", { { "ImageSelection", "all" },
+                                                                      { "ROILabelRegex", "Body" } }) );
+
+    // Ray casting.
+    out.emplace_back();
+    out.back().name = "ray_casting";
+    out.back().desc = "Accumulate dose along rays cast through a synthetic dose array.";
+    out.back().params = scaled_params;
+    out.back().params["grid"] = N_str;
+    out.back().setup.emplace_back( Make_Synthetic_Images(N, N, N, "1.0", "2.0", "Modality@RTDOSE") );
+    out.back().setup.emplace_back( Make_Op("ContourWholeImages", { { "ROILabel", "everything" } }) );
+    out.back().timed.emplace_back( Make_Op("GridBasedRayCastDoseAccumulate",
+                                           { { "DoseMapFileName", (bp.work_dir / "ray_dose.fits").string() },
+                                             { "DoseLengthMapFileName", (bp.work_dir / "ray_doselength.fits").string() },
+                                             { "LengthMapFileName", (bp.work_dir / "ray_length.fits").string() },
+                                             { "GridRows", N_str },
+                                             { "GridColumns", N_str },
+                                             { "SourceDetectorRows", N_str },
+                                             { "SourceDetectorColumns", N_str } }) );
+
+    // Deformable point registration.
+    {
+        const auto M = bp.tps_size;
+        const auto M_str = std::to_string(M);
+        out.emplace_back();
+        out.back().name = "tps_rpm";
+        out.back().desc = "Register two point clouds derived from stipled synthetic images using TPS-RPM.";
+        out.back().params = { { "rows", M_str },
+                              { "columns", M_str },
+                              { "images", "2" } };
+        out.back().setup.emplace_back( Make_Synthetic_Images(M, M, 2, "0.0", "1.0") );
+        out.back().setup.emplace_back( Make_Op("ConvertPixelsToPoints", { { "Label", "moving" },
+                                                                         { "Lower", "0.5" } }) );
+        out.back().setup.emplace_back( Make_Op("GenerateSyntheticImages", { { "NumberOfImages", "2" },
+                                                                           { "NumberOfRows", M_str },
+                                                                           { "NumberOfColumns", M_str },
+                                                                           { "ImagePosition", "0.3, 0.2, 0.1" },
+                                                                           { "VoxelValue", "0.0" },
+                                                                           { "StipleValue", "1.0" } }) );
+        out.back().setup.emplace_back( Make_Op("ConvertPixelsToPoints", { { "Label", "stationary" },
+                                                                         { "Lower", "0.5" } }) );
+        out.back().timed.emplace_back( Make_Op("ExtractPointsWarp", { { "MovingPointSelection", "first" },
+                                                                     { "ReferencePointSelection", "last" },
+                                                                     { "Method", "TPS-RPM" } }) );
+    }
+
+    return out;
+}
+
+
+static std::string
+JSON_Escape(const std::string &in){
+    std::stringstream ss;
+    for(const auto c : in){
+        switch(c){
+            case '"':  ss << "\\\""; break;
+            case '\\': ss << "\\\\"; break;
+            case '\n': ss << "\\n"; break;
+            case '\r': ss << "\\r"; break;
+            case '\t': ss << "\\t"; break;
+            default:
+                if(static_cast<unsigned char>(c) < 0x20){
+                    ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                       << std::dec << std::setfill(' ');
+                }else{
+                    ss << c;
+                }
+                break;
+        }
+    }
+    return ss.str();
+}
+
+static void
+Emit_JSON(std::ostream &os,
+          const std::string &label,
+          const bench_params &bp,
+          long int warmup,
+          long int repetitions,
+          const std::list<std::pair<bench_case, bench_result>> &results){
+
+    const auto original_precision = os.precision();
+    os.precision(9);
+
+    const auto now = std::time(nullptr);
+    char timestamp[32] = { 0 };
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    os << "{\n";
+    os << "  \"program\": \"dcma_bench\",\n";
+    os << "  \"label\": \"" << JSON_Escape(label) << "\",\n";
+    os << "  \"timestamp\": \"" << timestamp << "\",\n";
+    os << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    os << "  \"size\": " << bp.size << ",\n";
+    os << "  \"tps_size\": " << bp.tps_size << ",\n";
+    os << "  \"warmup\": " << warmup << ",\n";
+    os << "  \"repetitions\": " << repetitions << ",\n";
+    os << "  \"benchmarks\": [";
+
+    bool first_result = true;
+    for(const auto &p : results){
+        const auto &bc = p.first;
+        const auto &br = p.second;
+
+        os << (first_result ? "\n" : ",\n");
+        first_result = false;
+
+        os << "    {\n";
+        os << "      \"name\": \"" << JSON_Escape(bc.name) << "\",\n";
+        os << "      \"description\": \"" << JSON_Escape(bc.desc) << "\",\n";
+        os << "      \"status\": \"" << br.status << "\",\n";
+
+        os << "      \"params\": {";
+        bool first_param = true;
+        for(const auto &kv : bc.params){
+            os << (first_param ? " " : ", ") << "\"" << JSON_Escape(kv.first) << "\": \"" << JSON_Escape(kv.second) << "\"";
+            first_param = false;
+        }
+        os << (first_param ? "},\n" : " },\n");
+
+        os << "      \"samples_s\": [";
+        for(size_t i = 0; i < br.samples.size(); ++i){
+            os << ((i == 0) ? " " : ", ") << br.samples[i];
+        }
+        os << (br.samples.empty() ? "]" : " ]");
+
+        if(!br.samples.empty()){
+            auto sorted = br.samples;
+            std::sort(std::begin(sorted), std::end(sorted));
+            const auto n = sorted.size();
+            const auto median = (n % 2 == 1) ? sorted[n / 2]
+                                             : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+            const auto mean = std::accumulate(std::begin(sorted), std::end(sorted), 0.0) / static_cast<double>(n);
+            os << ",\n";
+            os << "      \"min_s\": " << sorted.front() << ",\n";
+            os << "      \"median_s\": " << median << ",\n";
+            os << "      \"mean_s\": " << mean << ",\n";
+            os << "      \"max_s\": " << sorted.back();
+        }
+        os << "\n    }";
+    }
+    os << (first_result ? "]\n" : "\n  ]\n");
+    os << "}" << std::endl;
+
+    os.precision(original_precision);
+    return;
+}
+
+
+int main(int argc, char* argv[]){
+
+    bench_params bp;
+    long int warmup = 1;
+    long int repetitions = 5;
+    std::string filter = ".*";
+    std::string label;
+    std::string out_filename = "dcma_bench.json";
+    bool list_only = false;
+
+    //================================================ Argument Parsing ==============================================
+
+    class ArgumentHandler arger;
+    arger.examples = { { "--help",
+                         "Show the help screen and some info about the program." },
+                       { "-s 64 -r 10 -o bench.json",
+                         "Run all benchmarks using 64x64x64 inputs, time ten repetitions of each, and write"
+                         " the results to 'bench.json'." },
+                       { "-b 'gamma|dvh.*' -L $(git rev-parse --short HEAD)",
+                         "Run only the gamma and DVH benchmarks, labelling the results with the current commit." }
+                     };
+    arger.description = "A program for timing DICOMautomaton routines using synthetic data.";
+
+    arger.default_callback = [](int, const std::string &optarg) -> void {
+      FUNCERR("Unrecognized option with argument: '" << optarg << "'");
+      return;
+    };
+    arger.optionless_callback = [&](const std::string &optarg) -> void {
+      FUNCERR("Unrecognized option: '" << optarg << "'");
+      return;
+    };
+
+    arger.push_back( ygor_arg_handlr_t(100, 'l', "lexicon", true, "<best guess>",
+      "Lexicon file for normalizing ROI contour names.",
+      [&](const std::string &optarg) -> void {
+        bp.FilenameLex = optarg;
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(200, 's', "size", true, std::to_string(bp.size),
+      "The number of rows, columns, and images used for scalable synthetic inputs.",
+      [&](const std::string &optarg) -> void {
+        bp.size = std::stol(optarg);
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(200, 't', "tps-size", true, std::to_string(bp.tps_size),
+      "The number of rows and columns of the synthetic images used to derive TPS-RPM point clouds."
+      " Point clouds contain size*size points, and TPS-RPM scales poorly, so keep this small.",
+      [&](const std::string &optarg) -> void {
+        bp.tps_size = std::stol(optarg);
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(300, 'w', "warmup", true, std::to_string(warmup),
+      "The number of untimed repetitions to perform before timing each benchmark.",
+      [&](const std::string &optarg) -> void {
+        warmup = std::stol(optarg);
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(300, 'r', "repetitions", true, std::to_string(repetitions),
+      "The number of timed repetitions to perform for each benchmark.",
+      [&](const std::string &optarg) -> void {
+        repetitions = std::stol(optarg);
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(400, 'b', "benchmarks", true, filter,
+      "A regular expression selecting which benchmarks to run by name.",
+      [&](const std::string &optarg) -> void {
+        filter = optarg;
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(400, 'n', "list", false, "",
+      "List the available benchmarks and quit.",
+      [&](const std::string &) -> void {
+        list_only = true;
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(500, 'L', "label", true, "abc1234",
+      "A free-form label (e.g., a commit hash) to embed in the results.",
+      [&](const std::string &optarg) -> void {
+        label = optarg;
+        return;
+      })
+    );
+
+    arger.push_back( ygor_arg_handlr_t(500, 'o', "output", true, out_filename,
+      "The file to which JSON results are written. Use '-' for stdout, in which case logging (which is normally"
+      " written to stdout) is diverted to stderr so that stdout contains only JSON.",
+      [&](const std::string &optarg) -> void {
+        out_filename = optarg;
+        return;
+      })
+    );
+
+    arger.Launch(argc, argv);
+
+    // Logging is written to stdout, so it is diverted to stderr when results are written to stdout.
+    std::ostream stdout_os(std::cout.rdbuf());
+    if(out_filename == "-") std::cout.rdbuf(std::cerr.rdbuf());
+
+    //============================================== Input Verification ==============================================
+
+    if( (bp.size < 1) || (bp.tps_size < 1) ){
+        FUNCERR("Input sizes must be positive");
+    }
+    if( (warmup < 0) || (repetitions < 1) ){
+        FUNCERR("At least one timed repetition is needed, and warmup cannot be negative");
+    }
+
+    //Try find a lexicon file if none were provided.
+    if(bp.FilenameLex.empty()){
+        std::list<std::string> trial = {
+                "20201007_standard_sites.lexicon",
+                "Lexicons/20201007_standard_sites.lexicon",
+                "/usr/share/explicator/lexicons/20201007_standard_sites.lexicon",
+                "20191212_SGF_and_SGFQ_tags.lexicon",
+                "Lexicons/20191212_SGF_and_SGFQ_tags.lexicon",
+                "/usr/share/explicator/lexicons/20191212_SGF_and_SGFQ_tags.lexicon" };
+        for(const auto & f : trial) if(Does_File_Exist_And_Can_Be_Read(f)){
+            bp.FilenameLex = boost::filesystem::canonical(f).string();
+            FUNCINFO("No lexicon was explicitly provided. Using file '" << bp.FilenameLex << "' as lexicon");
+            break;
+        }
+    }
+    if(bp.FilenameLex.empty()) FUNCERR("Lexicon not located. Please provide one or see program help for more info");
+
+    // Operations are run from within a scratch directory so that any incidental files are contained and removed.
+    const auto orig_dir = boost::filesystem::current_path();
+    bp.work_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("dcma_bench_%%%%-%%%%-%%%%");
+    boost::filesystem::create_directories(bp.work_dir);
+
+    const auto filter_regex = Compile_Regex(filter);
+    auto cases = Build_Bench_Cases(bp);
+    cases.remove_if([&](const bench_case &bc) -> bool {
+        return !std::regex_search(bc.name, filter_regex);
+    });
+
+    if(list_only){
+        for(const auto &bc : cases) stdout_os << bc.name << "\t" << bc.desc << std::endl;
+        boost::filesystem::remove_all(bp.work_dir);
+        return 0;
+    }
+
+    //=============================================== Benchmarking ===================================================
+
+    const auto known_ops = Known_Operations();
+    std::map<std::string, std::string> InvocationMetadata;
+    InvocationMetadata["Invocation"] = "dcma_bench";
+
+    std::list<std::pair<bench_case, bench_result>> results;
+    boost::filesystem::current_path(bp.work_dir);
+    for(const auto &bc : cases){
+        results.emplace_back(bc, bench_result());
+        auto &br = results.back().second;
+        br.status = "ok";
+
+        // Operations can be conditionally compiled, so skip benchmarks that cannot be performed.
+        std::list<OperationArgPkg> all_ops = bc.setup;
+        all_ops.insert(std::end(all_ops), std::begin(bc.timed), std::end(bc.timed));
+        for(const auto &op : all_ops){
+            if(known_ops.count(op.getName()) == 0){
+                FUNCWARN("Operation '" << op.getName() << "' is not available. Skipping benchmark '" << bc.name << "'");
+                br.status = "skipped";
+                break;
+            }
+        }
+        if(br.status != "ok") continue;
+
+        FUNCINFO("Running benchmark '" << bc.name << "'");
+        for(long int i = 0; i < (warmup + repetitions); ++i){
+            bool ok = true;
+            double elapsed = 0.0;
+            try{
+                Drover DICOM_data;
+                ok = bc.setup.empty()
+                  || Operation_Dispatcher(DICOM_data, InvocationMetadata, bp.FilenameLex, bc.setup);
+
+                if(ok){
+                    const auto t_start = std::chrono::steady_clock::now();
+                    ok = (bc.timed_func) ? bc.timed_func(DICOM_data, bp)
+                                         : Operation_Dispatcher(DICOM_data, InvocationMetadata, bp.FilenameLex, bc.timed);
+                    const auto t_stop = std::chrono::steady_clock::now();
+                    elapsed = std::chrono::duration<double>(t_stop - t_start).count();
+                }
+            }catch(const std::exception &e){
+                FUNCWARN("Benchmark '" << bc.name << "' threw: " << e.what());
+                ok = false;
+            }
+
+            if(!ok){
+                FUNCWARN("Benchmark '" << bc.name << "' failed");
+                br.status = "failed";
+                br.samples.clear();
+                break;
+            }
+            if(warmup <= i) br.samples.push_back(elapsed);
+        }
+    }
+    boost::filesystem::current_path(orig_dir);
+    boost::filesystem::remove_all(bp.work_dir);
+
+    //================================================= Reporting ====================================================
+
+    if(out_filename == "-"){
+        Emit_JSON(stdout_os, label, bp, warmup, repetitions, results);
+        stdout_os.flush();
+    }else{
+        std::ofstream FO(out_filename);
+        Emit_JSON(FO, label, bp, warmup, repetitions, results);
+        FO.flush();
+        if(!FO) FUNCERR("Unable to write results to '" << out_filename << "'");
+    }
+
+    const bool all_ok = std::all_of(std::begin(results), std::end(results),
+                                    [](const std::pair<bench_case, bench_result> &p) -> bool {
+                                        return (p.second.status != "failed");
+                                    });
+    return (all_ok) ? 0 : 1;
+}
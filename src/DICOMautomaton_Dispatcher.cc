@@ -27,6 +27,7 @@
 #include "Documentation.h"
 #include "PACS_Loader.h"
 #include "File_Loader.h"
+#include "Memory_Budget.h"
 //#include "Boost_Serialization_File_Loader.h"
 //#include "DICOM_File_Loader.h"
 //#include "FITS_File_Loader.h"
@@ -190,6 +191,21 @@ int main(int argc, char* argv[]){
       })
     );
 
+    arger.push_back( ygor_arg_handlr_t(240, 'b', "memory-budget", true, "48G",
+      "Bound the memory held by image arrays and surface meshes between operations. When the budget is"
+      " exceeded, the least-recently-used objects are spilled to a scratch file in the temporary"
+      " directory and reloaded when an operation needs them. Sizes can use K, M, G, or T suffixes"
+      " (powers of 1024). The default is unbounded.",
+      [&](const std::string &optarg) -> void {
+        try{
+            Set_Memory_Budget( Parse_Memory_Size(optarg) );
+        }catch(const std::exception &){
+            FUNCERR("Memory budget not understood: '" << optarg << "'");
+        }
+        return;
+      })
+    );
+
     arger.push_back( ygor_arg_handlr_t(300, 'm', "metadata", true, "'Volunteer=01'",
       "Metadata key-value pairs which are tacked onto results destined for a database. "
       "If there is an conflicting key-value pair, the values are concatenated.",
@@ -30,13 +30,16 @@
 #include <Wt/WWidget.h>
 #include <Wt/WAnimation.h>
 #include <Wt/WComboBox.h>
+#include <Wt/WServer.h>
 
 #include <boost/filesystem.hpp>
 
 #include <algorithm>
+#include <array>
 //#include <cfenv>              //Needed for std::feclearexcept(FE_ALL_EXCEPT).
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <ctime>
 #include <exception>
 #include <fstream>
@@ -47,6 +50,7 @@
 #include <memory>
 #include <regex>
 #include <set> 
+#include <sstream>
 #include <stdexcept>
 #include <string>    
 #include <type_traits>
@@ -57,6 +61,8 @@
 #include "DICOM_File_Loader.h"
 #include "FITS_File_Loader.h"
 #include "XYZ_File_Loader.h"
+#include "Job_Queue.h"
+#include "Memory_Budget.h"
 #include "Operation_Dispatcher.h"
 #include "Structs.h"
 #include "Regex_Selectors.h"
@@ -177,10 +183,124 @@ std::string HumanToCamel(std::string in){
     return in;
 }
 
+// ------------------------------ Server-wide job management ------------------------------
+
+// All sessions share a single job queue so that the number of concurrently-running operations can be bounded
+// irrespective of the number of clients. The bound can be adjusted via the DCMA_WEBSERVER_MAX_JOBS environment variable.
+static
+job_queue & Get_Job_Queue(){
+    static job_queue q( [](){
+        size_t n = 0;
+        if(const char *e = std::getenv("DCMA_WEBSERVER_MAX_JOBS")){
+            try{
+                n = static_cast<size_t>(std::max(0L, std::stol(e)));
+            }catch(const std::exception &){ }
+        }
+        return n;
+    }() );
+    return q;
+}
+
+// The state a job needs to run an operation independently of the session that submitted it. The Drover is a deep copy,
+// so the job and the session never share objects.
+struct webserver_job {
+    Drover DICOM_data;
+    std::map<std::string,std::string> InvocationMetadata;
+    std::string FilenameLex;
+
+    std::list<OperationArgPkg> Passes;
+
+    std::string CacheKey;
+    std::map<std::string,std::string> OutputFilenames; // Parameter name --> generated file path.
+
+    bool Started = false;
+    bool FromCache = false;
+    bool AllSuccessful = true;
+    std::string FailureMessage;
+};
+
+// A memoized job result. The Drover is deep-copied so that subsequent in-place modifications cannot alter it.
+struct webserver_cached_result {
+    Drover DICOM_data;
+    std::map<std::string,std::string> InvocationMetadata;
+    std::map<std::string,std::string> OutputFilenames;
+};
+
+// The result cache is bounded by the estimated size of the cached Drovers. The bound (e.g., '512M' or '2G') can be
+// adjusted via the DCMA_WEBSERVER_CACHE_SIZE environment variable.
+static
+lru_cache<std::string, webserver_cached_result> & Get_Result_Cache(){
+    static lru_cache<std::string, webserver_cached_result> c( [](){
+        uint64_t n = static_cast<uint64_t>(1) << 30;
+        if(const char *e = std::getenv("DCMA_WEBSERVER_CACHE_SIZE")){
+            try{
+                n = Parse_Memory_Size(e);
+            }catch(const std::exception &ex){
+                FUNCWARN("Ignoring DCMA_WEBSERVER_CACHE_SIZE: " << ex.what());
+            }
+        }
+        return static_cast<size_t>(n);
+    }() );
+    return c;
+}
+
+static
+Drover Deep_Copy_Drover(const Drover &in){
+    Drover out;
+    if(in.contour_data != nullptr) out.contour_data = std::make_shared<Contour_Data>(*(in.contour_data));
+    for(const auto &p : in.image_data) out.image_data.emplace_back( std::make_shared<Image_Array>(*p) );
+    for(const auto &p : in.point_data) out.point_data.emplace_back( std::make_shared<Point_Cloud>(*p) );
+    for(const auto &p : in.smesh_data) out.smesh_data.emplace_back( std::make_shared<Surface_Mesh>(*p) );
+    for(const auto &p : in.tplan_data) out.tplan_data.emplace_back( std::make_shared<TPlan_Config>(*p) );
+    for(const auto &p : in.lsamp_data) out.lsamp_data.emplace_back( std::make_shared<Line_Sample>(*p) );
+    for(const auto &p : in.trans_data) out.trans_data.emplace_back( std::make_shared<Transform3>(*p) );
+    return out;
+}
+
+// A rough estimate of the memory held by the bulk data of a Drover. Metadata and small objects are ignored.
+static
+size_t Estimate_Drover_Bytes(const Drover &in){
+    uint64_t bytes = sizeof(in);
+    if(in.contour_data != nullptr){
+        for(const auto &cc : in.contour_data->ccs){
+            for(const auto &c : cc.contours){
+                bytes += sizeof(c) + sizeof(vec3<double>) * c.points.size();
+            }
+        }
+    }
+    for(const auto &p : in.image_data) bytes += Estimate_Resident_Bytes(*p);
+    for(const auto &p : in.smesh_data) bytes += Estimate_Resident_Bytes(*p);
+    for(const auto &p : in.point_data) bytes += sizeof(*p) + sizeof(vec3<double>) * p->pset.points.size();
+    for(const auto &p : in.lsamp_data) bytes += sizeof(*p) + sizeof(std::array<double,4>) * p->line.samples.size();
+    return static_cast<size_t>(bytes);
+}
+
+// 64-bit FNV-1a hash, used to fingerprint session data provenance for the result cache.
+static
+uint64_t FNV1a_Hash(uint64_t h, const char *bytes, size_t N){
+    for(size_t i = 0; i < N; ++i){
+        h ^= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i]));
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static
+std::string FNV1a_Hash_Str(const std::string &in){
+    const auto h = FNV1a_Hash(14695981039346656037ULL, in.data(), in.size());
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0') << std::setw(16) << h;
+    return ss.str();
+}
+
 // This class is instanced for each client. It holds all state for a single session.
 class BaseWebServerApplication : public Wt::WApplication {
   public:
     BaseWebServerApplication(const Wt::WEnvironment& env);
+    ~BaseWebServerApplication() override;
+
+    // Invoked (via WServer::post) on the session's thread when a submitted job finishes.
+    void computeFinished(const std::shared_ptr<webserver_job> &job, job_status status, const std::string &msg);
 
   private:
 
@@ -201,7 +321,17 @@ class BaseWebServerApplication : public Wt::WApplication {
 
     //A working space specific to this instance. Not truly private: can be read by others.
     std::string InstancePrivateDirectory;
-    
+
+    //A fingerprint of the uploaded data and all operations successfully applied to it. Used to key the result cache.
+    std::string DataProvenance;
+
+    //The currently queued or running job, if any. Zero indicates no job.
+    job_queue::job_id_t ActiveJob = 0;
+
+    //Output file resources and mimetypes for the active job, keyed on operation parameter name.
+    std::map<std::string,std::shared_ptr<Wt::WFileResource>> ActiveOutputFiles;
+    std::map<std::string,std::string> ActiveOutputMimetype;
+
 
     //Regex for operation parameters.
     std::regex trueregex    = Compile_Regex("^tr?u?e?$");
@@ -230,6 +360,20 @@ BaseWebServerApplication::BaseWebServerApplication(const Wt::WEnvironment &env)
                                                                       "/");
     FUNCINFO("The unique directory for this session is '" << this->InstancePrivateDirectory << "'");
 
+    // Operations are performed asynchronously, so the server must be able to push updates to the client.
+    this->enableUpdates(true);
+
+    // Clients may voluntarily lower the priority of their jobs (e.g., for batch or background work) by providing a
+    // 'priority' URL parameter. Raising priority above the default is not permitted.
+    if(const std::string *p = env.getParameter("priority")){
+        try{
+            const auto priority = std::clamp(std::stol(*p), -10L, 0L);
+            Get_Job_Queue().set_owner_priority(this->sessionId(), priority);
+        }catch(const std::exception &){
+            FUNCWARN("Ignoring invalid priority parameter '" << *p << "'");
+        }
+    }
+
     //Try find a lexicon file if none were provided.
     {
         if(this->FilenameLex.empty()){
@@ -286,6 +430,12 @@ BaseWebServerApplication::BaseWebServerApplication(const Wt::WEnvironment &env)
     this->createFileUploadGB();
 }
 
+BaseWebServerApplication::~BaseWebServerApplication(){
+    // Abandon any outstanding work. Jobs only reference their own state, so they can finish safely after the session
+    // has been destroyed; results posted to a terminated session are discarded by the server.
+    if(this->ActiveJob != 0) Get_Job_Queue().cancel(this->ActiveJob);
+}
+
 
 void BaseWebServerApplication::createFileUploadGB(){
     // This routine creates a file upload box.
@@ -400,6 +550,22 @@ void BaseWebServerApplication::filesUploaded(){
     }
     fileup->disable();
 
+    // Fingerprint the uploaded data so identical operations on identical data can be served from the result cache.
+    {
+        uint64_t h = 14695981039346656037ULL;
+        std::vector<char> buf(1 << 16);
+        for(const auto &afile : files_vec){
+            std::ifstream fi(afile.spoolFileName(), std::ios::in | std::ios::binary);
+            while(fi){
+                fi.read(buf.data(), buf.size());
+                h = FNV1a_Hash(h, buf.data(), static_cast<size_t>(fi.gcount()));
+            }
+        }
+        std::stringstream ss;
+        ss << std::hex << std::setfill('0') << std::setw(16) << h;
+        this->DataProvenance = ss.str();
+    }
+
 
     // Feedback for the client.
     auto feedback = reinterpret_cast<Wt::WText *>( root()->find("file_upload_gb_feedback") );
@@ -1042,10 +1208,20 @@ void BaseWebServerApplication::createComputeGB(){
     std::map<std::string,std::shared_ptr<Wt::WFileResource>> OutputFiles;
     std::map<std::string,std::string> OutputFilenames;
     std::map<std::string,std::string> OutputMimetype;
+
+    // A canonical description of the requested work, used to key the result cache. Generated file names are unique for
+    // every invocation, so they are excluded.
+    std::stringstream canonical;
+    canonical << this->DataProvenance << "\n" << selected_op;
+    for(const auto &apair : this->InvocationMetadata){
+        canonical << "\n" << apair.first << "=" << apair.second;
+    }
+
+    auto job = std::make_shared<webserver_job>();
     const auto rows = table->rowCount(); 
     const auto cols = table->columnCount(); 
-    bool AllSuccessful = true;
     for(auto col = 1; col < cols; ++col){
+        canonical << "\n--";
         auto op_doc_l = (Known_Operations()[selected_op].first)(); // Documentation parameter list.
         OperationArgPkg op_args(selected_op); // The list of parameters passed to the operation.
         for(int row = 1; row < rows; ++row){
@@ -1063,10 +1239,12 @@ void BaseWebServerApplication::createComputeGB(){
             // This will hopefully prevent the user being able to provide parameters via DOM alteration.
             if(op_doc.visibility == OpArgVisibility::Hide){
                 op_args.insert(op_doc.name, op_doc.default_val);
+                canonical << "\n" << op_doc.name << "=" << op_doc.default_val;
                 continue;
             }
 
             std::string param_val;
+            bool is_generated_file = false;
             auto w = table->elementAt(row,col)->children().back();
             if(w == nullptr) throw std::logic_error("Table element's child widget not found. Cannot continue.");
 
@@ -1116,6 +1294,7 @@ void BaseWebServerApplication::createComputeGB(){
                 param_val = web_str;
 
             }else if(dynamic_cast<Wt::WProgressBar *>(w)){ //Dummy encoding for generated files.
+                is_generated_file = true;
                 OutputMimetype[param_name] = op_doc.mimetype;
 
                 //Create a working file.
@@ -1186,32 +1365,179 @@ void BaseWebServerApplication::createComputeGB(){
             if( (op_doc.expected == true)
             ||  ( (op_doc.expected == false) && !param_val.empty() ) ){
                 op_args.insert(param_name, param_val);
+                if(!is_generated_file) canonical << "\n" << param_name << "=" << param_val;
             }
         }
 
-        // ---
+        job->Passes.emplace_back(op_args);
+    }
 
-        //Perform the operation.
-        std::list<OperationArgPkg> PackedOperation = { op_args };
-        try{
-            if(!Operation_Dispatcher( this->DICOM_data, 
-                                      this->InvocationMetadata, 
-                                      this->FilenameLex,
-                                      PackedOperation )){
-                throw std::runtime_error("Return value non-zero (non-descript error condition)");
+    // ---
+
+    // Submit the operation to the shared job queue. The job only captures its own state, never the session, so it is
+    // safe for the session to terminate while the job is queued or running.
+    //
+    // Note: results are memoized. Re-running an identical operation on identical data will return the cached result
+    //       (and cached output files) without invoking the operation. Operations that are nondeterministic or depend
+    //       on external state (e.g., the current time or a remote database) will therefore not be re-evaluated.
+    job->DICOM_data = Deep_Copy_Drover(this->DICOM_data);
+    job->InvocationMetadata = this->InvocationMetadata;
+    job->FilenameLex = this->FilenameLex;
+    job->CacheKey = FNV1a_Hash_Str(canonical.str());
+    job->OutputFilenames = OutputFilenames;
+
+    this->ActiveOutputFiles = OutputFiles;
+    this->ActiveOutputMimetype = OutputMimetype;
+
+    auto cancelbutton = gb->addWidget(std::make_unique<Wt::WPushButton>("Cancel"));
+    cancelbutton->setObjectName("compute_gb_cancel");
+
+    const auto session_id = this->sessionId();
+    const auto post_to_session = [session_id](std::function<void(BaseWebServerApplication *)> f) -> void {
+        auto server = Wt::WServer::instance();
+        if(server == nullptr) return;
+        server->post(session_id, [f](){
+            auto app = dynamic_cast<BaseWebServerApplication *>( Wt::WApplication::instance() );
+            if(app == nullptr) return;
+            f(app);
+            app->triggerUpdate();
+        });
+    };
+
+    const auto work = [job](job_context &ctx) -> bool {
+        job->Started = true;
+
+        // Serve from the cache if possible. Cached output files are copied so each session owns its own files.
+        if(auto cached = Get_Result_Cache().get(job->CacheKey)){
+            bool files_available = true;
+            for(const auto &apair : job->OutputFilenames){
+                auto it = cached->OutputFilenames.find(apair.first);
+                if( (it == cached->OutputFilenames.end())
+                ||  !CopyFile(it->second, apair.second) ){
+                    files_available = false;
+                    break;
+                }
+            }
+            if(files_available){
+                job->DICOM_data = Deep_Copy_Drover(cached->DICOM_data);
+                job->InvocationMetadata = cached->InvocationMetadata;
+                job->FromCache = true;
+                return true;
             }
-        }catch(const std::exception &e){
-            feedback->setText("<p>Operation failed: "_s + e.what() + ".</p>");
-            AllSuccessful = false;
-            //return;
         }
+
+        // Cancellation is honoured before each operation, including operations nested within meta-operations.
+        operation_cancellation_scope cancellation(&(ctx.cancel_requested));
+        size_t pass = 0;
+        for(const auto &op_args : job->Passes){
+            if(ctx.cancel_requested.load()) return false;
+            ctx.report_progress("<p>Computing pass "_s + std::to_string(++pass) + " of "_s
+                                + std::to_string(job->Passes.size()) + "...</p>");
+
+            std::list<OperationArgPkg> PackedOperation = { op_args };
+            try{
+                if(!Operation_Dispatcher( job->DICOM_data, 
+                                          job->InvocationMetadata, 
+                                          job->FilenameLex,
+                                          PackedOperation )){
+                    throw std::runtime_error("Return value non-zero (non-descript error condition)");
+                }
+            }catch(const std::exception &e){
+                job->FailureMessage = e.what();
+                job->AllSuccessful = false;
+            }
+        }
+
+        if(job->AllSuccessful){
+            auto res = std::make_shared<webserver_cached_result>();
+            res->DICOM_data = Deep_Copy_Drover(job->DICOM_data);
+            res->InvocationMetadata = job->InvocationMetadata;
+            res->OutputFilenames = job->OutputFilenames;
+            const auto bytes = Estimate_Drover_Bytes(res->DICOM_data);
+            Get_Result_Cache().put(job->CacheKey, res, bytes);
+        }
+        return job->AllSuccessful;
+    };
+
+    const auto done = [job,post_to_session](job_status status, const std::string &msg) -> void {
+        post_to_session([job,status,msg](BaseWebServerApplication *app){
+            app->computeFinished(job, status, msg);
+        });
+    };
+
+    const auto progress = [post_to_session](const std::string &msg) -> void {
+        post_to_session([msg](BaseWebServerApplication *app){
+            auto feedback = reinterpret_cast<Wt::WText *>( app->root()->find("compute_gb_feedback") );
+            if(feedback != nullptr) feedback->setText(msg);
+        });
+    };
+
+    this->ActiveJob = Get_Job_Queue().submit(session_id, work, done, progress);
+
+    const auto queue_pos = Get_Job_Queue().queue_position(this->ActiveJob);
+    if(queue_pos && (0 < queue_pos.value())){
+        feedback->setText("<p>Waiting for "_s + std::to_string(queue_pos.value()) + " other job(s) to start...</p>");
     }
-    if(AllSuccessful){
-        feedback->setText("<p>Operation successful.</p>");
-    }
+
+    const auto job_id = this->ActiveJob;
+    cancelbutton->clicked().connect(std::bind([=](){
+        cancelbutton->disable();
+        if(Get_Job_Queue().cancel(job_id)){
+            feedback->setText("<p>Cancelling...</p>");
+        }
+        return;
+    }));
 
     gb->show();
     sep_break->setFocus(true);
+    gb->setCanReceiveFocus(true);
+    gb->setFocus(true);
+    gb->setFocus(false);
+    this->processEvents();
+    return;
+}
+
+void BaseWebServerApplication::computeFinished(const std::shared_ptr<webserver_job> &job,
+                                               job_status status,
+                                               const std::string &msg){
+    // This routine relays the results of a finished job to the client.
+    this->ActiveJob = 0;
+
+    auto gb = reinterpret_cast<Wt::WGroupBox *>( root()->find("compute_gb") );
+    if(gb == nullptr) throw std::logic_error("Cannot find computation widget in DOM tree. Cannot continue.");
+
+    auto feedback = reinterpret_cast<Wt::WText *>( root()->find("compute_gb_feedback") );
+    if(feedback == nullptr) throw std::logic_error("Cannot find computation feedback widget in DOM tree. Cannot continue.");
+
+    if(auto cancelbutton = root()->find("compute_gb_cancel")){
+        cancelbutton->hide();
+    }
+
+    // Adopt the job's data. Operations may partially succeed, so the data is adopted even if the job failed.
+    if(job->Started){
+        this->DICOM_data = job->DICOM_data;
+        this->InvocationMetadata = job->InvocationMetadata;
+    }
+
+    if(status == job_status::completed){
+        this->DataProvenance = FNV1a_Hash_Str(this->DataProvenance + job->CacheKey);
+        feedback->setText( (job->FromCache) ? "<p>Operation successful (cached result).</p>"
+                                            : "<p>Operation successful.</p>" );
+    }else if(status == job_status::cancelled){
+        // The data may have been partially modified, so cached results can no longer be trusted for this session.
+        this->DataProvenance = FNV1a_Hash_Str(this->DataProvenance + "cancelled" + job->CacheKey);
+        feedback->setText("<p>Operation cancelled.</p>");
+    }else{
+        this->DataProvenance = FNV1a_Hash_Str(this->DataProvenance + "failed" + job->CacheKey);
+        const auto &reason = (job->FailureMessage.empty()) ? msg : job->FailureMessage;
+        feedback->setText("<p>Operation failed: "_s + reason + ".</p>");
+    }
+
+    auto OutputFiles = this->ActiveOutputFiles;
+    auto OutputMimetype = this->ActiveOutputMimetype;
+    this->ActiveOutputFiles.clear();
+    this->ActiveOutputMimetype.clear();
+
     gb->setCanReceiveFocus(true);
     gb->setFocus(true);
     gb->setFocus(false);
@@ -1342,7 +1668,8 @@ void BaseWebServerApplication::createComputeGB(){
                                          "op_paramspec_gb_feedback",
 
                                          "compute_gb",
-                                         "compute_gb_feedback" };
+                                         "compute_gb_feedback",
+                                         "compute_gb_cancel" };
 
         for(auto &n : named){
             auto w = root()->find(n);
@@ -1356,7 +1683,6 @@ void BaseWebServerApplication::createComputeGB(){
     }));
 
     gb->show();
-    sep_break->setFocus(true);
     gobutton->setCanReceiveFocus(true);
     gobutton->setFocus(true);
     this->processEvents();
@@ -0,0 +1,272 @@
+//Dose_Influence_Matrix.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Thread_Pool.h"
+
+#include "Dose_Influence_Matrix.h"
+
+
+// Approximate number of stored elements per parallel work block. Smaller matrices are processed serially since the
+// synchronization overhead would exceed the cost of the products.
+static const long int nnz_per_block = 65'536;
+
+
+long int
+dose_influence_matrix::nnz() const {
+    return static_cast<long int>(this->values.size());
+}
+
+dose_influence_matrix
+Build_Dose_Influence_Matrix( const std::vector<std::vector<float>> &beam_doses ){
+    dose_influence_matrix out;
+    out.N_beams = static_cast<long int>(beam_doses.size());
+    if(out.N_beams == 0){
+        throw std::invalid_argument("No beams provided. Cannot build dose influence matrix.");
+    }
+    if(std::numeric_limits<int32_t>::max() < out.N_beams){
+        throw std::invalid_argument("Too many beams. Cannot build dose influence matrix.");
+    }
+    out.N_voxels = static_cast<long int>(beam_doses.front().size());
+    for(const auto &d : beam_doses){
+        if(static_cast<long int>(d.size()) != out.N_voxels){
+            throw std::invalid_argument("Beam dose samples do not align. Cannot build dose influence matrix.");
+        }
+    }
+
+    // Count the non-zero elements in each row so the storage can be allocated once.
+    out.row_offsets.assign(out.N_voxels + 1, 0);
+    for(const auto &d : beam_doses){
+        for(long int v = 0; v < out.N_voxels; ++v){
+            const auto val = d[v];
+            if(!std::isfinite(val)){
+                throw std::invalid_argument("Encountered non-finite dose. Cannot build dose influence matrix.");
+            }
+            if(val != 0.0f) ++out.row_offsets[v + 1];
+        }
+    }
+    std::partial_sum(out.row_offsets.begin(), out.row_offsets.end(), out.row_offsets.begin());
+
+    const auto nnz = out.row_offsets.back();
+    out.beam_indices.resize(nnz);
+    out.values.resize(nnz);
+
+    // Fill beam by beam so that each row's elements are ordered by beam.
+    std::vector<long int> next(out.row_offsets.begin(), std::prev(out.row_offsets.end()));
+    for(long int b = 0; b < out.N_beams; ++b){
+        const auto &d = beam_doses[b];
+        for(long int v = 0; v < out.N_voxels; ++v){
+            const auto val = d[v];
+            if(val == 0.0f) continue;
+            const auto i = next[v]++;
+            out.beam_indices[i] = static_cast<int32_t>(b);
+            out.values[i] = val;
+        }
+    }
+    return out;
+}
+
+
+dose_influence_objective::dose_influence_objective( dose_influence_matrix A_in,
+                                                    double D_norm_in,
+                                                    double V_min_in,
+                                                    double D_Rx_in )
+    : A(std::move(A_in)),
+      D_norm(D_norm_in),
+      V_min(V_min_in),
+      D_Rx(D_Rx_in) {
+
+    if(this->A.N_voxels <= 0){
+        throw std::invalid_argument("No voxels available. Cannot evaluate beam weights.");
+    }
+    if(!std::isfinite(this->V_min) || (this->V_min < 0.0) || (1.0 < this->V_min)){
+        throw std::invalid_argument("Normalization volume fraction must be within [0:1].");
+    }
+
+    // Partition the rows into blocks with approximately equal numbers of stored elements.
+    this->block_offsets.emplace_back(0);
+    for(long int v = 0; v < this->A.N_voxels; ++v){
+        if(nnz_per_block <= (this->A.row_offsets[v + 1] - this->A.row_offsets[this->block_offsets.back()])){
+            this->block_offsets.emplace_back(v + 1);
+        }
+    }
+    if(this->block_offsets.back() != this->A.N_voxels){
+        this->block_offsets.emplace_back(this->A.N_voxels);
+    }
+    const auto N_blocks = static_cast<long int>(this->block_offsets.size()) - 1;
+
+    if( (1 < N_blocks) && (1 < std::thread::hardware_concurrency()) ){
+        this->pool = std::make_unique<asio_thread_pool>();
+    }
+
+    this->dose.resize(this->A.N_voxels);
+    this->residual.resize(this->A.N_voxels);
+    this->ranks.resize(this->A.N_voxels);
+    this->block_partials.assign(N_blocks, std::vector<double>(this->A.N_beams, 0.0));
+}
+
+dose_influence_objective::~dose_influence_objective() = default;
+
+template <class F>
+void
+dose_influence_objective::for_each_block(F f){
+    const auto N_blocks = static_cast<long int>(this->block_offsets.size()) - 1;
+    if(!this->pool){
+        for(long int n = 0; n < N_blocks; ++n){
+            f(this->block_offsets[n], this->block_offsets[n + 1], n);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->pending_mutex);
+        this->pending = N_blocks;
+    }
+    for(long int n = 0; n < N_blocks; ++n){
+        this->pool->submit_task([this, f, n]() -> void {
+            f(this->block_offsets[n], this->block_offsets[n + 1], n);
+
+            std::lock_guard<std::mutex> lock(this->pending_mutex);
+            if(--this->pending == 0) this->pending_cv.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(this->pending_mutex);
+    this->pending_cv.wait(lock, [this]() -> bool { return (this->pending == 0); });
+    return;
+}
+
+void
+dose_influence_objective::Multiply( const std::vector<double> &weights, std::vector<double> &out ){
+    if(static_cast<long int>(weights.size()) != this->A.N_beams){
+        throw std::invalid_argument("Number of weights does not match number of beams.");
+    }
+    out.resize(this->A.N_voxels);
+
+    const auto *offsets = this->A.row_offsets.data();
+    const auto *beams = this->A.beam_indices.data();
+    const auto *vals = this->A.values.data();
+    const auto *w = weights.data();
+    auto *o = out.data();
+    this->for_each_block([=](long int first, long int last, long int) -> void {
+        for(long int v = first; v < last; ++v){
+            double acc = 0.0;
+            for(long int i = offsets[v]; i < offsets[v + 1]; ++i){
+                acc += static_cast<double>(vals[i]) * w[beams[i]];
+            }
+            o[v] = acc;
+        }
+    });
+    return;
+}
+
+void
+dose_influence_objective::Multiply_Transpose( const std::vector<double> &voxel_vals, std::vector<double> &out ){
+    if(static_cast<long int>(voxel_vals.size()) != this->A.N_voxels){
+        throw std::invalid_argument("Number of voxel values does not match number of voxels.");
+    }
+
+    // Each block accumulates separately. Partial sums are combined in a fixed order so the result is deterministic.
+    const auto *offsets = this->A.row_offsets.data();
+    const auto *beams = this->A.beam_indices.data();
+    const auto *vals = this->A.values.data();
+    const auto *x = voxel_vals.data();
+    auto *partials = this->block_partials.data();
+    this->for_each_block([=](long int first, long int last, long int n) -> void {
+        auto &p = partials[n];
+        std::fill(p.begin(), p.end(), 0.0);
+        for(long int v = first; v < last; ++v){
+            const auto x_v = x[v];
+            for(long int i = offsets[v]; i < offsets[v + 1]; ++i){
+                p[beams[i]] += static_cast<double>(vals[i]) * x_v;
+            }
+        }
+    });
+
+    out.assign(this->A.N_beams, 0.0);
+    for(const auto &p : this->block_partials){
+        for(long int b = 0; b < this->A.N_beams; ++b) out[b] += p[b];
+    }
+    return;
+}
+
+double
+dose_influence_objective::Evaluate( const std::vector<double> &weights, std::vector<double> &grad ){
+    this->Multiply(weights, this->dose);
+    const auto N = this->A.N_voxels;
+
+    // Locate the normalization dose. The (1 - V_min) percentile sits between the closest ranks k and k+1.
+    const double h = (1.0 - this->V_min) * static_cast<double>(N - 1);
+    const auto k = std::clamp(static_cast<long int>(std::floor(h)), 0L, N - 1);
+    const double t = (k + 1 < N) ? (h - static_cast<double>(k)) : 0.0;
+
+    const auto *d = this->dose.data();
+    const auto by_dose = [d](long int l, long int r) -> bool { return (d[l] < d[r]); };
+    std::iota(this->ranks.begin(), this->ranks.end(), 0L);
+    std::nth_element(this->ranks.begin(), std::next(this->ranks.begin(), k), this->ranks.end(), by_dose);
+    const auto v_lo = this->ranks[k];
+    const auto v_hi = (0.0 < t) ? *std::min_element(std::next(this->ranks.begin(), k + 1), this->ranks.end(), by_dose)
+                                : v_lo;
+    const double D_p = (1.0 - t) * d[v_lo] + t * d[v_hi];
+
+    if(!std::isfinite(D_p) || (D_p <= 0.0)){
+        this->dose_scaler = std::numeric_limits<double>::quiet_NaN();
+        std::fill(grad.begin(), grad.end(), 0.0);
+        return std::numeric_limits<double>::max();
+    }
+    this->dose_scaler = this->D_norm / D_p;
+
+    double cost = 0.0;
+    double e_dot_d = 0.0;
+    for(long int v = 0; v < N; ++v){
+        const auto e = this->dose_scaler * d[v] - this->D_Rx;
+        this->residual[v] = e;
+        cost += e * e;
+        e_dot_d += e * d[v];
+    }
+
+    if(!grad.empty()){
+        // With s = D_norm / D_p, the normalized dose is s * (A w). Since D_p depends on the weights through the
+        // voxel(s) at the normalization percentile,
+        //
+        //   d(cost)/dw = (2 s) * [ transpose(A) * e - (e . A w / D_p) * d(D_p)/dw ],
+        //
+        // where e is the residual and d(D_p)/dw interpolates the rows of the voxels at the closest ranks.
+        this->Multiply_Transpose(this->residual, grad);
+
+        std::vector<double> dD_p(this->A.N_beams, 0.0);
+        const auto add_row = [&](long int v, double c) -> void {
+            for(long int i = this->A.row_offsets[v]; i < this->A.row_offsets[v + 1]; ++i){
+                dD_p[this->A.beam_indices[i]] += c * static_cast<double>(this->A.values[i]);
+            }
+        };
+        add_row(v_lo, 1.0 - t);
+        if(0.0 < t) add_row(v_hi, t);
+
+        const auto c = e_dot_d / D_p;
+        for(long int b = 0; b < this->A.N_beams; ++b){
+            grad[b] = 2.0 * this->dose_scaler * (grad[b] - c * dD_p[b]);
+        }
+    }
+    return cost;
+}
+
+std::vector<double>
+dose_influence_objective::Normalized_Dose() const {
+    std::vector<double> out(this->dose);
+    for(auto &D : out) D *= this->dose_scaler;
+    return out;
+}
+
+const dose_influence_matrix &
+dose_influence_objective::Matrix() const {
+    return this->A;
+}
+
@@ -0,0 +1,88 @@
+//Dose_Influence_Matrix.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+class asio_thread_pool;
+
+
+// A dose-influence matrix stored in compressed sparse row (CSR) format. Each row corresponds to a voxel and each column
+// to a beam (or other independently-weighted dose source), so the dose distribution for a set of beam weights is the
+// matrix-vector product. Only non-zero elements are stored.
+struct dose_influence_matrix {
+    long int N_voxels = 0;
+    long int N_beams  = 0;
+
+    std::vector<long int> row_offsets;   // N_voxels + 1 entries; row v occupies [row_offsets[v], row_offsets[v+1]).
+    std::vector<int32_t>  beam_indices;
+    std::vector<float>    values;
+
+    long int nnz() const;
+};
+
+// Assembles the matrix from dense per-beam dose samples. Every beam must provide the same number of samples in the same
+// voxel order. Throws if the samples do not align or contain non-finite values.
+dose_influence_matrix Build_Dose_Influence_Matrix( const std::vector<std::vector<float>> &beam_doses );
+
+
+// Evaluates the cost of beam weights as the squared deviation from the prescription dose after normalizing the dose
+// distribution to satisfy a DVH criterion of the form $V_{D} \geq V_{min}$.
+//
+// The normalization point is the (1 - V_{min}) percentile of voxel doses, linearly interpolated between the closest
+// ranks. Since the dose is renormalized, the cost only depends on the relative beam weights.
+//
+// Products with the matrix and its transpose are evaluated in parallel over blocks of rows when the matrix is large
+// enough to benefit. Worker threads persist for the lifetime of the object. Evaluation is not re-entrant.
+class dose_influence_objective {
+  private:
+    dose_influence_matrix A;
+    double D_norm;    // Absolute dose required to cover the normalization volume.
+    double V_min;     // Fraction of voxels that must receive at least D_norm.
+    double D_Rx;      // Prescription dose.
+
+    std::vector<long int> block_offsets;   // Row boundaries of the parallel work blocks.
+    std::unique_ptr<asio_thread_pool> pool;
+
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    long int pending = 0;
+
+    std::vector<double> dose;               // Unnormalized dose from the most recent evaluation.
+    std::vector<double> residual;
+    std::vector<long int> ranks;            // Scratch space for locating the normalization percentile.
+    std::vector<std::vector<double>> block_partials;
+
+    double dose_scaler = 0.0;
+
+    // Invokes f(first_row, last_row, block) for every block and waits for completion.
+    template <class F>
+    void for_each_block(F f);
+
+  public:
+    dose_influence_objective( dose_influence_matrix A,
+                              double D_norm,
+                              double V_min,
+                              double D_Rx );
+    ~dose_influence_objective();
+
+    // Computes out = A * weights.
+    void Multiply( const std::vector<double> &weights, std::vector<double> &out );
+
+    // Computes out = transpose(A) * voxel_vals.
+    void Multiply_Transpose( const std::vector<double> &voxel_vals, std::vector<double> &out );
+
+    // Returns the cost. If the gradient vector is not empty, the derivative of the cost with respect to each weight is
+    // also computed. Non-finite or non-positive normalization doses result in the maximum double and a zero gradient.
+    double Evaluate( const std::vector<double> &weights, std::vector<double> &grad );
+
+    // The normalized dose distribution from the most recent evaluation.
+    std::vector<double> Normalized_Dose() const;
+
+    const dose_influence_matrix & Matrix() const;
+};
+
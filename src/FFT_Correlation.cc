@@ -0,0 +1,363 @@
+//FFT_Correlation.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Thread_Pool.h"
+
+#include "FFT_Correlation.h"
+
+
+static bool Is_Power_Of_Two(size_t n){
+    return (n != 0) && ((n & (n - 1)) == 0);
+}
+
+static size_t Next_Power_Of_Two(size_t n){
+    size_t p = 1;
+    while(p < n) p <<= 1;
+    return p;
+}
+
+fft_plan::fft_plan(size_t N) : N(N) {
+    if(!Is_Power_Of_Two(N)){
+        throw std::invalid_argument("FFT length must be a power of two");
+    }
+
+    const double pi = 3.14159265358979323846;
+    this->twiddles.resize(N / 2);
+    for(size_t k = 0; k < (N / 2); ++k){
+        const double theta = -2.0 * pi * static_cast<double>(k) / static_cast<double>(N);
+        this->twiddles[k] = std::complex<double>(std::cos(theta), std::sin(theta));
+    }
+
+    this->bit_reversed.resize(N, 0);
+    size_t log2N = 0;
+    while((static_cast<size_t>(1) << log2N) < N) ++log2N;
+    for(size_t i = 0; i < N; ++i){
+        size_t r = 0;
+        for(size_t b = 0; b < log2N; ++b){
+            if(i & (static_cast<size_t>(1) << b)) r |= (static_cast<size_t>(1) << (log2N - 1 - b));
+        }
+        this->bit_reversed[i] = r;
+    }
+}
+
+size_t fft_plan::size() const {
+    return this->N;
+}
+
+void fft_plan::forward(std::complex<double> *data) const {
+    for(size_t i = 0; i < this->N; ++i){
+        const auto j = this->bit_reversed[i];
+        if(i < j) std::swap(data[i], data[j]);
+    }
+
+    for(size_t len = 2; len <= this->N; len <<= 1){
+        const size_t half = len / 2;
+        const size_t step = this->N / len;
+        for(size_t i = 0; i < this->N; i += len){
+            for(size_t j = 0; j < half; ++j){
+                const auto u = data[i + j];
+                const auto v = data[i + j + half] * this->twiddles[j * step];
+                data[i + j] = u + v;
+                data[i + j + half] = u - v;
+            }
+        }
+    }
+    return;
+}
+
+void fft_plan::inverse(std::complex<double> *data) const {
+    // Uses the identity ifft(x) = conj(fft(conj(x))) / N.
+    for(size_t i = 0; i < this->N; ++i) data[i] = std::conj(data[i]);
+    this->forward(data);
+    const double scale = 1.0 / static_cast<double>(this->N);
+    for(size_t i = 0; i < this->N; ++i) data[i] = std::conj(data[i]) * scale;
+    return;
+}
+
+
+// Transforms a (row, column, image)-ordered block along each axis in turn.
+static void FFT_3D( std::vector<std::complex<double>> &buf,
+                    const std::array<size_t, 3> &F,
+                    const std::array<fft_plan, 3> &plans,
+                    bool inverse ){
+    const auto F_r = F[0];
+    const auto F_c = F[1];
+    const auto F_i = F[2];
+
+    const auto transform = [&](size_t axis, std::complex<double> *p){
+        if(inverse){
+            plans[axis].inverse(p);
+        }else{
+            plans[axis].forward(p);
+        }
+    };
+
+    // Columns are contiguous.
+    if(1 < F_c){
+        for(size_t i = 0; i < F_i; ++i){
+            for(size_t r = 0; r < F_r; ++r){
+                transform(1, &buf[(i * F_r + r) * F_c]);
+            }
+        }
+    }
+
+    // Rows and images are strided, so they are gathered into a scratch line.
+    std::vector<std::complex<double>> line(std::max(F_r, F_i));
+    if(1 < F_r){
+        for(size_t i = 0; i < F_i; ++i){
+            for(size_t c = 0; c < F_c; ++c){
+                for(size_t r = 0; r < F_r; ++r) line[r] = buf[(i * F_r + r) * F_c + c];
+                transform(0, line.data());
+                for(size_t r = 0; r < F_r; ++r) buf[(i * F_r + r) * F_c + c] = line[r];
+            }
+        }
+    }
+    if(1 < F_i){
+        for(size_t r = 0; r < F_r; ++r){
+            for(size_t c = 0; c < F_c; ++c){
+                for(size_t i = 0; i < F_i; ++i) line[i] = buf[(i * F_r + r) * F_c + c];
+                transform(2, line.data());
+                for(size_t i = 0; i < F_i; ++i) buf[(i * F_r + r) * F_c + c] = line[i];
+            }
+        }
+    }
+    return;
+}
+
+
+// Overlap-save blocking along a single axis.
+struct axis_tiling {
+    long int N = 0; // Volume extent.
+    long int K = 0; // Kernel extent.
+    long int V = 0; // Number of positions where the kernel fits entirely within the volume.
+    long int F = 1; // Transform length.
+    long int L = 1; // Number of valid outputs per tile.
+    long int T = 0; // Number of tiles.
+};
+
+static axis_tiling Plan_Axis_Tiling(long int N, long int K){
+    axis_tiling out;
+    out.N = N;
+    out.K = K;
+    out.V = N - K + 1;
+    if(out.V <= 0) return out;
+
+    // Transforms at least twice the kernel length waste at most half of each tile, but there is no point in
+    // transforming more than the entire (padded) volume.
+    const auto F_target = Next_Power_Of_Two(static_cast<size_t>(std::max<long int>(2 * K, 16)));
+    const auto F_max = Next_Power_Of_Two(static_cast<size_t>(N));
+    out.F = static_cast<long int>(std::min(F_target, F_max));
+    out.L = out.F - K + 1;
+    out.T = (out.V + out.L - 1) / out.L;
+    return out;
+}
+
+// Computes sums over every kernel-sized window that fits entirely within the volume. The result has dimensions
+// (N - K + 1) along each axis.
+static std::vector<double> Window_Sums( std::vector<double> v,
+                                        const std::array<axis_tiling, 3> &at ){
+    std::array<long int, 3> dims = {{ at[0].N, at[1].N, at[2].N }};
+
+    // Reduce one axis at a time using prefix sums along each line.
+    for(const long int axis : { 1L, 0L, 2L }){
+        const auto K = at[axis].K;
+        const auto V = at[axis].V;
+        std::array<long int, 3> out_dims = dims;
+        out_dims[axis] = V;
+        std::vector<double> out(static_cast<size_t>(out_dims[0] * out_dims[1] * out_dims[2]), 0.0);
+
+        const auto index = [](const std::array<long int, 3> &d, long int r, long int c, long int i) -> long int {
+            return (i * d[0] + r) * d[1] + c;
+        };
+
+        std::vector<double> prefix(static_cast<size_t>(dims[axis] + 1), 0.0);
+        std::array<long int, 3> pos = {{ 0, 0, 0 }};
+        const auto a1 = (axis == 0) ? 1L : 0L;
+        const auto a2 = (axis == 2) ? 1L : 2L;
+        for(pos[a2] = 0; pos[a2] < dims[a2]; ++pos[a2]){
+            for(pos[a1] = 0; pos[a1] < dims[a1]; ++pos[a1]){
+                auto p = pos;
+                for(p[axis] = 0; p[axis] < dims[axis]; ++p[axis]){
+                    prefix[p[axis] + 1] = prefix[p[axis]] + v[index(dims, p[0], p[1], p[2])];
+                }
+                for(p[axis] = 0; p[axis] < V; ++p[axis]){
+                    out[index(out_dims, p[0], p[1], p[2])] = prefix[p[axis] + K] - prefix[p[axis]];
+                }
+            }
+        }
+        v.swap(out);
+        dims = out_dims;
+    }
+    return v;
+}
+
+std::vector<double> Apply_Kernel_Via_FFT( const std::vector<double> &vol,
+                                          const volume_dims &vol_dims,
+                                          const std::vector<double> &kernel,
+                                          const volume_dims &kernel_dims,
+                                          const volume_dims &offset,
+                                          volume_kernel_reduction reduction ){
+
+    const auto N_vol = vol_dims[0] * vol_dims[1] * vol_dims[2];
+    const auto N_ker = kernel_dims[0] * kernel_dims[1] * kernel_dims[2];
+    if( (N_vol <= 0) || (static_cast<long int>(vol.size()) != N_vol) ){
+        throw std::invalid_argument("Volume dimensions do not match the provided voxels");
+    }
+    if( (N_ker <= 0) || (static_cast<long int>(kernel.size()) != N_ker) ){
+        throw std::invalid_argument("Kernel dimensions do not match the provided voxels");
+    }
+    for(const auto &k : kernel){
+        if(!std::isfinite(k)){
+            throw std::invalid_argument("Kernel contains non-finite values");
+        }
+    }
+
+    std::vector<double> out(vol.size(), std::numeric_limits<double>::quiet_NaN());
+
+    const std::array<axis_tiling, 3> at = {{ Plan_Axis_Tiling(vol_dims[0], kernel_dims[0]),
+                                             Plan_Axis_Tiling(vol_dims[1], kernel_dims[1]),
+                                             Plan_Axis_Tiling(vol_dims[2], kernel_dims[2]) }};
+    if( (at[0].V <= 0) || (at[1].V <= 0) || (at[2].V <= 0) ){
+        // The kernel does not fit anywhere.
+        return out;
+    }
+
+    // Windows containing non-finite voxels cannot be computed with transforms, so they are identified separately.
+    // The Euclidean distance also requires the sum of squared voxel values over each window.
+    std::vector<double> nonfinite(vol.size(), 0.0);
+    std::vector<double> squares;
+    if(reduction == volume_kernel_reduction::euclidean_distance){
+        squares.resize(vol.size(), 0.0);
+    }
+    for(size_t j = 0; j < vol.size(); ++j){
+        if(std::isfinite(vol[j])){
+            if(!squares.empty()) squares[j] = vol[j] * vol[j];
+        }else{
+            nonfinite[j] = 1.0;
+        }
+    }
+    const auto nonfinite_counts = Window_Sums(std::move(nonfinite), at);
+    if(!squares.empty()){
+        squares = Window_Sums(std::move(squares), at);
+    }
+    double kernel_sq_sum = 0.0;
+    for(const auto &k : kernel) kernel_sq_sum += k * k;
+
+    // Transform the kernel once. Correlation corresponds to multiplication by the conjugate spectrum.
+    const std::array<size_t, 3> F = {{ static_cast<size_t>(at[0].F),
+                                       static_cast<size_t>(at[1].F),
+                                       static_cast<size_t>(at[2].F) }};
+    const auto F_n = F[0] * F[1] * F[2];
+    const std::array<fft_plan, 3> plans = {{ fft_plan(F[0]), fft_plan(F[1]), fft_plan(F[2]) }};
+
+    std::vector<std::complex<double>> kernel_spectrum(F_n, std::complex<double>(0.0, 0.0));
+    for(long int i = 0; i < kernel_dims[2]; ++i){
+        for(long int r = 0; r < kernel_dims[0]; ++r){
+            for(long int c = 0; c < kernel_dims[1]; ++c){
+                kernel_spectrum[(i * F[0] + r) * F[1] + c] = kernel[(i * kernel_dims[0] + r) * kernel_dims[1] + c];
+            }
+        }
+    }
+    FFT_3D(kernel_spectrum, F, plans, false);
+    for(auto &k : kernel_spectrum) k = std::conj(k);
+
+    const auto vol_index = [&](long int r, long int c, long int i) -> long int {
+        return (i * vol_dims[0] + r) * vol_dims[1] + c;
+    };
+    const auto valid_index = [&](long int r, long int c, long int i) -> long int {
+        return (i * at[0].V + r) * at[1].V + c;
+    };
+
+    {
+        asio_thread_pool tp;
+        for(long int t_i = 0; t_i < at[2].T; ++t_i){
+            for(long int t_r = 0; t_r < at[0].T; ++t_r){
+                for(long int t_c = 0; t_c < at[1].T; ++t_c){
+                    tp.submit_task([&,t_r,t_c,t_i]() -> void {
+                        const std::array<long int, 3> s = {{ t_r * at[0].L, t_c * at[1].L, t_i * at[2].L }};
+
+                        // Gather the input block. Non-finite voxels are zeroed; the affected outputs are discarded.
+                        std::vector<std::complex<double>> buf(F_n, std::complex<double>(0.0, 0.0));
+                        const auto r_end = std::min<long int>(at[0].F, at[0].N - s[0]);
+                        const auto c_end = std::min<long int>(at[1].F, at[1].N - s[1]);
+                        const auto i_end = std::min<long int>(at[2].F, at[2].N - s[2]);
+                        for(long int i = 0; i < i_end; ++i){
+                            for(long int r = 0; r < r_end; ++r){
+                                for(long int c = 0; c < c_end; ++c){
+                                    const auto v = vol[vol_index(s[0] + r, s[1] + c, s[2] + i)];
+                                    if(std::isfinite(v)) buf[(i * F[0] + r) * F[1] + c] = v;
+                                }
+                            }
+                        }
+
+                        FFT_3D(buf, F, plans, false);
+                        for(size_t j = 0; j < F_n; ++j) buf[j] *= kernel_spectrum[j];
+                        FFT_3D(buf, F, plans, true);
+
+                        // Scatter the outputs that do not wrap around.
+                        const auto jr_end = std::min<long int>(at[0].L, at[0].V - s[0]);
+                        const auto jc_end = std::min<long int>(at[1].L, at[1].V - s[1]);
+                        const auto ji_end = std::min<long int>(at[2].L, at[2].V - s[2]);
+                        for(long int i = 0; i < ji_end; ++i){
+                            const auto u_i = s[2] + i;
+                            const auto p_i = u_i + offset[2];
+                            if( (p_i < 0) || (vol_dims[2] <= p_i) ) continue;
+                            for(long int r = 0; r < jr_end; ++r){
+                                const auto u_r = s[0] + r;
+                                const auto p_r = u_r + offset[0];
+                                if( (p_r < 0) || (vol_dims[0] <= p_r) ) continue;
+                                for(long int c = 0; c < jc_end; ++c){
+                                    const auto u_c = s[1] + c;
+                                    const auto p_c = u_c + offset[1];
+                                    if( (p_c < 0) || (vol_dims[1] <= p_c) ) continue;
+
+                                    const auto w = valid_index(u_r, u_c, u_i);
+                                    if(0.0 < nonfinite_counts[w]) continue;
+
+                                    const auto ip = buf[(i * F[0] + r) * F[1] + c].real();
+                                    double val = ip;
+                                    if(reduction == volume_kernel_reduction::euclidean_distance){
+                                        val = std::sqrt( std::max(0.0, squares[w] - 2.0 * ip + kernel_sq_sum) );
+                                    }
+                                    out[vol_index(p_r, p_c, p_i)] = val;
+                                }
+                            }
+                        }
+                    });
+                }
+            }
+        }
+    } // Wait for all tiles to complete.
+
+    return out;
+}
+
+bool FFT_Is_Preferable( const volume_dims &vol_dims,
+                        const volume_dims &kernel_dims ){
+    const auto N_vol = static_cast<double>(vol_dims[0] * vol_dims[1] * vol_dims[2]);
+    const auto N_ker = static_cast<double>(kernel_dims[0] * kernel_dims[1] * kernel_dims[2]);
+
+    const std::array<axis_tiling, 3> at = {{ Plan_Axis_Tiling(vol_dims[0], kernel_dims[0]),
+                                             Plan_Axis_Tiling(vol_dims[1], kernel_dims[1]),
+                                             Plan_Axis_Tiling(vol_dims[2], kernel_dims[2]) }};
+    if( (at[0].V <= 0) || (at[1].V <= 0) || (at[2].V <= 0) ){
+        return false;
+    }
+    const auto T = static_cast<double>(at[0].T * at[1].T * at[2].T);
+    const auto F_n = static_cast<double>(at[0].F * at[1].F * at[2].F);
+
+    // Direct sampling involves several look-ups per kernel voxel, whereas each tile requires a forward and an inverse
+    // transform plus gathering and scattering.
+    const double direct_cost = 10.0 * N_vol * N_ker;
+    const double fft_cost = T * F_n * (10.0 * std::log2(std::max(2.0, F_n)) + 20.0);
+    return (fft_cost < direct_cost);
+}
+
@@ -0,0 +1,64 @@
+//FFT_Correlation.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+
+// A power-of-two, radix-2 complex discrete Fourier transform.
+//
+// Twiddle factors and the bit-reversal permutation are computed once so that the plan can be reused for many
+// transforms of the same length. Plans are immutable after construction and can be shared between threads.
+class fft_plan {
+  private:
+    size_t N = 0;
+    std::vector<std::complex<double>> twiddles;
+    std::vector<size_t> bit_reversed;
+
+  public:
+    fft_plan() = default;
+    explicit fft_plan(size_t N); // N must be a power of two.
+
+    size_t size() const;
+
+    // Transforms N contiguous values in place. The inverse transform is normalized by 1/N.
+    void forward(std::complex<double> *data) const;
+    void inverse(std::complex<double> *data) const;
+};
+
+
+// Volumes are stored contiguously with columns varying fastest, then rows, then images; the voxel at (row, column,
+// image) is found at index (image * rows + row) * columns + column. Dimensions and offsets are ordered like (row,
+// column, image) to match the voxel triplets used by the volumetric neighbourhood sampler.
+using volume_dims = std::array<long int, 3>;
+
+enum class volume_kernel_reduction {
+    inner_product,      // out(p) = sum_q k(q) * v(p + q - offset).
+    euclidean_distance, // out(p) = sqrt( sum_q ( v(p + q - offset) - k(q) )^2 ).
+};
+
+// Applies a kernel to every voxel of a volume using FFT-based overlap-save blocking.
+//
+// The kernel voxel at q is paired with the volume voxel at p + q - offset, so an offset of half the kernel dimensions
+// (approximately) centres the kernel. To convolve, spatially flip the kernel and use an offset of (K - 1 - offset).
+//
+// The volume is divided into tiles that are transformed and reduced independently on a thread pool. The output has the
+// same dimensions as the volume. Voxels for which the kernel would extend beyond the volume, or which would pair the
+// kernel with a non-finite voxel, are assigned NaN.
+//
+// The kernel must contain only finite values.
+std::vector<double> Apply_Kernel_Via_FFT( const std::vector<double> &vol,
+                                          const volume_dims &vol_dims,
+                                          const std::vector<double> &kernel,
+                                          const volume_dims &kernel_dims,
+                                          const volume_dims &offset,
+                                          volume_kernel_reduction reduction );
+
+// Estimates whether Apply_Kernel_Via_FFT() will be faster than directly sampling the kernel neighbourhood of every
+// voxel. This is a coarse operation count comparison.
+bool FFT_Is_Preferable( const volume_dims &vol_dims,
+                        const volume_dims &kernel_dims );
+
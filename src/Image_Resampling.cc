@@ -0,0 +1,378 @@
+//Image_Resampling.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+
+#include "Image_Resampling.h"
+
+
+static std::shared_ptr<resampling_axis_table>
+Make_Resampling_Axis_Table( long int N_src,
+                            long int N_dst,
+                            double scale,
+                            double shift,
+                            resampling_kernel kernel,
+                            resampling_boundary boundary ){
+    if( (N_src <= 0) || (N_dst < 0) ){
+        throw std::invalid_argument("Resampling table dimensions are invalid");
+    }
+
+    auto t = std::make_shared<resampling_axis_table>();
+    t->N_src = N_src;
+    t->N_dst = N_dst;
+    t->taps = (kernel == resampling_kernel::nearest) ? 1
+            : (kernel == resampling_kernel::linear)  ? 2
+                                                     : 4;
+    t->identity = (N_src == N_dst)
+               && (std::abs(scale - 1.0) < 1E-9)
+               && (std::abs(shift) < 1E-9);
+    t->index.resize(N_dst * t->taps, 0);
+    t->weight.resize(N_dst * t->taps, 0.0f);
+    t->inside.resize(N_dst, 1);
+
+    const auto clamp_index = [N_src](long int i) -> long int {
+        return std::clamp<long int>(i, 0, N_src - 1);
+    };
+
+    const double eps = 1E-6;
+    for(long int d = 0; d < N_dst; ++d){
+        const double s = t->identity ? static_cast<double>(d) : (scale * static_cast<double>(d) + shift);
+        if( (boundary == resampling_boundary::nan)
+        &&  ( (s < (-0.5 - eps)) || ((static_cast<double>(N_src) - 0.5 + eps) < s) ) ){
+            t->inside[d] = 0;
+        }
+
+        long int *idx = &(t->index[d * t->taps]);
+        float *w = &(t->weight[d * t->taps]);
+        if(kernel == resampling_kernel::nearest){
+            idx[0] = clamp_index( static_cast<long int>(std::floor(s + 0.5)) );
+            w[0] = 1.0f;
+
+        }else if(kernel == resampling_kernel::linear){
+            const double s_c = std::clamp<double>(s, 0.0, static_cast<double>(N_src - 1));
+            const auto i0 = static_cast<long int>(std::floor(s_c));
+            const double f = s_c - static_cast<double>(i0);
+            idx[0] = clamp_index(i0);
+            idx[1] = clamp_index(i0 + 1);
+            w[0] = static_cast<float>(1.0 - f);
+            w[1] = static_cast<float>(f);
+
+        }else{
+            const auto i1 = static_cast<long int>(std::floor(s));
+            const double f = s - static_cast<double>(i1);
+            const double f2 = f * f;
+            const double f3 = f2 * f;
+            idx[0] = clamp_index(i1 - 1);
+            idx[1] = clamp_index(i1);
+            idx[2] = clamp_index(i1 + 1);
+            idx[3] = clamp_index(i1 + 2);
+            w[0] = static_cast<float>(0.5 * (-f3 + 2.0 * f2 - f));
+            w[1] = static_cast<float>(0.5 * (3.0 * f3 - 5.0 * f2 + 2.0));
+            w[2] = static_cast<float>(0.5 * (-3.0 * f3 + 4.0 * f2 + f));
+            w[3] = static_cast<float>(0.5 * (f3 - f2));
+        }
+    }
+    return t;
+}
+
+std::shared_ptr<const resampling_axis_table>
+Get_Resampling_Axis_Table( long int N_src,
+                           long int N_dst,
+                           double scale,
+                           double shift,
+                           resampling_kernel kernel,
+                           resampling_boundary boundary ){
+
+    // Resampling many images (e.g., every channel and time point of a series) onto the same grid is common, so tables
+    // are cached. The cache is small and simply cleared when full.
+    using key_t = std::tuple<long int, long int, double, double, int, int>;
+    static std::mutex m;
+    static std::map<key_t, std::shared_ptr<const resampling_axis_table>> cache;
+    const size_t max_cache_size = 256;
+
+    const key_t key{ N_src, N_dst, scale, shift, static_cast<int>(kernel), static_cast<int>(boundary) };
+    {
+        std::lock_guard<std::mutex> lock(m);
+        auto it = cache.find(key);
+        if(it != std::end(cache)) return it->second;
+    }
+
+    std::shared_ptr<const resampling_axis_table> t = Make_Resampling_Axis_Table(N_src, N_dst, scale, shift, kernel, boundary);
+
+    std::lock_guard<std::mutex> lock(m);
+    if(max_cache_size <= cache.size()) cache.clear();
+    cache.emplace(key, t);
+    return t;
+}
+
+
+void Resample_Plane( const float *src,
+                     long int channels,
+                     const resampling_axis_table &row_table,
+                     const resampling_axis_table &col_table,
+                     float *dst,
+                     long int channel ){
+
+    const auto src_rows = row_table.N_src;
+    const auto src_cols = col_table.N_src;
+    const auto dst_rows = row_table.N_dst;
+    const auto dst_cols = col_table.N_dst;
+    if( (channels <= 0) || (channels <= channel) ){
+        throw std::invalid_argument("Requested channel is not present");
+    }
+
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    const long int chnl_min = (channel < 0) ? 0 : channel;
+    const long int chnl_max = (channel < 0) ? (channels - 1) : channel;
+
+    std::vector<float> plane;   // Contiguous source plane for a single channel.
+    std::vector<float> interim; // Source plane resampled along rows only.
+    for(long int ch = chnl_min; ch <= chnl_max; ++ch){
+        const float *P = src;
+        if(channels != 1){
+            plane.resize(src_rows * src_cols);
+            for(long int i = 0; i < (src_rows * src_cols); ++i){
+                plane[i] = src[i * channels + ch];
+            }
+            P = plane.data();
+        }
+
+        // Resample along rows first. Each destination row is a weighted sum of whole source rows, which is a
+        // contiguous multiply-accumulate that compilers can vectorize.
+        const float *T = P;
+        if(!row_table.identity){
+            interim.assign(dst_rows * src_cols, 0.0f);
+            for(long int r = 0; r < dst_rows; ++r){
+                float *out_row = &interim[r * src_cols];
+                for(long int k = 0; k < row_table.taps; ++k){
+                    const auto w = row_table.weight[r * row_table.taps + k];
+                    if(w == 0.0f) continue;
+                    const float *in_row = P + row_table.index[r * row_table.taps + k] * src_cols;
+                    for(long int c = 0; c < src_cols; ++c){
+                        out_row[c] += w * in_row[c];
+                    }
+                }
+            }
+            T = interim.data();
+        }
+
+        // Resample along columns.
+        for(long int r = 0; r < dst_rows; ++r){
+            const float *in_row = T + r * src_cols;
+            const bool row_inside = (row_table.inside[r] != 0);
+            for(long int c = 0; c < dst_cols; ++c){
+                float val = nan;
+                if(row_inside && (col_table.inside[c] != 0)){
+                    if(col_table.identity){
+                        val = in_row[c];
+                    }else{
+                        val = 0.0f;
+                        for(long int k = 0; k < col_table.taps; ++k){
+                            const auto w = col_table.weight[c * col_table.taps + k];
+                            if(w == 0.0f) continue;
+                            val += w * in_row[ col_table.index[c * col_table.taps + k] ];
+                        }
+                    }
+                }
+                dst[(r * dst_cols + c) * channels + ch] = val;
+            }
+        }
+    }
+    return;
+}
+
+
+resampling_stack::resampling_stack( const std::list<std::reference_wrapper<planar_image<float,double>>> &src_imgs ){
+    if(src_imgs.empty()) return;
+
+    const auto &first = src_imgs.front().get();
+    if( (first.rows <= 0) || (first.columns <= 0) || (first.channels <= 0)
+    ||  !(0.0 < first.pxl_dx) || !(0.0 < first.pxl_dy) ){
+        return;
+    }
+    this->origin = first.position(0, 0);
+    this->row_unit = first.row_unit.unit();
+    this->col_unit = first.col_unit.unit();
+    this->normal = this->row_unit.Cross(this->col_unit).unit();
+
+    std::vector<std::pair<double, const planar_image<float,double> *>> sorted;
+    for(const auto &img_refw : src_imgs){
+        const auto &img = img_refw.get();
+        if( (img.rows != first.rows)
+        ||  (img.columns != first.columns)
+        ||  (img.channels != first.channels)
+        ||  (first.pxl_dx * 1E-6 < std::abs(img.pxl_dx - first.pxl_dx))
+        ||  (first.pxl_dy * 1E-6 < std::abs(img.pxl_dy - first.pxl_dy))
+        ||  (img.row_unit.unit().Dot(this->row_unit) < (1.0 - 1E-6))
+        ||  (img.col_unit.unit().Dot(this->col_unit) < (1.0 - 1E-6)) ){
+            return;
+        }
+
+        // Images must be aligned in-plane.
+        const auto dR = img.position(0, 0) - this->origin;
+        if( (first.pxl_dx * 1E-3 < std::abs(dR.Dot(this->row_unit)))
+        ||  (first.pxl_dy * 1E-3 < std::abs(dR.Dot(this->col_unit))) ){
+            return;
+        }
+        sorted.emplace_back( dR.Dot(this->normal), std::addressof(img) );
+    }
+    std::stable_sort(std::begin(sorted), std::end(sorted),
+                     [](const std::pair<double, const planar_image<float,double> *> &L,
+                        const std::pair<double, const planar_image<float,double> *> &R){
+                         return (L.first < R.first);
+                     });
+    for(const auto &p : sorted){
+        this->z.push_back(p.first);
+        this->imgs.push_back(p.second);
+    }
+    this->valid = true;
+}
+
+bool resampling_stack::is_valid() const {
+    return this->valid;
+}
+
+bool resampling_stack::is_compatible( const planar_image<float,double> &dst ) const {
+    if(!this->valid) return false;
+    const auto &first = *(this->imgs.front());
+    return (dst.channels == first.channels)
+        && (0.0 < dst.pxl_dx)
+        && (0.0 < dst.pxl_dy)
+        && (static_cast<long int>(dst.data.size()) == (dst.rows * dst.columns * dst.channels))
+        && ((1.0 - 1E-6) <= dst.row_unit.unit().Dot(this->row_unit))
+        && ((1.0 - 1E-6) <= dst.col_unit.unit().Dot(this->col_unit));
+}
+
+void resampling_stack::slice_weights( const vec3<double> &pos,
+                                      resampling_kernel kernel,
+                                      std::vector<const planar_image<float,double> *> &out_imgs,
+                                      std::vector<float> &out_weights ) const {
+    out_imgs.clear();
+    out_weights.clear();
+    if(!this->valid) return;
+
+    const auto N = static_cast<long int>(this->z.size());
+    const auto z_p = (pos - this->origin).Dot(this->normal);
+
+    if(kernel == resampling_kernel::nearest){
+        long int nearest = 0;
+        for(long int i = 1; i < N; ++i){
+            if(std::abs(this->z[i] - z_p) < std::abs(this->z[nearest] - z_p)) nearest = i;
+        }
+        out_imgs.push_back(this->imgs[nearest]);
+        out_weights.push_back(1.0f);
+        return;
+    }
+
+    // Image 'a' is the nearest image at or below the point, and image 'b' is the nearest image above it.
+    const auto b = static_cast<long int>( std::distance( std::begin(this->z),
+                                                         std::upper_bound(std::begin(this->z), std::end(this->z), z_p) ) );
+    const auto a = b - 1;
+
+    if(a < 0){
+        out_imgs.push_back(this->imgs[b]);
+        out_weights.push_back(1.0f);
+        return;
+    }
+    if(N <= b){
+        out_imgs.push_back(this->imgs[a]);
+        out_weights.push_back(1.0f);
+        return;
+    }
+
+    if( (kernel == resampling_kernel::cubic)
+    &&  (0 <= (a - 1)) && ((b + 1) < N) ){
+        const std::array<long int, 4> ids = {{ a - 1, a, b, b + 1 }};
+        bool distinct = true;
+        for(size_t i = 1; i < ids.size(); ++i){
+            if(std::abs(this->z[ids[i]] - this->z[ids[i-1]]) < 1E-6) distinct = false;
+        }
+        if(distinct){
+            for(size_t i = 0; i < ids.size(); ++i){
+                double w = 1.0;
+                for(size_t j = 0; j < ids.size(); ++j){
+                    if(i == j) continue;
+                    w *= (z_p - this->z[ids[j]]) / (this->z[ids[i]] - this->z[ids[j]]);
+                }
+                out_imgs.push_back(this->imgs[ids[i]]);
+                out_weights.push_back(static_cast<float>(w));
+            }
+            return;
+        }
+    }
+
+    // Linear interpolation. If the images overlap, weight them equally in a numerically-stable way.
+    auto a_dist = z_p - this->z[a];
+    auto b_dist = this->z[b] - z_p;
+    auto total_dist = a_dist + b_dist;
+    if(total_dist < 1E-3){
+        a_dist = 1.0;
+        b_dist = 1.0;
+        total_dist = 2.0;
+    }
+    out_imgs.push_back(this->imgs[a]);
+    out_weights.push_back(static_cast<float>(b_dist / total_dist)); // Note: weights are anti-paired.
+    out_imgs.push_back(this->imgs[b]);
+    out_weights.push_back(static_cast<float>(a_dist / total_dist));
+    return;
+}
+
+bool resampling_stack::resample( planar_image<float,double> &dst,
+                                 long int channel,
+                                 resampling_kernel kernel,
+                                 resampling_boundary boundary ) const {
+    if(!this->is_compatible(dst)) return false;
+    const auto &first = *(this->imgs.front());
+    if(first.channels <= channel) return false;
+
+    // Row numbers advance along row_unit in steps of pxl_dx, and column numbers along col_unit in steps of pxl_dy.
+    const auto dR = dst.position(0, 0) - this->origin;
+    const auto row_table = Get_Resampling_Axis_Table( first.rows, dst.rows,
+                                                      dst.pxl_dx / first.pxl_dx,
+                                                      dR.Dot(this->row_unit) / first.pxl_dx,
+                                                      kernel, boundary );
+    const auto col_table = Get_Resampling_Axis_Table( first.columns, dst.columns,
+                                                      dst.pxl_dy / first.pxl_dy,
+                                                      dR.Dot(this->col_unit) / first.pxl_dy,
+                                                      kernel, boundary );
+
+    std::vector<const planar_image<float,double> *> s_imgs;
+    std::vector<float> s_weights;
+    this->slice_weights(dst.position(0, 0), kernel, s_imgs, s_weights);
+    if(s_imgs.empty()) return false;
+
+    // Combine the contributing images into a single plane, unless only one contributes.
+    const float *src = s_imgs.front()->data.data();
+    std::vector<float> combined;
+    if( (s_imgs.size() != 1) || (s_weights.front() != 1.0f) ){
+        combined.assign(first.data.size(), 0.0f);
+        for(size_t j = 0; j < s_imgs.size(); ++j){
+            const auto w = s_weights[j];
+            if(w == 0.0f) continue;
+            const float *in = s_imgs[j]->data.data();
+            const auto N_elem = combined.size();
+            for(size_t i = 0; i < N_elem; ++i){
+                combined[i] += w * in[i];
+            }
+        }
+        src = combined.data();
+    }
+
+    Resample_Plane(src, first.channels, *row_table, *col_table, dst.data.data(), channel);
+    return true;
+}
+
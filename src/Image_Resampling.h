@@ -0,0 +1,105 @@
+//Image_Resampling.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+
+
+// Interpolation kernels. Each is applied separably along each axis.
+enum class resampling_kernel {
+    nearest,  // Nearest neighbour (1 tap).
+    linear,   // Linear (2 taps).
+    cubic,    // Catmull-Rom cubic convolution (4 taps).
+};
+
+// Treatment of destination samples that fall outside of the source grid.
+enum class resampling_boundary {
+    extend,   // Use the nearest edge voxel.
+    nan,      // Emit NaN for samples further than half a voxel beyond the outermost voxel centres.
+};
+
+
+// A precomputed table of source indices and weights for one axis.
+//
+// Destination sample 'd' is located at source sample coordinate 's = scale * d + shift' in pixel-number space. Source
+// indices are already clamped to the source grid, so tables can be applied without bounds checks.
+struct resampling_axis_table {
+    long int N_src = 0;
+    long int N_dst = 0;
+    long int taps  = 0;
+    bool identity  = false;          // Whether the table maps each destination sample exactly onto the same source sample.
+
+    std::vector<long int> index;     // N_dst * taps source indices.
+    std::vector<float> weight;       // N_dst * taps weights.
+    std::vector<uint8_t> inside;     // N_dst flags; samples outside the source grid are NaN (resampling_boundary::nan).
+};
+
+// Returns a (possibly cached) table. Tables are immutable once created and can be shared between threads.
+std::shared_ptr<const resampling_axis_table>
+Get_Resampling_Axis_Table( long int N_src,
+                           long int N_dst,
+                           double scale,
+                           double shift,
+                           resampling_kernel kernel,
+                           resampling_boundary boundary );
+
+// Resamples a single plane of interleaved channels using a pair of separable axis tables.
+//
+// The source is indexed like planar_image::data: channels * (columns * row + column) + channel. If 'channel' is
+// negative all channels are resampled, otherwise only the given channel is written.
+void Resample_Plane( const float *src,
+                     long int channels,
+                     const resampling_axis_table &row_table,
+                     const resampling_axis_table &col_table,
+                     float *dst,
+                     long int channel );
+
+
+// A rectilinear stack of source images that destination images can be resampled from.
+//
+// The source images must share row and column counts, voxel dimensions, and orientation, and must be aligned in-plane
+// so that they differ only by a translation along the image normal. Destination images need only share the
+// orientation; they may have any in-plane voxel dimensions, extent, and position.
+class resampling_stack {
+  private:
+    std::vector<const planar_image<float,double> *> imgs; // Sorted along the normal.
+    std::vector<double> z;                                // Position of each image along the normal.
+    vec3<double> origin;                                  // Position of voxel (0,0) of the first image.
+    vec3<double> row_unit;
+    vec3<double> col_unit;
+    vec3<double> normal;
+    bool valid = false;
+
+  public:
+    explicit resampling_stack( const std::list<std::reference_wrapper<planar_image<float,double>>> &src_imgs );
+
+    // Whether the source images satisfied the requirements.
+    bool is_valid() const;
+
+    // Whether the destination image can be resampled using separable tables.
+    bool is_compatible( const planar_image<float,double> &dst ) const;
+
+    // Determines the source images and weights needed to sample the given position along the normal.
+    //
+    // Linear weights mirror planar slice interpolation: the nearest images on either side are weighted by distance,
+    // and the nearest image alone is used beyond the extrema. Cubic weights use Lagrange interpolation over the two
+    // nearest images on either side where available, reverting to linear weights otherwise.
+    void slice_weights( const vec3<double> &pos,
+                        resampling_kernel kernel,
+                        std::vector<const planar_image<float,double> *> &out_imgs,
+                        std::vector<float> &out_weights ) const;
+
+    // Overwrites the voxels of the destination image. Returns false if the destination is not compatible.
+    bool resample( planar_image<float,double> &dst,
+                   long int channel,
+                   resampling_kernel kernel,
+                   resampling_boundary boundary ) const;
+};
+
@@ -11,19 +11,28 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <exception>
 #include <optional>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <list>
 #include <map>
 #include <memory>         //Needed for std::unique_ptr.
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>        //Needed for std::pair.
 #include <vector>
@@ -2246,6 +2255,181 @@ Load_TPlan_Config(const std::string &FilenameIn){
 }
 
 
+//------------------------------------------------------------------------------------------------------------------
+// Helpers for the native (DCMA_DICOM-based) writers.
+
+// An output stream buffer that appends to a caller-provided string. The string can be reserved beforehand so that
+// encoding a file does not repeatedly reallocate.
+class string_append_streambuf : public std::streambuf {
+  private:
+    std::string &buf;
+
+  protected:
+    int_type overflow(int_type ch) override {
+        if(traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        this->buf.push_back(traits_type::to_char_type(ch));
+        return ch;
+    }
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        this->buf.append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+  public:
+    explicit string_append_streambuf(std::string &b) : buf(b) {}
+};
+
+// An input stream buffer that reads directly from an existing block of memory without copying it.
+class memory_streambuf : public std::streambuf {
+  public:
+    memory_streambuf(const char *b, size_t n){
+        auto p = const_cast<char *>(b);
+        this->setg(p, p, p + n);
+    }
+};
+
+// Emits a DICOM file into a single buffer, reserving 'expected_size' bytes up front.
+static
+std::string
+Emit_DICOM_To_Buffer(const DCMA_DICOM::Node &root_node,
+                     DCMA_DICOM::Encoding enc,
+                     size_t expected_size){
+    std::string out;
+    out.reserve(expected_size);
+    {
+        string_append_streambuf sb(out);
+        std::ostream os(&sb);
+        const auto bytes_reqd = root_node.emit_DICOM(os, enc);
+        if(!os) throw std::runtime_error("Stream not in good state after emitting DICOM file");
+        if(bytes_reqd <= 0) throw std::runtime_error("Not enough DICOM data available for valid file");
+    }
+    return out;
+}
+
+// Invokes the functor for every index in [0, N) using a fixed set of worker threads.
+// The first exception thrown by any invocation is re-thrown after all workers have finished.
+static
+void
+Parallel_For_Each_Index(size_t N,
+                        const std::function<void(size_t)> &f){
+    const size_t n_threads = std::min<size_t>(N, std::max<size_t>(1, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next_index(0);
+    std::atomic<bool> abort(false);
+    std::mutex m;
+    std::exception_ptr eptr;
+
+    const auto worker = [&]() -> void {
+        while(!abort.load()){
+            const auto i = next_index.fetch_add(1);
+            if(N <= i) return;
+            try{
+                f(i);
+            }catch(...){
+                std::lock_guard<std::mutex> lock(m);
+                if(!eptr) eptr = std::current_exception();
+                abort.store(true);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < n_threads; ++i) threads.emplace_back(worker);
+    worker();
+    for(auto &t : threads) t.join();
+
+    if(eptr) std::rethrow_exception(eptr);
+    return;
+}
+
+// Encodes items concurrently and hands the encoded buffers to the consumer strictly in index order. At most
+// 'max_in_flight' items are being encoded or are awaiting consumption at any one time, which bounds memory usage
+// when there are many large items. The consumer is invoked on the calling thread.
+static
+void
+Encode_In_Parallel_Consume_In_Order(size_t N,
+                                    const std::function<std::string(size_t)> &encode,
+                                    const std::function<void(size_t, std::string &)> &consume,
+                                    size_t max_in_flight = 0){
+    const size_t n_threads = std::min<size_t>(N, std::max<size_t>(1, std::thread::hardware_concurrency()));
+    if(max_in_flight == 0) max_in_flight = 2 * n_threads;
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::map<size_t, std::string> ready;
+    size_t next_claim = 0;
+    size_t next_consume = 0;
+    bool abort = false;
+    std::exception_ptr eptr;
+
+    const auto worker = [&]() -> void {
+        while(true){
+            size_t i = 0;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]() -> bool {
+                    return abort || (N <= next_claim) || ((next_claim - next_consume) < max_in_flight);
+                });
+                if(abort || (N <= next_claim)) return;
+                i = next_claim++;
+            }
+            try{
+                auto buf = encode(i);
+                std::lock_guard<std::mutex> lock(m);
+                ready.emplace(i, std::move(buf));
+            }catch(...){
+                std::lock_guard<std::mutex> lock(m);
+                if(!eptr) eptr = std::current_exception();
+                abort = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < n_threads; ++i) threads.emplace_back(worker);
+
+    try{
+        for(size_t i = 0; i < N; ++i){
+            std::string buf;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]() -> bool {
+                    return abort || (ready.count(i) != 0);
+                });
+                if(abort) break;
+                auto it = ready.find(i);
+                buf = std::move(it->second);
+                ready.erase(it);
+            }
+            consume(i, buf);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                ++next_consume;
+            }
+            cv.notify_all();
+        }
+    }catch(...){
+        std::lock_guard<std::mutex> lock(m);
+        if(!eptr) eptr = std::current_exception();
+        abort = true;
+    }
+    cv.notify_all();
+    for(auto &t : threads) t.join();
+
+    if(eptr) std::rethrow_exception(eptr);
+    return;
+}
+
+// Formats a number for a DICOM decimal string (DS), which is limited to 16 characters.
+static
+std::string
+To_DICOM_DS(double x){
+    std::ostringstream ss;
+    ss << std::setprecision(9) << x;
+    return ss.str();
+}
+
+
 //This routine writes contiguous images to a single DICOM dose file.
 //
 // NOTE: Images are assumed to be contiguous and non-overlapping. They are also assumed to share image characteristics,
@@ -2273,27 +2457,34 @@ void Write_Dose_Array(const std::shared_ptr<Image_Array>& IA, const std::string
         throw std::runtime_error("No images provided for export. Cannot continue.");
     }
 
-    using namespace puntoexe;
-    ptr<imebra::dataSet> tds(new imebra::dataSet);
-
     //Gather some basic info. Note that the following dimensions must be identical for all images for a multi-frame
     // RTDOSE file.
     const auto num_of_imgs = IA->imagecoll.images.size();
     const auto row_count = IA->imagecoll.images.front().rows;
     const auto col_count = IA->imagecoll.images.front().columns;
-
-    auto max_dose = -std::numeric_limits<float>::infinity();
     for(const auto &p_img : IA->imagecoll.images){
+        if( (p_img.rows != row_count) || (p_img.columns != col_count) || (p_img.channels < 1) ){
+            throw std::invalid_argument("Images do not share the same dimensions. Refusing to continue.");
+        }
+    }
+
+    std::vector<const planar_image<float,double> *> imgs;
+    for(const auto &p_img : IA->imagecoll.images) imgs.emplace_back( &p_img );
+
+    std::vector<float> max_doses(num_of_imgs, -std::numeric_limits<float>::infinity());
+    Parallel_For_Each_Index(num_of_imgs, [&](size_t i) -> void {
+        const auto &p_img = *(imgs[i]);
         const long int channel = 0; // Ignore other channels for now. TODO.
         for(long int r = 0; r < row_count; r++){
             for(long int c = 0; c < col_count; c++){
                 const auto val = p_img.value(r, c, channel);
                 if(!std::isfinite(val)) throw std::domain_error("Found non-finite dose. Refusing to export.");
                 if(val < 0.0f ) throw std::domain_error("Found a voxel with negative dose. Refusing to continue.");
-                if(max_dose < val) max_dose = val;
+                if(max_doses[i] < val) max_doses[i] = val;
             }
         }
-    }
+    });
+    const auto max_dose = *std::max_element(std::begin(max_doses), std::end(max_doses));
     if( max_dose < 0.0f ) throw std::invalid_argument("No voxels were found to export. Cannot continue.");
     const double full_dose_scaling = max_dose / static_cast<double>(std::numeric_limits<uint32_t>::max());
     const double dose_scaling = std::max(full_dose_scaling, 1.0E-5); //Because excess bits might get truncated!
@@ -2321,6 +2512,8 @@ void Write_Dose_Array(const std::shared_ptr<Image_Array>& IA, const std::string
         }
         return ( lhs.position(0,0).Dot(ortho_unit) < rhs.position(0,0).Dot(ortho_unit) );
     });
+    imgs.clear();
+    for(const auto &p_img : IA->imagecoll.images) imgs.emplace_back( &p_img );
 
     const auto image_pos = IA->imagecoll.images.front().offset - IA->imagecoll.images.front().anchor;
     const auto ImagePositionPatient = std::to_string(image_pos.x) + R"***(\)***"_s
@@ -2353,13 +2546,8 @@ void Write_Dose_Array(const std::shared_ptr<Image_Array>& IA, const std::string
         return std::string(); 
     };
 
-    //Specify the list of acceptable character sets.
-    {
-        imebra::charsetsList::tCharsetsList suitableCharsets;
-        suitableCharsets.emplace_back(L"ISO_IR 100"); // "Latin alphabet 1"
-        //suitableCharsets.push_back(L"ISO_IR 192"); // utf-8
-        tds->setCharsetsList(&suitableCharsets);
-    }
+    DCMA_DICOM::Encoding enc = DCMA_DICOM::Encoding::ELE;
+    DCMA_DICOM::Node root_node;
 
     //Top-level stuff: metadata shared by all images.
     {
@@ -2441,187 +2629,183 @@ void Write_Dose_Array(const std::shared_ptr<Image_Array>& IA, const std::string
         //Generate some UIDs that need to be duplicated.
         const auto SOPInstanceUID = Generate_Random_UID(60);
 
+        //-------------------------------------------------------------------------------------------------
         //DICOM Header Metadata.
-        ds_OB_insert(tds, {0x0002, 0x0001},  std::string(1,static_cast<char>(0))
-                                           + std::string(1,static_cast<char>(1)) ); //"FileMetaInformationVersion".
-        //ds_insert(tds, {0x0002, 0x0001}, R"***(2/0/0/0/0/1)***"); //shtl); //"FileMetaInformationVersion".
-        ds_insert(tds, {0x0002, 0x0002}, "1.2.840.10008.5.1.4.1.1.481.2"); //"MediaStorageSOPClassUID" (Radiation Therapy Dose Storage)
-        ds_insert(tds, {0x0002, 0x0003}, SOPInstanceUID); //"MediaStorageSOPInstanceUID".
-        ds_insert(tds, {0x0002, 0x0010}, "1.2.840.10008.1.2.1"); //"TransferSyntaxUID".
-        ds_insert(tds, {0x0002, 0x0013}, "DICOMautomaton"); //"ImplementationVersionName".
-        ds_insert(tds, {0x0002, 0x0012}, "1.2.513.264.765.1.1.578"); //"ImplementationClassUID".
+        root_node.emplace_child_node({{0x0002, 0x0001}, "OB", std::string("\x0\x1", 2)}); // FileMetaInformationVersion
+        root_node.emplace_child_node({{0x0002, 0x0002}, "UI", "1.2.840.10008.5.1.4.1.1.481.2"}); // MediaStorageSOPClassUID (Radiation Therapy Dose Storage)
+        root_node.emplace_child_node({{0x0002, 0x0003}, "UI", SOPInstanceUID}); // MediaStorageSOPInstanceUID
+        root_node.emplace_child_node({{0x0002, 0x0010}, "UI", "1.2.840.10008.1.2.1"}); // TransferSyntaxUID
+        root_node.emplace_child_node({{0x0002, 0x0012}, "UI", "1.2.513.264.765.1.1.578"}); // ImplementationClassUID
+        root_node.emplace_child_node({{0x0002, 0x0013}, "SH", "DICOMautomaton"}); // ImplementationVersionName
 
+        //-------------------------------------------------------------------------------------------------
         //SOP Common Module.
-        ds_insert(tds, {0x0008, 0x0016}, "1.2.840.10008.5.1.4.1.1.481.2"); // "SOPClassUID"
-        ds_insert(tds, {0x0008, 0x0018}, SOPInstanceUID); // "SOPInstanceUID"
-        //ds_insert(tds, {0x0008, 0x0005}, "ISO_IR 100"); //fne({ cm["SpecificCharacterSet"], "ISO_IR 100" })); // Set above!
-        ds_insert(tds, {0x0008, 0x0012}, fne({ cm["InstanceCreationDate"], "19720101" }));
-        ds_insert(tds, {0x0008, 0x0013}, fne({ cm["InstanceCreationTime"], "010101" }));
-        ds_insert(tds, {0x0008, 0x0014}, foe({ cm["InstanceCreatorUID"] }));
-        ds_insert(tds, {0x0008, 0x0114}, foe({ cm["CodingSchemeExternalUID"] }));
-        ds_insert(tds, {0x0020, 0x0013}, foe({ cm["InstanceNumber"] }));
+        root_node.emplace_child_node({{0x0008, 0x0016}, "UI", "1.2.840.10008.5.1.4.1.1.481.2"}); // SOPClassUID
+        root_node.emplace_child_node({{0x0008, 0x0018}, "UI", SOPInstanceUID}); // SOPInstanceUID
+        root_node.emplace_child_node({{0x0008, 0x0005}, "CS", "ISO_IR 100"}); // 'ISO_IR 100' = Latin alphabet 1.
+        root_node.emplace_child_node({{0x0008, 0x0012}, "DA", fne({ cm["InstanceCreationDate"], "19720101" }) });
+        root_node.emplace_child_node({{0x0008, 0x0013}, "TM", fne({ cm["InstanceCreationTime"], "010101" }) });
+        root_node.emplace_child_node({{0x0008, 0x0014}, "UI", foe({ cm["InstanceCreatorUID"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0114}, "ST", foe({ cm["CodingSchemeExternalUID"] }) });
 
+        //-------------------------------------------------------------------------------------------------
         //Patient Module.
-        ds_insert(tds, {0x0010, 0x0010}, fne({ cm["PatientsName"], "DICOMautomaton^DICOMautomaton" }));
-        ds_insert(tds, {0x0010, 0x0020}, fne({ cm["PatientID"], "DCMA_"_s + Generate_Random_String_of_Length(10) }));
-        ds_insert(tds, {0x0010, 0x0030}, fne({ cm["PatientsBirthDate"], "19720101" }));
-        ds_insert(tds, {0x0010, 0x0040}, fne({ cm["PatientsGender"], "O" }));
-        ds_insert(tds, {0x0010, 0x0032}, fne({ cm["PatientsBirthTime"], "010101" }));
+        root_node.emplace_child_node({{0x0010, 0x0010}, "PN", fne({ cm["PatientsName"], "DICOMautomaton^DICOMautomaton" }) });
+        root_node.emplace_child_node({{0x0010, 0x0020}, "LO", fne({ cm["PatientID"], "DCMA_"_s + Generate_Random_String_of_Length(10) }) });
+        root_node.emplace_child_node({{0x0010, 0x0030}, "DA", fne({ cm["PatientsBirthDate"], "19720101" }) });
+        root_node.emplace_child_node({{0x0010, 0x0040}, "CS", fne({ cm["PatientsGender"], "O" }) });
+        root_node.emplace_child_node({{0x0010, 0x0032}, "TM", fne({ cm["PatientsBirthTime"], "010101" }) });
 
+        //-------------------------------------------------------------------------------------------------
         //General Study Module.
-        ds_insert(tds, {0x0020, 0x000D}, fne({ cm["StudyInstanceUID"], Generate_Random_UID(31) }));
-        ds_insert(tds, {0x0008, 0x0020}, fne({ cm["StudyDate"], "19720101" }));
-        ds_insert(tds, {0x0008, 0x0030}, fne({ cm["StudyTime"], "010101" }));
-        ds_insert(tds, {0x0008, 0x0090}, fne({ cm["ReferringPhysiciansName"], "UNSPECIFIED^UNSPECIFIED" }));
-        ds_insert(tds, {0x0020, 0x0010}, fne({ cm["StudyID"], "DCMA_"_s + Generate_Random_String_of_Length(10) })); // i.e., "Course"
-        ds_insert(tds, {0x0008, 0x0050}, fne({ cm["AccessionNumber"], Generate_Random_String_of_Length(14) }));
-        ds_insert(tds, {0x0008, 0x1030}, fne({ cm["StudyDescription"], "UNSPECIFIED" }));
+        root_node.emplace_child_node({{0x0020, 0x000D}, "UI", fne({ cm["StudyInstanceUID"], Generate_Random_UID(31) }) });
+        root_node.emplace_child_node({{0x0008, 0x0020}, "DA", fne({ cm["StudyDate"], "19720101" }) });
+        root_node.emplace_child_node({{0x0008, 0x0030}, "TM", fne({ cm["StudyTime"], "010101" }) });
+        root_node.emplace_child_node({{0x0008, 0x0090}, "PN", fne({ cm["ReferringPhysiciansName"], "UNSPECIFIED^UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0020, 0x0010}, "SH", fne({ cm["StudyID"], "DCMA_"_s + Generate_Random_String_of_Length(10) }) }); // i.e., "Course"
+        root_node.emplace_child_node({{0x0008, 0x0050}, "SH", fne({ cm["AccessionNumber"], Generate_Random_String_of_Length(14) }) });
+        root_node.emplace_child_node({{0x0008, 0x1030}, "LO", fne({ cm["StudyDescription"], "UNSPECIFIED" }) });
 
+        //-------------------------------------------------------------------------------------------------
         //General Series Module.
-        ds_insert(tds, {0x0008, 0x0060}, "RTDOSE");
-        ds_insert(tds, {0x0020, 0x000E}, fne({ cm["SeriesInstanceUID"], Generate_Random_UID(31) }));
-        ds_insert(tds, {0x0020, 0x0011}, fne({ cm["SeriesNumber"], Generate_Random_Int_Str(5000, 32767) })); // Upper: 2^15 - 1.
-        ds_insert(tds, {0x0008, 0x0021}, foe({ cm["SeriesDate"] }));
-        ds_insert(tds, {0x0008, 0x0031}, foe({ cm["SeriesTime"] }));
-        ds_insert(tds, {0x0008, 0x103E}, fne({ cm["SeriesDescription"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0018, 0x0015}, foe({ cm["BodyPartExamined"] }));
-        ds_insert(tds, {0x0018, 0x5100}, foe({ cm["PatientPosition"] }));
-        ds_insert(tds, {0x0040, 0x1001}, fne({ cm["RequestedProcedureID"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0040, 0x0009}, fne({ cm["ScheduledProcedureStepID"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x1070}, fne({ cm["OperatorsName"], "UNSPECIFIED" }));
+        root_node.emplace_child_node({{0x0008, 0x0060}, "CS", "RTDOSE" }); // "Modality"
+        root_node.emplace_child_node({{0x0020, 0x000E}, "UI", fne({ cm["SeriesInstanceUID"], Generate_Random_UID(31) }) });
+        root_node.emplace_child_node({{0x0020, 0x0011}, "IS", fne({ cm["SeriesNumber"], Generate_Random_Int_Str(5000, 32767) }) }); // Upper: 2^15 - 1.
+        root_node.emplace_child_node({{0x0008, 0x0021}, "DA", foe({ cm["SeriesDate"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0031}, "TM", foe({ cm["SeriesTime"] }) });
+        root_node.emplace_child_node({{0x0008, 0x103E}, "LO", fne({ cm["SeriesDescription"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0018, 0x0015}, "CS", foe({ cm["BodyPartExamined"] }) });
+        root_node.emplace_child_node({{0x0018, 0x5100}, "CS", foe({ cm["PatientPosition"] }) });
+        root_node.emplace_child_node({{0x0040, 0x1001}, "SH", fne({ cm["RequestedProcedureID"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0040, 0x0009}, "SH", fne({ cm["ScheduledProcedureStepID"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0008, 0x1070}, "PN", fne({ cm["OperatorsName"], "UNSPECIFIED" }) });
 
+        //-------------------------------------------------------------------------------------------------
         //Patient Study Module.
-        ds_insert(tds, {0x0010, 0x1030}, foe({ cm["PatientsMass"] }));
+        root_node.emplace_child_node({{0x0010, 0x1030}, "DS", foe({ cm["PatientsMass"] }) });
 
+        //-------------------------------------------------------------------------------------------------
         //Frame of Reference Module.
-        ds_insert(tds, {0x0020, 0x0052}, fne({ cm["FrameOfReferenceUID"], Generate_Random_UID(32) }));
-        ds_insert(tds, {0x0020, 0x1040}, fne({ cm["PositionReferenceIndicator"], "BB" }));
+        root_node.emplace_child_node({{0x0020, 0x0052}, "UI", fne({ cm["FrameOfReferenceUID"], Generate_Random_UID(32) }) });
+        root_node.emplace_child_node({{0x0020, 0x1040}, "LO", fne({ cm["PositionReferenceIndicator"], "BB" }) });
 
+        //-------------------------------------------------------------------------------------------------
         //General Equipment Module.
-        ds_insert(tds, {0x0008, 0x0070}, fne({ cm["Manufacturer"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x0080}, fne({ cm["InstitutionName"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x1010}, fne({ cm["StationName"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x1040}, fne({ cm["InstitutionalDepartmentName"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x1090}, fne({ cm["ManufacturersModelName"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0018, 0x1020}, fne({ cm["SoftwareVersions"], "UNSPECIFIED" }));
+        root_node.emplace_child_node({{0x0008, 0x0070}, "LO", fne({ cm["Manufacturer"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0008, 0x0080}, "LO", fne({ cm["InstitutionName"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0008, 0x1010}, "SH", fne({ cm["StationName"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0008, 0x1040}, "LO", fne({ cm["InstitutionalDepartmentName"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0008, 0x1090}, "LO", fne({ cm["ManufacturersModelName"], "UNSPECIFIED" }) });
+        root_node.emplace_child_node({{0x0018, 0x1020}, "LO", fne({ cm["SoftwareVersions"], "UNSPECIFIED" }) });
 
+        //-------------------------------------------------------------------------------------------------
         //General Image Module.
-        ds_insert(tds, {0x0020, 0x0013}, foe({ cm["InstanceNumber"] }));
-        //ds_insert(tds, {0x0020, 0x0020}, fne({ cm["PatientOrientation"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0008, 0x0023}, foe({ cm["ContentDate"] }));
-        ds_insert(tds, {0x0008, 0x0033}, foe({ cm["ContentTime"] }));
-        //ds_insert(tds, {0x0008, 0x0008}, fne({ cm["ImageType"], "UNSPECIFIED" }));
-        ds_insert(tds, {0x0020, 0x0012}, foe({ cm["AcquisitionNumber"] }));
-        ds_insert(tds, {0x0008, 0x0022}, foe({ cm["AcquisitionDate"] }));
-        ds_insert(tds, {0x0008, 0x0032}, foe({ cm["AcquisitionTime"] }));
-        ds_insert(tds, {0x0008, 0x2111}, foe({ cm["DerivationDescription"] }));
-        //insert_as_string_if_nonempty({0x0008, 0x9215}, "DerivationCodeSequence"], "" }));
-        ds_insert(tds, {0x0020, 0x1002}, foe({ cm["ImagesInAcquisition"] }));
-        ds_insert(tds, {0x0020, 0x4000}, "Research image generated by DICOMautomaton. Not for clinical use!" ); //"ImageComments".
-        ds_insert(tds, {0x0028, 0x0300}, foe({ cm["QualityControlImage"] }));
+        root_node.emplace_child_node({{0x0020, 0x0013}, "IS", foe({ cm["InstanceNumber"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0023}, "DA", foe({ cm["ContentDate"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0033}, "TM", foe({ cm["ContentTime"] }) });
+        root_node.emplace_child_node({{0x0020, 0x0012}, "IS", foe({ cm["AcquisitionNumber"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0022}, "DA", foe({ cm["AcquisitionDate"] }) });
+        root_node.emplace_child_node({{0x0008, 0x0032}, "TM", foe({ cm["AcquisitionTime"] }) });
+        root_node.emplace_child_node({{0x0008, 0x2111}, "ST", foe({ cm["DerivationDescription"] }) });
+        root_node.emplace_child_node({{0x0020, 0x1002}, "IS", foe({ cm["ImagesInAcquisition"] }) });
+        root_node.emplace_child_node({{0x0020, 0x4000}, "LT", "Research image generated by DICOMautomaton. Not for clinical use!" }); // ImageComments.
+        root_node.emplace_child_node({{0x0028, 0x0300}, "CS", foe({ cm["QualityControlImage"] }) });
 
+        //-------------------------------------------------------------------------------------------------
         //Image Plane Module.
-        ds_insert(tds, {0x0028, 0x0030}, PixelSpacing );
-        ds_insert(tds, {0x0020, 0x0037}, ImageOrientationPatient );
-        ds_insert(tds, {0x0020, 0x0032}, ImagePositionPatient );
-        ds_insert(tds, {0x0018, 0x0050}, SliceThickness );
-        ds_insert(tds, {0x0020, 0x1041}, "" ); // foe({ cm["SliceLocation"] }));
+        root_node.emplace_child_node({{0x0028, 0x0030}, "DS", PixelSpacing });
+        root_node.emplace_child_node({{0x0020, 0x0037}, "DS", ImageOrientationPatient });
+        root_node.emplace_child_node({{0x0020, 0x0032}, "DS", ImagePositionPatient });
+        root_node.emplace_child_node({{0x0018, 0x0050}, "DS", SliceThickness });
+        root_node.emplace_child_node({{0x0020, 0x1041}, "DS", "" }); // SliceLocation.
 
+        //-------------------------------------------------------------------------------------------------
         //Image Pixel Module.
-        ds_insert(tds, {0x0028, 0x0002}, fne({ cm["SamplesPerPixel"], "1" }));
-        ds_insert(tds, {0x0028, 0x0004}, fne({ cm["PhotometricInterpretation"], "MONOCHROME2" }));
-        ds_insert(tds, {0x0028, 0x0010}, fne({ std::to_string(row_count) })); // "Rows"
-        ds_insert(tds, {0x0028, 0x0011}, fne({ std::to_string(col_count) })); // "Columns"
-        ds_insert(tds, {0x0028, 0x0100}, "32" ); //fne({ cm["BitsAllocated"], "32" }));
-        ds_insert(tds, {0x0028, 0x0101}, "32" ); //fne({ cm["BitsStored"], "32" }));
-        ds_insert(tds, {0x0028, 0x0102}, "31" ); //fne({ cm["HighBit"], "31" }));
-        ds_insert(tds, {0x0028, 0x0103}, "0" ); // Unsigned.   fne({ cm["PixelRepresentation"], "0" }));
-        ds_insert(tds, {0x0028, 0x0006}, foe({ cm["PlanarConfiguration"] }));
-        ds_insert(tds, {0x0028, 0x0034}, foe({ cm["PixelAspectRatio"] }));
+        root_node.emplace_child_node({{0x0028, 0x0002}, "US", fne({ cm["SamplesPerPixel"], "1" }) });
+        root_node.emplace_child_node({{0x0028, 0x0004}, "CS", fne({ cm["PhotometricInterpretation"], "MONOCHROME2" }) });
+        root_node.emplace_child_node({{0x0028, 0x0010}, "US", std::to_string(row_count) }); // Rows
+        root_node.emplace_child_node({{0x0028, 0x0011}, "US", std::to_string(col_count) }); // Columns
+        root_node.emplace_child_node({{0x0028, 0x0100}, "US", "32" }); // BitsAllocated
+        root_node.emplace_child_node({{0x0028, 0x0101}, "US", "32" }); // BitsStored
+        root_node.emplace_child_node({{0x0028, 0x0102}, "US", "31" }); // HighBit
+        root_node.emplace_child_node({{0x0028, 0x0103}, "US", "0" }); // PixelRepresentation, unsigned.
+        if(!cm["PlanarConfiguration"].empty()){
+            root_node.emplace_child_node({{0x0028, 0x0006}, "US", cm["PlanarConfiguration"] });
+        }
+        root_node.emplace_child_node({{0x0028, 0x0034}, "IS", foe({ cm["PixelAspectRatio"] }) });
 
+        //-------------------------------------------------------------------------------------------------
         //Multi-Frame Module.
-        ds_insert(tds, {0x0028, 0x0008}, fne({ std::to_string(num_of_imgs) })); // "NumberOfFrames".
-        ds_insert(tds, {0x0028, 0x0009}, fne({ cm["FrameIncrementPointer"], // Default to (3004,000c).
-                                               R"***(12292\12)***" })); // Imebra default deserialization, but is brittle and depends on endianness.
-                                               //"\x04\x30\x0c\x00" })); // Imebra won't accept this...
-        ds_insert(tds, {0x3004, 0x000c}, GridFrameOffsetVector );
+        root_node.emplace_child_node({{0x0028, 0x0008}, "IS", std::to_string(num_of_imgs) }); // NumberOfFrames
+        root_node.emplace_child_node({{0x0028, 0x0009}, "AT", fne({ cm["FrameIncrementPointer"], // Default to (3004,000c).
+                                                                     R"***(12292\12)***" }) });
+        root_node.emplace_child_node({{0x3004, 0x000c}, "DS", GridFrameOffsetVector });
 
+        //-------------------------------------------------------------------------------------------------
         //Modality LUT Module.
-        //insert_as_string_if_nonempty(0x0028, 0x3000, "ModalityLUTSequence"], "" }));
-        ds_insert(tds, {0x0028, 0x3002}, foe({ cm["LUTDescriptor"] }));
-        ds_insert(tds, {0x0028, 0x3004}, foe({ cm["ModalityLUTType"] }));
-        ds_insert(tds, {0x0028, 0x3006}, foe({ cm["LUTData"] }));
-        //ds_insert(tds, {0x0028, 0x1052}, foe({ cm["RescaleIntercept"] })); // These force interpretation by Imebra
-        //ds_insert(tds, {0x0028, 0x1053}, foe({ cm["RescaleSlope"] }));     //  as 8 byte pixel depth, regardless of
-        //ds_insert(tds, {0x0028, 0x1054}, foe({ cm["RescaleType"] }));      //  the actual depth (@ current settings).
+        //
+        // Note: the LUT descriptor and data are binary and are not currently round-tripped through the metadata.
+        // Rescale slope and intercept are also omitted; the DoseGridScaling serves the same purpose.
+        root_node.emplace_child_node({{0x0028, 0x3004}, "LO", foe({ cm["ModalityLUTType"] }) });
 
+        //-------------------------------------------------------------------------------------------------
         //RT Dose Module.
-        //ds_insert(tds, {0x0028, 0x0002}, fne({ cm["SamplesPerPixel"], "1" }));
-        //ds_insert(tds, {0x0028, 0x0004}, fne({ cm["PhotometricInterpretation"], "MONOCHROME2" }));
-        //ds_insert(tds, {0x0028, 0x0100}, fne({ cm["BitsAllocated"], "32" }));
-        //ds_insert(tds, {0x0028, 0x0101}, fne({ cm["BitsStored"], "32" }));
-        //ds_insert(tds, {0x0028, 0x0102}, fne({ cm["HighBit"], "31" }));
-        //ds_insert(tds, {0x0028, 0x0103}, fne({ cm["PixelRepresentation"], "0" }));
-        ds_insert(tds, {0x3004, 0x0002}, fne({ cm["DoseUnits"], "GY" }));
-        ds_insert(tds, {0x3004, 0x0004}, fne({ cm["DoseType"], "PHYSICAL" }));
-        ds_insert(tds, {0x3004, 0x000a}, fne({ cm["DoseSummationType"], "PLAN" }));
-        ds_insert(tds, {0x3004, 0x000e}, std::to_string(dose_scaling) ); //"DoseGridScaling"
-
-        ds_seq_insert(tds, {0x300C, 0x0002},   // "ReferencedRTPlanSequence" 
-                           {0x0008, 0x1150}, // "ReferencedSOPClassUID"
-                           fne({ cm[R"***(ReferencedRTPlanSequence/ReferencedSOPClassUID)***"],
-                                 "1.2.840.10008.5.1.4.1.1.481.5" }) ); // "RTPlanStorage". Prefer existing UID.
-        ds_seq_insert(tds, {0x300C, 0x0002},   // "ReferencedRTPlanSequence"
-                           {0x0008, 0x1155}, // "ReferencedSOPInstanceUID"
-                           fne({ cm[R"***(ReferencedRTPlanSequence/ReferencedSOPInstanceUID)***"],
-                                 Generate_Random_UID(32) }) );
+        root_node.emplace_child_node({{0x3004, 0x0002}, "CS", fne({ cm["DoseUnits"], "GY" }) });
+        root_node.emplace_child_node({{0x3004, 0x0004}, "CS", fne({ cm["DoseType"], "PHYSICAL" }) });
+        root_node.emplace_child_node({{0x3004, 0x000a}, "CS", fne({ cm["DoseSummationType"], "PLAN" }) });
+        root_node.emplace_child_node({{0x3004, 0x000e}, "DS", To_DICOM_DS(dose_scaling) }); // DoseGridScaling
+
+        {
+            DCMA_DICOM::Node *seq_ptr = root_node.emplace_child_node({{0x300C, 0x0002}, "SQ", ""}); // ReferencedRTPlanSequence
+            DCMA_DICOM::Node *multi_ptr = seq_ptr->emplace_child_node({{0x0000, 0x0000}, "MULTI", ""});
+            multi_ptr->emplace_child_node({{0x0008, 0x1150}, "UI", fne({ cm[R"***(ReferencedRTPlanSequence/ReferencedSOPClassUID)***"],
+                                                                          "1.2.840.10008.5.1.4.1.1.481.5" }) }); // "RTPlanStorage". Prefer existing UID.
+            multi_ptr->emplace_child_node({{0x0008, 0x1155}, "UI", fne({ cm[R"***(ReferencedRTPlanSequence/ReferencedSOPInstanceUID)***"],
+                                                                          Generate_Random_UID(32) }) });
+        }
   
         if(0 != cm.count(R"***(ReferencedFractionGroupSequence/ReferencedFractionGroupNumber)***")){
-            ds_seq_insert(tds, {0x300C, 0x0020},   // "ReferencedFractionGroupSequence"
-                               {0x300C, 0x0022}, // "ReferencedFractionGroupNumber"
-                               foe({ cm[R"***(ReferencedFractionGroupSequence/ReferencedFractionGroupNumber)***"] }) );
+            DCMA_DICOM::Node *seq_ptr = root_node.emplace_child_node({{0x300C, 0x0020}, "SQ", ""}); // ReferencedFractionGroupSequence
+            DCMA_DICOM::Node *multi_ptr = seq_ptr->emplace_child_node({{0x0000, 0x0000}, "MULTI", ""});
+            multi_ptr->emplace_child_node({{0x300C, 0x0022}, "IS", foe({ cm[R"***(ReferencedFractionGroupSequence/ReferencedFractionGroupNumber)***"] }) });
         }
 
         if(0 != cm.count(R"***(ReferencedBeamSequence/ReferencedBeamNumber)***")){
-            ds_seq_insert(tds, {0x300C, 0x0004},   // "ReferencedBeamSequence"
-                               {0x300C, 0x0006}, // "ReferencedBeamNumber"
-                               foe({ cm[R"***(ReferencedBeamSequence/ReferencedBeamNumber)***"] }) );
+            DCMA_DICOM::Node *seq_ptr = root_node.emplace_child_node({{0x300C, 0x0004}, "SQ", ""}); // ReferencedBeamSequence
+            DCMA_DICOM::Node *multi_ptr = seq_ptr->emplace_child_node({{0x0000, 0x0000}, "MULTI", ""});
+            multi_ptr->emplace_child_node({{0x300C, 0x0006}, "IS", foe({ cm[R"***(ReferencedBeamSequence/ReferencedBeamNumber)***"] }) });
         }
     }
 
-    //Insert the raw pixel data.
-    std::vector<uint32_t> shtl;
-    shtl.reserve(num_of_imgs * col_count * row_count);
-    for(const auto &p_img : IA->imagecoll.images){
-
-        //Convert each pixel to the required format, scaling by the dose factor as needed.
+    //Insert the raw pixel data. Each frame is encoded straight from the float buffer into its own region of a single
+    // preallocated buffer, so frames can be encoded concurrently.
+    const size_t frame_voxels = static_cast<size_t>(row_count) * static_cast<size_t>(col_count);
+    const size_t frame_bytes = frame_voxels * sizeof(uint32_t);
+    std::string pixel_data(num_of_imgs * frame_bytes, '\0');
+    Parallel_For_Each_Index(num_of_imgs, [&](size_t i) -> void {
+        const auto &p_img = *(imgs[i]);
         const long int channel = 0; // Ignore other channels for now. TODO.
+        auto *dest = &(pixel_data[i * frame_bytes]);
         for(long int r = 0; r < row_count; r++){
             for(long int c = 0; c < col_count; c++){
                 const auto val = p_img.value(r, c, channel);
                 const auto scaled = std::round( std::abs(val/dose_scaling) );
-                auto as_uint = static_cast<uint32_t>(scaled);
-                shtl.push_back(as_uint);
+                const auto as_uint = static_cast<uint32_t>(scaled);
+                std::memcpy(dest, &as_uint, sizeof(as_uint));
+                dest += sizeof(as_uint);
             }
         }
-    }
-    {
-        auto tag_ptr = tds->getTag(0x7FE0, 0, 0x0010, true);
-        //FUNCINFO("Re-reading the tag.  Type is " << tag_ptr->getDataType() << ",  #_of_buffers = " <<
-        //     tag_ptr->getBuffersCount() << ",   buffer_0 has size = " << tag_ptr->getBufferSize(0));
-
-        auto rdh_ptr = tag_ptr->getDataHandlerRaw(0, true, "OW");
-        rdh_ptr->copyFromMemory(reinterpret_cast<const uint8_t *>(shtl.data()),
-                                4*static_cast<uint32_t>(shtl.size()));
-    }
+    });
+    root_node.emplace_child_node({{0x7FE0, 0x0010}, "OB", std::move(pixel_data) }); // PixelData.
 
-    // Write the file.
-    {  
-        ptr<puntoexe::stream> outputStream(new puntoexe::stream);
-        outputStream->openFile(FilenameOut, std::ios::out);
-        ptr<streamWriter> writer(new streamWriter(outputStream));
-        ptr<imebra::codecs::dicomCodec> writeCodec(new imebra::codecs::dicomCodec);
-        writeCodec->write(writer, tds);
+    // Write the file. The file is assembled in memory and written with a single call.
+    {
+        const auto buf = Emit_DICOM_To_Buffer(root_node, enc, num_of_imgs * frame_bytes + 64 * 1024);
+        std::ofstream ofs(FilenameOut, std::ios::out | std::ios::trunc | std::ios::binary);
+        if(!ofs) throw std::runtime_error("Unable to open file for writing");
+        ofs.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        ofs.flush();
+        if(!ofs) throw std::runtime_error("Unable to write DICOM file");
     }
 
     return;
@@ -2630,7 +2814,12 @@ void Write_Dose_Array(const std::shared_ptr<Image_Array>& IA, const std::string
 
 //This routine writes an image array to several DICOM CT-modality files.
 //
-// Note: the user callback will be called once per file.
+// Note: the user callback will be called once per file, in order, from the calling thread. Files are encoded
+//       concurrently ahead of the callback.
+//
+// Note: pixels are stored as signed 16-bit integers. If all voxel intensities fit, they are rounded and stored directly
+//       (i.e., the rescale slope is 1 and the intercept is 0). Otherwise a common rescale slope and intercept are
+//       computed once for the whole series so that the full range is represented.
 //
 void Write_CT_Images(const std::shared_ptr<Image_Array>& IA, 
                      const std::function<void(std::istream &is,
@@ -2670,18 +2859,55 @@ void Write_CT_Images(const std::shared_ptr<Image_Array>& IA,
     // TODO: Sample any existing UID (ReferencedFrameOfReferenceUID or FrameOfReferenceUID). 
     // Probably OK to use only the first in this case though...
 
-    long int InstanceNumber = -1;
+    std::vector<const planar_image<float,double> *> imgs;
+    std::vector<std::string> SOPInstanceUIDs;
     for(const auto &animg : IA->imagecoll.images){
         if( (animg.rows <= 0) || (animg.columns <= 0) || (animg.channels <= 0) ){
             continue;
         }
+        imgs.emplace_back( &animg );
+        SOPInstanceUIDs.emplace_back( Generate_Random_UID(60) );
+    }
 
-        ++InstanceNumber;
+    // Determine a common rescale for the whole series.
+    double RescaleSlope = 1.0;
+    double RescaleIntercept = 0.0;
+    {
+        std::vector<std::pair<float,float>> extrema(imgs.size(), { std::numeric_limits<float>::infinity(),
+                                                                  -std::numeric_limits<float>::infinity() });
+        Parallel_For_Each_Index(imgs.size(), [&](size_t i) -> void {
+            for(const auto &val : imgs[i]->data){
+                if(!std::isfinite(val)) continue;
+                extrema[i].first  = std::min(extrema[i].first, val);
+                extrema[i].second = std::max(extrema[i].second, val);
+            }
+        });
+        double min_val = std::numeric_limits<double>::infinity();
+        double max_val = -std::numeric_limits<double>::infinity();
+        for(const auto &e : extrema){
+            min_val = std::min<double>(min_val, e.first);
+            max_val = std::max<double>(max_val, e.second);
+        }
+
+        const auto int16_min = static_cast<double>(std::numeric_limits<int16_t>::min());
+        const auto int16_max = static_cast<double>(std::numeric_limits<int16_t>::max());
+        if( std::isfinite(min_val) && std::isfinite(max_val)
+        &&  ( (std::round(min_val) < int16_min) || (int16_max < std::round(max_val)) ) ){
+            RescaleSlope = (min_val < max_val) ? (max_val - min_val) / (int16_max - int16_min) : 1.0;
+            RescaleIntercept = min_val - int16_min * RescaleSlope;
+        }
+    }
+    const auto RescaleSlopeStr = To_DICOM_DS(RescaleSlope);
+    const auto RescaleInterceptStr = To_DICOM_DS(RescaleIntercept);
+
+    const auto encode_slice = [&](size_t i) -> std::string {
+        const auto &animg = *(imgs[i]);
+        const auto InstanceNumber = static_cast<long int>(i);
 
         DCMA_DICOM::Encoding enc = DCMA_DICOM::Encoding::ELE;
         DCMA_DICOM::Node root_node;
 
-        const auto SOPInstanceUID = Generate_Random_UID(60);
+        const auto &SOPInstanceUID = SOPInstanceUIDs[i];
 
         //auto cm = IA->imagecoll.get_common_metadata({});
         auto cm = animg.metadata;
@@ -2867,16 +3093,22 @@ void Write_CT_Images(const std::shared_ptr<Image_Array>& IA,
         }
 
         {
-            std::stringstream ss_pixels;
-            for(long int row = 0; row != animg.rows; ++row){
-                for(long int col = 0; col != animg.columns; ++col){
-                    for(long int chnl = 0; chnl != animg.channels; ++chnl){
-                        auto val = static_cast<int16_t>( std::round( animg.value(row, col, chnl ) ) );
-                        ss_pixels.write( reinterpret_cast<const char *>(&val), sizeof(val) );
-                    }
-                }
+            // Encode straight from the pixel buffer, which is already in row-major, channel-interleaved order.
+            const auto int16_min = static_cast<float>(std::numeric_limits<int16_t>::min());
+            const auto int16_max = static_cast<float>(std::numeric_limits<int16_t>::max());
+            const auto inv_slope = static_cast<float>(1.0 / RescaleSlope);
+            const auto intercept = static_cast<float>(RescaleIntercept);
+
+            std::string pixels(animg.data.size() * sizeof(int16_t), '\0');
+            auto *dest = &(pixels[0]);
+            for(const auto &val : animg.data){
+                float scaled = std::isfinite(val) ? std::round((val - intercept) * inv_slope) : 0.0f;
+                scaled = std::clamp(scaled, int16_min, int16_max);
+                const auto as_int = static_cast<int16_t>(scaled);
+                std::memcpy(dest, &as_int, sizeof(as_int));
+                dest += sizeof(as_int);
             }
-            root_node.emplace_child_node({{0x7FE0, 0x0010}, "OB", ss_pixels.str() }); // PixelData.
+            root_node.emplace_child_node({{0x7FE0, 0x0010}, "OB", std::move(pixels) }); // PixelData.
 
             // Note: the standard mentions that:
             //
@@ -2892,8 +3124,8 @@ void Write_CT_Images(const std::shared_ptr<Image_Array>& IA,
         //
         // Note: many elements in this module are duplicated in other modules. Omitted here if they appear above.
         //
-        root_node.emplace_child_node({{0x0028, 0x1052}, "DS", "0" }); //RescaleIntercept.
-        root_node.emplace_child_node({{0x0028, 0x1053}, "DS", "1" }); //RescaleSlope.
+        root_node.emplace_child_node({{0x0028, 0x1052}, "DS", RescaleInterceptStr }); //RescaleIntercept.
+        root_node.emplace_child_node({{0x0028, 0x1053}, "DS", RescaleSlopeStr }); //RescaleSlope.
         root_node.emplace_child_node({{0x0028, 0x1054}, "LO", "HU" }); //RescaleType, 'HU' for Hounsfield units, or 'US' for unspecified.
         root_node.emplace_child_node({{0x0018, 0x0060}, "DS", foe({ cm["KVP"] }) });
 
@@ -2903,17 +3135,16 @@ void Write_CT_Images(const std::shared_ptr<Image_Array>& IA,
         root_node.emplace_child_node({{0x0028, 0x1050}, "DS", "0" }); //WindowCenter.
         root_node.emplace_child_node({{0x0028, 0x1051}, "DS", "1000" }); //WindowWidth
 
-        // Send the file to the user's handler.
-        {
-            std::stringstream ss;
-            const auto bytes_reqd = root_node.emit_DICOM(ss, enc);
-            if(!ss) throw std::runtime_error("Stream not in good state after emitting DICOM file");
-            if(bytes_reqd <= 0) throw std::runtime_error("Not enough DICOM data available for valid file");
+        return Emit_DICOM_To_Buffer(root_node, enc, animg.data.size() * sizeof(int16_t) + 16 * 1024);
+    };
 
-            const auto fsize = static_cast<long int>(bytes_reqd);
-            file_handler(ss, fsize);
-        }
-    }
+    // Send the files to the user's handler.
+    Encode_In_Parallel_Consume_In_Order(imgs.size(), encode_slice,
+        [&](size_t, std::string &buf) -> void {
+            memory_streambuf sb(buf.data(), buf.size());
+            std::istream is(&sb);
+            file_handler(is, static_cast<long int>(buf.size()));
+        });
 
     return;
 }
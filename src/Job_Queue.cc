@@ -0,0 +1,205 @@
+//Job_Queue.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+
+#include "Job_Queue.h"
+
+
+// Selects the job with the highest effective priority. Owners with jobs already running are penalized so that a single
+// client cannot monopolize the workers. Ties are broken by submission order.
+template <class It, class Deref>
+static
+It
+Select_Next_Job(It first, It last, const std::map<std::string, long int> &running_per_owner, Deref deref){
+    auto best = last;
+    long int best_priority = std::numeric_limits<long int>::min();
+    for(auto it = first; it != last; ++it){
+        const auto &j = deref(*it);
+        auto r_it = running_per_owner.find(j.owner);
+        const long int n_running = (r_it == running_per_owner.end()) ? 0 : r_it->second;
+        const long int eff_priority = j.priority - n_running;
+        if( (best == last) || (best_priority < eff_priority) ){
+            best_priority = eff_priority;
+            best = it;
+        }
+    }
+    return best;
+}
+
+job_queue::job_queue(size_t max_concurrent){
+    if(max_concurrent == 0){
+        max_concurrent = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    for(size_t i = 0; i < max_concurrent; ++i){
+        this->workers.emplace_back( [this](){ this->worker_loop(); } );
+    }
+}
+
+job_queue::~job_queue(){
+    std::list<job> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        this->terminate = true;
+        abandoned.swap(this->pending);
+        for(auto &p : this->running) p.second->cancel_requested.store(true);
+    }
+    this->cv.notify_all();
+
+    for(auto &j : abandoned){
+        if(j.done) j.done(job_status::cancelled, "Server shutting down");
+    }
+    for(auto &w : this->workers){
+        if(w.joinable()) w.join();
+    }
+}
+
+void job_queue::set_owner_priority(const std::string &owner, long int priority){
+    std::lock_guard<std::mutex> lock(this->m);
+    this->owner_priority[owner] = priority;
+    for(auto &j : this->pending){
+        if(j.owner == owner) j.priority = priority;
+    }
+    return;
+}
+
+job_queue::job_id_t job_queue::submit(const std::string &owner,
+                                      work_t work,
+                                      done_t done,
+                                      std::function<void(const std::string &)> progress){
+    job j;
+    j.owner = owner;
+    j.work = std::move(work);
+    j.done = std::move(done);
+    j.context = std::make_shared<job_context>();
+    j.context->progress_callback = std::move(progress);
+
+    job_id_t id;
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        id = this->next_id++;
+        j.id = id;
+        auto p_it = this->owner_priority.find(owner);
+        j.priority = (p_it == this->owner_priority.end()) ? 0 : p_it->second;
+        this->pending.emplace_back(std::move(j));
+    }
+    this->cv.notify_one();
+    return id;
+}
+
+bool job_queue::cancel(job_id_t id){
+    job cancelled;
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        auto r_it = this->running.find(id);
+        if(r_it != this->running.end()){
+            r_it->second->cancel_requested.store(true);
+            return true;
+        }
+        auto p_it = std::find_if(this->pending.begin(), this->pending.end(),
+                                 [id](const job &j){ return (j.id == id); });
+        if(p_it == this->pending.end()) return false;
+        cancelled = std::move(*p_it);
+        this->pending.erase(p_it);
+    }
+    if(cancelled.done) cancelled.done(job_status::cancelled, "Cancelled before starting");
+    return true;
+}
+
+std::optional<size_t> job_queue::queue_position(job_id_t id) const {
+    std::lock_guard<std::mutex> lock(this->m);
+
+    // Replay the order in which idle workers would select the pending jobs.
+    std::list<const job *> order;
+    for(const auto &j : this->pending) order.push_back(&j);
+    auto running = this->running_per_owner;
+    size_t n = 0;
+    while(!order.empty()){
+        auto it = Select_Next_Job(order.begin(), order.end(), running,
+                                  [](const job *j) -> const job & { return *j; });
+        if((*it)->id == id) return n;
+        ++(running[(*it)->owner]);
+        order.erase(it);
+        ++n;
+    }
+    return {};
+}
+
+size_t job_queue::pending_count() const {
+    std::lock_guard<std::mutex> lock(this->m);
+    return this->pending.size();
+}
+
+size_t job_queue::running_count() const {
+    std::lock_guard<std::mutex> lock(this->m);
+    return this->running.size();
+}
+
+void job_queue::worker_loop(){
+    while(true){
+        job j;
+        {
+            std::unique_lock<std::mutex> lock(this->m);
+            this->cv.wait(lock, [this](){ return this->terminate || !this->pending.empty(); });
+            if(this->terminate) return;
+
+            auto best = Select_Next_Job(this->pending.begin(), this->pending.end(), this->running_per_owner,
+                                        [](const job &pj) -> const job & { return pj; });
+            j = std::move(*best);
+            this->pending.erase(best);
+            this->running[j.id] = j.context;
+            ++(this->running_per_owner[j.owner]);
+        }
+
+        job_status status = job_status::failed;
+        std::string msg;
+        try{
+            if(j.context->cancel_requested.load()){
+                status = job_status::cancelled;
+            }else if(j.work(*(j.context))){
+                status = job_status::completed;
+            }else{
+                status = (j.context->cancel_requested.load()) ? job_status::cancelled : job_status::failed;
+            }
+        }catch(const std::exception &e){
+            msg = e.what();
+            status = job_status::failed;
+        }catch(...){
+            msg = "Unknown error";
+            status = job_status::failed;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->m);
+            this->running.erase(j.id);
+            auto r_it = this->running_per_owner.find(j.owner);
+            if( (r_it != this->running_per_owner.end())
+            &&  (--(r_it->second) <= 0) ){
+                this->running_per_owner.erase(r_it);
+            }
+        }
+
+        try{
+            if(j.done) j.done(status, msg);
+        }catch(const std::exception &e){
+            FUNCWARN("Job completion handler failed: '" << e.what() << "'. Ignoring");
+        }catch(...){
+            FUNCWARN("Job completion handler failed with an unknown error. Ignoring");
+        }
+    }
+    return;
+}
+
@@ -0,0 +1,159 @@
+//Job_Queue.h - A part of DICOMautomaton 2020. Written by hal clark.
+//
+// A bounded-concurrency, prioritized job queue for long-running work submitted by many independent clients (e.g.,
+// web server sessions), and a small least-recently-used cache for memoizing job results.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+enum class job_status {
+    queued,
+    running,
+    completed,
+    failed,
+    cancelled,
+};
+
+
+// Passed to running jobs so they can report progress and cooperatively honour cancellation requests.
+class job_context {
+  public:
+    std::atomic<bool> cancel_requested = false;
+
+    // Invoked from the worker thread. Implementations must marshal to the relevant client thread themselves.
+    std::function<void(const std::string &)> progress_callback;
+
+    void report_progress(const std::string &msg) const {
+        if(this->progress_callback) this->progress_callback(msg);
+    }
+};
+
+
+class job_queue {
+  public:
+    using job_id_t = uint64_t;
+
+    // The 'work' functor is run on a worker thread. It should return true iff the job succeeded, and may throw.
+    // The 'done' functor is invoked on the worker thread after the job completes, fails, or is cancelled.
+    using work_t = std::function<bool(job_context &)>;
+    using done_t = std::function<void(job_status, const std::string &)>;
+
+  private:
+    struct job {
+        job_id_t id = 0;
+        std::string owner;     // Typically a session identifier.
+        long int priority = 0; // Larger values are scheduled sooner.
+        work_t work;
+        done_t done;
+        std::shared_ptr<job_context> context;
+    };
+
+    mutable std::mutex m;
+    std::condition_variable cv;
+    bool terminate = false;
+
+    job_id_t next_id = 1;
+    std::list<job> pending;
+    std::map<job_id_t, std::shared_ptr<job_context>> running;
+    std::map<std::string, long int> running_per_owner;
+    std::map<std::string, long int> owner_priority;
+
+    std::vector<std::thread> workers;
+
+    void worker_loop();
+
+  public:
+    // Note: at most 'max_concurrent' jobs will execute simultaneously. If zero, a default is chosen.
+    explicit job_queue(size_t max_concurrent = 0);
+    ~job_queue(); // Cancels pending jobs and waits for running jobs to finish.
+
+    job_queue(const job_queue &) = delete;
+    job_queue & operator=(const job_queue &) = delete;
+
+    // Sets a base priority for all jobs submitted by the given owner. Larger values are scheduled sooner.
+    void set_owner_priority(const std::string &owner, long int priority);
+
+    // Note: the optional 'progress' functor is made available to the job via job_context::report_progress().
+    job_id_t submit(const std::string &owner,
+                    work_t work,
+                    done_t done,
+                    std::function<void(const std::string &)> progress = {});
+
+    // Pending jobs are removed immediately. Running jobs are signalled and are expected to stop at the next
+    // convenient point. Returns false if the job is unknown (e.g., already finished).
+    bool cancel(job_id_t id);
+
+    // The number of pending jobs that would be started before the given job, following the same priority order the
+    // workers use, assuming no further jobs are submitted or finished. Empty if the job is not pending.
+    std::optional<size_t> queue_position(job_id_t id) const;
+
+    size_t pending_count() const;
+    size_t running_count() const;
+};
+
+
+// A least-recently-used cache bounded by the (caller-estimated) size of its entries. Entries larger than the capacity
+// are not retained. Safe for concurrent use.
+template <class K, class V>
+class lru_cache {
+  private:
+    mutable std::mutex m;
+    size_t capacity;  // In bytes.
+    size_t total = 0; // In bytes.
+    struct entry_t {
+        K key;
+        std::shared_ptr<const V> val;
+        size_t bytes;
+    };
+    std::list<entry_t> items; // Most recently used first.
+
+  public:
+    explicit lru_cache(size_t capacity) : capacity(capacity) {}
+
+    std::shared_ptr<const V> get(const K &key){
+        std::lock_guard<std::mutex> lock(this->m);
+        for(auto it = this->items.begin(); it != this->items.end(); ++it){
+            if(it->key == key){
+                this->items.splice(this->items.begin(), this->items, it);
+                return this->items.front().val;
+            }
+        }
+        return nullptr;
+    }
+
+    void put(const K &key, std::shared_ptr<const V> val, size_t bytes){
+        std::lock_guard<std::mutex> lock(this->m);
+        this->items.remove_if([&](const entry_t &e){
+            if(e.key != key) return false;
+            this->total -= e.bytes;
+            return true;
+        });
+        this->items.push_front(entry_t{ key, std::move(val), bytes });
+        this->total += bytes;
+        while(!this->items.empty() && (this->capacity < this->total)){
+            this->total -= this->items.back().bytes;
+            this->items.pop_back();
+        }
+    }
+
+    size_t size_bytes() const {
+        std::lock_guard<std::mutex> lock(this->m);
+        return this->total;
+    }
+};
+
@@ -3,6 +3,7 @@
 // This program loads line samples from files containing an exported samples_1D.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <exception>
@@ -12,10 +13,12 @@
 #include <memory>
 #include <stdexcept>
 #include <string>    
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <cstdlib>            //Needed for exit() calls.
 
+#include "Mapped_File.h"
 #include "Structs.h"
 #include "YgorMath.h"         //Needed for vec3 class.
 #include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
@@ -49,8 +52,24 @@ bool Load_From_Line_Sample_Files( Drover &DICOM_data,
         try{
             //////////////////////////////////////////////////////////////
             // Attempt to load the file.
-            bool read_ok = true;
+            bool read_ok = false;
             {
+                // Stringified version without metadata, which is parsed directly from a memory mapping.
+                mapped_file mf(Filename);
+                std::vector<double> values;
+                if( Parse_Number_Rows(mf.view(), 4, "", '\0', values)
+                &&  !values.empty() ){
+                    auto &samples = DICOM_data.lsamp_data.back()->line.samples;
+                    samples.reserve(values.size() / 4);
+                    for(size_t j = 0; (j + 3) < values.size(); j += 4){
+                        samples.push_back( { values[j], values[j + 1], values[j + 2], values[j + 3] } );
+                    }
+                    std::stable_sort( std::begin(samples), std::end(samples),
+                                      [](const auto &A, const auto &B) -> bool { return (A[0] < B[0]); } );
+                    read_ok = true;
+                }
+            }
+            if(!read_ok){
                 // Stringified version.
                 std::ifstream FI(Filename.c_str(), std::ios::in);
                 read_ok = DICOM_data.lsamp_data.back()->line.Read_From_Stream(FI);
@@ -0,0 +1,258 @@
+//Mapped_File.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Thread_Pool.h"
+
+#include "Mapped_File.h"
+
+
+struct mapped_file::impl {
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+};
+
+mapped_file::mapped_file(const std::string &filename){
+    try{
+        // Empty files cannot be mapped, but are otherwise valid.
+        if(boost::filesystem::file_size(filename) == 0) return;
+
+        this->pimpl = std::make_unique<impl>();
+        this->pimpl->mapping = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only);
+        this->pimpl->region = boost::interprocess::mapped_region(this->pimpl->mapping, boost::interprocess::read_only);
+        this->contents = std::string_view( static_cast<const char *>(this->pimpl->region.get_address()),
+                                           this->pimpl->region.get_size() );
+    }catch(const std::exception &e){
+        throw std::runtime_error("Unable to map file '" + filename + "': " + e.what());
+    }
+}
+
+mapped_file::~mapped_file() = default;
+
+std::string_view
+mapped_file::view() const {
+    return this->contents;
+}
+
+
+text_cursor::text_cursor(std::string_view text) : pos(text.data()),
+                                                  end(text.data() + text.size()) {}
+
+bool
+text_cursor::at_end() const {
+    return (this->pos == this->end);
+}
+
+void
+text_cursor::skip_blanks(){
+    while( (this->pos != this->end)
+       &&  (*this->pos != '\n')
+       &&  Is_Text_Whitespace(*this->pos) ) ++this->pos;
+    return;
+}
+
+void
+text_cursor::skip_whitespace(){
+    while( (this->pos != this->end)
+       &&  Is_Text_Whitespace(*this->pos) ) ++this->pos;
+    return;
+}
+
+void
+text_cursor::skip_line(){
+    const auto *nl = static_cast<const char *>(std::memchr(this->pos, '\n', this->end - this->pos));
+    this->pos = (nl == nullptr) ? this->end : (nl + 1);
+    return;
+}
+
+bool
+text_cursor::at_line_end(){
+    this->skip_blanks();
+    return (this->pos == this->end) || (*this->pos == '\n');
+}
+
+std::string_view
+text_cursor::next_token(){
+    this->skip_whitespace();
+    const auto *first = this->pos;
+    while( (this->pos != this->end)
+       &&  !Is_Text_Whitespace(*this->pos) ) ++this->pos;
+    return std::string_view(first, this->pos - first);
+}
+
+std::string_view
+text_cursor::next_token_on_line(){
+    this->skip_blanks();
+    const auto *first = this->pos;
+    while( (this->pos != this->end)
+       &&  !Is_Text_Whitespace(*this->pos) ) ++this->pos;
+    return std::string_view(first, this->pos - first);
+}
+
+
+std::string_view
+Next_Text_Line( const char *&pos,
+                const char *end,
+                char comment ){
+    const auto *nl = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+    const auto *line_end = (nl == nullptr) ? end : nl;
+    std::string_view line(pos, line_end - pos);
+    pos = (nl == nullptr) ? end : (nl + 1);
+
+    if(comment != '\0'){
+        const auto c = line.find(comment);
+        if(c != std::string_view::npos) line = line.substr(0, c);
+    }
+    return line;
+}
+
+std::vector<std::string_view>
+Split_Text_At_Lines( std::string_view text,
+                     size_t max_chunks,
+                     size_t min_chunk_bytes ){
+    std::vector<std::string_view> out;
+    const size_t N = std::max<size_t>(1, std::min<size_t>(max_chunks, text.size() / std::max<size_t>(1, min_chunk_bytes)));
+    const size_t target = text.size() / N;
+
+    size_t first = 0;
+    for(size_t n = 1; (n < N) && (first < text.size()); ++n){
+        // Place the boundary just after the first newline at or beyond the nominal split position.
+        const auto nl = text.find('\n', std::max(first, n * target));
+        if(nl == std::string_view::npos) break;
+        out.emplace_back(text.substr(first, (nl + 1) - first));
+        first = nl + 1;
+    }
+    if( out.empty() || (first < text.size()) ){
+        out.emplace_back(text.substr(first));
+    }
+    return out;
+}
+
+std::vector<std::string_view>
+Split_Text_At_Whitespace( std::string_view text,
+                          size_t max_chunks,
+                          size_t min_chunk_bytes ){
+    std::vector<std::string_view> out;
+    const size_t N = std::max<size_t>(1, std::min<size_t>(max_chunks, text.size() / std::max<size_t>(1, min_chunk_bytes)));
+    const size_t target = text.size() / N;
+
+    size_t first = 0;
+    for(size_t n = 1; (n < N) && (first < text.size()); ++n){
+        // Place the boundary just after the first whitespace character at or beyond the nominal split position.
+        size_t split = std::max(first, n * target);
+        while( (split < text.size()) && !Is_Text_Whitespace(text[split]) ) ++split;
+        if(text.size() <= split) break;
+        out.emplace_back(text.substr(first, (split + 1) - first));
+        first = split + 1;
+    }
+    if( out.empty() || (first < text.size()) ){
+        out.emplace_back(text.substr(first));
+    }
+    return out;
+}
+
+size_t
+Count_Text_Tokens( std::string_view text ){
+    size_t N = 0;
+    bool in_token = false;
+    for(const auto c : text){
+        const bool ws = Is_Text_Whitespace(c);
+        if(!ws && !in_token) ++N;
+        in_token = !ws;
+    }
+    return N;
+}
+
+bool
+Parse_Number_Rows( std::string_view text,
+                   size_t N_columns,
+                   std::string_view separators,
+                   char comment,
+                   std::vector<double> &out ){
+    const auto is_separator = [&](char c) -> bool {
+        return Is_Text_Whitespace(c) || (separators.find(c) != std::string_view::npos);
+    };
+
+    // Files larger than this are split at line boundaries and parsed concurrently.
+    const size_t parallel_parse_threshold = 4UL * 1024UL * 1024UL;
+    const size_t min_chunk_bytes = 1024UL * 1024UL;
+    const auto chunks = (text.size() < parallel_parse_threshold)
+                      ? std::vector<std::string_view>{ text }
+                      : Split_Text_At_Lines(text, Default_Parse_Chunk_Count(), min_chunk_bytes);
+    const auto N_chunks = chunks.size();
+
+    std::vector<std::vector<double>> parsed(N_chunks);
+    std::vector<char> chunk_ok(N_chunks, 1);
+    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+        const char *pos = chunks[n].data();
+        const char *end = pos + chunks[n].size();
+        while(pos != end){
+            const auto line = Next_Text_Line(pos, end, comment);
+            const char *p = line.data();
+            const char *e = p + line.size();
+
+            size_t N_numbers = 0;
+            while(true){
+                while( (p != e) && is_separator(*p) ) ++p;
+                if(p == e) break;
+
+                double x;
+                const auto *q = Parse_Number(p, e, x);
+                if( (q == nullptr)
+                ||  ( (q != e) && !is_separator(*q) ) ){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+                parsed[n].emplace_back(x);
+                ++N_numbers;
+                p = q;
+            }
+            if( (N_numbers != 0) && (N_numbers != N_columns) ){
+                chunk_ok[n] = 0;
+                return;
+            }
+        }
+    });
+    if(std::find(std::begin(chunk_ok), std::end(chunk_ok), 0) != std::end(chunk_ok)) return false;
+
+    size_t N_total = 0;
+    for(const auto &p : parsed) N_total += p.size();
+    out.reserve(out.size() + N_total);
+    for(const auto &p : parsed) out.insert(std::end(out), std::begin(p), std::end(p));
+    return true;
+}
+
+size_t
+Default_Parse_Chunk_Count(){
+    const auto n = std::thread::hardware_concurrency();
+    return (n == 0) ? 2 : static_cast<size_t>(n) * 4;
+}
+
+void
+Parse_Chunks_In_Parallel( size_t N,
+                          const std::function<void(size_t)> &f ){
+    if(N <= 1){
+        for(size_t i = 0; i < N; ++i) f(i);
+        return;
+    }
+    asio_thread_pool tp;
+    for(size_t i = 0; i < N; ++i){
+        tp.submit_task([&f, i]() -> void { f(i); });
+    }
+    // The pool waits for all tasks to complete when destroyed.
+    return;
+}
+
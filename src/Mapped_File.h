@@ -0,0 +1,175 @@
+//Mapped_File.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <charconv>
+
+
+// Read-only, memory-mapped view of a whole file.
+//
+// Parsing directly from the mapping avoids copying the file into stream buffers and allows disjoint regions of the file
+// to be parsed concurrently. Throws if the file cannot be opened or mapped.
+class mapped_file {
+  private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+    std::string_view contents;
+
+  public:
+    explicit mapped_file(const std::string &filename);
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file & operator=(const mapped_file &) = delete;
+
+    std::string_view view() const;
+};
+
+
+inline bool Is_Text_Whitespace(char c){
+    return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+
+// Parses a number from the beginning of [first, last) without skipping whitespace. Returns a pointer one past the
+// number, or nullptr if no number could be parsed.
+//
+// Floating-point numbers are accepted in fixed or scientific notation, optionally with a leading '+', which matches what
+// formatted stream extraction accepts. Unlike stream extraction, parsing does not depend on the global locale.
+template <class T>
+const char * Parse_Number(const char *first, const char *last, T &out){
+    if( (first != last) && (*first == '+') ) ++first;
+    if constexpr (std::is_floating_point<T>::value){
+#if defined(__cpp_lib_to_chars)
+        const auto res = std::from_chars(first, last, out);
+        return (res.ec == std::errc()) ? res.ptr : nullptr;
+#else
+        // Floating-point std::from_chars is not available, so fall back to strtod on a bounded, terminated copy.
+        char buf[128];
+        const auto N = std::min<std::ptrdiff_t>(last - first, sizeof(buf) - 1);
+        std::copy(first, first + N, buf);
+        buf[N] = '\0';
+        char *stop = nullptr;
+        const auto val = std::strtod(buf, &stop);
+        if(stop == buf) return nullptr;
+        out = static_cast<T>(val);
+        return first + (stop - buf);
+#endif
+    }else{
+        const auto res = std::from_chars(first, last, out);
+        return (res.ec == std::errc()) ? res.ptr : nullptr;
+    }
+}
+
+
+// Sequential, whitespace-delimited tokenizer over a region of text.
+//
+// Line-oriented formats can use the 'line' variants, which treat newlines as significant.
+struct text_cursor {
+    const char *pos = nullptr;
+    const char *end = nullptr;
+
+    text_cursor() = default;
+    explicit text_cursor(std::string_view text);
+
+    bool at_end() const;
+
+    // Skips spaces, tabs, and carriage returns, but not newlines.
+    void skip_blanks();
+
+    // Skips all whitespace, including newlines.
+    void skip_whitespace();
+
+    // Advances past the next newline (or to the end).
+    void skip_line();
+
+    // Skips blanks and reports whether the remainder of the line is empty.
+    bool at_line_end();
+
+    // Skips whitespace and returns the next token, which is empty at the end of the text.
+    std::string_view next_token();
+
+    // Skips blanks (but not newlines) and returns the next token on the current line, which is empty at the end of
+    // the line.
+    std::string_view next_token_on_line();
+
+    // Skips whitespace and parses a number that must be followed by whitespace or the end of the text.
+    template <class T>
+    bool next_number(T &out){
+        this->skip_whitespace();
+        return this->parse_number_here(out);
+    }
+
+    // Skips blanks (but not newlines) and parses a number that must be followed by whitespace or the end of the text.
+    template <class T>
+    bool next_number_on_line(T &out){
+        this->skip_blanks();
+        return this->parse_number_here(out);
+    }
+
+  private:
+    template <class T>
+    bool parse_number_here(T &out){
+        const auto *p = Parse_Number(this->pos, this->end, out);
+        if( (p == nullptr)
+        ||  ( (p != this->end) && !Is_Text_Whitespace(*p) ) ){
+            return false;
+        }
+        this->pos = p;
+        return true;
+    }
+};
+
+
+// Returns the next line (without the newline) and advances past it. If a comment character is provided, the comment
+// and anything following it on the line are removed.
+std::string_view Next_Text_Line( const char *&pos,
+                                 const char *end,
+                                 char comment = '\0' );
+
+// Splits text into at most 'max_chunks' contiguous pieces of at least 'min_chunk_bytes' (where possible). Every piece
+// except the first begins at the start of a line. Concatenating the pieces reproduces the text.
+std::vector<std::string_view> Split_Text_At_Lines( std::string_view text,
+                                                   size_t max_chunks,
+                                                   size_t min_chunk_bytes );
+
+// Splits text into at most 'max_chunks' contiguous pieces of at least 'min_chunk_bytes' (where possible). Every piece
+// except the first begins immediately after a whitespace character, so whitespace-delimited tokens are never divided.
+// This is suited to formats that place many values on a single, long line.
+std::vector<std::string_view> Split_Text_At_Whitespace( std::string_view text,
+                                                        size_t max_chunks,
+                                                        size_t min_chunk_bytes );
+
+// Counts the whitespace-delimited tokens in the text.
+size_t Count_Text_Tokens( std::string_view text );
+
+// Parses text in which every non-blank line holds exactly 'N_columns' numbers, separated by whitespace or any of the
+// provided separator characters. If a comment character is provided, comments are removed from each line first. The
+// numbers are appended to 'out' in row-major order. Large texts are parsed concurrently.
+//
+// Returns false, leaving 'out' unaltered, if any line does not conform.
+bool Parse_Number_Rows( std::string_view text,
+                        size_t N_columns,
+                        std::string_view separators,
+                        char comment,
+                        std::vector<double> &out );
+
+// The number of chunks to split a large file into for parallel parsing.
+size_t Default_Parse_Chunk_Count();
+
+// Invokes f(i) for every i in [0, N) and waits for completion. Invocations are concurrent when N > 1. The functor must
+// not throw.
+void Parse_Chunks_In_Parallel( size_t N,
+                               const std::function<void(size_t)> &f );
+
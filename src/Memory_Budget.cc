@@ -0,0 +1,513 @@
+//Memory_Budget.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+#include "YgorString.h"       //Needed for the _s string literal.
+
+#include "Regex_Selectors.h"
+#include "Structs.h"
+
+#include "Memory_Budget.h"
+
+
+uint64_t Parse_Memory_Size(const std::string &in){
+    // Parsed by hand: a non-negative number, then an optional k/m/g/t multiplier, then an optional 'b' or 'ib'.
+    const auto fail = [&]() -> void {
+        throw std::invalid_argument("Unable to parse memory size '"_s + in + "'");
+    };
+    const auto N = in.size();
+    size_t i = 0;
+    const auto skip_space = [&]() -> void {
+        while( (i < N) && std::isspace(static_cast<unsigned char>(in[i])) ) ++i;
+    };
+
+    skip_space();
+    const auto num_begin = i;
+    long int N_digits = 0;
+    long int N_points = 0;
+    while( (i < N) && (std::isdigit(static_cast<unsigned char>(in[i])) || (in[i] == '.')) ){
+        if(in[i] == '.'){
+            ++N_points;
+        }else{
+            ++N_digits;
+        }
+        ++i;
+    }
+    if( (N_digits == 0) || (1 < N_points) || (in[i - 1] == '.') ) fail();
+    const auto val = std::stod(in.substr(num_begin, i - num_begin));
+    skip_space();
+
+    double mult = 1.0;
+    const std::string suffixes = "kmgt";
+    const auto pos = (i < N) ? suffixes.find(static_cast<char>(std::tolower(static_cast<unsigned char>(in[i]))))
+                             : std::string::npos;
+    if(pos != std::string::npos){
+        mult = std::pow(1024.0, static_cast<double>(pos + 1));
+        ++i;
+        if( (i < N) && (std::tolower(static_cast<unsigned char>(in[i])) == 'i') ){
+            ++i;
+            if( (N <= i) || (std::tolower(static_cast<unsigned char>(in[i])) != 'b') ) fail();
+        }
+    }
+    if( (i < N) && (std::tolower(static_cast<unsigned char>(in[i])) == 'b') ) ++i;
+    skip_space();
+    if(i != N) fail();
+
+    return static_cast<uint64_t>(val * mult);
+}
+
+namespace {
+
+// Writes a nested vector as the number of inner vectors, each inner size, and then all elements.
+template <class T>
+uint64_t write_nested(std::fstream &fs, const std::vector<std::vector<T>> &v){
+    uint64_t bytes = 0;
+    const auto N = static_cast<uint64_t>(v.size());
+    std::vector<uint64_t> sizes;
+    sizes.reserve(N);
+    for(const auto &i : v) sizes.push_back(static_cast<uint64_t>(i.size()));
+
+    fs.write(reinterpret_cast<const char *>(&N), sizeof(N));
+    fs.write(reinterpret_cast<const char *>(sizes.data()), sizeof(uint64_t) * N);
+    bytes += sizeof(N) + sizeof(uint64_t) * N;
+    for(const auto &i : v){
+        fs.write(reinterpret_cast<const char *>(i.data()), sizeof(T) * i.size());
+        bytes += sizeof(T) * i.size();
+    }
+    return bytes;
+}
+
+template <class T>
+void read_nested(std::fstream &fs, std::vector<std::vector<T>> &v){
+    uint64_t N = 0;
+    fs.read(reinterpret_cast<char *>(&N), sizeof(N));
+    std::vector<uint64_t> sizes(N);
+    fs.read(reinterpret_cast<char *>(sizes.data()), sizeof(uint64_t) * N);
+    v.clear();
+    v.resize(N);
+    for(uint64_t i = 0; i < N; ++i){
+        v[i].resize(sizes[i]);
+        fs.read(reinterpret_cast<char *>(v[i].data()), sizeof(T) * sizes[i]);
+    }
+    return;
+}
+
+template <class T>
+uint64_t nested_bytes(const std::vector<std::vector<T>> &v){
+    uint64_t bytes = sizeof(std::vector<T>) * v.size();
+    for(const auto &i : v) bytes += sizeof(T) * i.size();
+    return bytes;
+}
+
+// Tracks which objects are spilled, where their data is stored, and when they were last used.
+class spill_registry {
+  private:
+    struct record_t {
+        std::weak_ptr<void> owner; // Used to detect objects that have since been destroyed.
+        uint64_t last_used = 0;
+
+        bool spilled = false;
+        uint64_t offset = 0;
+        uint64_t bytes = 0;
+        std::vector<uint64_t> counts; // Element counts needed to validate the reload.
+    };
+
+    std::mutex m;
+    uint64_t budget = 0;
+    uint64_t tick = 0;
+    std::map<const void *, record_t> records;
+    memory_budget_metrics metrics;
+
+    boost::filesystem::path scratch_path;
+    std::fstream scratch;
+    uint64_t scratch_end = 0;
+
+    // Note: the mutex must be held for all of the following.
+
+    template <class T>
+    record_t & get_record(const std::shared_ptr<T> &p){
+        auto &r = this->records[ static_cast<const void *>(p.get()) ];
+        if(r.owner.expired()){
+            // A new object, or a new object re-using the address of a destroyed one.
+            r = record_t();
+            r.owner = p;
+            r.last_used = this->tick;
+        }
+        return r;
+    }
+
+    void purge_expired(){
+        for(auto r_it = std::begin(this->records); r_it != std::end(this->records); ){
+            if(r_it->second.owner.expired()){
+                r_it = this->records.erase(r_it);
+            }else{
+                ++r_it;
+            }
+        }
+
+        // Reclaim the scratch file once nothing live is stored in it.
+        const bool any_spilled = std::any_of(std::begin(this->records), std::end(this->records),
+                                             [](const auto &r){ return r.second.spilled; });
+        if(!any_spilled && (0 < this->scratch_end)){
+            this->scratch.close();
+            this->scratch.open(this->scratch_path.string(),
+                               std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+            this->scratch_end = 0;
+        }
+        return;
+    }
+
+    std::fstream & open_scratch(){
+        if(!this->scratch.is_open()){
+            this->scratch_path = boost::filesystem::temp_directory_path()
+                               / boost::filesystem::unique_path("dcma_spill_%%%%-%%%%-%%%%-%%%%.bin");
+            this->scratch.open(this->scratch_path.string(),
+                               std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+            if(!this->scratch.is_open()){
+                throw std::runtime_error("Unable to create scratch file '"_s + this->scratch_path.string() + "'");
+            }
+            FUNCINFO("Spilling data to scratch file '" << this->scratch_path.string() << "'");
+        }
+        this->scratch.clear();
+        return this->scratch;
+    }
+
+    void begin_write(record_t &r){
+        auto &fs = this->open_scratch();
+        fs.seekp(static_cast<std::streamoff>(this->scratch_end));
+        r.offset = this->scratch_end;
+        r.counts.clear();
+        return;
+    }
+
+    void end_write(record_t &r, uint64_t bytes){
+        auto &fs = this->scratch;
+        fs.flush();
+        if(!fs){
+            throw std::runtime_error("Unable to write to scratch file '"_s + this->scratch_path.string() + "'");
+        }
+        r.bytes = bytes;
+        r.spilled = true;
+        this->scratch_end += bytes;
+        this->metrics.spill_count += 1;
+        this->metrics.bytes_spilled += bytes;
+        return;
+    }
+
+    std::fstream & begin_read(const record_t &r){
+        auto &fs = this->open_scratch();
+        fs.seekg(static_cast<std::streamoff>(r.offset));
+        return fs;
+    }
+
+    void end_read(record_t &r){
+        if(!this->scratch){
+            throw std::runtime_error("Unable to read from scratch file '"_s + this->scratch_path.string() + "'");
+        }
+        r.spilled = false;
+        this->metrics.reload_count += 1;
+        this->metrics.bytes_reloaded += r.bytes;
+        return;
+    }
+
+    void spill(const std::shared_ptr<Image_Array> &ia, record_t &r){
+        this->begin_write(r);
+        uint64_t bytes = 0;
+        for(auto &img : ia->imagecoll.images){
+            this->scratch.write(reinterpret_cast<const char *>(img.data.data()), sizeof(float) * img.data.size());
+            bytes += sizeof(float) * img.data.size();
+            r.counts.push_back(static_cast<uint64_t>(img.data.size()));
+        }
+        this->end_write(r, bytes);
+        for(auto &img : ia->imagecoll.images){
+            decltype(img.data)().swap(img.data);
+        }
+        return;
+    }
+
+    void reload(const std::shared_ptr<Image_Array> &ia, record_t &r){
+        if(r.counts.size() != ia->imagecoll.images.size()){
+            throw std::logic_error("Spilled image array was altered. Refusing to reload it");
+        }
+        auto &fs = this->begin_read(r);
+        auto c_it = std::begin(r.counts);
+        for(auto &img : ia->imagecoll.images){
+            img.data.resize(*c_it);
+            fs.read(reinterpret_cast<char *>(img.data.data()), sizeof(float) * (*c_it));
+            ++c_it;
+        }
+        this->end_read(r);
+        return;
+    }
+
+    void spill(const std::shared_ptr<Surface_Mesh> &sm, record_t &r){
+        this->begin_write(r);
+        auto &fs = this->scratch;
+        auto &mesh = sm->meshes;
+
+        uint64_t bytes = 0;
+        const auto N_verts = static_cast<uint64_t>(mesh.vertices.size());
+        std::vector<double> coords;
+        coords.reserve(N_verts * 3);
+        for(const auto &v : mesh.vertices){
+            coords.push_back(v.x);
+            coords.push_back(v.y);
+            coords.push_back(v.z);
+        }
+        fs.write(reinterpret_cast<const char *>(coords.data()), sizeof(double) * coords.size());
+        bytes += sizeof(double) * coords.size();
+        bytes += write_nested(fs, mesh.faces);
+        bytes += write_nested(fs, mesh.involved_faces);
+        r.counts.push_back(N_verts);
+        this->end_write(r, bytes);
+
+        decltype(mesh.vertices)().swap(mesh.vertices);
+        decltype(mesh.faces)().swap(mesh.faces);
+        decltype(mesh.involved_faces)().swap(mesh.involved_faces);
+        return;
+    }
+
+    void reload(const std::shared_ptr<Surface_Mesh> &sm, record_t &r){
+        auto &fs = this->begin_read(r);
+        auto &mesh = sm->meshes;
+
+        const auto N_verts = r.counts.at(0);
+        std::vector<double> coords(N_verts * 3);
+        fs.read(reinterpret_cast<char *>(coords.data()), sizeof(double) * coords.size());
+        mesh.vertices.clear();
+        mesh.vertices.reserve(N_verts);
+        for(uint64_t i = 0; i < N_verts; ++i){
+            mesh.vertices.emplace_back( coords[i * 3 + 0], coords[i * 3 + 1], coords[i * 3 + 2] );
+        }
+        read_nested(fs, mesh.faces);
+        read_nested(fs, mesh.involved_faces);
+        this->end_read(r);
+        return;
+    }
+
+    template <class T>
+    void make_resident(const std::shared_ptr<T> &p, bool touch){
+        if(p == nullptr) return;
+        auto &r = this->get_record(p);
+        if(r.spilled) this->reload(p, r);
+        if(touch) r.last_used = this->tick;
+        return;
+    }
+
+  public:
+    ~spill_registry(){
+        if(this->scratch.is_open()){
+            this->scratch.close();
+            boost::system::error_code ec;
+            boost::filesystem::remove(this->scratch_path, ec);
+        }
+    }
+
+    void set_budget(uint64_t bytes){
+        std::lock_guard<std::mutex> lock(this->m);
+        this->budget = bytes;
+        return;
+    }
+
+    uint64_t get_budget(){
+        std::lock_guard<std::mutex> lock(this->m);
+        return this->budget;
+    }
+
+    memory_budget_metrics get_metrics(){
+        std::lock_guard<std::mutex> lock(this->m);
+        return this->metrics;
+    }
+
+    void make_resident( const std::list<std::shared_ptr<Image_Array>> &ias,
+                        const std::list<std::shared_ptr<Surface_Mesh>> &sms,
+                        bool touch ){
+        std::lock_guard<std::mutex> lock(this->m);
+        ++(this->tick);
+        for(const auto &ia : ias) this->make_resident(ia, touch);
+        for(const auto &sm : sms) this->make_resident(sm, touch);
+        this->purge_expired();
+        return;
+    }
+
+    void enforce(Drover &DICOM_data){
+        std::lock_guard<std::mutex> lock(this->m);
+        if(this->budget == 0) return;
+        ++(this->tick);
+
+        struct candidate_t {
+            uint64_t last_used;
+            uint64_t bytes;
+            std::shared_ptr<Image_Array> ia;
+            std::shared_ptr<Surface_Mesh> sm;
+        };
+        std::vector<candidate_t> candidates;
+        std::set<const void *> seen;
+        uint64_t resident = 0;
+        for(const auto &ia : DICOM_data.image_data){
+            if( (ia == nullptr) || !seen.insert(ia.get()).second ) continue;
+            const auto &r = this->get_record(ia);
+            if(r.spilled) continue;
+            const auto bytes = Estimate_Resident_Bytes(*ia);
+            resident += bytes;
+            candidates.push_back({ r.last_used, bytes, ia, nullptr });
+        }
+        for(const auto &sm : DICOM_data.smesh_data){
+            if( (sm == nullptr) || !seen.insert(sm.get()).second ) continue;
+            const auto &r = this->get_record(sm);
+            if(r.spilled) continue;
+            const auto bytes = Estimate_Resident_Bytes(*sm);
+            resident += bytes;
+            candidates.push_back({ r.last_used, bytes, nullptr, sm });
+        }
+
+        std::stable_sort(std::begin(candidates), std::end(candidates),
+                         [](const candidate_t &L, const candidate_t &R){ return L.last_used < R.last_used; });
+        for(const auto &c : candidates){
+            if(resident <= this->budget) break;
+            if(c.bytes == 0) continue;
+            if(c.ia != nullptr){
+                this->spill(c.ia, this->get_record(c.ia));
+            }else{
+                this->spill(c.sm, this->get_record(c.sm));
+            }
+            resident -= c.bytes;
+        }
+        this->metrics.resident_bytes = resident;
+        if(this->budget < resident){
+            FUNCWARN("Unable to satisfy memory budget; " << resident << " bytes remain resident");
+        }
+
+        this->purge_expired();
+        return;
+    }
+};
+
+spill_registry & Get_Spill_Registry(){
+    static spill_registry r;
+    return r;
+}
+
+// Collects the objects selected by any of the operation's selection arguments of the given kind. Returns false if
+// the operation does not document any such argument or if the selection could not be evaluated.
+template <class T, class F>
+bool selected_by_operation( const OperationArgPkg &OptArgs,
+                            const OperationDoc &OpDoc,
+                            const std::regex &regex_arg_name,
+                            F all_objects,
+                            std::list<std::shared_ptr<T>> &out ){
+    bool found = false;
+    std::set<const void *> seen;
+    try{
+        for(const auto &a : OpDoc.args){
+            if(!std::regex_match(a.name, regex_arg_name)) continue;
+            const auto selection = OptArgs.getValueStr(a.name);
+            if(!selection) continue;
+
+            found = true;
+            for(const auto &it : Whitelist(all_objects(), selection.value())){
+                if(seen.insert(it->get()).second) out.push_back(*it);
+            }
+        }
+    }catch(const std::exception &){
+        return false;
+    }
+    return found;
+}
+
+} // namespace
+
+
+void Set_Memory_Budget(uint64_t bytes){
+    Get_Spill_Registry().set_budget(bytes);
+    return;
+}
+
+uint64_t Get_Memory_Budget(){
+    return Get_Spill_Registry().get_budget();
+}
+
+memory_budget_metrics Get_Memory_Budget_Metrics(){
+    return Get_Spill_Registry().get_metrics();
+}
+
+void Log_Memory_Budget_Metrics(){
+    const auto m = Get_Memory_Budget_Metrics();
+    FUNCINFO("Memory budget: " << m.spill_count << " spills (" << m.bytes_spilled << " bytes), "
+             << m.reload_count << " reloads (" << m.bytes_reloaded << " bytes), "
+             << m.resident_bytes << " bytes resident of " << Get_Memory_Budget() << " bytes permitted");
+    return;
+}
+
+uint64_t Estimate_Resident_Bytes(const Image_Array &ia){
+    uint64_t bytes = 0;
+    for(const auto &img : ia.imagecoll.images){
+        bytes += sizeof(img) + sizeof(float) * img.data.capacity();
+    }
+    return bytes;
+}
+
+uint64_t Estimate_Resident_Bytes(const Surface_Mesh &sm){
+    return sizeof(sm)
+         + sizeof(vec3<double>) * sm.meshes.vertices.capacity()
+         + nested_bytes(sm.meshes.faces)
+         + nested_bytes(sm.meshes.involved_faces);
+}
+
+void Make_Resident(Drover &DICOM_data){
+    Get_Spill_Registry().make_resident(DICOM_data.image_data, DICOM_data.smesh_data, false);
+    return;
+}
+
+void Make_Resident_For_Operation( Drover &DICOM_data,
+                                  const OperationArgPkg &OptArgs,
+                                  const OperationDoc &OpDoc ){
+    // Meta-operations can do anything with the data, so everything is made resident.
+    if(!OptArgs.getChildren().empty()){
+        Get_Spill_Registry().make_resident(DICOM_data.image_data, DICOM_data.smesh_data, true);
+        return;
+    }
+
+    // Objects made resident only because the operation might access them are not marked as recently used, so they
+    // remain the first to be spilled.
+    std::list<std::shared_ptr<Image_Array>> ias;
+    if(selected_by_operation( OptArgs, OpDoc, Compile_Regex(".*ImageSelection"),
+                              [&](){ return All_IAs(DICOM_data); }, ias )){
+        Get_Spill_Registry().make_resident(ias, {}, true);
+    }else{
+        Get_Spill_Registry().make_resident(DICOM_data.image_data, {}, false);
+    }
+
+    std::list<std::shared_ptr<Surface_Mesh>> sms;
+    if(selected_by_operation( OptArgs, OpDoc, Compile_Regex(".*MeshSelection"),
+                              [&](){ return All_SMs(DICOM_data); }, sms )){
+        Get_Spill_Registry().make_resident({}, sms, true);
+    }else{
+        Get_Spill_Registry().make_resident({}, DICOM_data.smesh_data, false);
+    }
+    return;
+}
+
+void Enforce_Memory_Budget(Drover &DICOM_data){
+    Get_Spill_Registry().enforce(DICOM_data);
+    return;
+}
+
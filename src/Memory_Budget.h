@@ -0,0 +1,57 @@
+//Memory_Budget.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Structs.h"
+
+
+// Memory budget for image arrays and surface meshes.
+//
+// When a budget is set, the bulk data of the least-recently-used image arrays (pixel buffers) and surface meshes
+// (vertices and faces) is written to a binary scratch file between operations whenever the resident total exceeds the
+// budget. Metadata, geometry, and the objects themselves remain in the Drover, so selectors continue to work. Spilled
+// data is read back before an operation that may access it is invoked.
+//
+// Operations access Drover members directly, so residency is managed by Operation_Dispatcher() around each operation.
+// If an operation documents a selection argument for a kind of object (e.g., 'ImageSelection' or 'MeshSelection'),
+// only the selected objects of that kind are made resident. Otherwise all objects of that kind are made resident.
+// Objects must therefore not be accessed outside of operations while they are spilled; call Make_Resident() first.
+//
+// The scratch file is created in the system temporary directory (honouring TMPDIR) and removed at exit.
+
+struct memory_budget_metrics {
+    long int spill_count  = 0;   // Number of objects written to the scratch file.
+    long int reload_count = 0;   // Number of objects read back from the scratch file.
+    uint64_t bytes_spilled  = 0;
+    uint64_t bytes_reloaded = 0;
+    uint64_t resident_bytes = 0; // Estimated resident size after the most recent enforcement.
+};
+
+// Parses a size like '4096', '512M', '48G', or '1.5TiB'. Suffixes are powers of 1024.
+uint64_t Parse_Memory_Size(const std::string &in);
+
+// Sets the budget in bytes. Zero (the default) disables the budget.
+void Set_Memory_Budget(uint64_t bytes);
+uint64_t Get_Memory_Budget();
+
+memory_budget_metrics Get_Memory_Budget_Metrics();
+void Log_Memory_Budget_Metrics();
+
+// Estimates the memory held by the bulk data of an object.
+uint64_t Estimate_Resident_Bytes(const Image_Array &ia);
+uint64_t Estimate_Resident_Bytes(const Surface_Mesh &sm);
+
+// Reads all spilled objects in the Drover back into memory.
+void Make_Resident(Drover &DICOM_data);
+
+// Reads back the spilled objects the operation may access and marks them as recently used.
+void Make_Resident_For_Operation( Drover &DICOM_data,
+                                  const OperationArgPkg &OptArgs,
+                                  const OperationDoc &OpDoc );
+
+// Spills least-recently-used objects until the resident total is within the budget.
+void Enforce_Memory_Budget(Drover &DICOM_data);
+
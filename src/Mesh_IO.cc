@@ -0,0 +1,615 @@
+//Mesh_IO.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "YgorMath.h"         //Needed for vec3 class.
+
+#include "Mapped_File.h"
+
+#include "Mesh_IO.h"
+
+
+namespace {
+
+using mesh_t = fv_surface_mesh<double, uint64_t>;
+
+// Inputs smaller than this are parsed serially, since they are parsed faster than threads can be started.
+const size_t parallel_parse_threshold = 4 * 1024 * 1024;
+const size_t min_chunk_bytes = 1024 * 1024;
+
+std::vector<std::string_view> split_for_parsing(std::string_view text){
+    if(text.size() < parallel_parse_threshold) return { text };
+    return Split_Text_At_Lines(text, Default_Parse_Chunk_Count(), min_chunk_bytes);
+}
+
+bool is_blank(std::string_view line){
+    return std::all_of(line.begin(), line.end(), Is_Text_Whitespace);
+}
+
+// Parses exactly three coordinates, which must be the only remaining content.
+bool parse_coordinates(text_cursor &tc, vec3<double> &v){
+    if( !tc.next_number(v.x)
+    ||  !tc.next_number(v.y)
+    ||  !tc.next_number(v.z) ) return false;
+    tc.skip_whitespace();
+    return tc.at_end();
+}
+
+
+// Little-endian encoding and decoding, independent of the host byte order.
+void put_u32(char *out, uint32_t x){
+    for(int i = 0; i < 4; ++i) out[i] = static_cast<char>((x >> (8 * i)) & 0xFF);
+    return;
+}
+
+void put_u64(char *out, uint64_t x){
+    for(int i = 0; i < 8; ++i) out[i] = static_cast<char>((x >> (8 * i)) & 0xFF);
+    return;
+}
+
+void put_f32(char *out, float x){
+    uint32_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    put_u32(out, u);
+    return;
+}
+
+void put_f64(char *out, double x){
+    uint64_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    put_u64(out, u);
+    return;
+}
+
+uint32_t get_u32(const char *in){
+    uint32_t x = 0;
+    for(int i = 0; i < 4; ++i) x |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return x;
+}
+
+float get_f32(const char *in){
+    const auto u = get_u32(in);
+    float x;
+    std::memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+
+// Merges triangle corners with identical coordinates into shared vertices, numbered in order of first appearance.
+//
+// Corners are partitioned by hash so that each partition can be de-duplicated independently. Each corner is then
+// mapped to the first corner with the same coordinates, which is sufficient to number the vertices in a single pass.
+void merge_corners(std::vector<vec3<double>> &corners, mesh_t &mesh){
+    const auto N = static_cast<uint64_t>(corners.size());
+    const bool parallel = (parallel_parse_threshold / 64 < N);
+    const uint64_t N_parts = parallel ? std::max<uint64_t>(1, Default_Parse_Chunk_Count() / 4) : 1;
+
+    std::vector<uint64_t> hashes(N);
+    const auto N_blocks = parallel ? Default_Parse_Chunk_Count() : 1;
+    Parse_Chunks_In_Parallel(N_blocks, [&](size_t n) -> void {
+        const auto first = (N * n) / N_blocks;
+        const auto last = (N * (n + 1)) / N_blocks;
+        for(auto c = first; c < last; ++c){
+            // Adding zero converts negative zero to positive zero, so equal coordinates have equal hashes.
+            auto &v = corners[c];
+            v.x += 0.0;
+            v.y += 0.0;
+            v.z += 0.0;
+
+            uint64_t h = 0x9E3779B97F4A7C15ULL;
+            for(const double x : { v.x, v.y, v.z }){
+                uint64_t u;
+                std::memcpy(&u, &x, sizeof(u));
+                h ^= u + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+            }
+            hashes[c] = h ^ (h >> 31);
+        }
+    });
+
+    // Stable counting sort of the corners by partition.
+    std::vector<uint64_t> part_offsets(N_parts + 1, 0);
+    for(uint64_t c = 0; c < N; ++c) ++part_offsets[(hashes[c] % N_parts) + 1];
+    std::partial_sum(part_offsets.begin(), part_offsets.end(), part_offsets.begin());
+    std::vector<uint64_t> order(N);
+    {
+        auto next = part_offsets;
+        for(uint64_t c = 0; c < N; ++c) order[next[hashes[c] % N_parts]++] = c;
+    }
+
+    std::vector<uint64_t> first_corner(N);
+    Parse_Chunks_In_Parallel(N_parts, [&](size_t p) -> void {
+        const auto hash = [&](uint64_t c) -> size_t { return static_cast<size_t>(hashes[c] / N_parts); };
+        const auto equal = [&](uint64_t l, uint64_t r) -> bool {
+            return (corners[l].x == corners[r].x)
+                && (corners[l].y == corners[r].y)
+                && (corners[l].z == corners[r].z);
+        };
+        std::unordered_set<uint64_t, decltype(hash), decltype(equal)> seen(part_offsets[p + 1] - part_offsets[p],
+                                                                           hash, equal);
+        for(auto i = part_offsets[p]; i < part_offsets[p + 1]; ++i){
+            const auto c = order[i];
+            first_corner[c] = *(seen.insert(c).first);
+        }
+    });
+    decltype(order)().swap(order);
+    decltype(hashes)().swap(hashes);
+
+    // Number the vertices. The ids are stored in place of the first corners, which always precede their duplicates.
+    std::vector<vec3<double>> vertices;
+    for(uint64_t c = 0; c < N; ++c){
+        if(first_corner[c] == c){
+            first_corner[c] = static_cast<uint64_t>(vertices.size());
+            vertices.emplace_back(corners[c]);
+        }else{
+            first_corner[c] = first_corner[first_corner[c]];
+        }
+    }
+    vertices.shrink_to_fit();
+
+    std::vector<std::vector<uint64_t>> faces(N / 3);
+    for(uint64_t f = 0; f < (N / 3); ++f){
+        faces[f] = { first_corner[3 * f], first_corner[3 * f + 1], first_corner[3 * f + 2] };
+    }
+
+    mesh.vertices = std::move(vertices);
+    mesh.faces = std::move(faces);
+    mesh.recreate_involved_face_index();
+    return;
+}
+
+
+// Parses the facets in a piece of an ASCII STL file, appending the triangle corners.
+bool parse_ascii_stl_facets(std::string_view text, std::vector<vec3<double>> &corners){
+    text_cursor tc(text);
+    double ignored;
+    while(true){
+        const auto token = tc.next_token();
+        if(token.empty()) break;
+
+        if( (token == "solid") || (token == "endsolid") ){
+            tc.skip_line(); // Discard the name.
+            continue;
+        }
+        if( (token != "facet")
+        ||  (tc.next_token() != "normal")
+        ||  !tc.next_number(ignored)
+        ||  !tc.next_number(ignored)
+        ||  !tc.next_number(ignored)
+        ||  (tc.next_token() != "outer")
+        ||  (tc.next_token() != "loop") ){
+            return false;
+        }
+        for(int i = 0; i < 3; ++i){
+            vec3<double> v;
+            if( (tc.next_token() != "vertex")
+            ||  !tc.next_number(v.x)
+            ||  !tc.next_number(v.y)
+            ||  !tc.next_number(v.z) ){
+                return false;
+            }
+            corners.emplace_back(v);
+        }
+        if( (tc.next_token() != "endloop")
+        ||  (tc.next_token() != "endfacet") ){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_ascii_stl(mesh_t &mesh, std::string_view contents){
+    {
+        text_cursor tc(contents);
+        if(tc.next_token() != "solid") return false;
+    }
+
+    // Split the file at lines that begin a facet so the pieces can be parsed independently. A split is placed at the
+    // first such line after each nominal chunk boundary.
+    const char *end = contents.data() + contents.size();
+    std::vector<size_t> splits = { 0 };
+    for(const auto &chunk : split_for_parsing(contents)){
+        const char *pos = chunk.data();
+        if(static_cast<size_t>(pos - contents.data()) <= splits.back()) continue;
+
+        while(pos != end){
+            text_cursor tc(std::string_view(pos, end - pos));
+            tc.skip_blanks();
+            if(std::string_view(tc.pos, std::min<size_t>(5, end - tc.pos)) == "facet"){
+                splits.emplace_back(static_cast<size_t>(pos - contents.data()));
+                break;
+            }
+            tc.skip_line();
+            pos = tc.pos;
+        }
+    }
+    splits.emplace_back(contents.size());
+
+    std::vector<std::string_view> pieces;
+    for(size_t n = 1; n < splits.size(); ++n){
+        pieces.emplace_back(contents.substr(splits[n - 1], splits[n] - splits[n - 1]));
+    }
+
+    std::vector<std::vector<vec3<double>>> piece_corners(pieces.size());
+    std::vector<char> piece_ok(pieces.size(), 0);
+    Parse_Chunks_In_Parallel(pieces.size(), [&](size_t n) -> void {
+        piece_corners[n].reserve(pieces[n].size() / 80);
+        piece_ok[n] = parse_ascii_stl_facets(pieces[n], piece_corners[n]) ? 1 : 0;
+    });
+    if(!std::all_of(piece_ok.begin(), piece_ok.end(), [](char ok){ return (ok != 0); })) return false;
+
+    std::vector<vec3<double>> corners;
+    corners.reserve(std::accumulate(piece_corners.begin(), piece_corners.end(), static_cast<size_t>(0),
+                                    [](size_t s, const std::vector<vec3<double>> &v){ return s + v.size(); }));
+    for(auto &v : piece_corners){
+        corners.insert(corners.end(), v.begin(), v.end());
+        std::vector<vec3<double>>().swap(v);
+    }
+    if(corners.empty()) return false;
+
+    merge_corners(corners, mesh);
+    return true;
+}
+
+bool parse_binary_stl(mesh_t &mesh, std::string_view contents){
+    // 80 byte header, 4 byte triangle count, and then 50 bytes per triangle. The size must match exactly.
+    const size_t header_size = 84;
+    const size_t facet_size = 50;
+    if(contents.size() < header_size) return false;
+    const auto N_facets = static_cast<size_t>(get_u32(contents.data() + 80));
+    if( (N_facets == 0)
+    ||  (contents.size() != (header_size + facet_size * N_facets)) ) return false;
+
+    std::vector<vec3<double>> corners(3 * N_facets);
+    const size_t N_blocks = (contents.size() < parallel_parse_threshold) ? 1 : Default_Parse_Chunk_Count();
+    Parse_Chunks_In_Parallel(N_blocks, [&](size_t n) -> void {
+        const auto first = (N_facets * n) / N_blocks;
+        const auto last = (N_facets * (n + 1)) / N_blocks;
+        for(auto f = first; f < last; ++f){
+            const char *p = contents.data() + header_size + facet_size * f + 12; // Skip the normal.
+            for(size_t i = 0; i < 3; ++i, p += 12){
+                corners[3 * f + i] = vec3<double>( static_cast<double>(get_f32(p)),
+                                                   static_cast<double>(get_f32(p + 4)),
+                                                   static_cast<double>(get_f32(p + 8)) );
+            }
+        }
+    });
+
+    merge_corners(corners, mesh);
+    return true;
+}
+
+} // namespace
+
+
+bool Parse_STL_Mesh( mesh_t &mesh,
+                     std::string_view contents ){
+    // Binary files can begin with 'solid', so fall back to binary if the ASCII parse fails.
+    return parse_ascii_stl(mesh, contents)
+        || parse_binary_stl(mesh, contents);
+}
+
+
+bool Parse_OBJ_Mesh( mesh_t &mesh,
+                     std::string_view contents ){
+    const auto chunks = split_for_parsing(contents);
+    const auto N_chunks = chunks.size();
+
+    const auto ignored_statement = [](std::string_view s) -> bool {
+        return (s == "vt") || (s == "vp") || (s == "o") || (s == "g") || (s == "s") || (s == "usemtl") || (s == "mtllib");
+    };
+
+    // Count the vertices and faces in each chunk so that they can be parsed directly into place. Vertex counts are
+    // also needed to resolve relative (i.e., negative) face indices.
+    std::vector<uint64_t> vert_offsets(N_chunks + 1, 0);
+    std::vector<uint64_t> face_offsets(N_chunks + 1, 0);
+    std::vector<char> chunk_ok(N_chunks, 1);
+    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+        const char *pos = chunks[n].data();
+        const char *end = pos + chunks[n].size();
+        while(pos != end){
+            text_cursor tc(Next_Text_Line(pos, end, '#'));
+            const auto s = tc.next_token();
+            if(s.empty() || ignored_statement(s)){
+                continue;
+            }else if(s == "v"){
+                ++vert_offsets[n + 1];
+            }else if(s == "f"){
+                ++face_offsets[n + 1];
+            }else{
+                chunk_ok[n] = 0;
+                break;
+            }
+        }
+    });
+    if(!std::all_of(chunk_ok.begin(), chunk_ok.end(), [](char ok){ return (ok != 0); })) return false;
+    std::partial_sum(vert_offsets.begin(), vert_offsets.end(), vert_offsets.begin());
+    std::partial_sum(face_offsets.begin(), face_offsets.end(), face_offsets.begin());
+    const auto N_verts = vert_offsets.back();
+    const auto N_faces = face_offsets.back();
+    if( (N_verts == 0) || (N_faces == 0) ) return false;
+
+    std::vector<vec3<double>> vertices(N_verts);
+    std::vector<std::vector<uint64_t>> faces(N_faces);
+    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+        auto v_i = vert_offsets[n];
+        auto f_i = face_offsets[n];
+        const char *pos = chunks[n].data();
+        const char *end = pos + chunks[n].size();
+        while(pos != end){
+            text_cursor tc(Next_Text_Line(pos, end, '#'));
+            const auto s = tc.next_token();
+            if(s == "v"){
+                if(!parse_coordinates(tc, vertices[v_i++])){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+            }else if(s == "f"){
+                // Each vertex reference has the form 'v', 'v/vt', 'v//vn', or 'v/vt/vn'. Only 'v' is used.
+                auto &face = faces[f_i++];
+                while(true){
+                    const auto ref = tc.next_token();
+                    if(ref.empty()) break;
+
+                    int64_t k = 0;
+                    const auto *p = Parse_Number(ref.data(), ref.data() + ref.size(), k);
+                    if( (p == nullptr)
+                    ||  ( (p != (ref.data() + ref.size())) && (*p != '/') ) ){
+                        chunk_ok[n] = 0;
+                        return;
+                    }
+                    const int64_t index = (0 < k) ? (k - 1) : (static_cast<int64_t>(v_i) + k);
+                    if( (k == 0) || (index < 0) || (static_cast<int64_t>(N_verts) <= index) ){
+                        chunk_ok[n] = 0;
+                        return;
+                    }
+                    face.emplace_back(static_cast<uint64_t>(index));
+                }
+                if(face.size() < 3){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+            }
+        }
+    });
+    if(!std::all_of(chunk_ok.begin(), chunk_ok.end(), [](char ok){ return (ok != 0); })) return false;
+
+    mesh.vertices = std::move(vertices);
+    mesh.faces = std::move(faces);
+    mesh.recreate_involved_face_index();
+    return true;
+}
+
+
+bool Parse_OFF_Mesh( mesh_t &mesh,
+                     std::string_view contents ){
+    const char *pos = contents.data();
+    const char *end = pos + contents.size();
+
+    // The header keyword, optionally followed by the counts on the same line.
+    text_cursor tc;
+    while(pos != end){
+        tc = text_cursor(Next_Text_Line(pos, end, '#'));
+        if(!tc.at_line_end()) break;
+    }
+    if(tc.next_token() != "OFF") return false;
+
+    uint64_t N_verts = 0;
+    uint64_t N_faces = 0;
+    uint64_t N_edges = 0;
+    tc.skip_whitespace();
+    while(tc.at_end() && (pos != end)){
+        tc = text_cursor(Next_Text_Line(pos, end, '#'));
+        tc.skip_whitespace();
+    }
+    if( !tc.next_number(N_verts)
+    ||  !tc.next_number(N_faces) ) return false;
+    tc.skip_whitespace();
+    if(!tc.at_end()){
+        if(!tc.next_number(N_edges)) return false;
+        tc.skip_whitespace();
+        if(!tc.at_end()) return false;
+    }
+    if( (N_verts == 0) || (N_faces == 0) ) return false;
+
+    // Every remaining non-blank line holds one vertex or one face, in that order. Count the lines in each chunk so
+    // that every line's element can be located, and then parse directly into place.
+    const auto chunks = split_for_parsing(std::string_view(pos, end - pos));
+    const auto N_chunks = chunks.size();
+    std::vector<uint64_t> line_offsets(N_chunks + 1, 0);
+    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+        const char *p = chunks[n].data();
+        const char *e = p + chunks[n].size();
+        while(p != e){
+            if(!is_blank(Next_Text_Line(p, e, '#'))) ++line_offsets[n + 1];
+        }
+    });
+    std::partial_sum(line_offsets.begin(), line_offsets.end(), line_offsets.begin());
+    if(line_offsets.back() < (N_verts + N_faces)) return false;
+
+    std::vector<vec3<double>> vertices(N_verts);
+    std::vector<std::vector<uint64_t>> faces(N_faces);
+    std::vector<char> chunk_ok(N_chunks, 1);
+    Parse_Chunks_In_Parallel(N_chunks, [&](size_t n) -> void {
+        auto l = line_offsets[n];
+        const char *p = chunks[n].data();
+        const char *e = p + chunks[n].size();
+        while( (p != e) && (l < (N_verts + N_faces)) ){
+            const auto line = Next_Text_Line(p, e, '#');
+            if(is_blank(line)) continue;
+            text_cursor ltc(line);
+
+            if(l < N_verts){
+                if(!parse_coordinates(ltc, vertices[l])){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+            }else{
+                auto &face = faces[l - N_verts];
+                uint64_t N_face_verts = 0;
+                if( !ltc.next_number(N_face_verts)
+                ||  (N_face_verts == 0)
+                ||  (N_verts < N_face_verts) ){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+                face.resize(N_face_verts);
+                for(auto &index : face){
+                    if( !ltc.next_number(index)
+                    ||  (N_verts <= index) ){
+                        chunk_ok[n] = 0;
+                        return;
+                    }
+                }
+
+                // Trailing per-face colours are not supported.
+                ltc.skip_whitespace();
+                if(!ltc.at_end()){
+                    chunk_ok[n] = 0;
+                    return;
+                }
+            }
+            ++l;
+        }
+    });
+    if(!std::all_of(chunk_ok.begin(), chunk_ok.end(), [](char ok){ return (ok != 0); })) return false;
+
+    mesh.vertices = std::move(vertices);
+    mesh.faces = std::move(faces);
+    mesh.recreate_involved_face_index();
+    return true;
+}
+
+
+bool Write_Binary_STL_Mesh( const mesh_t &mesh,
+                            std::ostream &os ){
+    const auto N_verts = static_cast<uint64_t>(mesh.vertices.size());
+    const auto N_faces = mesh.faces.size();
+
+    // Each polygon with n vertices contributes n - 2 triangles.
+    std::vector<uint64_t> tri_offsets(N_faces + 1, 0);
+    for(size_t f = 0; f < N_faces; ++f){
+        const auto &face = mesh.faces[f];
+        if(std::any_of(face.begin(), face.end(), [N_verts](uint64_t i){ return (N_verts <= i); })) return false;
+        tri_offsets[f + 1] = tri_offsets[f] + ((face.size() < 3) ? 0 : (face.size() - 2));
+    }
+    const auto N_tris = tri_offsets.back();
+    if(std::numeric_limits<uint32_t>::max() < N_tris) return false;
+
+    const size_t header_size = 84;
+    const size_t facet_size = 50;
+    std::vector<char> buf(header_size + facet_size * N_tris, 0);
+
+    // The header must not begin with 'solid', which would suggest an ASCII file.
+    const std::string header = "Binary STL written by DICOMautomaton";
+    std::copy(header.begin(), header.end(), buf.begin());
+    put_u32(buf.data() + 80, static_cast<uint32_t>(N_tris));
+
+    const size_t N_blocks = (buf.size() < parallel_parse_threshold) ? 1 : Default_Parse_Chunk_Count();
+    Parse_Chunks_In_Parallel(N_blocks, [&](size_t n) -> void {
+        const auto first = (N_faces * n) / N_blocks;
+        const auto last = (N_faces * (n + 1)) / N_blocks;
+        for(auto f = first; f < last; ++f){
+            const auto &face = mesh.faces[f];
+            char *p = buf.data() + header_size + facet_size * tri_offsets[f];
+            for(size_t i = 2; i < face.size(); ++i, p += facet_size){
+                const auto &A = mesh.vertices[face[0]];
+                const auto &B = mesh.vertices[face[i - 1]];
+                const auto &C = mesh.vertices[face[i]];
+
+                // Degenerate triangles are given a zero normal.
+                const auto N = (B - A).Cross(C - A);
+                const auto L = N.length();
+                const auto U = (0.0 < L) ? (N / L) : vec3<double>(0.0, 0.0, 0.0);
+
+                put_f32(p +  0, static_cast<float>(U.x));
+                put_f32(p +  4, static_cast<float>(U.y));
+                put_f32(p +  8, static_cast<float>(U.z));
+                size_t k = 12;
+                for(const auto *v : { &A, &B, &C }){
+                    put_f32(p + k + 0, static_cast<float>(v->x));
+                    put_f32(p + k + 4, static_cast<float>(v->y));
+                    put_f32(p + k + 8, static_cast<float>(v->z));
+                    k += 12;
+                }
+                // The trailing 'attribute byte count' is left zero.
+            }
+        }
+    });
+
+    os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    os.flush();
+    return os.good();
+}
+
+
+bool Write_Binary_PLY_Mesh( const mesh_t &mesh,
+                            std::ostream &os ){
+    const auto N_verts = static_cast<uint64_t>(mesh.vertices.size());
+    const auto N_faces = mesh.faces.size();
+    if(std::numeric_limits<uint32_t>::max() < N_verts) return false;
+
+    // Each face is stored as a one byte count followed by four byte indices.
+    std::vector<uint64_t> face_offsets(N_faces + 1, 0);
+    for(size_t f = 0; f < N_faces; ++f){
+        const auto &face = mesh.faces[f];
+        if(std::numeric_limits<uint8_t>::max() < face.size()) return false;
+        if(std::any_of(face.begin(), face.end(), [N_verts](uint64_t i){ return (N_verts <= i); })) return false;
+        face_offsets[f + 1] = face_offsets[f] + 1 + 4 * face.size();
+    }
+
+    const std::string header = "ply\n"
+                               "format binary_little_endian 1.0\n"
+                               "comment Written by DICOMautomaton\n"
+                               "element vertex " + std::to_string(N_verts) + "\n"
+                               "property double x\n"
+                               "property double y\n"
+                               "property double z\n"
+                               "element face " + std::to_string(N_faces) + "\n"
+                               "property list uchar uint vertex_indices\n"
+                               "end_header\n";
+    const size_t vert_size = 24;
+    const size_t face_start = header.size() + vert_size * N_verts;
+    std::vector<char> buf(face_start + face_offsets.back());
+    std::copy(header.begin(), header.end(), buf.begin());
+
+    const size_t N_blocks = (buf.size() < parallel_parse_threshold) ? 1 : Default_Parse_Chunk_Count();
+    Parse_Chunks_In_Parallel(N_blocks, [&](size_t n) -> void {
+        const auto v_first = (N_verts * n) / N_blocks;
+        const auto v_last = (N_verts * (n + 1)) / N_blocks;
+        for(auto v = v_first; v < v_last; ++v){
+            char *p = buf.data() + header.size() + vert_size * v;
+            put_f64(p +  0, mesh.vertices[v].x);
+            put_f64(p +  8, mesh.vertices[v].y);
+            put_f64(p + 16, mesh.vertices[v].z);
+        }
+
+        const auto f_first = (N_faces * n) / N_blocks;
+        const auto f_last = (N_faces * (n + 1)) / N_blocks;
+        for(auto f = f_first; f < f_last; ++f){
+            const auto &face = mesh.faces[f];
+            char *p = buf.data() + face_start + face_offsets[f];
+            *p++ = static_cast<char>(face.size());
+            for(const auto &i : face){
+                put_u32(p, static_cast<uint32_t>(i));
+                p += 4;
+            }
+        }
+    });
+
+    os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    os.flush();
+    return os.good();
+}
+
@@ -0,0 +1,43 @@
+//Mesh_IO.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "YgorMath.h"         //Needed for fv_surface_mesh class.
+
+
+// Parsers for whole, in-memory (e.g., memory-mapped) surface mesh files. Large inputs are split into chunks that are
+// parsed concurrently.
+//
+// These parsers accept a common subset of each format and return false if the input is malformed or uses features
+// they do not support (e.g., vertex normals or per-face colours). In that case the stream readers in Ygor, which are
+// slower but more permissive, can be tried instead. The mesh is only altered on success.
+
+// Reads an ASCII or binary STL file. Since STL files store each triangle independently, vertices with identical
+// coordinates are merged. Facet normals are ignored.
+bool Parse_STL_Mesh( fv_surface_mesh<double, uint64_t> &mesh,
+                     std::string_view contents );
+
+// Reads vertices and polygonal faces from an OBJ file. Texture coordinates, groups, objects, smoothing groups, and
+// materials are ignored.
+bool Parse_OBJ_Mesh( fv_surface_mesh<double, uint64_t> &mesh,
+                     std::string_view contents );
+
+// Reads vertices and polygonal faces from an OFF file.
+bool Parse_OFF_Mesh( fv_surface_mesh<double, uint64_t> &mesh,
+                     std::string_view contents );
+
+
+// Writes the mesh as a binary STL file. Polygonal faces are triangulated as fans around their first vertex, and vertex
+// coordinates are reduced to single precision (per the format).
+bool Write_Binary_STL_Mesh( const fv_surface_mesh<double, uint64_t> &mesh,
+                            std::ostream &os );
+
+// Writes the mesh as a little-endian binary PLY file with double-precision vertices and polygonal faces, which is
+// lossless for meshes with fewer than 2^32 vertices and faces with at most 255 vertices.
+bool Write_Binary_PLY_Mesh( const fv_surface_mesh<double, uint64_t> &mesh,
+                            std::ostream &os );
+
@@ -24,6 +24,8 @@
 
 #include "Structs.h"
 #include "Imebra_Shim.h"
+#include "Mapped_File.h"
+#include "Mesh_IO.h"
 
 
 bool Load_Mesh_From_OBJ_Files( Drover &DICOM_data,
@@ -55,11 +57,21 @@ bool Load_Mesh_From_OBJ_Files( Drover &DICOM_data,
         try{
             //////////////////////////////////////////////////////////////
             // Attempt to load the file.
-            std::ifstream FI(Filename.c_str(), std::ios::in);
-            if(!ReadFVSMeshFromOBJ(DICOM_data.smesh_data.back()->meshes, FI)){
+            //
+            // The memory-mapped parser handles common files. If it cannot, fall back to the stream reader, which accepts
+            // a broader subset of the format.
+            bool loaded = false;
+            {
+                mapped_file mf(Filename);
+                loaded = Parse_OBJ_Mesh(DICOM_data.smesh_data.back()->meshes, mf.view());
+            }
+            if(!loaded){
+                std::ifstream FI(Filename.c_str(), std::ios::in);
+                loaded = ReadFVSMeshFromOBJ(DICOM_data.smesh_data.back()->meshes, FI);
+            }
+            if(!loaded){
                 throw std::runtime_error("Unable to read mesh from file.");
             }
-            FI.close();
             //////////////////////////////////////////////////////////////
 
             // Reject the file if the mesh is not valid.
@@ -16,6 +16,8 @@
 #include <boost/filesystem.hpp>
 #include <cstdlib>            //Needed for exit() calls.
 
+#include "Mapped_File.h"
+#include "Mesh_IO.h"
 #include "Structs.h"
 #include "YgorMath.h"         //Needed for vec3 class.
 #include "YgorMathIOOFF.h"
@@ -52,11 +54,21 @@ bool Load_Mesh_From_OFF_Files( Drover &DICOM_data,
         try{
             //////////////////////////////////////////////////////////////
             // Attempt to load the file.
-            std::ifstream FI(Filename.c_str(), std::ios::in);
-            if(!ReadFVSMeshFromOFF(DICOM_data.smesh_data.back()->meshes, FI)){
+            //
+            // The memory-mapped parser handles common files. If it cannot, fall back to the stream reader, which accepts
+            // a broader subset of the format.
+            bool loaded = false;
+            {
+                mapped_file mf(Filename);
+                loaded = Parse_OFF_Mesh(DICOM_data.smesh_data.back()->meshes, mf.view());
+            }
+            if(!loaded){
+                std::ifstream FI(Filename.c_str(), std::ios::in);
+                loaded = ReadFVSMeshFromOFF(DICOM_data.smesh_data.back()->meshes, FI);
+            }
+            if(!loaded){
                 throw std::runtime_error("Unable to read mesh from file.");
             }
-            FI.close();
             //////////////////////////////////////////////////////////////
 
             // Reject the file if the mesh is not valid.
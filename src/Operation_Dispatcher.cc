@@ -5,11 +5,14 @@
 //
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <list>
 #include <map>
+#include <mutex>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>    
 #include <type_traits>
@@ -17,7 +20,9 @@
 
 #include <YgorMisc.h>
 
+#include "Memory_Budget.h"
 #include "Structs.h"
+#include "Write_File.h"
 
 #include "Operations/AccumulateRowsColumns.h"
 #include "Operations/AnalyzeHistograms.h"
@@ -117,6 +122,7 @@
 #include "Operations/LogScale.h"
 #include "Operations/MaxMinPixels.h"
 #include "Operations/MeldDose.h"
+#include "Operations/MergeResultShards.h"
 #include "Operations/ModifyContourMetadata.h"
 #include "Operations/ModifyImageMetadata.h"
 #include "Operations/NegatePixels.h"
@@ -299,6 +305,7 @@ std::map<std::string, op_packet_t> Known_Operations(){
     out["LogScale"] = std::make_pair(OpArgDocLogScale, LogScale);
     out["MaxMinPixels"] = std::make_pair(OpArgDocMaxMinPixels, MaxMinPixels);
     out["MeldDose"] = std::make_pair(OpArgDocMeldDose, MeldDose);
+    out["MergeResultShards"] = std::make_pair(OpArgDocMergeResultShards, MergeResultShards);
     out["ModifyContourMetadata"] = std::make_pair(OpArgDocModifyContourMetadata, ModifyContourMetadata);
     out["ModifyImageMetadata"] = std::make_pair(OpArgDocModifyImageMetadata, ModifyImageMetadata);
     out["NegatePixels"] = std::make_pair(OpArgDocNegatePixels, NegatePixels);
@@ -381,6 +388,43 @@ std::map<std::string, op_packet_t> Known_Operations(){
 }
 
 
+bool Operation_Has_External_Side_Effects(const std::string &op_name){
+    for(const auto &op_func : Known_Operations()){
+        if(boost::iequals(op_func.first, op_name)) return op_func.second.first().has_external_side_effects;
+    }
+    return false;
+}
+
+static thread_local const std::atomic<bool> *operation_cancel_flag = nullptr;
+
+operation_cancellation_scope::operation_cancellation_scope(const std::atomic<bool> *flag)
+    : prev(operation_cancel_flag) {
+    operation_cancel_flag = flag;
+}
+
+operation_cancellation_scope::~operation_cancellation_scope(){
+    operation_cancel_flag = this->prev;
+}
+
+const std::atomic<bool> * Get_Operation_Cancel_Flag(){
+    return operation_cancel_flag;
+}
+
+static thread_local long int dispatch_depth = 0;
+
+operation_dispatch_depth_scope::operation_dispatch_depth_scope(long int depth)
+    : prev(dispatch_depth) {
+    dispatch_depth = depth;
+}
+
+operation_dispatch_depth_scope::~operation_dispatch_depth_scope(){
+    dispatch_depth = this->prev;
+}
+
+long int Get_Operation_Dispatch_Depth(){
+    return dispatch_depth;
+}
+
 bool Operation_Dispatcher( Drover &DICOM_data,
                            const std::map<std::string,std::string> &InvocationMetadata,
                            const std::string &FilenameLex,
@@ -388,8 +432,21 @@ bool Operation_Dispatcher( Drover &DICOM_data,
 
     auto op_name_mapping = Known_Operations();
 
+    // Only the outermost dispatcher manages the memory budget. Nested invocations (e.g., from meta-operations) work on
+    // objects that were made resident before the meta-operation was invoked. The depth is tracked per thread so that
+    // independent dispatchers (e.g., concurrent web server jobs) each manage their own data.
+    struct dispatch_depth_guard_t {
+        bool outermost;
+        dispatch_depth_guard_t() : outermost(dispatch_depth++ == 0) {}
+        ~dispatch_depth_guard_t(){ --dispatch_depth; }
+    } dispatch_depth_guard;
+    const bool manage_memory = dispatch_depth_guard.outermost && (0 < Get_Memory_Budget());
+
     try{
         for(const auto &OptArgs : Operations){
+            if( (operation_cancel_flag != nullptr) && operation_cancel_flag->load() ){
+                throw std::runtime_error("Cancelled before operation '" + OptArgs.getName() + "'");
+            }
             auto optargs = OptArgs;
             bool WasFound = false;
             for(const auto &op_func : op_name_mapping){
@@ -402,17 +459,43 @@ bool Operation_Dispatcher( Drover &DICOM_data,
                         if(r.expected) optargs.insert( r.name, r.default_val );
                     }
 
+                    // Operations with external side-effects are serialized in case several chains are being
+                    // evaluated concurrently (e.g., by ForEachDistinct).
+                    static std::mutex side_effect_mutex;
+                    std::unique_lock<std::mutex> lock(side_effect_mutex, std::defer_lock);
+                    if(OpDocs.has_external_side_effects) lock.lock();
+
+                    if(manage_memory) Make_Resident_For_Operation(DICOM_data, optargs, OpDocs);
+
                     FUNCINFO("Performing operation '" << op_func.first << "' now..");
                     DICOM_data = op_func.second.second(DICOM_data,
                                                        optargs,
                                                        InvocationMetadata,
                                                        FilenameLex);
+
+                    if(manage_memory) Enforce_Memory_Budget(DICOM_data);
                 }
             }
             if(!WasFound) throw std::invalid_argument("No operation matched '" + optargs.getName() + "'");
         }
     }catch(const std::exception &e){
         FUNCWARN("Analysis failed: '" << e.what() << "'. Aborting remaining analyses");
+        if(manage_memory) Log_Memory_Budget_Metrics();
+        try{
+            Flush_Result_Sinks();
+        }catch(const std::exception &e){
+            FUNCWARN("Unable to write buffered results: '" << e.what() << "'");
+        }
+        return false;
+    }
+
+    if(manage_memory) Log_Memory_Budget_Metrics();
+
+    // Write any buffered results so they are available to later invocations.
+    try{
+        Flush_Result_Sinks();
+    }catch(const std::exception &e){
+        FUNCWARN("Unable to write buffered results: '" << e.what() << "'");
         return false;
     }
 
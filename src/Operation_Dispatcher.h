@@ -7,6 +7,7 @@
 #include <list>
 #include <functional>
 #include <utility>
+#include <atomic>
 
 #include "Structs.h"
 
@@ -19,6 +20,47 @@ typedef std::pair<op_doc_func_t,op_func_t> op_packet_t;
 
 std::map<std::string, op_packet_t> Known_Operations();
 
+// Whether the operation declares external side-effects (see OperationDoc::has_external_side_effects). Unknown
+// operations are assumed to have none.
+bool Operation_Has_External_Side_Effects(const std::string &op_name);
+
+// Cooperative cancellation. While a scope is alive, Operation_Dispatcher() invocations on the calling thread check the
+// flag before each operation (including those nested within meta-operations) and fail once it has been set. Operations
+// that dispatch children on other threads should re-install the current flag there (see Get_Operation_Cancel_Flag()).
+// The flag must outlive the scope.
+class operation_cancellation_scope {
+    private:
+        const std::atomic<bool> *prev;
+
+    public:
+        explicit operation_cancellation_scope(const std::atomic<bool> *flag);
+        ~operation_cancellation_scope();
+
+        operation_cancellation_scope(const operation_cancellation_scope &) = delete;
+        operation_cancellation_scope & operator=(const operation_cancellation_scope &) = delete;
+};
+
+// The flag installed for the calling thread, or nullptr if none.
+const std::atomic<bool> * Get_Operation_Cancel_Flag();
+
+// The nesting depth of Operation_Dispatcher() invocations on the calling thread. Operations that dispatch children on
+// other threads should carry the depth over so the children are not treated as outermost invocations.
+class operation_dispatch_depth_scope {
+    private:
+        long int prev;
+
+    public:
+        explicit operation_dispatch_depth_scope(long int depth);
+        ~operation_dispatch_depth_scope();
+
+        operation_dispatch_depth_scope(const operation_dispatch_depth_scope &) = delete;
+        operation_dispatch_depth_scope & operator=(const operation_dispatch_depth_scope &) = delete;
+};
+
+long int Get_Operation_Dispatch_Depth();
+
+// Invokes the operations in order. If a memory budget is set (see Memory_Budget.h), the outermost invocation spills and
+// reloads data around each operation. Spilled data remains spilled when this routine returns.
 bool Operation_Dispatcher( Drover &DICOM_data,
                            const std::map<std::string,std::string> &InvocationMetadata,
                            const std::string &FilenameLex,
@@ -29,6 +29,7 @@
 OperationDoc OpArgDocAccumulateRowsColumns(){
     OperationDoc out;
     out.name = "AccumulateRowsColumns";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation generates row- and column-profiles of images in which the entire row or column has been summed"
@@ -41,6 +41,7 @@
 OperationDoc OpArgDocAnalyzeLightRadFieldCoincidence(){
     OperationDoc out;
     out.name = "AnalyzeLightRadFieldCoincidence";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation analyzes the selected images to compare light and radiation field coincidence for fixed, symmetric"
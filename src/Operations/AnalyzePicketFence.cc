@@ -39,6 +39,7 @@
 OperationDoc OpArgDocAnalyzePicketFence(){
     OperationDoc out;
     out.name = "AnalyzePicketFence";
+    out.has_external_side_effects = true;
 
     out.desc = "This operation extracts MLC positions from a picket fence image.";
 
@@ -18,6 +18,7 @@
 OperationDoc OpArgDocBoost_Serialize_Drover(){
     OperationDoc out;
     out.name = "Boost_Serialize_Drover";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation exports all loaded state to a serialized format that can be loaded again later."
         " Is is especially useful for suspending long-running operations with intermittant interactive sub-operations.";
@@ -25,6 +25,7 @@
 OperationDoc OpArgDocBuildLexiconInteractively(){
     OperationDoc out;
     out.name = "BuildLexiconInteractively";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation interactively builds a lexicon using the currently loaded contour labels."
         " It is useful for constructing a domain-specific lexicon from a set of representative data.";
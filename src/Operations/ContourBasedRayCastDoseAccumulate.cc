@@ -10,6 +10,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <stdexcept>
 #include <string>    
@@ -17,7 +18,9 @@
 
 #include "../Dose_Meld.h"
 #include "../Structs.h"
+#include "../Ray_Casting.h"
 #include "../Regex_Selectors.h"
+#include "../Thread_Pool.h"
 #include "ContourBasedRayCastDoseAccumulate.h"
 #include "Explicator.h"       //Needed for Explicator class.
 #include "YgorImages.h"
@@ -30,6 +33,7 @@
 OperationDoc OpArgDocContourBasedRayCastDoseAccumulate(){
     OperationDoc out;
     out.name = "ContourBasedRayCastDoseAccumulate";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation performs ray-casting to estimate the dose of a surface."
         " The surface is represented as a set of contours (i.e., an ROI).";
@@ -73,12 +77,26 @@ OperationDoc OpArgDocContourBasedRayCastDoseAccumulate(){
     out.args.back().expected = true;
     out.args.back().examples = { "1.0", "2.0", "0.5", "5.0" };
     
+    out.args.emplace_back();
+    out.args.back().name = "Method";
+    out.args.back().desc = "Controls how rays are traced through the surface."
+                      " The 'exact' method intersects rays analytically with the cylinders and spheres (using a bounding"
+                      " volume hierarchy) and integrates dose exactly over the in-surface intervals by traversing dose"
+                      " voxels. Results do not depend on any step size."
+                      " The 'march' method advances rays in fixed increments of RaydL, sampling the surface and dose at"
+                      " each step. It is much slower and is retained mainly for comparison.";
+    out.args.back().default_val = "exact";
+    out.args.back().expected = true;
+    out.args.back().examples = { "exact", "march" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
     out.args.emplace_back();
     out.args.back().name = "RaydL";
     out.args.back().desc = "The distance to move a ray each iteration. Should be << img_thickness and << cylinder_radius."
                       " Making too large will invalidate results, causing rays to pass through the surface without"
                       " registering any dose accumulation. Making too small will cause the run-time to grow and may"
-                      " eventually lead to truncation or round-off errors. Quantity is in the DICOM coordinate system.";
+                      " eventually lead to truncation or round-off errors. Quantity is in the DICOM coordinate system."
+                      " Only used by the 'march' method.";
     out.args.back().default_val = "0.1";
     out.args.back().expected = true;
     out.args.back().examples = { "0.1", "0.05", "0.01", "0.005" };
@@ -116,6 +134,7 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
     const auto ROILabelRegex = OptArgs.getValueStr("ROILabelRegex").value();
     const auto NormalizedROILabelRegex = OptArgs.getValueStr("NormalizedROILabelRegex").value();
     const auto CylinderRadiusStr = OptArgs.getValueStr("CylinderRadius").value();
+    const auto MethodStr = OptArgs.getValueStr("Method").value();
     const auto RaydLStr = OptArgs.getValueStr("RaydL").value();
     const auto RowsStr = OptArgs.getValueStr("Rows").value();
     const auto ColumnsStr = OptArgs.getValueStr("Columns").value();
@@ -126,6 +145,13 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
     const auto Rows = std::stol(RowsStr);
     const auto Columns = std::stol(ColumnsStr);
 
+    const auto regex_exact = Compile_Regex("^ex?a?c?t?$");
+    const auto regex_march = Compile_Regex("^ma?r?c?h?$");
+    const bool use_exact = std::regex_match(MethodStr, regex_exact);
+    if(!use_exact && !std::regex_match(MethodStr, regex_march)){
+        throw std::invalid_argument("Method not understood. Cannot continue.");
+    }
+
     Explicator X(FilenameLex);
 
     //Ensure the Ray dL is sufficiently small. We enforce that ray cannot step over the cylinder in a single iteration
@@ -199,7 +225,7 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
     //
     const double catch_frac = 0.95; // Catch 95% of randomly distributed rays incident perpendicularly.
     const double minRaydL = 2.0 * CylinderRadius * std::sqrt(1.0 - catch_frac);
-    if(RaydL > minRaydL){
+    if(!use_exact && (RaydL > minRaydL)){
         throw std::runtime_error("Ray dL is too small. MinRaydL=" + std::to_string(minRaydL) + ". Are you sure this is OK? (edit me if so).");
     } 
 
@@ -234,9 +260,6 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
     }
 
     //Pre-compute the line segments and spheres we will use to define the surface boundary. 
-    //
-    // NOTE: We should be using a spatial indexing data structure, like R*-tree. (Does it support cylinders? Can it be
-    // made to support cylinders?) TODO.
     std::vector<line_segment<double>> cylinders; // Radii are all the same: CylinderRadius.
     std::vector<vec3<double>> spheres; // Centres of the spheres. The radii are the same as the cylinder radii.
 
@@ -263,6 +286,13 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
         }
     }
 
+    //The union of the spheres and cylinders is the union of capsules surrounding each line segment, which can be
+    // intersected analytically.
+    capsule_bvh surface;
+    if(use_exact){
+        surface = Build_Contour_Capsule_BVH(cc_ROIs, CylinderRadius);
+    }
+
     //Trim geometry above some user-specified plane.
     // ... ideal? necessary? cumbersome? ...
 
@@ -384,63 +414,87 @@ Drover ContourBasedRayCastDoseAccumulate(Drover DICOM_data,
     //Now ready to ray cast. Loop over integer pixel coordinates. Start and finish are image pixels.
     // The top image can be the length image.
     const auto sq_radius = std::pow(CylinderRadius, 2.0);
-    for(long int row = 0; row < Rows; ++row){
-        FUNCINFO("Working on row " << (row+1) << " of " << Rows 
-                  << " --> " << static_cast<int>(1000.0*(row+1)/Rows)/10.0 << "% done");
-        for(long int col = 0; col < Columns; ++col){
-            double accumulated_length = 0.0;      //Length of ray travel within the 'surface'.
-            double accumulated_doselength = 0.0;
-
-            vec3<double> ray_pos = SourceImg.position(row, col);
-            const vec3<double> terminus = DetectImg.position(row, col);
-            const vec3<double> ray_dir = (terminus - ray_pos).unit();
-
-            //Go until we get within certain distance or overshoot and the ray wants to backtrack.
-            while(    (ray_dir.Dot( (terminus - ray_pos).unit() ) > 0.8 ) // Ray orientation is still downward-facing.
-                   && (ray_pos.distance(terminus) > std::max(RaydL, grid_margin)) ){ // Still far away from detector.
-
-                ray_pos += ray_dir * RaydL;
-                const auto midpoint = ray_pos - (ray_dir * RaydL * 0.5);
-
-                //Search to see if ray is in an object.
-                bool skip = false; //Was already found to be in a surface and was counted.
-                for(const auto &asphere : spheres){
-                    if(ray_pos.sq_dist(asphere) < sq_radius){
-                        accumulated_length += RaydL;
-
-                        //Find the dose at the half-way point.
-                        auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
-                        for(const auto &enc_img : encompass_imgs){
-                            const auto pix_val = enc_img->value(midpoint, 0);
-                            accumulated_doselength += RaydL * pix_val;
-                        }
-                        skip = true;
-                        break;
-                    }
-                }
-
-                if(!skip){
-                    for(const auto &acylinder : cylinders){
-                        if(acylinder.Within_Cylindrical_Volume(ray_pos, CylinderRadius)){
-                            accumulated_length += RaydL;
+    {
+        asio_thread_pool tp;
+        std::mutex printer; // Who gets to print to the console and iterate the counter.
+        long int completed = 0;
+
+        for(long int row = 0; row < Rows; ++row){
+            tp.submit_task([&,row]() -> void {
+                for(long int col = 0; col < Columns; ++col){
+                    double accumulated_length = 0.0;      //Length of ray travel within the 'surface'.
+                    double accumulated_doselength = 0.0;
+
+                    if(use_exact){
+                        const vec3<double> ray_start = SourceImg.position(row, col);
+                        const vec3<double> terminus = DetectImg.position(row, col);
+                        const vec3<double> ray_dir = (terminus - ray_start).unit();
+                        const auto intervals = surface.intersect(ray_start, ray_dir, 0.0, ray_start.distance(terminus));
+
+                        accumulated_length = Total_Ray_Interval_Length(intervals);
+                        accumulated_doselength = Integrate_Image_Along_Ray(img_arr_ptr->imagecoll, ray_start, ray_dir,
+                                                                           intervals, 0);
+                    }else{
+                        vec3<double> ray_pos = SourceImg.position(row, col);
+                        const vec3<double> terminus = DetectImg.position(row, col);
+                        const vec3<double> ray_dir = (terminus - ray_pos).unit();
+
+                        //Go until we get within certain distance or overshoot and the ray wants to backtrack.
+                        while(    (ray_dir.Dot( (terminus - ray_pos).unit() ) > 0.8 ) // Ray orientation is still downward-facing.
+                               && (ray_pos.distance(terminus) > std::max(RaydL, grid_margin)) ){ // Still far away from detector.
+
+                            ray_pos += ray_dir * RaydL;
+                            const auto midpoint = ray_pos - (ray_dir * RaydL * 0.5);
+
+                            //Search to see if ray is in an object.
+                            bool skip = false; //Was already found to be in a surface and was counted.
+                            for(const auto &asphere : spheres){
+                                if(ray_pos.sq_dist(asphere) < sq_radius){
+                                    accumulated_length += RaydL;
+
+                                    //Find the dose at the half-way point.
+                                    auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
+                                    for(const auto &enc_img : encompass_imgs){
+                                        const auto pix_val = enc_img->value(midpoint, 0);
+                                        accumulated_doselength += RaydL * pix_val;
+                                    }
+                                    skip = true;
+                                    break;
+                                }
+                            }
 
-                            //Find the dose at the half-way point.
-                            auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
-                            for(const auto &enc_img : encompass_imgs){
-                                const auto pix_val = enc_img->value(midpoint, 0);
-                                accumulated_doselength += RaydL * pix_val;
+                            if(!skip){
+                                for(const auto &acylinder : cylinders){
+                                    if(acylinder.Within_Cylindrical_Volume(ray_pos, CylinderRadius)){
+                                        accumulated_length += RaydL;
+
+                                        //Find the dose at the half-way point.
+                                        auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
+                                        for(const auto &enc_img : encompass_imgs){
+                                            const auto pix_val = enc_img->value(midpoint, 0);
+                                            accumulated_doselength += RaydL * pix_val;
+                                        }
+                                        break;
+                                    }
+                                }
                             }
-                            break;
                         }
                     }
+
+                    //Deposit the dose in the images.
+                    SourceImg.reference(row, col, 0) = static_cast<float>(accumulated_length);
+                    DetectImg.reference(row, col, 0) = static_cast<float>(accumulated_doselength);
                 }
-            }
 
-            //Deposit the dose in the images.
-            SourceImg.reference(row, col, 0) = static_cast<float>(accumulated_length);
-            DetectImg.reference(row, col, 0) = static_cast<float>(accumulated_doselength);
+                {
+                    std::lock_guard<std::mutex> lock(printer);
+                    ++completed;
+                    FUNCINFO("Completed " << completed << " of " << Rows 
+                          << " --> " << static_cast<int>(1000.0*(completed)/Rows)/10.0 << "% done");
+                }
+            });
         }
-    }
+    } // Complete tasks and terminate thread pool.
 
     // Save image maps to file.
     if(!WriteToFITS(SourceImg, LengthMapFileName)){
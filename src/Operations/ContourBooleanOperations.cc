@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>            //Needed for exit() calls.
+#include <exception>
 #include <optional>
 #include <fstream>
 #include <functional>
@@ -10,12 +11,15 @@
 #include <map>
 #include <memory>
 #include <regex>
+#include <mutex>
 #include <stdexcept>
 #include <string>    
+#include <vector>
 
 #include "../Contour_Boolean_Operations.h"
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
+#include "../Thread_Pool.h"
 #include "ContourBooleanOperations.h"
 #include "Explicator.h"       //Needed for Explicator class.
 #include "YgorMath.h"         //Needed for vec3 class.
@@ -53,6 +57,12 @@ OperationDoc OpArgDocContourBooleanOperations(){
     out.notes.emplace_back(
         "Only the common metadata between contours is propagated to the product contours."
     );
+
+    out.notes.emplace_back(
+        "Each plane is processed independently and concurrently. Within each plane, the contours comprising 'A' and"
+        " 'B' are combined using a balanced tree of pairwise unions, so many small contours can be combined"
+        " efficiently."
+    );
         
 
     out.args.emplace_back();
@@ -119,6 +129,29 @@ OperationDoc OpArgDocContourBooleanOperations(){
     out.args.back().expected = true;
     out.args.back().examples = { "A+B", "A-B", "AuB", "AnB", "AxB", "A^B", "union", "xor", "combined", "body_without_spinal_cord" };
 
+    out.args.emplace_back();
+    out.args.back().name = "Kernel";
+    out.args.back().desc = "Controls the arithmetic used for the Boolean operations."
+                           " The 'inexact' kernel uses floating-point arithmetic, which is fast but can fail for"
+                           " degenerate inputs (e.g., contours with coincident or nearly-coincident edges)."
+                           " The 'exact' kernel is robust, but slower.";
+    out.args.back().default_val = "inexact";
+    out.args.back().expected = true;
+    out.args.back().examples = { "inexact", "exact" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
+    out.args.emplace_back();
+    out.args.back().name = "SnapSpacing";
+    out.args.back().desc = "If positive, contour vertices are snapped to an in-plane grid with this spacing (in DICOM"
+                           " units; mm) before the Boolean operation is performed. Snapping merges nearly-coincident"
+                           " vertices and edges, which helps the 'inexact' kernel cope with degenerate inputs."
+                           " Contours that would become degenerate after snapping are used as-is."
+                           " Snapping alters the contours slightly, so it should only be used when small (i.e.,"
+                           " grid-sized) deviations are acceptable.";
+    out.args.back().default_val = "0.0";
+    out.args.back().expected = true;
+    out.args.back().examples = { "0.0", "0.001", "0.01", "0.1" };
+
     return out;
 }
 
@@ -137,6 +170,8 @@ Drover ContourBooleanOperations(const Drover& DICOM_data,
 
     const auto Operation_str = OptArgs.getValueStr("Operation").value();
     const auto OutputROILabel = OptArgs.getValueStr("OutputROILabel").value();
+    const auto KernelStr = OptArgs.getValueStr("Kernel").value();
+    const auto SnapSpacing = std::stod( OptArgs.getValueStr("SnapSpacing").value() );
 
     //-----------------------------------------------------------------------------------------------------------------
     const auto roiregexA = Compile_Regex(ROILabelRegexA);
@@ -164,6 +199,22 @@ Drover ContourBooleanOperations(const Drover& DICOM_data,
         throw std::logic_error("Unanticipated Boolean operation request.");
     }
 
+    const auto regex_inexact = Compile_Regex("^in?e?x?a?c?t?$");
+    const auto regex_exact = Compile_Regex("^ex?a?c?t?$");
+
+    ContourBooleanOpts cb_opts;
+    if(std::regex_match(KernelStr, regex_inexact)){
+        cb_opts.kernel = ContourBooleanKernel::inexact;
+    }else if(std::regex_match(KernelStr, regex_exact)){
+        cb_opts.kernel = ContourBooleanKernel::exact;
+    }else{
+        throw std::invalid_argument("Kernel not understood. Cannot continue.");
+    }
+    if(!std::isfinite(SnapSpacing) || (SnapSpacing < 0.0)){
+        throw std::invalid_argument("Snap spacing must be non-negative. Cannot continue.");
+    }
+    cb_opts.snap_spacing = SnapSpacing;
+
     Explicator X(FilenameLex);
 
 
@@ -226,43 +277,62 @@ Drover ContourBooleanOperations(const Drover& DICOM_data,
         return ( vA.sq_dist(vB) < std::pow(0.01,2.0) );
     };
 
-    // For each plane, pack the shuttles with (only) the relevant contours.
-    contour_collection<double> cc_new;
-    for(const auto &aplane : ucp){
-        std::list<std::reference_wrapper<contour_of_points<double>>> A;
-        std::list<std::reference_wrapper<contour_of_points<double>>> B;
+    // Clean the contours once, up front, so that planes can be processed concurrently without modifying shared
+    // contours.
+    for(auto &cc : cc_A_B){
+        for(auto &cop : cc.get().contours){
+            cop.Remove_Sequential_Duplicate_Points(verts_equal_F);
+            cop.Remove_Needles(verts_equal_F);
+        }
+    }
 
-        for(auto &cc : cc_A){
+    // For each plane, pack the shuttles with (only) the relevant contours.
+    const auto gather_incident_contours = [&](const plane<double> &aplane,
+                                              const std::list<std::reference_wrapper<contour_collection<double>>> &ccs)
+                                              -> std::list<std::reference_wrapper<contour_of_points<double>>> {
+        std::list<std::reference_wrapper<contour_of_points<double>>> out;
+        for(auto &cc : ccs){
             for(auto &cop : cc.get().contours){
                 //Ignore contours that are not 'on' the specified plane.
                 // We give planes a thickness to help determine coincidence.
-                cop.Remove_Sequential_Duplicate_Points(verts_equal_F);
-                cop.Remove_Needles(verts_equal_F);
                 if(cop.points.empty()) continue;
                 const auto dist_to_plane = std::abs(aplane.Get_Signed_Distance_To_Point(cop.points.front()));
                 if(dist_to_plane > est_cont_thickness) continue;
 
                 //Pack the contour into the shuttle.
-                A.emplace_back(std::ref(cop));
+                out.emplace_back(std::ref(cop));
             }
         }
-        for(auto &cc : cc_B){
-            for(auto &cop : cc.get().contours){
-                cop.Remove_Sequential_Duplicate_Points(verts_equal_F);
-                cop.Remove_Needles(verts_equal_F);
-                if(cop.points.empty()) continue;
-                const auto dist_to_plane = std::abs(aplane.Get_Signed_Distance_To_Point(cop.points.front()));
-                if(dist_to_plane > est_cont_thickness) continue;
+        return out;
+    };
 
-                B.emplace_back(std::ref(cop));
-            }
+    // Perform the operation on each plane concurrently. Results are collected per plane so the output contour order
+    // does not depend on scheduling.
+    std::vector<plane<double>> planes(std::begin(ucp), std::end(ucp));
+    std::vector<contour_collection<double>> plane_results(planes.size());
+    std::mutex eptr_mutex;
+    std::exception_ptr eptr;
+    {
+        asio_thread_pool tp;
+        for(size_t i = 0; i < planes.size(); ++i){
+            tp.submit_task([&,i]() -> void {
+                try{
+                    const auto &aplane = planes[i];
+                    const auto A = gather_incident_contours(aplane, cc_A);
+                    const auto B = gather_incident_contours(aplane, cc_B);
+                    plane_results[i] = ContourBoolean(aplane, A, B, op, ContourBooleanMethod::join, cb_opts);
+                }catch(const std::exception &){
+                    std::lock_guard<std::mutex> lock(eptr_mutex);
+                    if(!eptr) eptr = std::current_exception();
+                }
+            });
         }
+    } // Wait for all planes to be processed.
+    if(eptr) std::rethrow_exception(eptr);
 
-        //Perform the operation.
-        //FUNCINFO("About to perform boolean operation. A and B have " << A.size() << " and " << B.size() << " elements, respectively");
-        auto cc = ContourBoolean(aplane, A, B, op);
-
-        //Insert any contours created into a holding contour_collection.
+    //Insert any contours created into a holding contour_collection.
+    contour_collection<double> cc_new;
+    for(auto &cc : plane_results){
         cc_new.contours.splice(cc_new.contours.end(), std::move(cc.contours));
     }
 
@@ -32,6 +32,7 @@
 OperationDoc OpArgDocContourSimilarity(){
     OperationDoc out;
     out.name = "ContourSimilarity";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation estimates the similarity or overlap between two sets of contours."
         " The comparison is based on point samples. It is useful for comparing contouring styles."
@@ -30,6 +30,7 @@
 OperationDoc OpArgDocConvertContoursToMeshes(){
     OperationDoc out;
     out.name = "ConvertContoursToMeshes";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This routine creates a mesh directly from contours, finding a correspondence between adjacent contours"
@@ -33,6 +33,7 @@
     #error "Attempted to compile without CGAL support, which is required."
 #endif
 
+#include "../Mesh_IO.h"
 #include "../Surface_Meshes.h"
 
 
@@ -299,7 +300,8 @@ Drover ConvertImageToMeshes(Drover DICOM_data,
                 throw std::runtime_error("Unable to emit mesh OFF format. Cannot continue.");
             }
             DICOM_data.smesh_data.emplace_back( std::make_unique<Surface_Mesh>() );
-            if(!ReadFVSMeshFromOFF( DICOM_data.smesh_data.back()->meshes, ss )){
+            if( !Parse_OFF_Mesh( DICOM_data.smesh_data.back()->meshes, ss.str() )
+            &&  !ReadFVSMeshFromOFF( DICOM_data.smesh_data.back()->meshes, ss ) ){
                 throw std::runtime_error("Unable to parse mesh OFF format. Cannot continue.");
             }
 
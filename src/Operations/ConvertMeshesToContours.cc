@@ -2,6 +2,7 @@
 
 #include <asio.hpp>
 #include <algorithm>
+#include <functional>
 #include <optional>
 #include <fstream>
 #include <iterator>
@@ -53,7 +54,12 @@ OperationDoc OpArgDocConvertMeshesToContours(){
         "Images and meshes are unaltered. Existing contours are ignored and unaltered."
     );
     out.notes.emplace_back(
-        "Contour orientation is (likely) not guaranteed to be consistent in this routine."
+        "Contours are oriented using the mesh face normals, so outer boundaries are counter-clockwise and holes are"
+        " clockwise (viewed along the image plane normal) if the mesh is consistently oriented."
+    );
+    out.notes.emplace_back(
+        "All image planes are sliced at once. Mesh faces are indexed by their extent along the plane normal so each"
+        " plane only visits the faces that straddle it, and planes are sliced in parallel."
     );
         
 
@@ -134,29 +140,36 @@ Drover ConvertMeshesToContours(Drover DICOM_data,
         //       Proceeding with a manifold mesh can cause lots of issues later.
         //dcma_surface_meshes::Polyhedron surface_mesh = dcma_surface_meshes::FVSMeshToPolyhedron((*smp_it)->meshes);
 
+        // Slice the mesh along all image planes at once.
+        std::vector<std::reference_wrapper<const planar_image<float,double>>> imgs;
+        std::vector<plane<double>> img_planes;
         for(auto & iap_it : IAs){
             for(const auto &animg : (*iap_it)->imagecoll.images){
-                // Slice the mesh along the image plane.
-                auto lcc = polyhedron_processing::Slice_Polyhedron( surface_mesh, 
-                                                                    {{ animg.image_plane() }} );
-
-                N_new_contours += lcc.contours.size();
-
-                // Tag the contours with metadata.
-                for(auto &cop : lcc.contours){
-                    cop.closed = true;
-                    cop.metadata["ROIName"] = ROILabel;
-                    cop.metadata["NormalizedROIName"] = NormalizedROILabel;
-                    cop.metadata["Description"] = "Sliced surface mesh";
-                    cop.metadata["MinimumSeparation"] = std::to_string(MinimumSeparation);
-                    for(const auto &key : { "StudyInstanceUID", "FrameOfReferenceUID" }){
-                        if(animg.metadata.count(key) != 0) cop.metadata[key] = animg.metadata.at(key);
-                    }
+                imgs.emplace_back( std::cref(animg) );
+                img_planes.emplace_back( animg.image_plane() );
+            }
+        }
+        auto lccs = polyhedron_processing::Slice_Polyhedron_Planes( surface_mesh, img_planes );
+
+        for(size_t i = 0; i < lccs.size(); ++i){
+            const auto &animg = imgs.at(i).get();
+            auto &lcc = lccs[i];
+            N_new_contours += lcc.contours.size();
+
+            // Tag the contours with metadata.
+            for(auto &cop : lcc.contours){
+                cop.closed = true;
+                cop.metadata["ROIName"] = ROILabel;
+                cop.metadata["NormalizedROIName"] = NormalizedROILabel;
+                cop.metadata["Description"] = "Sliced surface mesh";
+                cop.metadata["MinimumSeparation"] = std::to_string(MinimumSeparation);
+                for(const auto &key : { "StudyInstanceUID", "FrameOfReferenceUID" }){
+                    if(animg.metadata.count(key) != 0) cop.metadata[key] = animg.metadata.at(key);
                 }
-
-                DICOM_data.contour_data->ccs.back().contours.splice(DICOM_data.contour_data->ccs.back().contours.end(),
-                                                                    lcc.contours);
             }
+
+            DICOM_data.contour_data->ccs.back().contours.splice(DICOM_data.contour_data->ccs.back().contours.end(),
+                                                                lcc.contours);
         }
 
         ++completed;
@@ -1,6 +1,9 @@
 //ConvolveImages.cc - A part of DICOMautomaton 2019. Written by hal clark.
 
+#include <algorithm>
 #include <any>
+#include <array>
+#include <cmath>
 #include <optional>
 #include <functional>
 #include <iterator>
@@ -11,9 +14,12 @@
 #include <stdexcept>
 #include <numeric>        //Needed for std::inner_product().
 #include <string>    
+#include <vector>
 
 #include "../Structs.h"
+#include "../FFT_Correlation.h"
 #include "../Regex_Selectors.h"
+#include "../Thread_Pool.h"
 #include "../YgorImages_Functors/ConvenienceRoutines.h"
 #include "../YgorImages_Functors/Grouping/Misc_Functors.h"
 #include "../YgorImages_Functors/Compute/Volumetric_Neighbourhood_Sampler.h"
@@ -111,9 +117,103 @@ OperationDoc OpArgDocConvolveImages(){
                                  "pattern-match" };
     out.args.back().samples = OpArgSamples::Exhaustive;
 
+
+    out.args.emplace_back();
+    out.args.back().name = "Method";
+    out.args.back().desc = "Controls how the kernel is applied."
+                           " The 'direct' method samples the kernel neighbourhood of every voxel within the ROI(s)."
+                           " The 'fft' method transforms the whole image array in blocks using fast Fourier transforms"
+                           " (overlap-save), which is much faster for large kernels, and then updates the voxels within"
+                           " the ROI(s). The 'fft' method requires a single channel to be selected, a kernel without"
+                           " non-finite voxels, and images that share a common row and column count."
+                           " Both methods assign NaN to voxels where the kernel would extend beyond the image array."
+                           " The 'fft' method also assigns NaN where the kernel would overlap a non-finite voxel."
+                           " Otherwise results differ only by floating-point round-off."
+                           " The 'auto' method selects the 'fft' method when it is applicable and estimated to be faster.";
+    out.args.back().default_val = "auto";
+    out.args.back().expected = true;
+    out.args.back().examples = { "auto",
+                                 "direct",
+                                 "fft" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
     return out;
 }
 
+
+// Applies the kernel to the whole image array using FFT-based blocking and then updates the voxels within the ROIs.
+//
+// The images are gathered into a contiguous volume ordered by image adjacency, which mirrors the way the volumetric
+// neighbourhood sampler addresses adjacent images.
+static void Apply_Kernel_Via_FFT_To_Images( planar_image_collection<float,double> &imagecoll,
+                                            std::list<std::reference_wrapper<contour_collection<double>>> cc_ROIs,
+                                            const vec3<double> &orientation_normal,
+                                            const std::vector<double> &kernel,
+                                            const volume_dims &k_dims,
+                                            const volume_dims &offset,
+                                            volume_kernel_reduction reduction,
+                                            long int channel,
+                                            const std::string &description ){
+
+    planar_image_adjacency<float,double> img_adj( {}, { { std::ref(imagecoll) } }, orientation_normal );
+    if(img_adj.int_to_img.empty()){
+        throw std::invalid_argument("Image array contained no images. Cannot continue.");
+    }
+    const long int N_imgs = static_cast<long int>(img_adj.int_to_img.size());
+    const long int rows = img_adj.index_to_image(0).get().rows;
+    const long int columns = img_adj.index_to_image(0).get().columns;
+    const volume_dims vol_dims = {{ rows, columns, N_imgs }};
+
+    std::vector<double> vol;
+    vol.reserve(static_cast<size_t>(rows * columns * N_imgs));
+    for(long int i = 0; i < N_imgs; ++i){
+        const auto &img = img_adj.index_to_image(i).get();
+        if( (img.rows != rows) || (img.columns != columns) ){
+            throw std::invalid_argument("Images do not share a common row and column count. Cannot continue.");
+        }
+        if( (img.channels <= channel) || (channel < 0) ){
+            throw std::invalid_argument("A single, valid channel must be selected. Cannot continue.");
+        }
+        for(long int r = 0; r < rows; ++r){
+            for(long int c = 0; c < columns; ++c){
+                vol.push_back( static_cast<double>(img.value(r, c, channel)) );
+            }
+        }
+    }
+
+    const auto res = Apply_Kernel_Via_FFT(vol, vol_dims, kernel, k_dims, offset, reduction);
+
+    Mutate_Voxels_Opts mv_opts;
+    mv_opts.editstyle      = Mutate_Voxels_Opts::EditStyle::InPlace;
+    mv_opts.inclusivity    = Mutate_Voxels_Opts::Inclusivity::Centre;
+    mv_opts.contouroverlap = Mutate_Voxels_Opts::ContourOverlap::Ignore;
+    mv_opts.aggregate      = Mutate_Voxels_Opts::Aggregate::First;
+    mv_opts.adjacency      = Mutate_Voxels_Opts::Adjacency::SingleVoxel;
+    mv_opts.maskmod        = Mutate_Voxels_Opts::MaskMod::Noop;
+
+    asio_thread_pool tp;
+    for(long int i = 0; i < N_imgs; ++i){
+        auto img_refw = img_adj.index_to_image(i);
+        tp.submit_task([&,i,img_refw]() -> void {
+            auto f_bounded = [&,i](long int E_row, long int E_col, long int E_chnl,
+                                   std::reference_wrapper<planar_image<float,double>>, float &voxel_val) {
+                if(E_chnl != channel) return;
+                voxel_val = static_cast<float>( res[(i * rows + E_row) * columns + E_col] );
+                return;
+            };
+            Mutate_Voxels<float,double>( img_refw,
+                                         { img_refw },
+                                         cc_ROIs,
+                                         mv_opts,
+                                         f_bounded );
+
+            UpdateImageDescription( img_refw, description );
+            UpdateImageWindowCentreWidth( img_refw );
+        });
+    }
+    return;
+}
+
 Drover ConvolveImages(Drover DICOM_data,
                       const OperationArgPkg& OptArgs,
                       const std::map<std::string, std::string>&
@@ -129,6 +229,7 @@ Drover ConvolveImages(Drover DICOM_data,
 
     const auto Channel = std::stol( OptArgs.getValueStr("Channel").value() );
     const auto OperationStr = OptArgs.getValueStr("Operation").value();
+    const auto MethodStr = OptArgs.getValueStr("Method").value();
 
     //-----------------------------------------------------------------------------------------------------------------
     const auto regex_conv = Compile_Regex("^conv?o?l?u?t?i?o?n?$");
@@ -138,6 +239,17 @@ Drover ConvolveImages(Drover DICOM_data,
     const bool op_is_conv = std::regex_match(OperationStr, regex_conv);
     const bool op_is_corr = std::regex_match(OperationStr, regex_corr);
     const bool op_is_mtch = std::regex_match(OperationStr, regex_mtch);
+
+    const auto regex_auto = Compile_Regex("^au?t?o?$");
+    const auto regex_drct = Compile_Regex("^di?r?e?c?t?$");
+    const auto regex_fft  = Compile_Regex("^ff?t?$");
+
+    const bool method_is_auto = std::regex_match(MethodStr, regex_auto);
+    const bool method_is_drct = std::regex_match(MethodStr, regex_drct);
+    const bool method_is_fft  = std::regex_match(MethodStr, regex_fft);
+    if(!method_is_auto && !method_is_drct && !method_is_fft){
+        throw std::invalid_argument("Method not understood. Cannot continue.");
+    }
     //-----------------------------------------------------------------------------------------------------------------
 
     // Identify the contours to use.
@@ -220,6 +332,58 @@ Drover ConvolveImages(Drover DICOM_data,
                 }
             }
             
+            // Decide how to apply the kernel.
+            const volume_dims k_dims = {{ k_rows, k_columns, k_imgs }};
+            bool use_fft = method_is_fft;
+            if(method_is_auto){
+                // The FFT method requires a single volume, so images of differing sizes are handled directly.
+                const auto &imgs = (*iap_it)->imagecoll.images;
+                const bool kernel_is_finite = std::all_of( std::begin(k_values), std::end(k_values),
+                                                           [](float k){ return std::isfinite(k); } );
+                const bool images_are_uniform = std::all_of( std::begin(imgs), std::end(imgs),
+                    [&](const planar_image<float,double> &img){
+                        return (img.rows == imgs.front().rows)
+                            && (img.columns == imgs.front().columns)
+                            && (Channel < img.channels);
+                    } );
+                use_fft = (0 <= Channel)
+                       && kernel_is_finite
+                       && !imgs.empty()
+                       && images_are_uniform
+                       && FFT_Is_Preferable( {{ imgs.front().rows,
+                                                imgs.front().columns,
+                                                static_cast<long int>(imgs.size()) }}, k_dims );
+            }
+            if(use_fft){
+                // The kernel is stored contiguously with columns varying fastest, then rows, then images.
+                std::vector<double> kernel(k_values.size());
+                for(long int r = 0; r < k_rows; ++r){
+                    for(long int c = 0; c < k_columns; ++c){
+                        for(long int i = 0; i < k_imgs; ++i){
+                            const auto val = k_values[(r * k_columns + c) * k_imgs + i];
+                            if(op_is_conv){
+                                // Spatially flip the kernel.
+                                kernel[((k_imgs - 1 - i) * k_rows + (k_rows - 1 - r)) * k_columns + (k_columns - 1 - c)] = val;
+                            }else{
+                                kernel[(i * k_rows + r) * k_columns + c] = val;
+                            }
+                        }
+                    }
+                }
+                const volume_dims offset = op_is_conv ? volume_dims{{ k_rows - 1 - d_r, k_columns - 1 - d_c, k_imgs - 1 - d_i }}
+                                                      : volume_dims{{ d_r, d_c, d_i }};
+                if(!op_is_conv && !op_is_corr && !op_is_mtch){
+                    throw std::logic_error("Requested operation is not understood. Cannot continue.");
+                }
+                const auto reduction = op_is_mtch ? volume_kernel_reduction::euclidean_distance
+                                                  : volume_kernel_reduction::inner_product;
+
+                FUNCINFO("Applying kernel comprising " << k_values.size() << " voxels via FFT");
+                Apply_Kernel_Via_FFT_To_Images( (*iap_it)->imagecoll, cc_ROIs, orientation_normal,
+                                                kernel, k_dims, offset, reduction, Channel, ud.description );
+                continue;
+            }
+
             // Perform any necessary post-processing.
             if(op_is_conv){
                 // Spatially flip the kernel. This can be accomplished by negating since the kernel is (approximately)
@@ -19,6 +19,7 @@
 OperationDoc OpArgDocDICOMExportContours(){
     OperationDoc out;
     out.name = "DICOMExportContours";
+    out.has_external_side_effects = true;
     out.desc = "This operation exports the selected contours to a DICOM RTSTRUCT-modality file.";
 
     out.notes.emplace_back(
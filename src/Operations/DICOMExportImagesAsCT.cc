@@ -26,6 +26,7 @@
 OperationDoc OpArgDocDICOMExportImagesAsCT(){
     OperationDoc out;
     out.name = "DICOMExportImagesAsCT";
+    out.has_external_side_effects = true;
     out.desc = "This operation exports the selected Image_Array(s) to DICOM CT-modality files.";
 
     out.notes.emplace_back(
@@ -19,6 +19,7 @@
 OperationDoc OpArgDocDICOMExportImagesAsDose(){
     OperationDoc out;
     out.name = "DICOMExportImagesAsDose";
+    out.has_external_side_effects = true;
     out.desc = "This operation exports the selected Image_Array to a DICOM dose file.";
 
     out.notes.emplace_back(
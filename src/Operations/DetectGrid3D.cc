@@ -1,6 +1,9 @@
 //DetectGrid3D.cc - A part of DICOMautomaton 2019. Written by hal clark.
 
 #include <any>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <optional>
 #include <functional>
 #include <iterator>
@@ -13,6 +16,8 @@
 #include <stdexcept>
 #include <string>    
 #include <algorithm>    
+#include <unordered_map>
+#include <vector>
 
 /*
 #include <boost/geometry.hpp>
@@ -43,6 +48,7 @@
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
 #include "../Insert_Contours.h"
+#include "../Thread_Pool.h"
 #include "../Write_File.h"
 #include "../YgorImages_Functors/ConvenienceRoutines.h"
 #include "../YgorImages_Functors/Grouping/Misc_Functors.h"
@@ -86,9 +92,10 @@ struct ICP_Context {
     // Point cloud points participating in a single RANSAC phase.
     //
     // This list is regenerated for each round of RANSAC. Only some point cloud points within a fixed distance from
-    // some randomly-selected point will be retained. The points are not altered, just copied for ease-of-use.
+    // some randomly-selected point will be retained. The points are never altered, so the whole point cloud can be
+    // shared between concurrent rounds rather than copied.
     using pcp_c_t = decltype(Point_Cloud().pset.points); // Point_Cloud point container type.
-    pcp_c_t cohort;
+    std::shared_ptr<const pcp_c_t> cohort;
 
     // Cohort points projected into a single volumetric proto cell.
     pcp_c_t p_cell;
@@ -338,7 +345,7 @@ Project_Into_Proto_Cube( Grid_Context &GC,
                         ICP_Context &ICPC ){
     // Using the current grid axes directions and anchor point, project all points into the proto cell.
     auto p_cell_it = std::begin(ICPC.p_cell);
-    for(const auto &P : ICPC.cohort){
+    for(const auto &P : *(ICPC.cohort)){
 
         // Vector rel. to grid anchor.
         const auto R = (P - GC.current_grid_anchor);
@@ -413,7 +420,7 @@ Translate_Grid_Optimally( Grid_Context &GC,
     dist_z.reserve(ICPC.p_cell.size());
     {
         auto p_cell_it = std::begin(ICPC.p_cell);
-        for(const auto &pp : ICPC.cohort){
+        for(const auto &pp : *(ICPC.cohort)){
             const auto C = (*p_cell_it) - GC.current_grid_anchor;
 
             const auto proj_x = GC.current_grid_x.Dot(C);
@@ -453,7 +460,7 @@ Find_Corresponding_Points( Grid_Context &GC,
     // Note: There is likely a faster way to do the following using the same approach as the optimal translation routine.
     // This way is easy to debug and reason about.
 
-    if(ICPC.p_corr.size() != ICPC.cohort.size() ){
+    if(ICPC.p_corr.size() != ICPC.cohort->size() ){
         throw std::logic_error("Insufficient working space allocated. Cannot continue.");
     }
 
@@ -588,7 +595,7 @@ Rotate_Grid_Optimally( Grid_Context &GC,
     Eigen::MatrixXf A(N_rows, N_cols);
     Eigen::MatrixXf B(N_rows, N_cols);
 
-    auto o_it = std::begin(ICPC.cohort);
+    auto o_it = std::begin(*(ICPC.cohort));
     auto c_it = std::begin(ICPC.p_corr);
     auto p_it = std::begin(ICPC.p_cell);
     size_t col = 0;
@@ -776,8 +783,8 @@ return;
         Write_PLY(filename_base + "ransac_point.ply", points);
     }
 
-    Write_XYZ(filename_base + "original_points.xyz", ICPC.cohort);
-    Write_PLY(filename_base + "original_points.ply", ICPC.cohort);
+    Write_XYZ(filename_base + "original_points.xyz", *(ICPC.cohort));
+    Write_PLY(filename_base + "original_points.ply", *(ICPC.cohort));
 
     Write_XYZ(filename_base + "cube_proj_points.xyz", ICPC.p_cell);
     Write_PLY(filename_base + "cube_proj_points.ply", ICPC.p_cell);
@@ -800,8 +807,8 @@ return;
     {
         // Determine where the average original point is.
         vec3<double> avg(0.0, 0.0, 0.0);
-        for(const auto &vp : ICPC.cohort) avg += vp;
-        avg *= (1.0 / (1.0 * ICPC.cohort.size()));
+        for(const auto &vp : *(ICPC.cohort)) avg += vp;
+        avg *= (1.0 / (1.0 * ICPC.cohort->size()));
 
         const auto proto_mid = GC.current_grid_anchor
                              + GC.current_grid_x * GC.grid_sep * 0.5
@@ -868,7 +875,7 @@ return;
         lines.emplace_back( c_H, c_E );
 
 
-        for(const auto &P : ICPC.cohort){
+        for(const auto &P : *(ICPC.cohort)){
 
             double closest_dist = std::numeric_limits<double>::quiet_NaN();
             vec3<double> closest_proj = NaN_vec3;
@@ -920,7 +927,7 @@ ICP_Fit_Grid( std::mt19937 re,
 
     Grid_Context best_GC = GC;
 
-static int icp_invoke = 0;
+static std::atomic<int> icp_invoke(0);
 
     for(long int loop = 1; loop <= icp_max_loops; ++loop){
 //        std::cout << "====================================== " << "Loop: " << loop << std::endl;
@@ -930,9 +937,9 @@ static int icp_invoke = 0;
         // Note: This *might* be wasteful, but it will also help protect against picking an irrelevant point and being
         // stuck with it for the entire ICP procedure. TODO: try commenting out this code to always use the ransac point
         // as the rotation centre.
-        std::uniform_int_distribution<long int> rd(0, ICPC.cohort.size());
+        std::uniform_int_distribution<long int> rd(0, static_cast<long int>(ICPC.cohort->size()) - 1);
         const auto N_select = rd(re);
-        ICPC.rot_centre = (*std::next( std::begin(ICPC.cohort), N_select ));
+        ICPC.rot_centre = (*std::next( std::begin(*(ICPC.cohort)), N_select ));
 
 Write_Everything("/tmp/ransac"_s + std::to_string(icp_invoke) + "_icp" + std::to_string(loop) + "_01loopbegins_", GC, ICPC);
         Project_Into_Proto_Cube(GC, ICPC);
@@ -968,9 +975,146 @@ Write_Everything("/tmp/ransac"_s + std::to_string(icp_invoke) + "_icp" + std::to
     return;
 }
 
+// Spatial index for fixed-radius neighbourhood queries over point cloud points.
+//
+// Points are bucketed into cubic cells with sides equal to the query radius, so only the 27 cells surrounding the
+// query point need to be examined. The cost of a query is proportional to the number of nearby points rather than
+// the size of the point cloud.
+struct Point_Bucket_Index {
+    using cell_t = std::array<int64_t, 3>;
+
+    struct cell_hash {
+        size_t operator()(const cell_t &c) const {
+            size_t h = std::hash<int64_t>()(c[0]);
+            h ^= std::hash<int64_t>()(c[1]) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<int64_t>()(c[2]) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    double cell_size;
+    std::unordered_map<cell_t, std::vector<size_t>, cell_hash> cells;
+
+    Point_Bucket_Index(const std::vector<vec3<double>> &points, double radius) : cell_size(radius) {
+        if(!std::isfinite(this->cell_size) || (this->cell_size <= 0.0)){
+            throw std::invalid_argument("Spatial index cell size is not valid. Cannot continue.");
+        }
+        for(size_t i = 0; i < points.size(); ++i){
+            this->cells[ this->cell_for(points[i]) ].push_back(i);
+        }
+    }
+
+    cell_t cell_for(const vec3<double> &p) const {
+        return {{ static_cast<int64_t>(std::floor(p.x / this->cell_size)),
+                  static_cast<int64_t>(std::floor(p.y / this->cell_size)),
+                  static_cast<int64_t>(std::floor(p.z / this->cell_size)) }};
+    }
+
+    // Returns the points within the given distance of the centre, in their original order. The distance should not
+    // exceed the cell size.
+    std::vector<vec3<double>> neighbours(const std::vector<vec3<double>> &points,
+                                         const vec3<double> &centre,
+                                         double dist) const {
+        std::vector<size_t> indices;
+        const auto c = this->cell_for(centre);
+        for(int64_t dx = -1; dx <= 1; ++dx){
+            for(int64_t dy = -1; dy <= 1; ++dy){
+                for(int64_t dz = -1; dz <= 1; ++dz){
+                    const auto it = this->cells.find({{ c[0] + dx, c[1] + dy, c[2] + dz }});
+                    if(it == std::end(this->cells)) continue;
+                    for(const auto &i : it->second){
+                        if(points[i].distance(centre) <= dist) indices.push_back(i);
+                    }
+                }
+            }
+        }
+        std::sort(std::begin(indices), std::end(indices));
+
+        std::vector<vec3<double>> out;
+        out.reserve(indices.size());
+        for(const auto &i : indices) out.push_back(points[i]);
+        return out;
+    }
+};
+
+// The outcome of a single, independent round of RANSAC.
+struct RANSAC_Round_Result {
+    bool success = false;
+    std::string failure_reason;
+    Grid_Context GC;
+};
+
+// Performs a single round of RANSAC: the grid is coarsely fitted to the vicinity of a randomly selected point and then
+// refined using the whole point cloud. Rounds only depend on the provided seed, so they can be evaluated in any order
+// or concurrently. The point cloud is shared between rounds; only per-round working space is allocated.
+static
+RANSAC_Round_Result
+Perform_RANSAC_Round( const std::shared_ptr<const ICP_Context::pcp_c_t> &points,
+                      const Point_Bucket_Index &index,
+                      const Grid_Context &initial_GC,
+                      double ransac_dist,
+                      long int coarse_icp_max_loops,
+                      long int fine_icp_max_loops,
+                      uint64_t seed ){
+    RANSAC_Round_Result out;
+    out.GC = initial_GC;
+    std::mt19937 re( seed );
+
+    // Randomly select a point from the cloud.
+    ICP_Context ICPC;
+    std::uniform_int_distribution<long int> rd(0, static_cast<long int>(points->size()) - 1);
+    ICPC.ransac_centre = points->at( rd(re) );
+
+    // Retain only the points within a small distance of the RANSAC centre.
+    ICPC.cohort = std::make_shared<const ICP_Context::pcp_c_t>(
+                      index.neighbours(*points, ICPC.ransac_centre, ransac_dist) );
+    if(ICPC.cohort->size() < 3){
+        // If there are too few points to meaningfully continue, then the only thing we can assume is that the
+        // selected point is in a region with a low density of points. However, if multiple failures occur then we can
+        // probably conclude that the grid parameters are inappropriate. For example, if the GridSeparation is too
+        // small then all points will appear to be in regions of low density.
+        out.failure_reason = "Too few adjacent points ("_s + std::to_string(ICPC.cohort->size()) + ")";
+        return out;
+    }
+
+    // Allocate storage for ICP loops.
+    ICPC.p_cell.resize(ICPC.cohort->size());
+    ICPC.p_corr.resize(ICPC.cohort->size());
+
+    // Perform ICP on the sub-set cohort.
+    try{
+        ICP_Fit_Grid(re, coarse_icp_max_loops, out.GC, ICPC);
+    }catch(const std::exception &e){
+        out.failure_reason = "Error encountered during coarse ICP ("_s + e.what() + ")";
+        return out;
+    }
+
+    // Invalidate the coarse fit score since it is not applicable to the whole point cloud.
+    out.GC.score = std::numeric_limits<double>::quiet_NaN();
+
+    // Using the subset cohort fit, perform an ICP using the whole point cloud.
+    ICP_Context whole_ICPC;
+    whole_ICPC.cohort = points;
+    whole_ICPC.p_cell.resize(points->size());
+    whole_ICPC.p_corr.resize(points->size());
+    whole_ICPC.ransac_centre = ICPC.ransac_centre;
+    try{
+        ICP_Fit_Grid(re, fine_icp_max_loops, out.GC, whole_ICPC);
+    }catch(const std::exception &e){
+        out.failure_reason = "Error encountered during fine ICP ("_s + e.what() + ")";
+        return out;
+    }
+
+    // Evaluate over the entire point cloud.
+    out.GC.score = Score_Fit(whole_ICPC);
+    out.success = true;
+    return out;
+}
+
 OperationDoc OpArgDocDetectGrid3D(){
     OperationDoc out;
     out.name = "DetectGrid3D";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This routine fits a 3D grid to a point cloud using a Procrustes analysis with "
@@ -1095,7 +1239,9 @@ OperationDoc OpArgDocDetectGrid3D(){
 
     out.args.emplace_back();
     out.args.back().name = "RandomSeed";
-    out.args.back().desc = "A whole number seed value to use for random number generation.";
+    out.args.back().desc = "A whole number seed value to use for random number generation."
+                           " RANSAC rounds are evaluated concurrently, but each round draws from its own seeded"
+                           " random number stream, so results are reproducible for a given seed.";
     out.args.back().default_val = "1317";
     out.args.back().expected = true;
     out.args.back().examples = { "1", 
@@ -1242,12 +1388,10 @@ if(false){
         GC.grid_sep = GridSeparation;
         GC.grid_sampling = GridSampling;
 
-        ICP_Context ICPC; // Working ICP context.
-
         ICP_Context whole_ICPC; // Whole (i.e., entire point cloud) context.
-        whole_ICPC.cohort = (*pcp_it)->pset.points;
-        whole_ICPC.p_cell = whole_ICPC.cohort; // Prime the container with dummy info.
-        whole_ICPC.p_corr = whole_ICPC.cohort; // Prime the container with dummy info.
+        whole_ICPC.cohort = std::shared_ptr<const ICP_Context::pcp_c_t>( *pcp_it, &((*pcp_it)->pset.points) );
+        whole_ICPC.p_cell.resize(whole_ICPC.cohort->size());
+        whole_ICPC.p_corr.resize(whole_ICPC.cohort->size());
         //whole_ICPC.p_corr.resize(whole_ICPC.cohort.size());
         //whole_ICPC.rot_centre = whole_ICPC.ransac_centre;
 
@@ -1272,82 +1416,48 @@ if(false){
         };
 
         // Perform a RANSAC analysis by only analyzing the vicinity of a randomly selected point.
+        //
+        // Rounds are independent, so they are evaluated concurrently. Each round is seeded from a single sequence of
+        // seeds and results are reduced in round order, so the outcome depends only on RandomSeed and not on thread
+        // scheduling. Failed rounds are replaced by additional rounds until enough rounds have succeeded.
+        const Point_Bucket_Index index( (*pcp_it)->pset.points, RANSACDist );
         long int ransac_loop = 0;
-        std::mutex saver_printer;
+        long int ransac_round = 0;
         while(ransac_loop < RANSACMaxLoops){
-            // Randomly select a point from the cloud.
-            std::uniform_int_distribution<long int> rd(0, (*pcp_it)->pset.points.size());
-            const auto N = rd(re);
-            ICPC.ransac_centre = (* std::next( std::begin((*pcp_it)->pset.points), N ));
-
-            // Retain only the points within a small distance of the RANSAC centre.
-            using pcp_t = decltype((*pcp_it)->pset.points.front());
-            ICPC.cohort = (*pcp_it)->pset.points;
-            ICPC.cohort.erase(
-                std::remove_if(std::begin(ICPC.cohort), 
-                               std::end(ICPC.cohort),
-                               [&](pcp_t &pcp) -> bool {
-                                   return (pcp.distance(ICPC.ransac_centre) > RANSACDist);
-                               }),
-                std::end(ICPC.cohort) );
-
-            if(ICPC.cohort.size() < 3){
-                // If there are too few points to meaningfully continue, then the only thing we can assume is that the
-                // selected point is in a region with a low density of points. So re-do the loop. However, if multiple
-                // failures occur then we can probably conclude that the grid parameters are inappropriate. For example,
-                // if the GridSeparation is too small then all points will appear to be in regions of low density.
-                FUNCWARN("Too few adjacent points (" << ICPC.cohort.size() << "), rebooting RANSAC loop.");
-                Handle_RANSAC_Failure(); // Will throw if too many failures encountered.
-                continue;
-            }
-
-            // Allocate storage for ICP loops.
-            ICPC.p_cell = ICPC.cohort;
-            ICPC.p_corr = ICPC.cohort;
-            //ICPC.p_corr.resize(ICPC.cohort.size());
-            //ICPC.rot_centre = ICPC.ransac_centre;
-
-            // Perform ICP on the sub-set cohort.
-            try{
-                ICP_Fit_Grid(re, CoarseICPMaxLoops, GC, ICPC);
-            }catch(const std::exception &e){
-                FUNCWARN("Error encountered during coarse ICP (" << e.what() << "), rebooting RANSAC loop.");
-                Handle_RANSAC_Failure(); // Will throw if too many failures encountered.
-                continue;
-            }
-
-            // Invalidate the coarse fit score since it is not applicable to the whole point cloud.
-            GC.score = std::numeric_limits<double>::quiet_NaN();
-
-            // Using the subset cohort fit, perform an ICP using the whole point cloud.
-            //Grid_Context whole_GC = GC; // Needed?
-            //whole_GC.grid_sep = GridSeparation;
-            whole_ICPC.ransac_centre = ICPC.ransac_centre;
-
-            try{
-                ICP_Fit_Grid(re, FineICPMaxLoops, GC, whole_ICPC);
-            }catch(const std::exception &e){
-                FUNCWARN("Error encountered during fine ICP (" << e.what() << "), rebooting RANSAC loop.");
-                Handle_RANSAC_Failure(); // Will throw if too many failures encountered.
-                continue;
-            }
-
-            // Evaluate over the entire point cloud, retaining the global best.
-            GC.score = Score_Fit(whole_ICPC);
-            if(!std::isfinite(best_GC.score) || (GC.score < best_GC.score)){
-                best_GC = GC;
-            }
+            const long int N_rounds = RANSACMaxLoops - ransac_loop;
+            std::vector<uint64_t> seeds;
+            seeds.reserve(N_rounds);
+            for(long int i = 0; i < N_rounds; ++i) seeds.push_back( static_cast<uint64_t>(re()) );
 
+            std::vector<RANSAC_Round_Result> results(N_rounds);
             {
-                std::lock_guard<std::mutex> lock(saver_printer);
-                std::stringstream ss;
+                asio_thread_pool tp;
+                for(long int i = 0; i < N_rounds; ++i){
+                    tp.submit_task([&,i]() -> void {
+                        results[i] = Perform_RANSAC_Round( whole_ICPC.cohort, index, GC,
+                                                           RANSACDist, CoarseICPMaxLoops, FineICPMaxLoops,
+                                                           seeds[i] );
+                    });
+                }
+            } // Wait for all rounds to complete.
+
+            // Retain the global best, breaking ties in favour of earlier rounds.
+            for(const auto &res : results){
+                ++ransac_round;
+                if(!res.success){
+                    FUNCWARN(res.failure_reason << " in RANSAC round " << ransac_round << ", rebooting RANSAC loop.");
+                    Handle_RANSAC_Failure(); // Will throw if too many failures encountered.
+                    continue;
+                }
 
-                ss << "Completed RANSAC loop " << ransac_loop << " of " << RANSACMaxLoops
-                   << " --> " << static_cast<int>(1000.0*(ransac_loop)/RANSACMaxLoops)/10.0 << "%."
-                   << " Best and current scores are " << best_GC.score << " and " << GC.score;
-                FUNCINFO(ss.str());
+                if(!std::isfinite(best_GC.score) || (res.GC.score < best_GC.score)){
+                    best_GC = res.GC;
+                }
+                FUNCINFO("Completed RANSAC loop " << ransac_loop << " of " << RANSACMaxLoops
+                         << " --> " << static_cast<int>(1000.0*(ransac_loop)/RANSACMaxLoops)/10.0 << "%."
+                         << " Best and current scores are " << best_GC.score << " and " << res.GC.score);
+                ++ransac_loop;
             }
-            ++ransac_loop;
         } // RANSAC loop.
 
         // Do something with the results.
@@ -1382,7 +1492,7 @@ if(false){
             // Write the grid for inspection.
             Insert_Grid_Contours(DICOM_data,
                            "best_grid",
-                           whole_ICPC.cohort,
+                           *(whole_ICPC.cohort),
                            best_GC.current_grid_anchor,
                            best_GC.current_grid_x * best_GC.grid_sep,
                            best_GC.current_grid_y * best_GC.grid_sep,
@@ -1403,7 +1513,7 @@ if(false){
                 const double proj_eps = 1.0E-4; // The amount of numerical uncertainty in the planar projection.
                 const bool inhibit_sort = true;
 
-                auto o_it = std::begin(whole_ICPC.cohort);
+                auto o_it = std::begin(*(whole_ICPC.cohort));
                 auto c_it = std::begin(whole_ICPC.p_corr);
                 for(const auto &P : whole_ICPC.p_cell){
                     const auto C = (*c_it);
@@ -1487,7 +1597,7 @@ if(false){
                                              std::numeric_limits<double>::quiet_NaN(),
                                              std::numeric_limits<double>::quiet_NaN() );
 
-                auto o_it = std::begin(whole_ICPC.cohort);
+                auto o_it = std::begin(*(whole_ICPC.cohort));
                 auto c_it = std::begin(whole_ICPC.p_corr);
                 for(const auto &P : whole_ICPC.p_cell){
                     const auto C = (*c_it);  // Corresponding point (in the proto cell).
@@ -1615,7 +1725,7 @@ for(const auto &apair : partitioned){
 
         // Imbue the fitted point cloud with metadata for visualization.
         {
-            std::vector<double> displacement(whole_ICPC.cohort.size(), std::numeric_limits<double>::quiet_NaN());
+            std::vector<double> displacement(whole_ICPC.cohort->size(), std::numeric_limits<double>::quiet_NaN());
 
             auto d_it = std::begin(displacement);
             auto c_it = std::begin(whole_ICPC.p_corr);
@@ -31,6 +31,7 @@ static void dump_metadata(std::ostream &os,
 OperationDoc OpArgDocDroverDebug(){
     OperationDoc out;
     out.name = "DroverDebug";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation reports basic information on the state of the main Drover class."
@@ -19,6 +19,7 @@
 OperationDoc OpArgDocDumpAllOrderedImageMetadataToFile(){
     OperationDoc out;
     out.name = "DumpAllOrderedImageMetadataToFile";
+    out.has_external_side_effects = true;
     out.desc = 
         "Dump exactly what order the data will be in for the following analysis.";
 
@@ -17,6 +17,7 @@
 OperationDoc OpArgDocDumpAnEncompassedPoint(){
     OperationDoc out;
     out.name = "DumpAnEncompassedPoint";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation estimates the number of spatially-overlapping images. It finds an arbitrary point within an"
         " arbitrary image, and then finds all other images which encompass the point.";
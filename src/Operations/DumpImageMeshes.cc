@@ -26,6 +26,7 @@
 OperationDoc OpArgDocDumpImageMeshes(){
     OperationDoc out;
     out.name = "DumpImageMeshes";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation exports images as a 3D surface mesh model (structured ASCII Wavefront OBJ)"
@@ -25,6 +25,7 @@
 OperationDoc OpArgDocDumpImageMetadataOccurrencesToFile(){
     OperationDoc out;
     out.name = "DumpImageMetadataOccurrencesToFile";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "Dump all the metadata elements, but group like-items together and also print the occurence number.";
@@ -34,6 +34,7 @@
 OperationDoc OpArgDocDumpPerROIParams_KineticModel_1Compartment2Input_5Param(){
     OperationDoc out;
     out.name = "DumpPerROIParams_KineticModel_1Compartment2Input_5Param";
+    out.has_external_side_effects = true;
     out.desc = "Given a perfusion model, this routine computes parameter estimates for ROIs.";
 
     out.args.emplace_back();
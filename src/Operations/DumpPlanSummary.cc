@@ -38,6 +38,7 @@
 OperationDoc OpArgDocDumpPlanSummary(){
     OperationDoc out;
     out.name = "DumpPlanSummary";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation dumps a summary of a radiotherapy plan. This operation can be used to gain insight into a plan"
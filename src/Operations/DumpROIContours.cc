@@ -24,6 +24,7 @@
 OperationDoc OpArgDocDumpROIContours(){
     OperationDoc out;
     out.name = "DumpROIContours";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation exports contours in a standard surface mesh format (structured ASCII Wavefront OBJ)"
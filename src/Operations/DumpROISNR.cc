@@ -35,6 +35,7 @@
 OperationDoc OpArgDocDumpROISNR(){
     OperationDoc out;
     out.name = "DumpROISNR";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation computes the Signal-to-Noise ratio (SNR) for each ROI. The specific 'SNR' computed is SNR = (mean"
@@ -124,6 +124,7 @@
 OperationDoc OpArgDocDumpROISurfaceMeshes(){
     OperationDoc out;
     out.name = "DumpROISurfaceMeshes";
+    out.has_external_side_effects = true;
 
     out.desc = 
         " This operation generates surface meshes from contour volumes."
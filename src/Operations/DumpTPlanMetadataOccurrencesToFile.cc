@@ -25,6 +25,7 @@
 OperationDoc OpArgDocDumpTPlanMetadataOccurrencesToFile(){
     OperationDoc out;
     out.name = "DumpTPlanMetadataOccurrencesToFile";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "Dump all the metadata elements, but group like-items together and also print the occurence number.";
@@ -1,8 +1,5 @@
 //EvaluateDoseVolumeStats.cc - A part of DICOMautomaton 2017. Written by hal clark.
 
-#include <boost/interprocess/creation_tags.hpp>
-#include <boost/interprocess/sync/named_mutex.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <cmath>
 #include <exception>
 #include <any>
@@ -14,6 +11,7 @@
 #include <map>
 #include <memory>
 #include <regex>
+#include <sstream>
 #include <stdexcept>
 #include <string>    
 #include <utility>            //Needed for std::pair.
@@ -21,6 +19,7 @@
 
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
+#include "../Write_File.h"
 #include "../YgorImages_Functors/Compute/AccumulatePixelDistributions.h"
 #include "EvaluateDoseVolumeStats.h"
 #include "Explicator.h"       //Needed for Explicator class.
@@ -256,38 +255,23 @@ Drover EvaluateDoseVolumeStats(Drover DICOM_data,
 
 
     //Report the findings. 
-    FUNCINFO("Attempting to claim a mutex");
     try{
-        //File-based locking is used so this program can be run over many patients concurrently.
-        //
-        //Try open a named mutex. Probably created in /dev/shm/ if you need to clear it manually...
-        boost::interprocess::named_mutex mutex(boost::interprocess::open_or_create,
-                                               "dicomautomaton_operation_evaluatendvstats_mutex");
-        boost::interprocess::scoped_lock<boost::interprocess::named_mutex> lock(mutex);
-
-        if(OutFilename.empty()){
-            OutFilename = Get_Unique_Sequential_Filename("/tmp/dicomautomaton_evaluatendvstats_", 6, ".csv");
-        }
-        const auto FirstWrite = !Does_File_Exist_And_Can_Be_Read(OutFilename);
-        std::fstream FO_tcp(OutFilename, std::fstream::out | std::fstream::app);
-        if(!FO_tcp){
-            throw std::runtime_error("Unable to open file for reporting derivative data. Cannot continue.");
-        }
-        if(FirstWrite){ // Write a CSV header.
-            FO_tcp << "UserComment,"
-                   << "PatientID,"
-                   << "ROIname,"
-                   << "NormalizedROIname,"
-                   << "HeterogeneityIndex,"
-                   << "ConformityNumber,"
-                   << "DoseMin,"
-                   << "DoseMean,"
-                   << "DoseMedian,"
-                   << "DoseMax,"
-                   << "DoseStdDev,"
-                   << "VoxelCount"
-                   << std::endl;
-        }
+        std::stringstream header;
+        header << "UserComment,"
+               << "PatientID,"
+               << "ROIname,"
+               << "NormalizedROIname,"
+               << "HeterogeneityIndex,"
+               << "ConformityNumber,"
+               << "DoseMin,"
+               << "DoseMean,"
+               << "DoseMedian,"
+               << "DoseMax,"
+               << "DoseStdDev,"
+               << "VoxelCount"
+               << std::endl;
+
+        std::stringstream body;
         for(const auto &av : ud_PTV.accumulated_voxels){
             const auto lROIname = av.first;
             const auto DoseMin = Stats::Min( av.second );
@@ -298,22 +282,32 @@ Drover EvaluateDoseVolumeStats(Drover DICOM_data,
             const auto HeterogeneityIndex = HI[lROIname];
             const auto ConformityNumber = CN[lROIname];
 
-            FO_tcp  << UserComment.value_or("") << ","
-                    << patient_ID         << ","
-                    << lROIname           << ","
-                    << X(lROIname)        << ","
-                    << HeterogeneityIndex << ","
-                    << ConformityNumber   << ","
-                    << DoseMin            << ","
-                    << DoseMean           << ","
-                    << DoseMedian         << ","
-                    << DoseMax            << ","
-                    << DoseStdDev         << ","
-                    << av.second.size()
-                    << std::endl;
+            body << UserComment.value_or("") << ","
+                 << patient_ID         << ","
+                 << lROIname           << ","
+                 << X(lROIname)        << ","
+                 << HeterogeneityIndex << ","
+                 << ConformityNumber   << ","
+                 << DoseMin            << ","
+                 << DoseMean           << ","
+                 << DoseMedian         << ","
+                 << DoseMax            << ","
+                 << DoseStdDev         << ","
+                 << av.second.size()
+                 << std::endl;
         }
-        FO_tcp.flush();
-        FO_tcp.close();
+
+        const auto gen_filename = [&]() -> std::string {
+            if(OutFilename.empty()){
+                OutFilename = Get_Unique_Sequential_Filename("/tmp/dicomautomaton_evaluatendvstats_", 6, ".csv");
+            }
+            return OutFilename;
+        };
+
+        Append_File( gen_filename,
+                     "dicomautomaton_operation_evaluatendvstats_mutex",
+                     header.str(),
+                     body.str() );
 
     }catch(const std::exception &e){
         FUNCERR("Unable to write to output dose-volume stats file: '" << e.what() << "'");
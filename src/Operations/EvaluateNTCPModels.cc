@@ -35,6 +35,7 @@
 OperationDoc OpArgDocEvaluateNTCPModels(){
     OperationDoc out;
     out.name = "EvaluateNTCPModels";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation evaluates a variety of NTCP models for each provided ROI. The selected ROI should be OARs."
@@ -36,6 +36,7 @@
 OperationDoc OpArgDocEvaluateTCPModels(){
     OperationDoc out;
     out.name = "EvaluateTCPModels";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation evaluates a variety of TCP models for each provided ROI. The selected ROI should be the GTV"
@@ -36,6 +36,7 @@
 OperationDoc OpArgDocExportFITSImages(){
     OperationDoc out;
     out.name = "ExportFITSImages";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation writes image arrays to FITS-formatted image files.";
@@ -35,6 +35,7 @@
 OperationDoc OpArgDocExportLineSamples(){
     OperationDoc out;
     out.name = "ExportLineSamples";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation writes a line sample to a file.";
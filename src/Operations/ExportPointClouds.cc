@@ -36,6 +36,7 @@
 OperationDoc OpArgDocExportPointClouds(){
     OperationDoc out;
     out.name = "ExportPointClouds";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation writes point clouds to file.";
@@ -26,6 +26,7 @@
 
 #include "Explicator.h"       //Needed for Explicator class.
 
+#include "../Mesh_IO.h"
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
 #include "../Thread_Pool.h"
@@ -35,6 +36,7 @@
 OperationDoc OpArgDocExportSurfaceMeshes(){
     OperationDoc out;
     out.name = "ExportSurfaceMeshes";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation writes a surface mesh to a file.";
@@ -48,15 +50,28 @@ OperationDoc OpArgDocExportSurfaceMeshes(){
     out.args.emplace_back();
     out.args.back().name = "Filename";
     out.args.back().desc = "The filename (or full path name) to which the surface mesh data should be written."
-                           " The file format is an ASCII OFF model."
                            " If no name is given, unique names will be chosen automatically.";
     out.args.back().default_val = "";
     out.args.back().expected = true;
     out.args.back().examples = { "smesh.off", 
-                                 "../somedir/mesh.off", 
-                                 "/path/to/some/surface_mesh.off" };
+                                 "../somedir/mesh.stl", 
+                                 "/path/to/some/surface_mesh.ply" };
     out.args.back().mimetype = "application/object-file-format"; // TODO: find correct MIME type.
 
+
+    out.args.emplace_back();
+    out.args.back().name = "Format";
+    out.args.back().desc = "The file format to write."
+                           " 'OFF' is an ASCII Object File Format model."
+                           " 'STL' is a binary stereolithography model, which is widely supported but stores vertex"
+                           " coordinates in single precision and triangulates polygonal faces."
+                           " 'PLY' is a binary Polygon File Format model with double-precision vertices."
+                           " The binary formats are much faster to write and read for large meshes.";
+    out.args.back().default_val = "OFF";
+    out.args.back().expected = true;
+    out.args.back().examples = { "OFF", "STL", "PLY" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
     return out;
 }
 
@@ -71,20 +86,46 @@ Drover ExportSurfaceMeshes(Drover DICOM_data,
     //---------------------------------------------- User Parameters --------------------------------------------------
     const auto MeshSelectionStr = OptArgs.getValueStr("MeshSelection").value();
     auto FilenameStr = OptArgs.getValueStr("Filename").value();
+    const auto FormatStr = OptArgs.getValueStr("Format").value();
 
     //-----------------------------------------------------------------------------------------------------------------
+    const auto regex_off = Compile_Regex("^of?f?$");
+    const auto regex_stl = Compile_Regex("^st?l?$");
+    const auto regex_ply = Compile_Regex("^pl?y?$");
+
+    const bool write_off = std::regex_match(FormatStr, regex_off);
+    const bool write_stl = std::regex_match(FormatStr, regex_stl);
+    const bool write_ply = std::regex_match(FormatStr, regex_ply);
+    if(!write_off && !write_stl && !write_ply){
+        throw std::invalid_argument("Format not understood. Refusing to continue.");
+    }
+    const std::string extension = write_stl ? ".stl"
+                                : write_ply ? ".ply"
+                                            : ".off";
 
     auto SMs_all = All_SMs( DICOM_data );
     auto SMs = Whitelist( SMs_all, MeshSelectionStr );
     for(auto & smp_it : SMs){
         auto FN = FilenameStr;
         if(FilenameStr.empty()){
-            FN = Get_Unique_Sequential_Filename("/tmp/dicomautomaton_exportsurfacemeshes_", 6, ".off");
+            FN = Get_Unique_Sequential_Filename("/tmp/dicomautomaton_exportsurfacemeshes_", 6, extension);
         }
-        std::fstream FO(FN, std::fstream::out);
 
-        if(!WriteFVSMeshToOFF( (*smp_it)->meshes, FO )){
-            throw std::runtime_error("Unable to write mesh in OFF format. Cannot continue.");
+        if(write_stl){
+            std::fstream FO(FN, std::fstream::out | std::fstream::binary);
+            if(!Write_Binary_STL_Mesh( (*smp_it)->meshes, FO )){
+                throw std::runtime_error("Unable to write mesh in STL format. Cannot continue.");
+            }
+        }else if(write_ply){
+            std::fstream FO(FN, std::fstream::out | std::fstream::binary);
+            if(!Write_Binary_PLY_Mesh( (*smp_it)->meshes, FO )){
+                throw std::runtime_error("Unable to write mesh in PLY format. Cannot continue.");
+            }
+        }else{
+            std::fstream FO(FN, std::fstream::out);
+            if(!WriteFVSMeshToOFF( (*smp_it)->meshes, FO )){
+                throw std::runtime_error("Unable to write mesh in OFF format. Cannot continue.");
+            }
         }
         FUNCINFO("Surface mesh written to '" << FN << "'");
     }
@@ -36,6 +36,7 @@
 OperationDoc OpArgDocExportWarps(){
     OperationDoc out;
     out.name = "ExportWarps";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation exports a vector-valued transformation (e.g., a deformation) to a file.";
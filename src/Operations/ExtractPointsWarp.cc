@@ -36,6 +36,7 @@
 OperationDoc OpArgDocExtractPointsWarp(){
     OperationDoc out;
     out.name = "ExtractPointsWarp";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation uses two point clouds (one 'moving' and the other 'stationary' or 'reference') to find a"
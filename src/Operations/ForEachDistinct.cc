@@ -109,11 +109,18 @@ OperationDoc OpArgDocForEachDistinct() {
         "If this operation has no children, this operation will evaluate to a no-op."
     );
     out.notes.emplace_back(
-        "Each invocation is performed sequentially, and all side-effects are carried forward for each iteration."
-        " However, partitions are generated before any child operations are invoked, so newly-added elements (e.g.,"
-        " new Image_Arrays) created by one invocation will not participate in subsequent invocations."
+        "By default each invocation is performed sequentially, and all side-effects are carried forward for each"
+        " iteration. However, partitions are generated before any child operations are invoked, so newly-added"
+        " elements (e.g., new Image_Arrays) created by one invocation will not participate in subsequent invocations."
         " The final order of the partitions is arbitrary."
     );
+    out.notes.emplace_back(
+        "Partitions can optionally be processed concurrently (see the 'Concurrency' parameter). Partitions are"
+        " independent, so this is equivalent to sequential processing for most child operations. However, child"
+        " operations with external side-effects (e.g., writing files, launching viewers, or prompting the user) are"
+        " evaluated one-at-a-time, and the order in which partitions reach them will vary from run to run."
+        " Partitions are always merged back together in the same order regardless of concurrency."
+    );
     out.notes.emplace_back(
         " This operation will most often be used to process data group-wise rather than as a whole."
     );
@@ -132,6 +139,17 @@ OperationDoc OpArgDocForEachDistinct() {
                                  "SeriesInstanceUID", 
                                  "StationName" };
 
+    out.args.emplace_back();
+    out.args.back().name = "Concurrency";
+    out.args.back().desc = "The maximum number of partitions to process concurrently."
+                           " A value of 1 processes partitions sequentially."
+                           " A value of 0 uses one worker per available hardware thread."
+                           " Note that child operations may themselves be multi-threaded, so a small value is"
+                           " generally sufficient.";
+    out.args.back().default_val = "1";
+    out.args.back().expected = true;
+    out.args.back().examples = { "0", "1", "2", "4", "8" };
+
     return out;
 }
 
@@ -141,9 +159,14 @@ Drover ForEachDistinct(Drover DICOM_data,
               const std::string& FilenameLex){
     //---------------------------------------------- User Parameters --------------------------------------------------
     const auto KeysCommonStr = OptArgs.getValueStr("KeysCommon").value();
+    const auto Concurrency = std::stol( OptArgs.getValueStr("Concurrency").value() );
 
     //-----------------------------------------------------------------------------------------------------------------
 
+    if(Concurrency < 0){
+        throw std::invalid_argument("Concurrency must be non-negative. Cannot continue.");
+    }
+
     // Parse the chain of metadata keys.
     std::list<std::string> KeysCommon;
     for(auto a : SplitStringToVector(KeysCommonStr, ';', 'd')){
@@ -213,9 +236,43 @@ Drover ForEachDistinct(Drover DICOM_data,
 
         // Invoke children operations over each valid partition.
         FUNCINFO("Performing children operations over " << partitions.size() << " partitions (+1 'N/A' partition)");
-        for(auto & p : partitions){
-            if(!Operation_Dispatcher(p.second, InvocationMetadata, FilenameLex, OptArgs.getChildren())){
-                throw std::runtime_error("Child analysis failed. Cannot continue");
+        if( (Concurrency == 1) || (partitions.size() < 2) ){
+            for(auto & p : partitions){
+                if(!Operation_Dispatcher(p.second, InvocationMetadata, FilenameLex, OptArgs.getChildren())){
+                    throw std::runtime_error("Child analysis failed. Cannot continue");
+                }
+            }
+
+        }else{
+            const auto Children = OptArgs.getChildren();
+            const auto *cancel_flag = Get_Operation_Cancel_Flag();
+            const auto dispatch_depth = Get_Operation_Dispatch_Depth();
+            std::mutex failure_mutex;
+            long int failures = 0;
+            {
+                asio_thread_pool tp( std::min<size_t>(static_cast<size_t>(Concurrency), partitions.size()) );
+                for(auto & p : partitions){
+                    auto *d_ptr = &(p.second);
+                    tp.submit_task([&,d_ptr](){
+                        bool success = false;
+                        try{
+                            operation_cancellation_scope cancellation(cancel_flag);
+                            operation_dispatch_depth_scope depth(dispatch_depth);
+                            success = Operation_Dispatcher(*d_ptr, InvocationMetadata, FilenameLex, Children);
+                        }catch(const std::exception &e){
+                            FUNCWARN("Child analysis failed: '" << e.what() << "'");
+                        }
+                        if(!success){
+                            std::lock_guard<std::mutex> lock(failure_mutex);
+                            ++failures;
+                        }
+                    });
+                }
+            } // Wait for all tasks to complete.
+
+            if(failures != 0){
+                throw std::runtime_error("Child analysis failed for "_s + std::to_string(failures)
+                                         + " partition(s). Cannot continue");
             }
         }
 
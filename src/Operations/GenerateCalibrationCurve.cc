@@ -28,6 +28,7 @@
 OperationDoc OpArgDocGenerateCalibrationCurve(){
     OperationDoc out;
     out.name = "GenerateCalibrationCurve";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation uses two overlapping images volumes to generate a calibration curve mapping from the first"
@@ -6,6 +6,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <regex>
 #include <stdexcept>
 #include <string>    
 
@@ -24,6 +25,11 @@ OperationDoc OpArgDocGenerateSurfaceMask(){
         "This operation generates a surface image mask, which contains information about whether each voxel is"
         " within, on, or outside the selected ROI(s).";
 
+    out.notes.emplace_back(
+        "If the images form a rectilinear grid, the ROI(s) are rasterized with a single scanline pass and voxels are"
+        " classified on the resulting dense mask, which is much faster than the general approach used otherwise."
+    );
+
 
     out.args.emplace_back();
     out.args.back().name = "BackgroundVal";
@@ -48,6 +54,20 @@ OperationDoc OpArgDocGenerateSurfaceMask(){
 
 
 
+    out.args.emplace_back();
+    out.args.back().name = "SignedDistanceMap";
+    out.args.back().desc = "Whether to also generate a signed Euclidean distance map, which is appended as a new image"
+                           " array. Voxels outside the ROI(s) are assigned the distance (in DICOM units) to the nearest"
+                           " interior voxel, and voxels inside are assigned the negated distance to the nearest"
+                           " exterior voxel. Distances are exact (up to voxel discretization) and account for"
+                           " anisotropic voxels. The map can be thresholded to implement margins."
+                           " Images must form a rectilinear grid.";
+    out.args.back().default_val = "false";
+    out.args.back().expected = true;
+    out.args.back().examples = { "true", "false" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
+
     out.args.emplace_back();
     out.args.back() = NCWhitelistOpArgDoc();
     out.args.back().name = "NormalizedROILabelRegex";
@@ -74,6 +94,7 @@ Drover GenerateSurfaceMask(Drover DICOM_data,
     const auto SurfaceVal     = std::stod(OptArgs.getValueStr("SurfaceVal").value());
     const auto ROILabelRegex  = OptArgs.getValueStr("ROILabelRegex").value();
     const auto NormalizedROILabelRegex = OptArgs.getValueStr("NormalizedROILabelRegex").value();
+    const auto SignedDistanceMapStr = OptArgs.getValueStr("SignedDistanceMap").value();
     //-----------------------------------------------------------------------------------------------------------------
 
     auto img_arr_ptr = DICOM_data.image_data.back();
@@ -93,16 +114,32 @@ Drover GenerateSurfaceMask(Drover DICOM_data,
         throw std::invalid_argument("No contours selected. Cannot continue.");
     }
 
+    const auto regex_true = Compile_Regex("^tr?u?e?$");
+    const bool ShouldGenerateSDM = std::regex_match(SignedDistanceMapStr, regex_true);
+
     //Perform the computation.
     GenerateSurfaceMaskUserData ud;
     ud.background_val = BackgroundVal;
     ud.surface_val    = SurfaceVal;
     ud.interior_val   = InteriorVal;
 
+    std::shared_ptr<Image_Array> sdm_arr_ptr;
+    if(ShouldGenerateSDM){
+        sdm_arr_ptr = std::make_shared<Image_Array>( *img_arr_ptr );
+        ud.signed_distance_map = &(sdm_arr_ptr->imagecoll);
+    }
+
     if(!img_arr_ptr->imagecoll.Compute_Images( ComputeGenerateSurfaceMask, { },
                                                cc_ROIs, &ud )){
         throw std::runtime_error("Unable to generate a surface mask.");
     }
 
+    if(sdm_arr_ptr != nullptr){
+        for(auto &img : sdm_arr_ptr->imagecoll.images){
+            img.metadata["Description"] = "Signed distance map";
+        }
+        DICOM_data.image_data.emplace_back( sdm_arr_ptr );
+    }
+
     return DICOM_data;
 }
@@ -18,6 +18,7 @@
 
 #include "../Dose_Meld.h"
 #include "../Structs.h"
+#include "../Ray_Casting.h"
 #include "../Regex_Selectors.h"
 #include "../Thread_Pool.h"
 #include "../YgorImages_Functors/Compute/GenerateSurfaceMask.h"
@@ -36,6 +37,7 @@
 OperationDoc OpArgDocGridBasedRayCastDoseAccumulate(){
     OperationDoc out;
     out.name = "GridBasedRayCastDoseAccumulate";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation performs a ray casting to estimate the surface dose of an ROI.";
 
@@ -110,12 +112,25 @@ OperationDoc OpArgDocGridBasedRayCastDoseAccumulate(){
     out.args.back().expected = true;
     out.args.back().examples = { "1.0", "2.0", "0.5", "5.0" };
     
+    out.args.emplace_back();
+    out.args.back().name = "Method";
+    out.args.back().desc = "Controls how rays are traced through the surface mask."
+                      " The 'exact' method walks each ray voxel-by-voxel through the mask and dose grids, so the"
+                      " in-surface path length and dose integral are computed exactly and do not depend on any step size."
+                      " The 'march' method advances rays in fixed increments of RaydL, sampling the mask and dose at"
+                      " each step. It is much slower and is retained mainly for comparison.";
+    out.args.back().default_val = "exact";
+    out.args.back().expected = true;
+    out.args.back().examples = { "exact", "march" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
     out.args.emplace_back();
     out.args.back().name = "RaydL";
     out.args.back().desc = "The distance to move a ray each iteration. Should be << img_thickness and << cylinder_radius."
                       " Making too large will invalidate results, causing rays to pass through the surface without"
                       " registering any dose accumulation. Making too small will cause the run-time to grow and may"
-                      " eventually lead to truncation or round-off errors. Quantity is in the DICOM coordinate system.";
+                      " eventually lead to truncation or round-off errors. Quantity is in the DICOM coordinate system."
+                      " Only used by the 'march' method.";
     out.args.back().default_val = "0.1";
     out.args.back().expected = true;
     out.args.back().examples = { "0.1", "0.05", "0.01", "0.005" };
@@ -181,6 +196,7 @@ Drover GridBasedRayCastDoseAccumulate(Drover DICOM_data,
     const auto ReferenceROILabelRegex = OptArgs.getValueStr("ReferenceROILabelRegex").value();
     const auto NormalizedReferenceROILabelRegex = OptArgs.getValueStr("NormalizedReferenceROILabelRegex").value();
     const auto SmallestFeature = std::stod(OptArgs.getValueStr("SmallestFeature").value());
+    const auto MethodStr = OptArgs.getValueStr("Method").value();
     const auto RaydL = std::stod(OptArgs.getValueStr("RaydL").value());
     const auto GridRows = std::stol(OptArgs.getValueStr("GridRows").value());
     const auto GridColumns = std::stol(OptArgs.getValueStr("GridColumns").value());
@@ -194,6 +210,13 @@ Drover GridBasedRayCastDoseAccumulate(Drover DICOM_data,
     const auto refregex = Compile_Regex(ReferenceROILabelRegex);
     const auto refnormalizedregex = Compile_Regex(NormalizedReferenceROILabelRegex);
 
+    const auto regex_exact = Compile_Regex("^ex?a?c?t?$");
+    const auto regex_march = Compile_Regex("^ma?r?c?h?$");
+    const bool use_exact = std::regex_match(MethodStr, regex_exact);
+    if(!use_exact && !std::regex_match(MethodStr, regex_march)){
+        throw std::invalid_argument("Method not understood. Cannot continue.");
+    }
+
     Explicator X(FilenameLex);
 
     //Merge the dose arrays if multiple are available.
@@ -461,32 +484,52 @@ Drover GridBasedRayCastDoseAccumulate(Drover DICOM_data,
                 for(long int col = 0; col < SourceDetectorColumns; ++col){
                     double accumulated_length = 0.0;      //Length of ray travel within the 'surface'.
                     double accumulated_doselength = 0.0;
-                    vec3<double> ray_pos = SourceImg->position(row, col);
-                    const vec3<double> terminus = DetectImg->position(row, col);
-                    const vec3<double> ray_dir = (terminus - ray_pos).unit();
-
-                    ray_pos += ray_dir * cleaved_gap_dist; // Skip the gap which has been cleaved out.
-
-                    //Go until we get within certain distance or overshoot and the ray wants to backtrack.
-                    while(    (ray_dir.Dot( (terminus - ray_pos).unit() ) > 0.8 ) // Ray orientation is still downward-facing.
-                           && (ray_pos.distance(terminus) > std::max(RaydL, SmallestFeature)) ){ // Still far away from detector.
-
-                        ray_pos += ray_dir * RaydL;
-                        const auto midpoint = ray_pos - (ray_dir * RaydL * 0.5);
-
-                        //Check if it was in the surface at the midpoint.
-                        auto rel_img = grid_arr_ptr->imagecoll.get_images_which_encompass_point(midpoint);
-                        if(rel_img.empty()) continue;
-                        const auto mask_val = rel_img.front()->value(midpoint, 0);
-                        const auto is_in_surface = (mask_val == surface_mask_val);
-                        if(is_in_surface){
-                            accumulated_length += RaydL;
-
-                            //Find the dose at the half-way point.
-                            auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
-                            for(const auto &enc_img : encompass_imgs){
-                                const auto pix_val = enc_img->value(midpoint, 0);
-                                accumulated_doselength += RaydL * pix_val;
+
+                    if(use_exact){
+                        const vec3<double> ray_start = SourceImg->position(row, col);
+                        const vec3<double> terminus = DetectImg->position(row, col);
+                        const vec3<double> ray_dir = (terminus - ray_start).unit();
+
+                        // Skip the gap which has been cleaved out and stop short of the detector.
+                        const double t_min = cleaved_gap_dist;
+                        const double t_max = ray_start.distance(terminus) - SmallestFeature;
+                        const auto intervals = Image_Ray_Intervals(grid_arr_ptr->imagecoll, ray_start, ray_dir,
+                                                                   t_min, t_max, 0,
+                                                                   [=](float mask_val) -> bool {
+                                                                       return (mask_val == surface_mask_val);
+                                                                   });
+
+                        accumulated_length = Total_Ray_Interval_Length(intervals);
+                        accumulated_doselength = Integrate_Image_Along_Ray(img_arr_ptr->imagecoll, ray_start, ray_dir,
+                                                                           intervals, 0);
+                    }else{
+                        vec3<double> ray_pos = SourceImg->position(row, col);
+                        const vec3<double> terminus = DetectImg->position(row, col);
+                        const vec3<double> ray_dir = (terminus - ray_pos).unit();
+
+                        ray_pos += ray_dir * cleaved_gap_dist; // Skip the gap which has been cleaved out.
+
+                        //Go until we get within certain distance or overshoot and the ray wants to backtrack.
+                        while(    (ray_dir.Dot( (terminus - ray_pos).unit() ) > 0.8 ) // Ray orientation is still downward-facing.
+                               && (ray_pos.distance(terminus) > std::max(RaydL, SmallestFeature)) ){ // Still far away from detector.
+
+                            ray_pos += ray_dir * RaydL;
+                            const auto midpoint = ray_pos - (ray_dir * RaydL * 0.5);
+
+                            //Check if it was in the surface at the midpoint.
+                            auto rel_img = grid_arr_ptr->imagecoll.get_images_which_encompass_point(midpoint);
+                            if(rel_img.empty()) continue;
+                            const auto mask_val = rel_img.front()->value(midpoint, 0);
+                            const auto is_in_surface = (mask_val == surface_mask_val);
+                            if(is_in_surface){
+                                accumulated_length += RaydL;
+
+                                //Find the dose at the half-way point.
+                                auto encompass_imgs = img_arr_ptr->imagecoll.get_images_which_encompass_point( midpoint );
+                                for(const auto &enc_img : encompass_imgs){
+                                    const auto pix_val = enc_img->value(midpoint, 0);
+                                    accumulated_doselength += RaydL * pix_val;
+                                }
                             }
                         }
                     }
@@ -41,6 +41,11 @@ OperationDoc OpArgDocInterpolateSlices(){
         " invalid and marked with NaNs. Non-rectilearity which amounts to a differing number of rows"
         " or columns will merely be slower to interpolate."
     );
+    out.notes.emplace_back(
+        "If the selected images form a rectilinear grid and share an orientation with the reference images, the"
+        " interpolation is separable and precomputed interpolation tables are used regardless of the reference image"
+        " voxel dimensions. Other kernels are only available in this case."
+    );
 
 
     out.args.emplace_back();
@@ -66,6 +71,18 @@ OperationDoc OpArgDocInterpolateSlices(){
                                  "1",
                                  "2" };
 
+    out.args.emplace_back();
+    out.args.back().name = "Kernel";
+    out.args.back().desc = "The interpolation kernel to use. 'Nearest' takes the nearest voxel, 'linear' performs"
+                           " trilinear interpolation, and 'cubic' performs cubic interpolation (Catmull-Rom in-plane"
+                           " and Lagrange between slices).";
+    out.args.back().default_val = "linear";
+    out.args.back().expected = true;
+    out.args.back().examples = { "nearest",
+                                 "linear",
+                                 "cubic" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
     return out;
 }
 
@@ -82,8 +99,23 @@ Drover InterpolateSlices(Drover DICOM_data,
     const auto ReferenceImageSelectionStr = OptArgs.getValueStr("ReferenceImageSelection").value();
 
     const auto Channel = std::stol( OptArgs.getValueStr("Channel").value() );
+    const auto KernelStr = OptArgs.getValueStr("Kernel").value();
 
     //-----------------------------------------------------------------------------------------------------------------
+    const auto regex_nearest = Compile_Regex("^ne?a?r?e?s?t?$");
+    const auto regex_linear  = Compile_Regex("^li?n?e?a?r?$");
+    const auto regex_cubic   = Compile_Regex("^cu?b?i?c?$");
+
+    resampling_kernel kernel;
+    if(std::regex_match(KernelStr, regex_nearest)){
+        kernel = resampling_kernel::nearest;
+    }else if(std::regex_match(KernelStr, regex_linear)){
+        kernel = resampling_kernel::linear;
+    }else if(std::regex_match(KernelStr, regex_cubic)){
+        kernel = resampling_kernel::cubic;
+    }else{
+        throw std::invalid_argument("Kernel not understood. Cannot continue.");
+    }
 
     auto RIAs_all = All_IAs( DICOM_data );
     auto RIAs = Whitelist( RIAs_all, ReferenceImageSelectionStr );
@@ -98,6 +130,7 @@ Drover InterpolateSlices(Drover DICOM_data,
 
         ComputeInterpolateImageSlicesUserData ud;
         ud.channel = Channel;
+        ud.kernel = kernel;
 
         std::list<std::reference_wrapper<planar_image_collection<float, double>>> IARL = { std::ref( (*iap_it)->imagecoll ) };
 
@@ -0,0 +1,83 @@
+//MergeResultShards.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <map>
+#include <stdexcept>
+#include <string>    
+
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+
+#include "../Structs.h"
+#include "../Write_File.h"
+
+#include "MergeResultShards.h"
+
+
+OperationDoc OpArgDocMergeResultShards(){
+    OperationDoc out;
+    out.name = "MergeResultShards";
+    out.has_external_side_effects = true;
+
+    out.desc = 
+        "This operation concatenates result shards into a single results file."
+        " Operations that append rows to a shared results file (e.g., CountVoxels or EvaluateDoseVolumeStats)"
+        " normally serialize writes with a named mutex. When the environment variable 'DCMA_RESULT_SINK' is set to"
+        " 'sharded', rows are instead buffered in memory and written to per-process shard files alongside the"
+        " results file. This operation merges those shards into the results file.";
+        
+    out.notes.emplace_back(
+        "This operation does not alter the loaded data."
+    );
+    out.notes.emplace_back(
+        "The header is written only if the results file does not already exist. Merged shards are removed."
+    );
+    out.notes.emplace_back(
+        "Shards that are still being written are not merged. Run this operation after all writers have finished."
+    );
+        
+
+    out.args.emplace_back();
+    out.args.back().name = "FileName";
+    out.args.back().desc = "The results file to merge shards into. Shards are named '<FileName>.shard-*'.";
+    out.args.back().default_val = "";
+    out.args.back().expected = true;
+    out.args.back().examples = { "/tmp/somefile", "localfile.csv", "derivative_data.csv" };
+    out.args.back().mimetype = "text/csv";
+
+
+    out.args.emplace_back();
+    out.args.back().name = "MutexName";
+    out.args.back().desc = "The named mutex that writers use to protect the results file."
+                           " It is held while merging so that writers using the named-mutex path are not interleaved."
+                           " Each operation uses its own mutex name, e.g., 'dicomautomaton_operation_countvoxels_mutex'."
+                           " If empty, the mutex name recorded in the shards by their writer is used.";
+    out.args.back().default_val = "";
+    out.args.back().expected = false;
+    out.args.back().examples = { "dicomautomaton_operation_countvoxels_mutex",
+                                 "dicomautomaton_operation_evaluatendvstats_mutex",
+                                 "dicomautomaton_operation_analyzepicketfence_mutex" };
+
+    return out;
+}
+
+Drover MergeResultShards(Drover DICOM_data,
+                         const OperationArgPkg& OptArgs,
+                         const std::map<std::string, std::string>& /*InvocationMetadata*/,
+                         const std::string& /*FilenameLex*/){
+
+    //---------------------------------------------- User Parameters --------------------------------------------------
+    const auto FileName = OptArgs.getValueStr("FileName").value();
+    const auto MutexName = OptArgs.getValueStr("MutexName").value_or("");
+
+    //-----------------------------------------------------------------------------------------------------------------
+    if(FileName.empty()){
+        throw std::invalid_argument("A results file name must be provided.");
+    }
+
+    // Write this process' own buffered rows first so they are included.
+    Flush_Result_Sinks();
+
+    const auto N_merged = Merge_Result_Shards(FileName, MutexName);
+    FUNCINFO("Merged " << N_merged << " result shards into '" << FileName << "'");
+
+    return DICOM_data;
+}
@@ -55,6 +55,7 @@
 OperationDoc OpArgDocMinkowskiSum3D(){
     OperationDoc out;
     out.name = "MinkowskiSum3D";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation computes a Minkowski sum or symmetric difference of a 3D surface mesh generated from the"
@@ -62,6 +63,17 @@ OperationDoc OpArgDocMinkowskiSum3D(){
         " The effect is that a margin is added or subtracted to the ROIs, causing them to 'grow' outward or 'shrink'"
         " inward. Exact and inexact routines can be used.";
 
+    out.notes.emplace_back(
+        "The exact routines can take a long time (minutes to hours) and may fail for complex ROIs."
+        " The inexact isotropic routines are faster, but still rely on repeated Boolean operations."
+    );
+    out.notes.emplace_back(
+        "The grid routines rasterize the ROIs onto a voxel grid, compute a signed distance transform, and extract the"
+        " offset surface with Marching Cubes. They are fast and robust, but are only accurate to within approximately"
+        " one voxel diagonal, i.e., sqrt(2*VoxelSize^2 + s^2) where s is the separation between contour planes."
+        " The achieved bound is reported when the operation runs."
+    );
+
     out.args.emplace_back();
     out.args.back() = NCWhitelistOpArgDoc();
     out.args.back().name = "NormalizedROILabelRegex";
@@ -94,15 +106,21 @@ OperationDoc OpArgDocMinkowskiSum3D(){
                            " 'dilate_exact_surface',"
                            " 'dilate_exact_vertex',"
                            " 'dilate_inexact_isotropic',"
-                           " 'erode_inexact_isotropic', and"
-                           " 'shell_inexact_isotropic'.";
+                           " 'erode_inexact_isotropic',"
+                           " 'shell_inexact_isotropic',"
+                           " 'dilate_grid',"
+                           " 'erode_grid', and"
+                           " 'shell_grid'.";
     out.args.back().default_val = "dilate_inexact_isotropic";
     out.args.back().expected = true;
     out.args.back().examples = { "dilate_exact_surface", 
                                  "dilate_exact_vertex", 
                                  "dilate_inexact_isotropic",
                                  "erode_inexact_isotropic", 
-                                 "shell_inexact_isotropic" };
+                                 "shell_inexact_isotropic",
+                                 "dilate_grid",
+                                 "erode_grid",
+                                 "shell_grid" };
     out.args.back().samples = OpArgSamples::Exhaustive;
 
     out.args.emplace_back();
@@ -114,6 +132,16 @@ OperationDoc OpArgDocMinkowskiSum3D(){
     out.args.back().expected = true;
     out.args.back().examples = { "0.5", "1.0", "2.0", "3.0", "5.0" };
 
+    out.args.emplace_back();
+    out.args.back().name = "VoxelSize";
+    out.args.back().desc = "For the grid operations, this parameter controls the maximum in-plane voxel size."
+                           " The out-of-plane voxel size is always the separation between contour planes."
+                           " Smaller voxels improve accuracy, but increase memory usage and runtime."
+                           " DICOM units are assumed.";
+    out.args.back().default_val = "1.0";
+    out.args.back().expected = true;
+    out.args.back().examples = { "0.5", "1.0", "2.0" };
+
 
 /*
     out.args.emplace_back();
@@ -146,6 +174,7 @@ Drover MinkowskiSum3D(Drover DICOM_data,
 //    const auto ContourOverlapStr = OptArgs.getValueStr("ContourOverlap").value();
     const auto OpSelectionStr = OptArgs.getValueStr("Operation").value();
     const auto Distance = std::stod( OptArgs.getValueStr("Distance").value() );
+    const auto VoxelSize = std::stod( OptArgs.getValueStr("VoxelSize").value() );
 
     const std::string base_dir("/tmp/MinkowskiSum3D");
     const std::string NewROIName("New ROI");
@@ -161,12 +190,18 @@ Drover MinkowskiSum3D(Drover DICOM_data,
     const auto regex_dilate_inexact_isotropic = Compile_Regex("dil?a?t?e?_?ine?x?a?c?t?_?isot?r?o?p?i?c?"); //diiniso
     const auto regex_erode_inexact_isotropic  = Compile_Regex("ero?d?e?_?ine?x?a?c?t?_?isot?r?o?p?i?c?"); //eriniso
     const auto regex_shell_inexact_isotropic  = Compile_Regex("she?l?l?_?ine?x?a?c?t?_?isot?r?o?p?i?c?"); //shiniso
+    const auto regex_dilate_grid              = Compile_Regex("dil?a?t?e?_?gri?d?");
+    const auto regex_erode_grid               = Compile_Regex("ero?d?e?_?gri?d?");
+    const auto regex_shell_grid               = Compile_Regex("she?l?l?_?gri?d?");
 
     if( !std::regex_match(OpSelectionStr, regex_dilate_exact_surface)
     &&  !std::regex_match(OpSelectionStr, regex_dilate_exact_vertex)
     &&  !std::regex_match(OpSelectionStr, regex_dilate_inexact_isotropic)
     &&  !std::regex_match(OpSelectionStr, regex_erode_inexact_isotropic)
-    &&  !std::regex_match(OpSelectionStr, regex_shell_inexact_isotropic) ){
+    &&  !std::regex_match(OpSelectionStr, regex_shell_inexact_isotropic)
+    &&  !std::regex_match(OpSelectionStr, regex_dilate_grid)
+    &&  !std::regex_match(OpSelectionStr, regex_erode_grid)
+    &&  !std::regex_match(OpSelectionStr, regex_shell_grid) ){
         throw std::invalid_argument("Operation selection is not valid. Cannot continue.");
     }
 
@@ -183,7 +218,10 @@ Drover MinkowskiSum3D(Drover DICOM_data,
 
     // Generate a polyhedron surface mesh iff necessary.
     dcma_surface_meshes::Polyhedron output_mesh;
-    if( (std::regex_match(OpSelectionStr, regex_dilate_exact_vertex)) ){
+    if( (std::regex_match(OpSelectionStr, regex_dilate_exact_vertex))
+    ||  (std::regex_match(OpSelectionStr, regex_dilate_grid))
+    ||  (std::regex_match(OpSelectionStr, regex_erode_grid))
+    ||  (std::regex_match(OpSelectionStr, regex_shell_grid)) ){
         // Do nothing -- no surface is needed.
 
     }else if( (std::regex_match(OpSelectionStr, regex_dilate_exact_surface))
@@ -231,6 +269,24 @@ Drover MinkowskiSum3D(Drover DICOM_data,
                                           Distance,
                                           polyhedron_processing::TransformOp::Shell );
 
+    }else if(std::regex_match(OpSelectionStr, regex_dilate_grid)){
+        output_mesh = polyhedron_processing::Transform_Via_Distance_Field( cc_ROIs,
+                                                                          Distance,
+                                                                          VoxelSize,
+                                                                          polyhedron_processing::TransformOp::Dilate );
+
+    }else if(std::regex_match(OpSelectionStr, regex_erode_grid)){
+        output_mesh = polyhedron_processing::Transform_Via_Distance_Field( cc_ROIs,
+                                                                          Distance,
+                                                                          VoxelSize,
+                                                                          polyhedron_processing::TransformOp::Erode );
+
+    }else if(std::regex_match(OpSelectionStr, regex_shell_grid)){
+        output_mesh = polyhedron_processing::Transform_Via_Distance_Field( cc_ROIs,
+                                                                          Distance,
+                                                                          VoxelSize,
+                                                                          polyhedron_processing::TransformOp::Shell );
+
     }else{
         throw std::invalid_argument("Operation not recognized");
     }
@@ -13,6 +13,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <regex>
 #include <stdexcept>
 #include <string>    
@@ -34,6 +35,7 @@
 
 #include "Explicator.h"
 
+#include "../Dose_Influence_Matrix.h"
 #include "../Insert_Contours.h"
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
@@ -61,35 +63,6 @@ struct dose_dist_stats {
 
 };
 
-// Global objects so lambdas can be non-capturing and thus passed as function pointers.
-std::function< dose_dist_stats (std::vector<double> &, std::vector<double> &)> global_evaluate_weights;
-std::vector<double> global_working;
-bool generate_dose_dist_stats = false;
-
-
-// This routine determines the normalization factor required to satisfy the given DVH criteria: $V_{D} \geq V_{min}$.
-// Every element in the input should be multiplied with the return value to satisfy the DVH criteria.
-//
-// Note: it may not be possible to satisfy the criteria. Check the result for non-finite values.
-//
-// Note: Vmin is assumed to be a fraction (of the number of elements, but if each element represents the same fractional
-//       volume of the whole then Vmin is also a fraction of the whole volume).
-//
-// Note: D is in whatever units the input data is; most likely absolute dose. If the normalization condition is a
-//       fraction of the prescribed dose, it will need to be converted into absolute dose if the input data is in
-//       absolute dose.
-//
-double DVH_Normalize(std::vector<double> in, 
-                     double D, 
-                     double Vmin){
-
-    // Compute the current dose that corresponds to Vmin.
-    const auto D_current = Stats::Percentile(std::move(in), (1.0 - Vmin));
-
-    // Scale needed to make it coincide with desired dose.
-    return D / D_current;
-}
-
 
 OperationDoc OpArgDocOptimizeStaticBeams(){
     OperationDoc out;
@@ -117,6 +90,12 @@ OperationDoc OpArgDocOptimizeStaticBeams(){
         " For example, bolus D_{max} can be high, but is ultimately irrelevant."
     );
 
+    out.notes.emplace_back(
+        "Voxel doses within the ROI(s) are gathered into a sparse dose-influence matrix (voxels x beams), so the"
+        " cost of evaluating a weighting scheme scales with the number of non-zero voxel doses. Large problems are"
+        " evaluated in parallel."
+    );
+
     out.notes.emplace_back(
         "By default, this routine uses all available images. This may be fixed in a future release."
         " Patches are welcome."
@@ -165,10 +144,25 @@ OperationDoc OpArgDocOptimizeStaticBeams(){
                            " Setting lower will result in faster calculation, but lower precision."
                            " A reasonable setting depends on the size of the target structure; small"
                            " targets may suffice with a few hundred voxels, but larger targets"
-                           " probably require several thousand.";
+                           " probably require several thousand."
+                           " Set to zero to use all voxels within the ROI(s).";
     out.args.back().default_val = "1000";
     out.args.back().expected = true;
-    out.args.back().examples = { "200", "500", "1000", "2000", "5000" };
+    out.args.back().examples = { "0", "200", "500", "1000", "2000", "5000" };
+
+
+    out.args.emplace_back();
+    out.args.back().name = "Optimizer";
+    out.args.back().desc = "The optimization algorithm to use."
+                           " 'DIRECT-L' is a derivative-free global optimizer. It is robust, but the number of"
+                           " evaluations needed grows rapidly with the number of beams."
+                           " 'L-BFGS' is a bound-constrained, gradient-based local optimizer. It converges quickly even"
+                           " for many beams, but may terminate in a local minimum."
+                           " Note that the cost is not smooth where the voxel at the normalization percentile changes.";
+    out.args.back().default_val = "DIRECT-L";
+    out.args.back().expected = true;
+    out.args.back().examples = { "DIRECT-L", "L-BFGS" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
 
 
     out.args.emplace_back();
@@ -232,7 +226,20 @@ Drover OptimizeStaticBeams(Drover DICOM_data,
     const auto dvh_Vmin_frac = std::stod(  OptArgs.getValueStr("NormalizationV").value() );
     const auto D_Rx = std::stod(  OptArgs.getValueStr("RxDose").value() );
 
+    const auto OptimizerStr = OptArgs.getValueStr("Optimizer").value();
+
     //-----------------------------------------------------------------------------------------------------------------
+    const auto regex_direct = Compile_Regex("^di?r?e?c?t?[-_]?l?$");
+    const auto regex_lbfgs = Compile_Regex("^l[-_]?b?f?g?s?[-_]?b?$");
+
+    const bool use_direct = std::regex_match(OptimizerStr, regex_direct);
+    const bool use_lbfgs = std::regex_match(OptimizerStr, regex_lbfgs);
+    if(!use_direct && !use_lbfgs){
+        throw std::invalid_argument("Optimizer not understood. Refusing to continue.");
+    }
+    if(MaxVoxelSamples < 0){
+        throw std::invalid_argument("MaxVoxelSamples must be non-negative. Refusing to continue.");
+    }
 
     if(ResultsSummaryFileName.empty()){
         ResultsSummaryFileName = Get_Unique_Sequential_Filename("/tmp/dicomautomaton_optimizestaticbeamssummary_", 6, ".csv");
@@ -248,8 +255,7 @@ Drover OptimizeStaticBeams(Drover DICOM_data,
         throw std::invalid_argument("No contours selected. Cannot continue.");
     }
 
-    std::mutex common_access;
-    std::vector<std::vector<double>> voxels;
+    std::vector<std::vector<float>> voxels;
     std::vector<std::string> beam_id; // Something that will identify each beam.
 
     // Cycle over the Image_Arrays, extracting for each a collection of relevant voxels.
@@ -335,122 +341,71 @@ Drover OptimizeStaticBeams(Drover DICOM_data,
     const long int N_voxels_max = MaxVoxelSamples;
     const long int random_seed = 123456;
     std::mt19937 re_orig( random_seed );
-    {
+    if( (0 < N_voxels_max) && (N_voxels_max < static_cast<long int>(voxels.front().size())) ){
         for(auto &vec : voxels){
             auto re = re_orig;
             std::shuffle(vec.begin(), vec.end(), re);
-        }
-        if(voxels.front().size() > N_voxels_max){
-            for(auto &vec : voxels){
-                vec.resize( N_voxels_max );
-            }
+            vec.resize( N_voxels_max );
         }
     }
 
     const auto N_beams = static_cast<long int>(voxels.size());
-    const auto N_voxels = voxels.front().size();
-
-    std::stringstream ss;
-
-    // This routine evaluates weighting schemes to produce cost and quality metrics.
-    auto evaluate_weights = [&,N_beams](std::vector<double> &weights, 
-                                        std::vector<double> &working) -> dose_dist_stats {
-
-        dose_dist_stats out;
-
-        // Compute the total dose using the current weighting scheme.
-        //
-        // Note: This requires consistent voxel ordering!
-        std::fill(working.begin(), working.end(), 0.0);
-        for(long int beam = 0; beam < N_beams; ++beam){
-            const auto weight = weights[beam];
-            std::transform( working.begin(), working.end(),
-                            voxels[beam].begin(), 
-                            working.begin(),
-                            [=](const double &L, const double &R){ return L + weight * R; });
-        }
-
-        // Sanity check.
-        const auto D_max = Stats::Max(working);
-        if(!std::isfinite(D_max) || (D_max < 1E-3)){
-            out.cost = std::numeric_limits<double>::max();
-        }
-
-        // Scale the weighted dose distribution to achieve the specified normalization.
-        const auto DVH_norm_D = dvh_D_frac * D_Rx;
-        const auto DVH_norm_Vmin = dvh_Vmin_frac;
-        const auto dose_scaler = DVH_Normalize(working, DVH_norm_D, DVH_norm_Vmin);
-
-        std::transform(working.begin(), working.end(), 
-                       working.begin(), [=](double D) -> double { return D*dose_scaler; });
-        
-        // Generate descriptive stats for the dose distribution.
-        if(generate_dose_dist_stats){
-            out.D_min  = 100.0 * Stats::Min(working) / D_Rx;
-            out.D_max  = 100.0 * Stats::Max(working) / D_Rx;
-            out.D_mean = 100.0 * Stats::Mean(working) / D_Rx;
-            out.D_02   = Stats::Percentile(working, 0.02);
-            out.D_05   = Stats::Percentile(working, 0.05);
-            out.D_50   = Stats::Percentile(working, 0.50);
-            out.D_95   = Stats::Percentile(working, 0.95);
-            out.D_98   = Stats::Percentile(working, 0.98);
-        }
-
-        //Compute the cost function for each dose element.
-        std::transform(working.begin(), working.end(), 
-                       working.begin(), [=](double D) -> double { return std::pow(D - D_Rx, 2.0); });
-        out.cost = Stats::Sum(working);
-
-/*
-            std::cout << "Evaluation # " << eval_count << " yields " << total_cost << " with weights ";
-            for(auto &w : weights) std::cout << w << " ";
-            std::cout << "Dmin= " << Dmin << "\% Dmean= " << Dmean << "\% Dmax= " << Dmax << "\%";
-            std::cout << std::endl;
-*/
-        return out;
-    };
-    global_evaluate_weights = evaluate_weights;
-
-    //Constrained surface optimization.
+    const auto N_voxels = static_cast<long int>(voxels.front().size());
+
+    // Assemble the sparse dose-influence matrix. The dense per-beam samples are no longer needed afterward.
+    dose_influence_objective objective( Build_Dose_Influence_Matrix(voxels),
+                                        dvh_D_frac * D_Rx,
+                                        dvh_Vmin_frac,
+                                        D_Rx );
+    voxels.clear();
+    voxels.shrink_to_fit();
+    FUNCINFO("Dose influence matrix contains " << objective.Matrix().nnz() << " non-zero elements for "
+             << N_voxels << " voxels and " << N_beams << " beams");
+
+    // The cost is independent of the overall weight scale, so the optimizer works directly with un-normalized weights.
+    // The gradient is only requested by gradient-based algorithms.
     auto f_to_optimize = [](const std::vector<double> &open_weights, 
                             std::vector<double> &grad, 
-                            void * ) -> double {
-        if(!grad.empty()) throw std::logic_error("This implementation cannot handle derivatives.");
-
-        std::vector<double> weights(open_weights);
-        const auto sum = std::accumulate(weights.begin(), weights.end(), 0.0);
-        std::transform(weights.begin(), weights.end(), weights.begin(), [=](double ow) -> double { return ow / sum; });
-
-        auto res = global_evaluate_weights(weights, global_working);
-        return res.cost;
+                            void *data ) -> double {
+        auto *obj = reinterpret_cast<dose_influence_objective *>(data);
+        return obj->Evaluate(open_weights, grad);
     };
 
     std::vector<double> open_weights(N_beams, 0.5);
-    std::vector<double> working(N_voxels, 0.0);
-    global_working = working;
 
 #ifdef DCMA_USE_NLOPT
     //nlopt::opt optimizer(nlopt::LN_NELDERMEAD, N_beams);
-    nlopt::opt optimizer(nlopt::GN_DIRECT_L, N_beams);
     //nlopt::opt optimizer(nlopt::GN_ISRES, N_beams);
     //nlopt::opt optimizer(nlopt::GN_ESCH, N_beams);
+    nlopt::opt optimizer( (use_lbfgs ? nlopt::LD_LBFGS : nlopt::GN_DIRECT_L), N_beams);
 
     std::vector<double> lower_bounds(N_beams, 0.0);
     std::vector<double> upper_bounds(N_beams, 1.0);
 
     optimizer.set_lower_bounds(lower_bounds);
     optimizer.set_upper_bounds(upper_bounds);
-    optimizer.set_min_objective(f_to_optimize, nullptr);
+    optimizer.set_min_objective(f_to_optimize, reinterpret_cast<void *>(&objective));
     optimizer.set_ftol_abs(-HUGE_VAL);
-    optimizer.set_ftol_rel(1.0E-8);
     optimizer.set_xtol_abs(-HUGE_VAL);
-    optimizer.set_xtol_rel(-HUGE_VAL);
-    optimizer.set_maxeval(500'000);
+    if(use_lbfgs){
+        optimizer.set_ftol_rel(1.0E-10);
+        optimizer.set_xtol_rel(1.0E-8);
+        optimizer.set_maxeval(20'000);
+    }else{
+        optimizer.set_ftol_rel(1.0E-8);
+        optimizer.set_xtol_rel(-HUGE_VAL);
+        optimizer.set_maxeval(500'000);
+    }
     double minf;
 
-    generate_dose_dist_stats = false;
     FUNCINFO("Beginning optimization now..")
-    nlopt::result nlopt_result = optimizer.optimize(open_weights, minf); // open_weights will contain the current-best weights on success.
+    nlopt::result nlopt_result = nlopt::FAILURE;
+    try{
+        nlopt_result = optimizer.optimize(open_weights, minf); // open_weights will contain the current-best weights on success.
+    }catch(const nlopt::roundoff_limited &){
+        // Gradient-based algorithms can stall where the cost is not smooth. The current-best weights are retained.
+        nlopt_result = nlopt::ROUNDOFF_LIMITED;
+    }
     FUNCINFO("Optimizer result: " << nlopt_result);
 #else // DCMA_USE_NLOPT
     FUNCERR("Unable to optimize -- nlopt was not used");
@@ -461,8 +416,22 @@ Drover OptimizeStaticBeams(Drover DICOM_data,
     std::transform(weights.begin(), weights.end(), 
                    weights.begin(), [=](double ow) -> double { return ow / sum; });
 
-    generate_dose_dist_stats = true;
-    const auto res = global_evaluate_weights(weights, global_working);
+    // Generate descriptive stats for the normalized dose distribution.
+    dose_dist_stats res;
+    {
+        std::vector<double> no_grad;
+        res.cost = objective.Evaluate(weights, no_grad);
+
+        const auto dose = objective.Normalized_Dose();
+        res.D_min  = 100.0 * Stats::Min(dose) / D_Rx;
+        res.D_max  = 100.0 * Stats::Max(dose) / D_Rx;
+        res.D_mean = 100.0 * Stats::Mean(dose) / D_Rx;
+        res.D_02   = Stats::Percentile(dose, 0.02);
+        res.D_05   = Stats::Percentile(dose, 0.05);
+        res.D_50   = Stats::Percentile(dose, 0.50);
+        res.D_95   = Stats::Percentile(dose, 0.95);
+        res.D_98   = Stats::Percentile(dose, 0.98);
+    }
 
     // Construct a summary.
     std::stringstream summary;
@@ -309,6 +309,7 @@ void Plot(const std::vector<Shuttle<samples_1D<T>>> &Shuttles,
 OperationDoc OpArgDocPlotLineSamples(){
     OperationDoc out;
     out.name = "PlotLineSamples";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This operation plots the selected line samples.";
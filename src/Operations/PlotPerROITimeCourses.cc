@@ -30,6 +30,7 @@
 OperationDoc OpArgDocPlotPerROITimeCourses(){
     OperationDoc out;
     out.name = "PlotPerROITimeCourses";
+    out.has_external_side_effects = true;
     out.desc = "Interactively plot time courses for the specified ROI(s).";
 
 
@@ -32,6 +32,7 @@
 OperationDoc OpArgDocPointSeparation(){
     OperationDoc out;
     out.name = "PointSeparation";
+    out.has_external_side_effects = true;
     out.desc = 
         "This operation estimates the minimum and maximum point-to-point separation between two point clouds."
         " It also computes the longest-nearest (Hausdorff) separation, i.e., the length of the longest lines from points in"
@@ -31,6 +31,7 @@
 #include "../Common_Plotting.h"
 #include "../Structs.h"
 #include "../Regex_Selectors.h"
+#include "../Slice_Renderer.h"
 #include "../YgorImages_Functors/Compute/AccumulatePixelDistributions.h"
 #include "PresentationImage.h"
 #include "YgorFilesDirs.h"    //Needed for Does_File_Exist_And_Can_Be_Read(...), etc..
@@ -47,6 +48,7 @@
 OperationDoc OpArgDocPresentationImage(){
     OperationDoc out;
     out.name = "PresentationImage";
+    out.has_external_side_effects = true;
     out.desc = "This operation renders an image with any contours in-place and colour mapping using an SFML backend.";
 
 
@@ -266,125 +268,18 @@ Drover PresentationImage(Drover DICOM_data,
             FUNCERR("Image dimensions are not reasonable. Is this a mistake? Refusing to continue");
         }
 
-        sf::Image animage;
-        animage.create(img_cols, img_rows);
-
-        //------------------------------------------------------------------------------------------------
-        //Apply a window to the data if it seems like the WindowCenter or WindowWidth specified in the image metadata
-        // are applicable. Note that it is likely that pixels will be clipped or truncated. This is intentional.
-        
-        auto img_win_valid = img_it->GetMetadataValueAs<std::string>("WindowValidFor");
-        auto img_desc      = img_it->GetMetadataValueAs<std::string>("Description");
-        auto img_win_c     = img_it->GetMetadataValueAs<double>("WindowCenter");
-        auto img_win_fw    = img_it->GetMetadataValueAs<double>("WindowWidth"); //Full width or range. (Diameter, not radius.)
-
-        auto custom_win_c  = custom_centre; 
-        auto custom_win_fw = custom_width; 
-
-        const auto UseCustomWL = (custom_win_c && custom_win_fw);
-        const auto UseImgWL = (UseCustomWL) ? false 
-                                            : (  img_win_valid && img_desc && img_win_c 
-                                              && img_win_fw && (img_win_valid.value() == img_desc.value()));
-
-        if( UseCustomWL || UseImgWL ){
-            //Window/linear scaling transformation parameters.
-            //const auto win_r = 0.5*(win_fw.value() - 1.0); //The 'radius' of the range, or half width omitting the centre point.
-
-            //The 'radius' of the range, or half width omitting the centre point.
-            const auto win_r  = (UseCustomWL) ? 0.5*custom_win_fw.value()
-                                              : 0.5*img_win_fw.value();
-            const auto win_c  = (UseCustomWL) ? custom_win_c.value()
-                                              : img_win_c.value();
-            const auto win_fw = (UseCustomWL) ? custom_win_fw.value()
-                                              : img_win_fw.value();
-
-            //The output range we are targeting. In this case, a commodity 8 bit (2^8 = 256 intensities) display.
-            const auto destmin = static_cast<double>( 0 );
-            const auto destmax = static_cast<double>( std::numeric_limits<uint8_t>::max() );
-    
-            for(auto i = 0; i < img_cols; ++i){
-                for(auto j = 0; j < img_rows; ++j){
-                    const auto val = static_cast<double>( img_it->value(j,i,0) ); //The first (R or gray) channel.
-                    if(!std::isfinite(val)){
-                        animage.setPixel(i,j,NaN_Color);
-                    }else{
-                        double x; // range = [0,1].
-                        if(val <= (win_c - win_r)){
-                            x = 0.0;
-                        }else if(val >= (win_c + win_r)){
-                            x = 1.0;
-                        }else{
-                            x = (val - (win_c - win_r)) / win_fw;
-                        }
-
-                        const auto res = colour_maps[colour_map].second(x);
-                        const double x_R = res.R;
-                        const double x_G = res.G;
-                        const double x_B = res.B;
-
-                        const double out_R = x_R * (destmax - destmin) + destmin;
-                        const double out_B = x_B * (destmax - destmin) + destmin;
-                        const double out_G = x_G * (destmax - destmin) + destmin;
-    
-                        const auto scaled_R = static_cast<uint8_t>( std::floor(out_R) );
-                        const auto scaled_G = static_cast<uint8_t>( std::floor(out_G) );
-                        const auto scaled_B = static_cast<uint8_t>( std::floor(out_B) );
-                        animage.setPixel(i,j,sf::Color(scaled_R,scaled_G,scaled_B));
-                    }
-                }
-            }
-
-        //------------------------------------------------------------------------------------------------
-        //Scale pixels to fill the maximum range. None will be clipped or truncated.
-        }else{
-            //Due to a strange dependence on windowing, some manufacturers spit out massive pixel values.
-            // If you don't want to window you need to anticipate and ignore the gigantic numbers being 
-            // you might encounter. This is not the place to do this! If you need to do it here, write a
-            // filter routine and *call* it from here.
-            //
-            // NOTE: This routine could definitely use a re-working, especially to make it safe for all
-            //       arithmetical types (i.e., handling negatives, ensuring there is no overflow or wrap-
-            //       around, ensuring there is minimal precision loss).
-            using pixel_value_t = decltype(img_it->value(0, 0, 0));
-            const auto pixel_minmax_allchnls = img_it->minmax();
-            const auto lowest = std::get<0>(pixel_minmax_allchnls);
-            const auto highest = std::get<1>(pixel_minmax_allchnls);
-
-            const auto pixel_type_max = static_cast<double>(std::numeric_limits<pixel_value_t>::max());
-            const auto pixel_type_min = static_cast<double>(std::numeric_limits<pixel_value_t>::min());
-            const auto dest_type_max = static_cast<double>(std::numeric_limits<uint8_t>::max()); //Min is implicitly 0.
-
-            const double clamped_low  = static_cast<double>(lowest )/pixel_type_max;
-            const double clamped_high = static_cast<double>(highest)/pixel_type_max;
-    
-            for(auto i = 0; i < img_cols; ++i){ 
-                for(auto j = 0; j < img_rows; ++j){ 
-                    const auto val = img_it->value(j,i,0);
-                    if(!std::isfinite(val)){
-                        animage.setPixel(i,j,NaN_Color);
-                    }else{
-                        const double clamped_value = (static_cast<double>(val) - pixel_type_min)/(pixel_type_max - pixel_type_min);
-                        const auto rescaled_value = (clamped_value - clamped_low)/(clamped_high - clamped_low);
-
-                        const auto res = colour_maps[colour_map].second(rescaled_value);
-                        const double x_R = res.R;
-                        const double x_G = res.G;
-                        const double x_B = res.B;
-                        
-                        const auto scaled_R = static_cast<uint8_t>(x_R * dest_type_max);
-                        const auto scaled_G = static_cast<uint8_t>(x_G * dest_type_max);
-                        const auto scaled_B = static_cast<uint8_t>(x_B * dest_type_max);
-                        animage.setPixel(i,j,sf::Color(scaled_R,scaled_G,scaled_B));
-                    }
-                }
-            }
-        }
-        
+        slice_render_settings s;
+        s.colour_map_name = colour_maps[colour_map].first;
+        s.colour_map      = colour_maps[colour_map].second;
+        s.window_centre   = custom_centre;
+        s.window_width    = custom_width;
+        s.nan_colour      = {{ NaN_Color.r, NaN_Color.g, NaN_Color.b, NaN_Color.a }};
+        const auto rendered = Render_Slice(*img_it, s);
 
         out.first = sf::Texture();
         out.second = sf::Sprite();
         if(!out.first.create(img_cols, img_rows)) FUNCERR("Unable to create empty SFML texture");
-        if(!out.first.loadFromImage(animage)) FUNCERR("Unable to create SFML texture from planar_image");
+        out.first.update(rendered.rgba.data());
         //out.first.setSmooth(true);        
         out.first.setSmooth(false);        
         out.second.setTexture(out.first);
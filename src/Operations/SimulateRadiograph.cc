@@ -56,6 +56,7 @@
 OperationDoc OpArgDocSimulateRadiograph(){
     OperationDoc out;
     out.name = "SimulateRadiograph";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This routine uses ray marching and volumetric sampling to simulate radiographs using a CT image array."
@@ -38,6 +38,7 @@
 OperationDoc OpArgDocSubsegment_ComputeDose_VanLuijk(){
     OperationDoc out;
     out.name = "Subsegment_ComputeDose_VanLuijk";
+    out.has_external_side_effects = true;
     out.desc = "This operation sub-segments the selected ROI(s) and computes dose within the resulting sub-segments.";
 
 
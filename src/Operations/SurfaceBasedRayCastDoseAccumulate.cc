@@ -126,6 +126,7 @@
 OperationDoc OpArgDocSurfaceBasedRayCastDoseAccumulate(){
     OperationDoc out;
     out.name = "SurfaceBasedRayCastDoseAccumulate";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This routine uses rays (actually: line segments) to estimate point-dose on the surface of an ROI. The ROI is "
@@ -37,6 +37,7 @@
 OperationDoc OpArgDocThresholdOtsu(){
     OperationDoc out;
     out.name = "ThresholdOtsu";
+    out.has_external_side_effects = true;
 
     out.desc = 
         "This routine performs Otsu thresholding (i.e., 'binarization') on an image volume."
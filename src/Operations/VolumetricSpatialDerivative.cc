@@ -1,6 +1,7 @@
 //VolumetricSpatialDerivative.cc - A part of DICOMautomaton 2019. Written by hal clark.
 
 #include <any>
+#include <cmath>
 #include <optional>
 #include <functional>
 #include <iterator>
@@ -68,25 +69,63 @@ OperationDoc OpArgDocVolumetricSpatialDerivative(){
                            " centred and use mirror boundary conditions. First-order estimators include the basic"
                            " nearest-neighbour first derivative and Sobel estimators."
                            " 'XxYxZ' denotes the size of the convolution kernel (i.e., the number of adjacent pixels"
-                           " considered).";
+                           " considered)."
+                           " The 'Gaussian' estimator computes derivatives of the Gaussian-smoothed image (see"
+                           " 'GaussianSigma') in DICOM units rather than pixel coordinates, accounting for the voxel"
+                           " dimensions along each axis. Beyond the image array the outermost voxels are repeated.";
     out.args.back().default_val = "Sobel-3x3x3";
     out.args.back().expected = true;
     out.args.back().examples = { "first",
-                                 "Sobel-3x3x3" };
+                                 "Sobel-3x3x3",
+                                 "Gaussian" };
     out.args.back().samples = OpArgSamples::Exhaustive;
 
 
     out.args.emplace_back();
     out.args.back().name = "Method";
     out.args.back().desc = "Controls partial derivative method. First-order derivatives can be row-, column-, or image-aligned,"
-                           " All methods also support magnitude (addition of orthogonal components in quadrature).";
+                           " All methods also support magnitude (addition of orthogonal components in quadrature)."
+                           " The 'Gaussian' estimator also supports the Laplacian (i.e., the Laplacian-of-Gaussian)"
+                           " and the Hessian. The Hessian leaves the selected image arrays intact and appends six new"
+                           " image arrays after each, holding the row-row, column-column, image-image, row-column,"
+                           " row-image, and column-image second derivatives.";
     out.args.back().default_val = "magnitude";
     out.args.back().expected = true;
     out.args.back().examples = { "row-aligned",
                                  "column-aligned",
                                  "image-aligned",
                                  "magnitude",
-                                 "non-maximum-suppression" };
+                                 "non-maximum-suppression",
+                                 "laplacian",
+                                 "hessian" };
+    out.args.back().samples = OpArgSamples::Exhaustive;
+
+
+    out.args.emplace_back();
+    out.args.back().name = "GaussianSigma";
+    out.args.back().desc = "The Gaussian sigma (in DICOM units; mm) used by the 'Gaussian' estimator."
+                           " Zero disables smoothing, in which case centred finite differences are used.";
+    out.args.back().default_val = "1.0";
+    out.args.back().expected = true;
+    out.args.back().examples = { "0.5",
+                                 "1.0",
+                                 "2.5",
+                                 "10.0" };
+
+
+    out.args.emplace_back();
+    out.args.back().name = "GaussianMethod";
+    out.args.back().desc = "Controls how the 'Gaussian' estimator is applied."
+                           " 'FIR' convolves with sampled kernels truncated at 4*sigma, so the cost grows with sigma."
+                           " 'IIR' uses a recursive approximation (Young and van Vliet) whose cost does not depend on"
+                           " sigma, followed by centred finite differences. It is only used when sigma is at least half"
+                           " a voxel."
+                           " 'auto' selects IIR when sigma spans three or more voxels along an axis, and FIR otherwise.";
+    out.args.back().default_val = "auto";
+    out.args.back().expected = true;
+    out.args.back().examples = { "auto",
+                                 "FIR",
+                                 "IIR" };
     out.args.back().samples = OpArgSamples::Exhaustive;
 
     return out;
@@ -107,16 +146,39 @@ Drover VolumetricSpatialDerivative(Drover DICOM_data,
 
     const auto EstimatorStr = OptArgs.getValueStr("Estimator").value();
     const auto MethodStr = OptArgs.getValueStr("Method").value();
+    const auto GaussianSigma = std::stod( OptArgs.getValueStr("GaussianSigma").value() );
+    const auto GaussianMethodStr = OptArgs.getValueStr("GaussianMethod").value();
 
     //-----------------------------------------------------------------------------------------------------------------
     const auto regex_1st = Compile_Regex("^fi?r?s?t?$");
     const auto regex_sob3x3x3 = Compile_Regex("^so?b?e?l?-?3x?3?x?3?$");
+    const auto regex_gauss = Compile_Regex("^ga?u?s?s?i?a?n?$");
 
     const auto regex_row  = Compile_Regex("^ro?w?-?a?l?i?g?n?e?d?$");
     const auto regex_col  = Compile_Regex("^col?u?m?n?-?a?l?i?g?n?e?d?$");
     const auto regex_img  = Compile_Regex("^im?a?g?e?-?a?l?i?g?n?e?d?$");
     const auto regex_mag  = Compile_Regex("^ma?g?n?i?t?u?d?e?$");
     const auto regex_nms  = Compile_Regex("^no?n?-?m?a?x?i?m?u?m?-?s?u?p?p?r?e?s?s?i?o?n?$");
+    const auto regex_lap  = Compile_Regex("^la?p?l?a?c?i?a?n?$");
+    const auto regex_hes  = Compile_Regex("^he?s?s?i?a?n?$");
+
+    const auto regex_auto = Compile_Regex("^au?t?o?m?a?t?i?c?$");
+    const auto regex_fir  = Compile_Regex("^fi?r?$");
+    const auto regex_iir  = Compile_Regex("^ii?r?$");
+
+    if( !std::isfinite(GaussianSigma) || (GaussianSigma < 0.0) ){
+        throw std::invalid_argument("GaussianSigma must be non-negative. Refusing to continue.");
+    }
+    gaussian_method filter_method = gaussian_method::automatic;
+    if( std::regex_match(GaussianMethodStr, regex_auto) ){
+        filter_method = gaussian_method::automatic;
+    }else if( std::regex_match(GaussianMethodStr, regex_fir) ){
+        filter_method = gaussian_method::fir;
+    }else if( std::regex_match(GaussianMethodStr, regex_iir) ){
+        filter_method = gaussian_method::iir;
+    }else{
+        throw std::invalid_argument("GaussianMethod argument '"_s + GaussianMethodStr + "' is not valid");
+    }
 
 
     auto cc_all = All_CCs( DICOM_data );
@@ -155,11 +217,15 @@ Drover VolumetricSpatialDerivative(Drover DICOM_data,
         ud.channel = Channel;
         ud.order = VolumetricSpatialDerivativeEstimator::first;
         ud.method = VolumetricSpatialDerivativeMethod::row_aligned;
+        ud.sigma = GaussianSigma;
+        ud.filter_method = filter_method;
 
         if( std::regex_match(EstimatorStr, regex_1st) ){
             ud.order = VolumetricSpatialDerivativeEstimator::first;
         }else if( std::regex_match(EstimatorStr, regex_sob3x3x3) ){
             ud.order = VolumetricSpatialDerivativeEstimator::Sobel_3x3x3;
+        }else if( std::regex_match(EstimatorStr, regex_gauss) ){
+            ud.order = VolumetricSpatialDerivativeEstimator::Gaussian;
         }else{
             throw std::invalid_argument("Estimator argument '"_s + EstimatorStr + "' is not valid");
         }
@@ -173,12 +239,27 @@ Drover VolumetricSpatialDerivative(Drover DICOM_data,
             ud.method = VolumetricSpatialDerivativeMethod::magnitude;
         }else if( std::regex_match(MethodStr, regex_nms) ){
             ud.method = VolumetricSpatialDerivativeMethod::non_maximum_suppression;
+        }else if( std::regex_match(MethodStr, regex_lap) ){
+            ud.method = VolumetricSpatialDerivativeMethod::laplacian;
+        }else if( std::regex_match(MethodStr, regex_hes) ){
+            ud.method = VolumetricSpatialDerivativeMethod::hessian;
         }else{
             throw std::invalid_argument("Method argument '"_s + MethodStr + "' is not valid");
         }
 
+        // Hessian components are written to copies of the image array, which are inserted after it.
+        std::list<std::reference_wrapper<planar_image_collection<float,double>>> external_imgs;
+        if(ud.method == VolumetricSpatialDerivativeMethod::hessian){
+            auto insert_it = std::next(iap_it);
+            for(long int i = 0; i < 6; ++i){
+                auto ia = std::make_shared<Image_Array>( *(*iap_it) );
+                external_imgs.push_back( std::ref(ia->imagecoll) );
+                DICOM_data.image_data.insert( insert_it, ia );
+            }
+        }
+
         if(!(*iap_it)->imagecoll.Compute_Images( ComputeVolumetricSpatialDerivative,
-                                                 {}, cc_ROIs, &ud )){
+                                                 external_imgs, cc_ROIs, &ud )){
             throw std::runtime_error("Unable to compute volumetric partial derivative.");
         }
     }
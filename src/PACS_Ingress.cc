@@ -1,9 +1,12 @@
 //PACS_Ingress.h - DICOMautomaton 2015. Written by hal clark.
 //
-//This program is suitable for importing individual DICOM files into a PACS-like database.
+//This program is suitable for importing DICOM files into a PACS-like database.
 // The modality and linkage is ignored for the purposes of ingress. Files can be properly
 // linked, queried, and further examined after they have been imported.
 //
+// Files can be imported individually, or in batches (e.g., entire directories or archives). Batch mode parses files
+// in parallel, checks for duplicates with a single bulk query, and inserts records in chunked transactions using COPY.
+//
 // Note that, because this program essentially just distills files down to a collection of
 // DICOM key-values, routines are tightly coupled with the DICOM parser. 
 //
@@ -13,26 +16,366 @@
     #error "Attempted to compile without PostgreSQL support, which is required."
 #endif
 
+#include <algorithm>
+#include <cstdint>
 #include <exception>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <list>
 #include <map>
 #include <pqxx/pqxx> //PostgreSQL C++ interface.
+#include <set>
+#include <sstream>
 #include <string>
 #include <tuple>
+#include <vector>
+
+#include <boost/filesystem.hpp>
 
 #include "Imebra_Shim.h"     //Wrapper for Imebra library. Black-boxed to speed up compilation.
+#include "Thread_Pool.h"
 #include "YgorArguments.h"
 #include "YgorFilesDirs.h"
 #include "YgorMisc.h"           //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
 #include "YgorString.h"         //Needed for stringtoX(), X_to_string().
 
+
+// Figure out a reasonable place to keep the file in the filesystem store. It isn't so important except to be reasonably
+// human-readable, fairly balanced in the filesystem, and not already present.
+struct store_location {
+    std::string NewFullDir;            //Not the full path, just the complete directory.
+    std::string StoreFullPathName;
+    std::string StoreGDCMDumpFileName;
+};
+
+static
+bool Determine_Store_Location( std::map<std::string,std::string> &mmap,
+                               const std::string &DICOMFileSystemStoreBase,
+                               store_location &loc ){
+    const auto StudyInstanceUID  = mmap["StudyInstanceUID"];
+    const auto StudyDate         = mmap["StudyDate"];
+    const auto StudyTime         = mmap["StudyTime"];
+    const auto SeriesInstanceUID = mmap["SeriesInstanceUID"];
+    const auto SeriesNumber      = mmap["SeriesNumber"];
+    const auto SOPInstanceUID    = mmap["SOPInstanceUID"];
+
+    if(StudyInstanceUID.empty()  || StudyDate.empty()    || StudyTime.empty() 
+    || SeriesInstanceUID.empty() || SeriesNumber.empty() || SOPInstanceUID.empty() ){
+        return false;
+    }
+
+    const auto TopDirName = Detox_String(StudyDate) + "-"_s
+                          + Detox_String(StudyTime) + "_"_s
+                          + Detox_String(StudyInstanceUID);
+
+    const auto MidDirName = Detox_String(SeriesNumber) + "-"_s
+                          + Detox_String(SeriesInstanceUID);
+
+    loc.NewFullDir = DICOMFileSystemStoreBase + "/"_s
+                   + TopDirName + "/"_s
+                   + MidDirName + "/";
+
+    loc.StoreFullPathName = loc.NewFullDir + Detox_String(SOPInstanceUID) + ".dcm";
+    loc.StoreGDCMDumpFileName = loc.NewFullDir + Detox_String(SOPInstanceUID) + ".gdcmdump";
+    return true;
+}
+
+
+// ------------------------------------------------ Batch ingress ------------------------------------------------
+
+struct batch_ingress_file {
+    std::string DICOMFile;
+    std::string FullPathName;
+    std::map<std::string,std::string> mmap;
+    store_location loc;
+    bool valid = false;
+};
+
+struct batch_ingress_params {
+    std::string db_params;
+    std::string DICOMFileSystemStoreBase;
+    std::string Project;
+    std::string Comments;
+    std::string JournalFile;
+    long int ChunkSize = 1000;
+    bool dryrun = false;
+    bool verbose = false;
+};
+
+// Recursively expands directories and reads file lists (one file per line) into a list of files.
+static
+std::vector<std::string> Enumerate_Batch_Files( const std::list<std::string> &Files,
+                                                const std::list<std::string> &Dirs,
+                                                const std::list<std::string> &FileLists ){
+    std::vector<std::string> out(Files.begin(), Files.end());
+
+    for(const auto &d : Dirs){
+        for(const auto &e : boost::filesystem::recursive_directory_iterator(d)){
+            if(!boost::filesystem::is_regular_file(e.path())) continue;
+            if(e.path().extension() == ".gdcmdump") continue; // Sidecars are handled alongside their DICOM file.
+            out.emplace_back(e.path().string());
+        }
+    }
+
+    for(const auto &l : FileLists){
+        std::ifstream fi(l);
+        if(!fi) FUNCERR("Unable to read file list '" << l << "'. Cannot continue");
+        std::string line;
+        while(std::getline(fi, line)){
+            if(!line.empty() && (line.back() == '\r')) line.pop_back();
+            if(!line.empty()) out.emplace_back(line);
+        }
+    }
+    return out;
+}
+
+// Ingests many files at once. Returns the number of files that could not be ingested.
+//
+// Files are processed in chunks. Each chunk is placed into the filesystem store in parallel and then registered in the
+// database in a single transaction. When a chunk is committed its files are recorded in the (optional) journal, so an
+// interrupted batch can be resumed by re-running the same command: files already recorded are skipped.
+static
+long int Batch_Ingress( const batch_ingress_params &params,
+                        const std::vector<std::string> &InputFiles ){
+
+    // Load the journal, if present.
+    std::set<std::string> completed;
+    if(!params.JournalFile.empty()){
+        std::ifstream fi(params.JournalFile);
+        std::string line;
+        while(std::getline(fi, line)){
+            if(!line.empty()) completed.insert(line);
+        }
+        if(!completed.empty()) FUNCINFO("Resuming: " << completed.size() << " files previously ingested will be skipped");
+    }
+    std::ofstream journal;
+    if(!params.JournalFile.empty() && !params.dryrun){
+        journal.open(params.JournalFile, std::ios::out | std::ios::app);
+        if(!journal) FUNCERR("Unable to open journal file '" << params.JournalFile << "'. Cannot continue");
+    }
+    const auto record_completed = [&](const std::string &FullPathName){
+        if(journal.is_open()) journal << FullPathName << "\n";
+    };
+
+    std::vector<batch_ingress_file> files;
+    {
+        std::set<std::string> seen;
+        for(const auto &f : InputFiles){
+            const auto FullPathName = Fully_Expand_Filename(f);
+            if( (completed.count(FullPathName) != 0) 
+            ||  !seen.insert(FullPathName).second ) continue;
+            files.emplace_back();
+            files.back().DICOMFile = f;
+            files.back().FullPathName = FullPathName;
+        }
+    }
+    FUNCINFO("Ingesting " << files.size() << " files");
+    long int N_failed = 0;
+
+    // Parse metadata in parallel.
+    {
+        asio_thread_pool tp;
+        for(auto &f : files){
+            tp.submit_task([&f,&params]() -> void {
+                try{
+                    auto mmap = get_metadata_top_level_tags(f.DICOMFile);
+                    f.valid = Determine_Store_Location(mmap, params.DICOMFileSystemStoreBase, f.loc);
+
+                    // Only retain the metadata needed for registration, since many files may be held in memory.
+                    for(const auto &key : { "PatientID", "StudyInstanceUID", "SeriesInstanceUID", "SOPInstanceUID" }){
+                        f.mmap[key] = mmap[key];
+                    }
+                }catch(const std::exception &){
+                    f.valid = false;
+                }
+            });
+        }
+    }
+    for(const auto &f : files){
+        if(!f.valid){
+            FUNCWARN("File '" << f.DICOMFile << "' is missing information and cannot be imported into the database");
+            ++N_failed;
+        }
+    }
+
+    //----------------------------- Determine if records already exist ----------------------------------
+    // Duplicates within the batch are identified in memory. Duplicates already in the database are identified using a
+    // single query against a temporary table of candidate keys.
+    using key_t = std::tuple<std::string,std::string,std::string,std::string>;
+    const auto make_key = [](std::map<std::string,std::string> &mmap) -> key_t {
+        return key_t( mmap["PatientID"], mmap["StudyInstanceUID"], mmap["SeriesInstanceUID"], mmap["SOPInstanceUID"] );
+    };
+
+    std::set<key_t> existing;
+    {
+        pqxx::connection c(params.db_params);
+        pqxx::work txn(c);
+        txn.exec("CREATE TEMPORARY TABLE dcma_ingress_keys ( "
+                 "    PatientID TEXT, StudyInstanceUID TEXT, SeriesInstanceUID TEXT, SOPInstanceUID TEXT "
+                 ") ON COMMIT DROP;");
+        {
+            pqxx::stream_to stream(txn, "dcma_ingress_keys",
+                                   std::vector<std::string>{ "PatientID", "StudyInstanceUID",
+                                                             "SeriesInstanceUID", "SOPInstanceUID" });
+            for(auto &f : files){
+                if(f.valid) stream << make_key(f.mmap);
+            }
+            stream.complete();
+        }
+        const auto r = txn.exec("SELECT DISTINCT k.PatientID, k.StudyInstanceUID, k.SeriesInstanceUID, k.SOPInstanceUID "
+                                "FROM dcma_ingress_keys AS k "
+                                "INNER JOIN metadata AS m ON "
+                                "    ( m.PatientID         = k.PatientID ) "
+                                "AND ( m.StudyInstanceUID  = k.StudyInstanceUID ) "
+                                "AND ( m.SeriesInstanceUID = k.SeriesInstanceUID ) "
+                                "AND ( m.SOPInstanceUID    = k.SOPInstanceUID );");
+        for(pqxx::result::size_type i = 0; i != r.size(); ++i){
+            existing.emplace( r[i][0].as<std::string>(), r[i][1].as<std::string>(),
+                              r[i][2].as<std::string>(), r[i][3].as<std::string>() );
+        }
+        txn.commit();
+    }
+
+    std::vector<batch_ingress_file *> pending;
+    {
+        std::set<key_t> batch_keys;
+        for(auto &f : files){
+            if(!f.valid) continue;
+            const auto key = make_key(f.mmap);
+            if( (existing.count(key) != 0)
+            ||  !batch_keys.insert(key).second ){
+                if(params.verbose) FUNCINFO("Conflicting file '" << f.DICOMFile << "' already present. Treating as a duplicate and NOT ingressing");
+                record_completed(f.FullPathName);
+                continue;
+            }
+            pending.emplace_back(&f);
+        }
+    }
+    journal.flush();
+    FUNCINFO(pending.size() << " files are not duplicates and will be ingested");
+
+    //-------------------------------------- Import the files ---------------------------------------------
+    pqxx::connection c(params.db_params);
+    const auto chunk_size = std::max<long int>(1, params.ChunkSize);
+    for(size_t chunk_begin = 0; chunk_begin < pending.size(); chunk_begin += chunk_size){
+        const auto chunk_end = std::min(pending.size(), chunk_begin + static_cast<size_t>(chunk_size));
+
+        // Place the files into the store. Directories are created serially to avoid races, then files are copied in
+        // parallel.
+        std::vector<uint8_t> placed(chunk_end - chunk_begin, 1);
+        if(!params.dryrun){
+            std::set<std::string> dirs;
+            for(size_t i = chunk_begin; i < chunk_end; ++i) dirs.insert(pending[i]->loc.NewFullDir);
+            for(const auto &d : dirs){
+                if(!Does_Dir_Exist_And_Can_Be_Read(d) && !Create_Dir_and_Necessary_Parents(d)){
+                    FUNCERR("Unable to create directory '" << d << "'. Cannot continue");
+                }
+            }
+
+            asio_thread_pool tp;
+            for(size_t i = chunk_begin; i < chunk_end; ++i){
+                tp.submit_task([&,i]() -> void {
+                    const auto &f = *(pending[i]);
+                    if(!CopyFile(f.DICOMFile, f.loc.StoreFullPathName)){
+                        placed[i - chunk_begin] = 0;
+                        return;
+                    }
+                    // Include the output from `gdcmdump` if a sidecar file is available.
+                    const auto GDCMDumpFile = f.DICOMFile + ".gdcmdump";
+                    if(Does_File_Exist_And_Can_Be_Read(GDCMDumpFile)){
+                        CopyFile(GDCMDumpFile, f.loc.StoreGDCMDumpFileName);
+                    }
+                });
+            }
+        }
+
+        // Register the chunk. Records are streamed into a staging table and then moved into the metadata table in a
+        // single statement, which assigns pacsids and performs the same conversions as single-file ingress.
+        try{
+            pqxx::work txn(c);
+            txn.exec("CREATE TEMPORARY TABLE dcma_ingress_staging ( "
+                     "    pacsid BIGINT, "
+                     "    PatientID TEXT, StudyInstanceUID TEXT, SeriesInstanceUID TEXT, SOPInstanceUID TEXT, "
+                     "    Project TEXT, Comments TEXT, FullPathName TEXT, StoreFullPathName TEXT "
+                     ") ON COMMIT DROP;");
+            long int N_staged = 0;
+            {
+                pqxx::stream_to stream(txn, "dcma_ingress_staging",
+                                       std::vector<std::string>{ "PatientID", "StudyInstanceUID", "SeriesInstanceUID",
+                                                                 "SOPInstanceUID", "Project", "Comments",
+                                                                 "FullPathName", "StoreFullPathName" });
+                for(size_t i = chunk_begin; i < chunk_end; ++i){
+                    auto &f = *(pending[i]);
+                    if(placed[i - chunk_begin] == 0){
+                        FUNCWARN("Unable to copy file '" << f.DICOMFile << "' to filesystem store destination '"
+                                 << f.loc.StoreFullPathName << "'. Skipping it");
+                        ++N_failed;
+                        continue;
+                    }
+                    stream << std::make_tuple( f.mmap["PatientID"], f.mmap["StudyInstanceUID"],
+                                               f.mmap["SeriesInstanceUID"], f.mmap["SOPInstanceUID"],
+                                               params.Project, params.Comments,
+                                               f.FullPathName, f.loc.StoreFullPathName );
+                    ++N_staged;
+                }
+                stream.complete();
+            }
+
+            //Don't worry about iterating the nidus unnecessarily. There is plenty of room to skip ids, and we can
+            // always squash holes at a later time (as required).
+            txn.exec("UPDATE dcma_ingress_staging SET pacsid = nextval('pacsid_nidus_seq');");
+            txn.exec("INSERT INTO pacsid_nidus (pacsid) SELECT pacsid FROM dcma_ingress_staging;");
+            const auto r = txn.exec("INSERT INTO metadata ( "
+                                    "    pacsid, PatientID, StudyInstanceUID, SeriesInstanceUID, SOPInstanceUID, "
+                                    "    Project, Comments, FullPathName, ImportTimepoint, StoreFullPathName "
+                                    ") SELECT "
+                                    "    pacsid, "
+                                    "    NULLIF(PatientID,''), NULLIF(StudyInstanceUID,''), "
+                                    "    NULLIF(SeriesInstanceUID,''), NULLIF(SOPInstanceUID,''), "
+                                    "    NULLIF(Project,''), NULLIF(Comments,''), NULLIF(FullPathName,''), "
+                                    "    now(), StoreFullPathName "
+                                    "FROM dcma_ingress_staging;");
+            if(r.affected_rows() != static_cast<pqxx::result::size_type>(N_staged)){
+                throw std::runtime_error("DB insertion affected "_s + std::to_string(r.affected_rows())
+                                         + " rows instead of " + std::to_string(N_staged));
+            }
+
+            if(params.dryrun){
+                txn.abort();
+            }else{
+                txn.commit();
+                for(size_t i = chunk_begin; i < chunk_end; ++i){
+                    if(placed[i - chunk_begin] != 0) record_completed(pending[i]->FullPathName);
+                }
+                journal.flush();
+            }
+
+        }catch(const std::exception &e){
+            //Files copied into the store for this chunk are left in place. They will be overwritten when the batch
+            // is resumed.
+            FUNCERR("Unable to push chunk to database:\n" << e.what() << "\n" << "Cannot continue");
+        }
+
+        FUNCINFO("Ingested " << chunk_end << "/" << pending.size() << " files");
+    }
+
+    if(params.dryrun && params.verbose) FUNCINFO("Dry run successful. No errors encountered");
+    return N_failed;
+}
+
+
 int main(int argc, char **argv){
     //std::string db_params("dbname=pacs user=hal host=localhost port=63443");
     std::string db_params("dbname=pacs user=hal host=localhost");
     std::string DICOMFileSystemStoreBase("/home/pacs_store");
     std::string DICOMFile;  //The filename to use.
+    std::list<std::string> BatchFiles;     //Files to ingest in batch mode.
+    std::list<std::string> BatchDirs;      //Directories to (recursively) ingest in batch mode.
+    std::list<std::string> BatchFileLists; //Files containing lists of files to ingest in batch mode.
+    std::string JournalFile;               //Batch mode progress journal, used to resume interrupted batches.
+    long int ChunkSize = 1000;             //Number of files to ingest per transaction in batch mode.
+    bool batch = false;                    //Whether to ingest many files at once.
     std::string Project;    //Human-readable project of data origin. MSc, PhD, Special_Project_...
     std::string Comments;   //Human-readable general comments.
     std::string GDCMDump;   //Text of executing `gdcmdump` if available.
@@ -50,7 +393,10 @@ int main(int argc, char **argv){
                         " the database and various bits of data will be deciphered.          ";
 
     arger.examples = { { " -f '/tmp/a.dcm' -g '/tmp/a.gdcmdump' -p 'XYZ Study 2017' -c 'Bulk insert for XYZ.'" ,
-                         "Insert the file '/tmp/a.dcm' into the database." } 
+                         "Insert the file '/tmp/a.dcm' into the database." },
+                       { " -B -D '/archive/' -j '/tmp/archive.journal' -p 'XYZ Study 2017' -c 'Bulk insert for XYZ.'" ,
+                         "Insert all files within the directory '/archive/' into the database. If interrupted, re-running"
+                         " the same command will resume where it left off." }
     };
     //----
 
@@ -58,20 +404,15 @@ int main(int argc, char **argv){
         FUNCERR("Unrecognized option with argument: '" << optarg << "'");
     };
     arger.optionless_callback = [&](const std::string &optarg) -> void {
-        if(!DICOMFile.empty()){
-            FUNCERR("This program can only handle a single file at a time."
-                    " Earlier file: '" << DICOMFile << "'. This file: '" << optarg << "'");
-        }
-        DICOMFile = optarg;
+        BatchFiles.push_back(optarg);
         return;
     };
     //----
 
     arger.push_back( std::make_tuple(1, 'f', "dicom-file", true, "/tmp/a",
-                                     "(req'd) The DICOM file to use.",
+                                     "(req'd) The DICOM file to use. May be provided multiple times in batch mode.",
                                      [&](const std::string &optarg) -> void {
-        if(!DICOMFile.empty()) FUNCERR("This program can only handle a single file at a time");
-        DICOMFile = optarg;
+        BatchFiles.push_back(optarg);
         return;
     }));
     arger.push_back( std::make_tuple(2, 'p', "project", true, "MSc",
@@ -105,6 +446,44 @@ int main(int argc, char **argv){
         verbose = true;
         return;
     }));
+    arger.push_back( std::make_tuple(4, 'B', "batch", false, "",
+                                     "Ingest many files at once. Files are parsed in parallel and registered in chunked"
+                                     " transactions. A 'gdcmdump' file is not required, but if a sidecar file with the"
+                                     " suffix '.gdcmdump' is present alongside a DICOM file, it will be stored too.",
+                                     [&](const std::string &optarg) -> void {
+        batch = true;
+        return;
+    }));
+    arger.push_back( std::make_tuple(4, 'D', "directory", true, "/archive/",
+                                     "(batch mode) A directory to recursively search for files to ingest.",
+                                     [&](const std::string &optarg) -> void {
+        if(!Does_Dir_Exist_And_Can_Be_Read(optarg)) FUNCERR("Cannot access directory '" << optarg << "'");
+        BatchDirs.push_back(optarg);
+        batch = true;
+        return;
+    }));
+    arger.push_back( std::make_tuple(4, 'l', "file-list", true, "/tmp/files.txt",
+                                     "(batch mode) A file containing a list of files to ingest, one per line.",
+                                     [&](const std::string &optarg) -> void {
+        BatchFileLists.push_back(optarg);
+        batch = true;
+        return;
+    }));
+    arger.push_back( std::make_tuple(4, 'j', "journal", true, "/tmp/ingress.journal",
+                                     "(batch mode) A progress journal. Successfully ingested (and duplicate) files are"
+                                     " appended as each transaction is committed. Files listed in the journal are"
+                                     " skipped, so an interrupted batch can be resumed by re-running the same command.",
+                                     [&](const std::string &optarg) -> void {
+        JournalFile = optarg;
+        return;
+    }));
+    arger.push_back( std::make_tuple(4, 'k', "chunk-size", true, "1000",
+                                     "(batch mode) The number of files to register per database transaction.",
+                                     [&](const std::string &optarg) -> void {
+        ChunkSize = std::stol(optarg);
+        if(ChunkSize <= 0) FUNCERR("Chunk size must be positive");
+        return;
+    }));
     arger.push_back( std::make_tuple(1, 'b', "store-base", true, DICOMFileSystemStoreBase,
                                      "The root of the DB file storage directory.",
                                      [&](const std::string &optarg) -> void {
@@ -115,9 +494,45 @@ int main(int argc, char **argv){
 
     arger.Launch(argc, argv);
 
+    //---------------------------------------------------------------------------------------------------------
+    //--------------------------------------------- Batch Mode ------------------------------------------------
+    //---------------------------------------------------------------------------------------------------------
+    if(batch){
+        if(Project.empty())   FUNCERR("The 'project' string is mandatory. Cannot continue");
+        if(Comments.empty())  FUNCERR("The 'comments' string is mandatory. Cannot continue");
+        if(!GDCMDump.empty()) FUNCERR("A single 'gdcmdump' file cannot be used in batch mode. Provide sidecar files instead");
+
+        batch_ingress_params params;
+        params.db_params = db_params;
+        params.DICOMFileSystemStoreBase = DICOMFileSystemStoreBase;
+        params.Project = Project;
+        params.Comments = Comments;
+        params.JournalFile = JournalFile;
+        params.ChunkSize = ChunkSize;
+        params.dryrun = dryrun;
+        params.verbose = verbose;
+
+        long int N_failed = 0;
+        try{
+            const auto InputFiles = Enumerate_Batch_Files(BatchFiles, BatchDirs, BatchFileLists);
+            N_failed = Batch_Ingress(params, InputFiles);
+        }catch(const std::exception &e){
+            FUNCERR("Batch ingress failed:\n" << e.what() << "\n" << "Cannot continue");
+        }
+        if(N_failed != 0){
+            FUNCWARN(N_failed << " files could not be ingested");
+            return 1;
+        }
+        return 0;
+    }
+
     //---------------------------------------------------------------------------------------------------------
     //--------------------------------------- Requirement Verification ----------------------------------------
     //---------------------------------------------------------------------------------------------------------
+    if(1 < BatchFiles.size()){
+        FUNCERR("This program can only handle a single file at a time, unless batch mode is used");
+    }
+    if(!BatchFiles.empty()) DICOMFile = BatchFiles.front();
     if(DICOMFile.empty()) FUNCERR("Cannot read DICOM file '" << DICOMFile << "'. Cannot continue");
     if(Project.empty())   FUNCERR("The 'project' string is mandatory. Cannot continue");
     if(Comments.empty())  FUNCERR("The 'comments' string is mandatory. Cannot continue");
@@ -129,36 +544,13 @@ int main(int argc, char **argv){
     //Process the file.
     auto mmap = get_metadata_top_level_tags(DICOMFile);
 
-    //Figure out a reasonable place to keep the file in the filesystem store. It isn't so important except to
-    // be reasonably human-readable, fairly balanced in the filesystem, and not already present.
-    const auto StudyInstanceUID  = mmap["StudyInstanceUID"];
-    const auto StudyDate         = mmap["StudyDate"];
-    const auto StudyTime         = mmap["StudyTime"];
-    const auto SeriesInstanceUID = mmap["SeriesInstanceUID"];
-    const auto SeriesNumber      = mmap["SeriesNumber"];
-    const auto SOPInstanceUID    = mmap["SOPInstanceUID"];
-
-    if(StudyInstanceUID.empty()  || StudyDate.empty()    || StudyTime.empty() 
-    || SeriesInstanceUID.empty() || SeriesNumber.empty() || SOPInstanceUID.empty() ){
+    store_location loc;
+    if(!Determine_Store_Location(mmap, DICOMFileSystemStoreBase, loc)){
         FUNCERR("File is '" << DICOMFile << "' missing information and cannot be imported into the database");
     }
-
-    const auto TopDirName = Detox_String(StudyDate) + "-"_s
-                          + Detox_String(StudyTime) + "_"_s
-                          + Detox_String(StudyInstanceUID);
-
-    const auto MidDirName = Detox_String(SeriesNumber) + "-"_s
-                          + Detox_String(SeriesInstanceUID);
-
-    const auto NewFullDir = DICOMFileSystemStoreBase + "/"_s
-                          + TopDirName + "/"_s
-                          + MidDirName + "/";    //Not the full path, just the complete directory.
-
-    const auto NewFileName = Detox_String(SOPInstanceUID) + ".dcm";
-    const auto StoreFullPathName = NewFullDir + NewFileName;
-
-    const auto NewGDCMDumpFileName = Detox_String(SOPInstanceUID) + ".gdcmdump";
-    const auto StoreGDCMDumpFileName = NewFullDir + NewGDCMDumpFileName;
+    const auto NewFullDir = loc.NewFullDir;
+    const auto StoreFullPathName = loc.StoreFullPathName;
+    const auto StoreGDCMDumpFileName = loc.StoreGDCMDumpFileName;
 
     //---------------------------------------------------------------------------------------------------------
     //----------------------------------------- Database Registration -----------------------------------------
@@ -9,13 +9,20 @@
 #endif
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <cctype>
+#include <condition_variable>
 #include <exception>
 #include <fstream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <set> 
+#include <sstream>
 #include <string>    
+#include <thread>
 //#include <cfenv>              //Needed for std::feclearexcept(FE_ALL_EXCEPT).
 
 #include <algorithm>
@@ -25,20 +32,62 @@
 #include "Explicator.h"       //Needed for Explicator class.
 #include "Imebra_Shim.h"      //Wrapper for Imebra library. Black-boxed to speed up compilation.
 #include "Structs.h"
+#include "Thread_Pool.h"
 #include "YgorFilesDirs.h"    //Needed for Does_File_Exist_And_Can_Be_Read(...), etc..
 #include "YgorImages.h"
 #include "YgorMath.h"         //Needed for vec3 class.
 #include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+#include "YgorString.h"       //Needed for the _s string literal suffix.
 
 
+// A single file selected by the filter query, along with whatever was decoded from it.
+//
+// Rows are extracted from the query result on the main thread, decoded concurrently, and then consumed in query order
+// on the main thread so that the loaded data does not depend on scheduling.
+struct pacs_loader_file {
+    std::string StoreFullPathName;
+    std::string Modality;
+    std::optional<std::string> dt;
+    std::optional<std::string> FrameOfReferenceUID;
+
+    std::unique_ptr<Contour_Data> contour_data;
+    std::shared_ptr<Image_Array> img_arr;
+    bool failed = false; // Decoding failed in a recoverable way. The file is skipped.
+
+    bool ready = false; // Guarded by the loader's mutex.
+};
+
+static
+void Decode_PACS_File(pacs_loader_file &f){
+    //Parse the file and/or try load the data. If we cannot ascertain the type then we will treat it as an image and
+    // hope it can be loaded.
+    try{
+        if(boost::iequals(f.Modality,"RTSTRUCT")){
+            f.contour_data = get_Contour_Data(f.StoreFullPathName);
+        }else if(boost::iequals(f.Modality,"RTDOSE")){
+            f.img_arr = Load_Dose_Array(f.StoreFullPathName);
+        }else{ //Image loading. 'CT' and 'MR' should work. Not sure about others.
+            f.img_arr = Load_Image_Array(f.StoreFullPathName);
+        }
+    }catch(const std::exception &e){
+        FUNCWARN("Difficulty encountered while loading '" << f.StoreFullPathName << "': '" << e.what() <<
+                 "'. Ignoring file and continuing");
+        f.failed = true;
+    }
+    return;
+}
+
+// Strips trailing whitespace and semicolons. If the remainder is a single statement, it can be wrapped in a cursor.
 static
-std::unique_ptr<Contour_Data> 
-Concatenate_Contour_Data(std::unique_ptr<Contour_Data> A,
-                         std::unique_ptr<Contour_Data> B){
-    //This routine concatenates A and B's contour collections. No internal checking is performed.
-    // No copying is performed, but A and B are consumed. A is returned as if it were a new pointer.
-    A->ccs.splice( A->ccs.end(), std::move(B->ccs) );
-    return A;
+std::optional<std::string> Cursorable_Query(std::string query){
+    while(!query.empty()
+    &&    ( std::isspace(static_cast<unsigned char>(query.back()))
+         || (query.back() == ';') ) ){
+        query.pop_back();
+    }
+    if(query.empty()
+    || (query.find(';') != std::string::npos)) return {};
+    return query;
 }
 
 
@@ -46,13 +95,17 @@ bool Load_From_PACS_DB( Drover &DICOM_data,
                         std::map<std::string,std::string> & /* InvocationMetadata */,
                         const std::string &FilenameLex,
                         std::string &db_connection_params,
-                        std::list<std::list<std::string>> &GroupedFilterQueryFiles ){
+                        std::list<std::list<std::string>> &GroupedFilterQueryFiles,
+                        long int max_in_flight ){
 
     std::set<std::string> FrameOfReferenceUIDs;
 
     FUNCINFO("Executing database queries...");
 
-
+    if(max_in_flight <= 0){
+        max_in_flight = 2 * std::max<long int>(1, std::thread::hardware_concurrency());
+    }
+    const long int fetch_size = std::max<long int>(64, max_in_flight);
 
     //Prepare separate storage space for each of the groups of filter query files. We keep them segregated based on the
     // user's grouping of input query files. This allows us to work on several distinct data sets per invocation, if
@@ -63,127 +116,192 @@ bool Load_From_PACS_DB( Drover &DICOM_data,
     std::list<loaded_dose_storage_t> loaded_dose_storage;
     std::shared_ptr<Contour_Data> loaded_contour_data_storage = std::make_shared<Contour_Data>();
 
+    // A single connection is used for all queries. Each group gets its own transaction.
+    std::unique_ptr<pqxx::connection> c;
+
     try{
+        c = std::make_unique<pqxx::connection>(db_connection_params);
+
         //Loop over each group of filter query files.
         for(const auto &FilterQueryFiles : GroupedFilterQueryFiles){
             loaded_imgs_storage.emplace_back();
             loaded_dose_storage.emplace_back();
 
-            //Unfortunately, it seems one cannot reset or deactivate/reactivate a connection. So we are forced to 
-            // start anew each time.
-            //
-            // Also note that the libpqxx documentaton states that transactional connections are required if using
-            // PostgreSQL large files.
-            //
-            pqxx::connection c(db_connection_params);
-            pqxx::work txn(c);
+            //Note that the libpqxx documentaton states that transactional connections are required if using
+            // PostgreSQL large files. Cursors also require a transaction.
+            pqxx::work txn(*c);
 
             //-------------------------------------------------------------------------------------------------------------
             //Query1 stage: select records from the system pacs database.
             //
-            //Whatever is in the file(s), let the database figure out if they're legal and valid.
-            pqxx::result r1;
-     
+            //Whatever is in the file(s), let the database figure out if they're legal and valid. All but the final query
+            // are executed eagerly. The final query, which should return full metadata records, is streamed via a
+            // cursor if it consists of a single statement.
             std::stringstream ss;
-            for(const auto &FilterQueryFile : FilterQueryFiles){ 
-                ss << "'" << FilterQueryFile << "'"; //Save the names in case something goes wrong.
-                const auto query1 = LoadFileToString(FilterQueryFile);
-                r1 = txn.exec(query1);
+            std::string final_query;
+            for(auto f_it = FilterQueryFiles.begin(); f_it != FilterQueryFiles.end(); ++f_it){
+                ss << "'" << *f_it << "'"; //Save the names in case something goes wrong.
+                const auto query1 = LoadFileToString(*f_it);
+                if(std::next(f_it) == FilterQueryFiles.end()){
+                    final_query = query1;
+                }else{
+                    txn.exec(query1);
+                }
             }
-            if(r1.empty()){
-                FUNCWARN("Database query1 stage " << ss.str() << " resulted in no records. Cannot continue");
-                return false;
+
+            const auto cursor_query = Cursorable_Query(final_query);
+            pqxx::result r1;
+            if(cursor_query){
+                txn.exec("DECLARE dcma_pacs_loader_cursor NO SCROLL CURSOR FOR " + cursor_query.value() + ";");
+            }else{
+                r1 = txn.exec(final_query);
             }
-    
-    
-            //-------------------------------------------------------------------------------------------------------------
-            FUNCINFO("Query1 stage: number of records found = " << r1.size());
-    
+
             //-------------------------------------------------------------------------------------------------------------
             //Query2 stage: process each record, loading whatever data is needed later into memory.
-            for(pqxx::result::size_type i = 0; i != r1.size(); ++i){
-                FUNCINFO("Parsing file #" << i+1 << "/" << r1.size() << " = " << 100*(i+1)/r1.size() << "%");
-
-                //Get the returned pacsid.
-                //const auto pacsid = r1[i]["pacsid"].as<long int>();
-                const auto StoreFullPathName = (r1[i]["StoreFullPathName"].is_null()) ? 
-                                               "" : r1[i]["StoreFullPathName"].as<std::string>();
-
-                //Parse the file and/or try load the data. Push it into the list (we can collate later).
-                // If we cannot ascertain the type then we will treat it as an image and hope it can be loaded.
-                const auto Modality = r1[i]["Modality"].as<std::string>();
-                if(boost::iequals(Modality,"RTSTRUCT")){
-                    const auto preloadcount = loaded_contour_data_storage->ccs.size();
-                    try{
-                        auto combined = Concatenate_Contour_Data( loaded_contour_data_storage->Duplicate(),
-                                                                  get_Contour_Data(StoreFullPathName));
-                        loaded_contour_data_storage = std::move(combined);
-                    }catch(const std::exception &e){
-                        FUNCWARN("Difficulty encountered during contour data loading: '" << e.what() <<
-                                 "'. Ignoring file and continuing");
-                        //loaded_contour_data_storage.back().pop_back();
-                        continue;
+            //
+            // Rows are fetched in batches and files are decoded concurrently, but no more than 'max_in_flight' decoded
+            // files are held at once. Files are consumed in the order they were returned by the query.
+            std::mutex m;
+            std::condition_variable cv;
+            long int in_flight = 0;
+            long int N_rows = 0;
+            long int N_consumed = 0;
+            std::string fatal_error;
+
+            std::list<pacs_loader_file> files;
+
+            const auto consume_ready = [&](bool wait_for_all) -> void {
+                while(true){
+                    {
+                        std::unique_lock<std::mutex> lock(m);
+                        if(files.empty()) return;
+                        if(!files.front().ready){
+                            if(!wait_for_all) return;
+                            cv.wait(lock, [&](){ return files.front().ready; });
+                        }
                     }
+                    auto &f = files.front();
+                    ++N_consumed;
+                    FUNCINFO("Parsed file #" << N_consumed << "/" << N_rows);
+
+                    if(f.failed
+                    || ( !boost::iequals(f.Modality,"RTSTRUCT") && (f.img_arr == nullptr) ) ){
+                        // Already reported. Ignore the file and continue.
+
+                    }else if(boost::iequals(f.Modality,"RTSTRUCT")){
+                        if( (f.contour_data == nullptr)
+                        ||  f.contour_data->ccs.empty() ){
+                            //If you get here, it isn't necessarily an error. But something has most likely gone wrong.
+                            // Why bother to load an RTSTRUCT file if it is empty? If you know what you're doing, you can
+                            // safely disable this error. Otherwise, try examining the contour loading code and file data.
+                            if(fatal_error.empty()) fatal_error = "RTSTRUCT file was loaded, but contained no ROIs";
+                        }else{
+                            loaded_contour_data_storage->ccs.splice( loaded_contour_data_storage->ccs.end(),
+                                                                     f.contour_data->ccs );
+                        }
+
+                    }else if(boost::iequals(f.Modality,"RTDOSE")){
+                        loaded_dose_storage.back().push_back( f.img_arr );
 
-                    const auto postloadcount = loaded_contour_data_storage->ccs.size();
-                    if(postloadcount == preloadcount){
-                        FUNCWARN("RTSTRUCT file was loaded, but contained no ROIs");
-                        return false;
-                        //If you get here, it isn't necessarily an error. But something has most likely gone wrong. Why bother
-                        // to load an RTSTRUCT file if it is empty? If you know what you're doing, you can safely disable this
-                        // error and pop the last-added data. Otherwise, try examining the contour loading code and file data.
+                    }else{
+                        if(f.img_arr->imagecoll.images.size() != 1){
+                            //If you get here, you've tried to load a file that contains more than one image slice. This
+                            // is OK, (and is legitimate behaviour) but you'll need to update the following code to ensure
+                            // each file's metadata is set accordingly.
+                            if(fatal_error.empty()){
+                                fatal_error = "More or less than one image loaded into the image array."
+                                              " You'll need to tweak the code to handle this";
+                            }
+                        }else{
+                            //If we want to add any additional image metadata, or replace the default Imebra_Shim.cc
+                            // populated metadata with, say, the non-null PostgreSQL metadata, it should be done here.
+                            auto &img = f.img_arr->imagecoll.images.back();
+                            img.metadata["StoreFullPathName"] = f.StoreFullPathName;
+                            if(f.dt) img.metadata["dt"] = f.dt.value();
+                            // ... more metadata operations ...
+                            loaded_imgs_storage.back().push_back( f.img_arr );
+                        }
                     }
 
+                    //Whatever file type, 
+                    if(f.FrameOfReferenceUID) FrameOfReferenceUIDs.insert(f.FrameOfReferenceUID.value());
 
-                }else if(boost::iequals(Modality,"RTDOSE")){
-                    try{
-                        loaded_dose_storage.back().push_back( Load_Dose_Array(StoreFullPathName));
-                    }catch(const std::exception &e){
-                        FUNCWARN("Difficulty encountered during dose array loading: '" << e.what() <<
-                                 "'. Ignoring file and continuing");
-                        //loaded_dose_storage.back().pop_back();
-                        continue;
-                    }
-
-                }else{ //Image loading. 'CT' and 'MR' should work. Not sure about others.
-                    try{
-                        loaded_imgs_storage.back().push_back( Load_Image_Array(StoreFullPathName));
-                    }catch(const std::exception &e){
-                        FUNCWARN("Difficulty encountered during image array loading: '" << e.what() <<
-                                 "'. Ignoring file and continuing");
-                        //loaded_imgs_storage.back().pop_back();
-                        continue;
-                    }
+                    std::lock_guard<std::mutex> lock(m);
+                    files.pop_front();
+                    --in_flight;
+                    cv.notify_all();
+                }
+            };
 
-                    if(loaded_imgs_storage.back().back()->imagecoll.images.size() != 1){
-                        FUNCWARN("More or less than one image loaded into the image array. You'll need to tweak the code to handle this");
-                        return false;
-                        //If you get here, you've tried to load a file that contains more than one image slice. This is OK,
-                        // (and is legitimate behaviour) but you'll need to update the following code to ensure each file's 
-                        // metadata is set accordingly. This is all you need to do at the time of writing, but take a look over
-                        // the rest of the code to ensure the code doesn't assume too much.
+            {
+                asio_thread_pool tp;
+
+                const auto submit_rows = [&](const pqxx::result &r) -> void {
+                    for(pqxx::result::size_type i = 0; i != r.size(); ++i){
+                        if(!fatal_error.empty()) return;
+
+                        // Wait for space in the in-flight window, consuming decoded files in order as they become ready.
+                        while(true){
+                            consume_ready(false);
+                            std::unique_lock<std::mutex> lock(m);
+                            if(in_flight < max_in_flight) break;
+                            cv.wait(lock, [&](){ return files.front().ready; });
+                        }
+
+                        pacs_loader_file *f_ptr = nullptr;
+                        {
+                            std::lock_guard<std::mutex> lock(m);
+                            files.emplace_back();
+                            f_ptr = &(files.back());
+                            ++in_flight;
+                            ++N_rows;
+                        }
+                        f_ptr->StoreFullPathName = (r[i]["StoreFullPathName"].is_null()) ? 
+                                                   "" : r[i]["StoreFullPathName"].as<std::string>();
+                        f_ptr->Modality = r[i]["Modality"].as<std::string>();
+                        if(!r[i]["dt"].is_null()) f_ptr->dt = r[i]["dt"].c_str();
+                        if(!r[i]["FrameOfReferenceUID"].is_null()){
+                            f_ptr->FrameOfReferenceUID = r[i]["FrameOfReferenceUID"].as<std::string>();
+                        }
+
+                        tp.submit_task([&,f_ptr]() -> void {
+                            Decode_PACS_File(*f_ptr);
+                            std::lock_guard<std::mutex> lock(m);
+                            f_ptr->ready = true;
+                            cv.notify_all();
+                        });
                     }
- 
-                    //If we want to add any additional image metadata, or replace the default Imebra_Shim.cc populated metadata
-                    // with, say, the non-null PostgreSQL metadata, it should be done here.
-                    loaded_imgs_storage.back().back()->imagecoll.images.back().metadata["StoreFullPathName"] = StoreFullPathName;
-                    if(!r1[i]["dt"].is_null()){
-                        //DICOM_data.image_data.back()->imagecoll.images.back().metadata["dt"] = r1[i]["dt"].c_str();
-                        //loaded_imgs_storage.back()->imagecoll.images.back().metadata["dt"] = r1[i]["dt"].c_str();
-                        loaded_imgs_storage.back().back()->imagecoll.images.back().metadata["dt"] = r1[i]["dt"].c_str();
+                };
+
+                // Note: if an exception is thrown, the thread pool is destroyed (and all outstanding tasks completed)
+                //       before the file list is.
+                if(cursor_query){
+                    const auto fetch = "FETCH FORWARD "_s + std::to_string(fetch_size) + " FROM dcma_pacs_loader_cursor;";
+                    while(fatal_error.empty()){
+                        const auto batch = txn.exec(fetch);
+                        if(batch.empty()) break;
+                        submit_rows(batch);
                     }
-                    // ... more metadata operations ...
-                }
-
-                //Whatever file type, 
-                if(!r1[i]["FrameOfReferenceUID"].is_null()){
-                    FrameOfReferenceUIDs.insert(r1[i]["FrameOfReferenceUID"].as<std::string>());
+                    txn.exec("CLOSE dcma_pacs_loader_cursor;");
+                }else{
+                    submit_rows(r1);
                 }
+                consume_ready(true);
+            }
 
+            if(!fatal_error.empty()){
+                FUNCWARN(fatal_error);
+                return false;
+            }
+            if(N_rows == 0){
+                FUNCWARN("Database query1 stage " << ss.str() << " resulted in no records. Cannot continue");
+                return false;
             }
+            FUNCINFO("Query1 stage: number of records found = " << N_rows);
 
             //-------------------------------------------------------------------------------------------------------------
-            //Finish the transaction and drop the connection.
+            //Finish the transaction.
             txn.commit();
 
         } // Loop over groups of query filter files.
@@ -196,8 +314,7 @@ bool Load_From_PACS_DB( Drover &DICOM_data,
     //Custom contour loading from an auxiliary database.
     if(!FrameOfReferenceUIDs.empty()){
         try{
-            pqxx::connection c(db_connection_params);
-            pqxx::work txn(c);
+            pqxx::work txn(*c);
 
             //Query for any contours matching the specific FrameOfReferenceUID.
             std::stringstream ss;
@@ -285,11 +402,12 @@ bool Load_From_PACS_DB( Drover &DICOM_data,
         }   
     }
 
-    //Concatenate contour data into the Drover instance.
+    //Concatenate contour data into the Drover instance. The existing contour data may be shared with other Drover
+    // instances, so it is copied rather than modified. The newly-loaded contours are spliced in without copying.
     {
         if(DICOM_data.contour_data == nullptr) DICOM_data.contour_data = std::make_shared<Contour_Data>();
-        auto combined = Concatenate_Contour_Data( DICOM_data.contour_data->Duplicate(),
-                                                  loaded_contour_data_storage->Duplicate());
+        std::shared_ptr<Contour_Data> combined = DICOM_data.contour_data->Duplicate();
+        combined->ccs.splice( combined->ccs.end(), loaded_contour_data_storage->ccs );
         DICOM_data.contour_data = std::move(combined);
     }
 
@@ -8,10 +8,16 @@
 
 #include "Structs.h"
 
+// Loads files selected by the filter queries from the PACS database.
+//
+// The final query in each group is streamed from the database via a cursor and the selected files are decoded
+// concurrently. At most 'max_in_flight' files are decoded or held awaiting collation at any one time; if non-positive,
+// a default based on the number of available cores is used. Use 1 to load files serially.
 bool Load_From_PACS_DB( Drover &DICOM_data,
                         std::map<std::string,std::string> &InvocationMetadata,
                         const std::string &FilenameLex,
                         std::string &db_connection_params,
-                        std::list<std::list<std::string>> &GroupedFilterQueryFiles );
+                        std::list<std::list<std::string>> &GroupedFilterQueryFiles,
+                        long int max_in_flight = 0 );
 
 
@@ -0,0 +1,459 @@
+//Ray_Casting.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+
+#include "Ray_Casting.h"
+
+
+void Merge_Ray_Intervals(std::vector<ray_interval> &intervals){
+    if(intervals.empty()) return;
+    std::sort(std::begin(intervals), std::end(intervals),
+              [](const ray_interval &L, const ray_interval &R) -> bool {
+                  return (L.t_enter < R.t_enter);
+              });
+
+    std::vector<ray_interval> merged;
+    merged.reserve(intervals.size());
+    for(const auto &i : intervals){
+        if(!(i.t_enter < i.t_exit)) continue;
+        if(!merged.empty() && (i.t_enter <= merged.back().t_exit)){
+            merged.back().t_exit = std::max(merged.back().t_exit, i.t_exit);
+        }else{
+            merged.push_back(i);
+        }
+    }
+    intervals.swap(merged);
+    return;
+}
+
+double Total_Ray_Interval_Length(const std::vector<ray_interval> &intervals){
+    double out = 0.0;
+    for(const auto &i : intervals) out += (i.t_exit - i.t_enter);
+    return out;
+}
+
+// Solves |oc + t*d|^2 = r^2 for a unit vector d. Returns false if there are no real roots.
+static bool Intersect_Ray_Sphere( const vec3<double> &oc,
+                                  const vec3<double> &dir,
+                                  double sq_radius,
+                                  ray_interval &out ){
+    const double b = oc.Dot(dir);
+    const double c = oc.Dot(oc) - sq_radius;
+    const double disc = b*b - c;
+    if(disc < 0.0) return false;
+    const double sq = std::sqrt(disc);
+    out.t_enter = -b - sq;
+    out.t_exit  = -b + sq;
+    return true;
+}
+
+bool Intersect_Ray_Capsule( const vec3<double> &origin,
+                            const vec3<double> &dir,
+                            const vec3<double> &A,
+                            const vec3<double> &B,
+                            double radius,
+                            ray_interval &out ){
+
+    // Because capsules are convex, the intersection with a line is a single interval. It is the union of the
+    // intervals from the two end-cap spheres and the finite cylinder, so it suffices to track the extrema.
+    const double sq_radius = radius * radius;
+    bool hit = false;
+    double t_enter = std::numeric_limits<double>::infinity();
+    double t_exit = -std::numeric_limits<double>::infinity();
+    const auto extend = [&](const ray_interval &i) -> void {
+        hit = true;
+        t_enter = std::min(t_enter, i.t_enter);
+        t_exit  = std::max(t_exit, i.t_exit);
+    };
+
+    ray_interval i;
+    const auto oa = origin - A;
+    if(Intersect_Ray_Sphere(oa, dir, sq_radius, i)) extend(i);
+
+    const auto ba = B - A;
+    const double baba = ba.Dot(ba);
+    if(0.0 < baba){
+        if(Intersect_Ray_Sphere(origin - B, dir, sq_radius, i)) extend(i);
+
+        // Fractional position along the axis: s(t) = s0 + t*ds. The cylinder body spans s in [0,1].
+        const double s0 = oa.Dot(ba) / baba;
+        const double ds = dir.Dot(ba) / baba;
+
+        // Components orthogonal to the axis.
+        const auto d_perp = dir - ba * ds;
+        const auto o_perp = oa - ba * s0;
+        const double a = d_perp.Dot(d_perp);
+        const double b = o_perp.Dot(d_perp);
+        const double c = o_perp.Dot(o_perp) - sq_radius;
+
+        double c_enter = -std::numeric_limits<double>::infinity();
+        double c_exit  =  std::numeric_limits<double>::infinity();
+        bool body_hit = true;
+        if(a < 1E-14){
+            // Ray is parallel to the axis. Either it is always within the radius, or never.
+            body_hit = (c <= 0.0);
+        }else{
+            const double disc = b*b - a*c;
+            if(disc < 0.0){
+                body_hit = false;
+            }else{
+                const double sq = std::sqrt(disc);
+                c_enter = (-b - sq) / a;
+                c_exit  = (-b + sq) / a;
+            }
+        }
+
+        if(body_hit){
+            // Clip to the extent of the cylinder body.
+            if(std::abs(ds) < 1E-14){
+                body_hit = (0.0 <= s0) && (s0 <= 1.0);
+            }else{
+                double sa = (0.0 - s0) / ds;
+                double sb = (1.0 - s0) / ds;
+                if(sb < sa) std::swap(sa, sb);
+                c_enter = std::max(c_enter, sa);
+                c_exit  = std::min(c_exit, sb);
+                body_hit = (c_enter < c_exit);
+            }
+        }
+        if(body_hit){
+            i.t_enter = c_enter;
+            i.t_exit  = c_exit;
+            extend(i);
+        }
+    }
+
+    if(hit){
+        out.t_enter = t_enter;
+        out.t_exit = t_exit;
+    }
+    return hit;
+}
+
+// Slab test for an axis-aligned bounding box, narrowing [t_min, t_max].
+static bool Intersect_Ray_AABB( const vec3<double> &origin,
+                                const vec3<double> &inv_dir,
+                                const vec3<double> &bb_min,
+                                const vec3<double> &bb_max,
+                                double t_min,
+                                double t_max ){
+    const std::array<double,3> o = {{ origin.x, origin.y, origin.z }};
+    const std::array<double,3> id = {{ inv_dir.x, inv_dir.y, inv_dir.z }};
+    const std::array<double,3> lo = {{ bb_min.x, bb_min.y, bb_min.z }};
+    const std::array<double,3> hi = {{ bb_max.x, bb_max.y, bb_max.z }};
+    for(size_t k = 0; k < 3; ++k){
+        if(!std::isfinite(id[k])){
+            // Ray is parallel to this slab.
+            if((o[k] < lo[k]) || (hi[k] < o[k])) return false;
+            continue;
+        }
+        double ta = (lo[k] - o[k]) * id[k];
+        double tb = (hi[k] - o[k]) * id[k];
+        if(tb < ta) std::swap(ta, tb);
+        t_min = std::max(t_min, ta);
+        t_max = std::min(t_max, tb);
+        if(t_max < t_min) return false;
+    }
+    return true;
+}
+
+
+capsule_bvh::capsule_bvh(std::vector<vec3<double>> A, std::vector<vec3<double>> B, double r) : radius(r) {
+    if(A.size() != B.size()){
+        throw std::invalid_argument("Capsule endpoint lists differ in size");
+    }
+    if(!std::isfinite(radius) || (radius <= 0.0)){
+        throw std::invalid_argument("Capsule radius must be positive and finite");
+    }
+    this->seg_A = std::move(A);
+    this->seg_B = std::move(B);
+    if(this->seg_A.empty()) return;
+
+    std::vector<vec3<double>> centroids;
+    centroids.reserve(this->seg_A.size());
+    for(size_t i = 0; i < this->seg_A.size(); ++i){
+        centroids.emplace_back( (this->seg_A[i] + this->seg_B[i]) * 0.5 );
+    }
+    this->nodes.reserve(2 * this->seg_A.size());
+    this->build(0, this->seg_A.size(), centroids);
+}
+
+size_t capsule_bvh::build(size_t first, size_t count, std::vector<vec3<double>> &centroids){
+    const size_t leaf_size = 4;
+    const vec3<double> r3(this->radius, this->radius, this->radius);
+
+    const auto n = this->nodes.size();
+    this->nodes.emplace_back();
+    {
+        const auto inf = std::numeric_limits<double>::infinity();
+        vec3<double> bb_min( inf, inf, inf );
+        vec3<double> bb_max( -inf, -inf, -inf );
+        for(size_t i = first; i < (first + count); ++i){
+            for(const auto &v : { this->seg_A[i], this->seg_B[i] }){
+                bb_min = vec3<double>( std::min(bb_min.x, v.x), std::min(bb_min.y, v.y), std::min(bb_min.z, v.z) );
+                bb_max = vec3<double>( std::max(bb_max.x, v.x), std::max(bb_max.y, v.y), std::max(bb_max.z, v.z) );
+            }
+        }
+        this->nodes[n].bb_min = bb_min - r3;
+        this->nodes[n].bb_max = bb_max + r3;
+    }
+
+    if(count <= leaf_size){
+        this->nodes[n].first = first;
+        this->nodes[n].count = count;
+        return n;
+    }
+
+    // Split at the median centroid along the longest axis of the centroid bounds.
+    const auto inf = std::numeric_limits<double>::infinity();
+    vec3<double> c_min( inf, inf, inf );
+    vec3<double> c_max( -inf, -inf, -inf );
+    for(size_t i = first; i < (first + count); ++i){
+        const auto &c = centroids[i];
+        c_min = vec3<double>( std::min(c_min.x, c.x), std::min(c_min.y, c.y), std::min(c_min.z, c.z) );
+        c_max = vec3<double>( std::max(c_max.x, c.x), std::max(c_max.y, c.y), std::max(c_max.z, c.z) );
+    }
+    const auto extent = c_max - c_min;
+    const auto axis_val = [&](const vec3<double> &v) -> double {
+        if((extent.x >= extent.y) && (extent.x >= extent.z)) return v.x;
+        if(extent.y >= extent.z) return v.y;
+        return v.z;
+    };
+
+    std::vector<size_t> idx(count);
+    std::iota(std::begin(idx), std::end(idx), first);
+    const size_t half = count / 2;
+    std::nth_element(std::begin(idx), std::next(std::begin(idx), half), std::end(idx),
+                     [&](size_t L, size_t R) -> bool {
+                         return (axis_val(centroids[L]) < axis_val(centroids[R]));
+                     });
+
+    // Permute the capsules into the partitioned order.
+    {
+        std::vector<vec3<double>> A, B, C;
+        A.reserve(count);
+        B.reserve(count);
+        C.reserve(count);
+        for(const auto i : idx){
+            A.push_back(this->seg_A[i]);
+            B.push_back(this->seg_B[i]);
+            C.push_back(centroids[i]);
+        }
+        std::copy(std::begin(A), std::end(A), std::next(std::begin(this->seg_A), first));
+        std::copy(std::begin(B), std::end(B), std::next(std::begin(this->seg_B), first));
+        std::copy(std::begin(C), std::end(C), std::next(std::begin(centroids), first));
+    }
+
+    const auto left = this->build(first, half, centroids);
+    const auto right = this->build(first + half, count - half, centroids);
+    this->nodes[n].first = left;
+    this->nodes[n].right = right;
+    this->nodes[n].count = 0;
+    return n;
+}
+
+bool capsule_bvh::empty() const {
+    return this->seg_A.empty();
+}
+
+size_t capsule_bvh::size() const {
+    return this->seg_A.size();
+}
+
+std::vector<ray_interval> capsule_bvh::intersect(const vec3<double> &origin,
+                                                 const vec3<double> &dir,
+                                                 double t_min,
+                                                 double t_max) const {
+    std::vector<ray_interval> out;
+    if(this->nodes.empty() || !(t_min < t_max)) return out;
+
+    const vec3<double> inv_dir( 1.0 / dir.x, 1.0 / dir.y, 1.0 / dir.z );
+
+    std::vector<size_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while(!stack.empty()){
+        const auto &nd = this->nodes[stack.back()];
+        stack.pop_back();
+        if(!Intersect_Ray_AABB(origin, inv_dir, nd.bb_min, nd.bb_max, t_min, t_max)) continue;
+
+        if(nd.count == 0){
+            stack.push_back(nd.first);
+            stack.push_back(nd.right);
+            continue;
+        }
+        for(size_t i = nd.first; i < (nd.first + nd.count); ++i){
+            ray_interval ri;
+            if(!Intersect_Ray_Capsule(origin, dir, this->seg_A[i], this->seg_B[i], this->radius, ri)) continue;
+            ri.t_enter = std::max(ri.t_enter, t_min);
+            ri.t_exit  = std::min(ri.t_exit, t_max);
+            if(ri.t_enter < ri.t_exit) out.push_back(ri);
+        }
+    }
+
+    Merge_Ray_Intervals(out);
+    return out;
+}
+
+capsule_bvh Build_Contour_Capsule_BVH( const std::list<std::reference_wrapper<contour_collection<double>>> &ccs,
+                                       double radius ){
+    std::vector<vec3<double>> A;
+    std::vector<vec3<double>> B;
+    for(const auto &cc_refw : ccs){
+        for(const auto &cop : cc_refw.get().contours){
+            if(cop.points.empty()){
+                continue;
+            }else if(cop.points.size() == 1){
+                // A lone vertex is represented by a sphere.
+                A.emplace_back( cop.points.front() );
+                B.emplace_back( cop.points.front() );
+                continue;
+            }
+
+            auto itA = std::begin(cop.points);
+            auto itB = std::next(itA);
+            for( ; itB != std::end(cop.points); ++itA, ++itB){
+                A.emplace_back( *itA );
+                B.emplace_back( *itB );
+            }
+            if(cop.closed && (2 < cop.points.size())){
+                A.emplace_back( cop.points.back() );
+                B.emplace_back( cop.points.front() );
+            }
+        }
+    }
+    return capsule_bvh(std::move(A), std::move(B), radius);
+}
+
+
+// Liang-Barsky style clipping of the parametric coordinate p(t) = p0 + t*dp to [lo, hi].
+static bool Clip_Ray_Coordinate( double p0, double dp, double lo, double hi, double &t_min, double &t_max ){
+    if(dp == 0.0){
+        return (lo <= p0) && (p0 <= hi);
+    }
+    double ta = (lo - p0) / dp;
+    double tb = (hi - p0) / dp;
+    if(tb < ta) std::swap(ta, tb);
+    t_min = std::max(t_min, ta);
+    t_max = std::min(t_max, tb);
+    return (t_min < t_max);
+}
+
+void Traverse_Ray_Through_Image( const planar_image<float,double> &img,
+                                 const vec3<double> &origin,
+                                 const vec3<double> &dir,
+                                 double t_min,
+                                 double t_max,
+                                 const std::function<void(long int row, long int col, double t_enter, double t_exit)> &f ){
+    if(!(t_min < t_max) || (img.rows <= 0) || (img.columns <= 0)) return;
+
+    // Continuous pixel coordinates: pixel centres lie on integers.
+    // Note that the row number increases along row_unit (in steps of pxl_dx) and the column number along col_unit (in
+    // steps of pxl_dy), matching planar_image::position().
+    const auto ortho_unit = img.row_unit.Cross( img.col_unit ).unit();
+    const auto rel = origin - img.position(0, 0);
+    const double r0 = rel.Dot(img.row_unit) / img.pxl_dx;
+    const double dr = dir.Dot(img.row_unit) / img.pxl_dx;
+    const double c0 = rel.Dot(img.col_unit) / img.pxl_dy;
+    const double dc = dir.Dot(img.col_unit) / img.pxl_dy;
+    const double w0 = rel.Dot(ortho_unit);
+    const double dw = dir.Dot(ortho_unit);
+
+    if(!Clip_Ray_Coordinate(w0, dw, -0.5 * img.pxl_dz, 0.5 * img.pxl_dz, t_min, t_max)
+    || !Clip_Ray_Coordinate(c0, dc, -0.5, static_cast<double>(img.columns) - 0.5, t_min, t_max)
+    || !Clip_Ray_Coordinate(r0, dr, -0.5, static_cast<double>(img.rows) - 0.5, t_min, t_max) ){
+        return;
+    }
+
+    const auto initial_cell = [](double p, double dp, long int N) -> long int {
+        const double q = p + 0.5;
+        auto i = static_cast<long int>(std::floor(q));
+        if((dp < 0.0) && (q == std::floor(q))) i -= 1; // On a boundary and heading into the lower pixel.
+        return std::clamp<long int>(i, 0, N - 1);
+    };
+
+    const double c_start = c0 + dc * t_min;
+    const double r_start = r0 + dr * t_min;
+    long int col = initial_cell(c_start, dc, img.columns);
+    long int row = initial_cell(r_start, dr, img.rows);
+
+    const auto inf = std::numeric_limits<double>::infinity();
+    const long int step_c = (0.0 < dc) ? 1 : -1;
+    const long int step_r = (0.0 < dr) ? 1 : -1;
+    const double delta_c = (dc == 0.0) ? inf : std::abs(1.0 / dc);
+    const double delta_r = (dr == 0.0) ? inf : std::abs(1.0 / dr);
+    double next_c = (dc == 0.0) ? inf : t_min + ((static_cast<double>(col) + 0.5 * step_c) - c_start) / dc;
+    double next_r = (dr == 0.0) ? inf : t_min + ((static_cast<double>(row) + 0.5 * step_r) - r_start) / dr;
+
+    double t = t_min;
+    while(t < t_max){
+        const double t_next = std::min( { next_c, next_r, t_max } );
+        if(t < t_next) f(row, col, t, t_next);
+        if(t_max <= t_next) break;
+
+        if(next_c < next_r){
+            col += step_c;
+            next_c += delta_c;
+        }else{
+            row += step_r;
+            next_r += delta_r;
+        }
+        if( (col < 0) || (img.columns <= col) || (row < 0) || (img.rows <= row) ) break;
+        t = t_next;
+    }
+    return;
+}
+
+std::vector<ray_interval> Image_Ray_Intervals( const planar_image_collection<float,double> &imagecoll,
+                                               const vec3<double> &origin,
+                                               const vec3<double> &dir,
+                                               double t_min,
+                                               double t_max,
+                                               long int chnl,
+                                               const std::function<bool(float)> &pred ){
+    std::vector<ray_interval> out;
+    for(const auto &img : imagecoll.images){
+        Traverse_Ray_Through_Image(img, origin, dir, t_min, t_max,
+            [&](long int row, long int col, double t_enter, double t_exit) -> void {
+                if(!pred(img.value(row, col, chnl))) return;
+                if(!out.empty() && (out.back().t_exit == t_enter)){
+                    out.back().t_exit = t_exit;
+                }else{
+                    out.push_back( ray_interval{ t_enter, t_exit } );
+                }
+            });
+    }
+    Merge_Ray_Intervals(out);
+    return out;
+}
+
+double Integrate_Image_Along_Ray( const planar_image_collection<float,double> &imagecoll,
+                                  const vec3<double> &origin,
+                                  const vec3<double> &dir,
+                                  const std::vector<ray_interval> &intervals,
+                                  long int chnl ){
+    double out = 0.0;
+    for(const auto &img : imagecoll.images){
+        for(const auto &i : intervals){
+            Traverse_Ray_Through_Image(img, origin, dir, i.t_enter, i.t_exit,
+                [&](long int row, long int col, double t_enter, double t_exit) -> void {
+                    out += static_cast<double>(img.value(row, col, chnl)) * (t_exit - t_enter);
+                });
+        }
+    }
+    return out;
+}
+
@@ -0,0 +1,117 @@
+//Ray_Casting.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+
+
+// A closed interval of ray parameter 't' along a ray R(t) = origin + t*direction, where direction is a unit vector.
+// Interval lengths are therefore physical distances.
+struct ray_interval {
+    double t_enter = 0.0;
+    double t_exit  = 0.0;
+};
+
+// Sorts the intervals and merges any that overlap or touch, so the result is a disjoint, ordered set.
+void Merge_Ray_Intervals(std::vector<ray_interval> &intervals);
+
+// Sums the lengths of a set of (disjoint) intervals.
+double Total_Ray_Interval_Length(const std::vector<ray_interval> &intervals);
+
+// Exact ray-capsule intersection. A capsule is the set of points within 'radius' of the line segment [A,B] (i.e., a
+// finite cylinder with hemispherical caps). A degenerate segment (A == B) is a sphere.
+//
+// Returns false if the infinite line does not intersect the capsule. The interval is not clipped to t >= 0.
+bool Intersect_Ray_Capsule( const vec3<double> &origin,
+                            const vec3<double> &dir,
+                            const vec3<double> &A,
+                            const vec3<double> &B,
+                            double radius,
+                            ray_interval &out );
+
+
+// Bounding volume hierarchy over capsules sharing a common radius.
+//
+// This is used to represent the 'peel' surrounding a set of contours: the union of spheres centred on contour vertices
+// and cylinders surrounding contour line segments is exactly the union of capsules surrounding each line segment.
+// Rays are tested against the hierarchy and the exact intervals where they are inside the union are returned.
+class capsule_bvh {
+  public:
+    struct node {
+        vec3<double> bb_min;
+        vec3<double> bb_max;
+        size_t first = 0;  // Leaves: index of the first capsule. Interior nodes: index of the left child.
+        size_t count = 0;  // Leaves: number of capsules. Interior nodes: zero.
+        size_t right = 0;  // Interior nodes: index of the right child.
+    };
+
+  private:
+    double radius = 0.0;
+    std::vector<vec3<double>> seg_A;
+    std::vector<vec3<double>> seg_B;
+    std::vector<node> nodes;
+
+    size_t build(size_t first, size_t count, std::vector<vec3<double>> &centroids);
+
+  public:
+    capsule_bvh() = default;
+
+    // Degenerate segments (A == B) are permitted and represent spheres.
+    capsule_bvh(std::vector<vec3<double>> A, std::vector<vec3<double>> B, double radius);
+
+    bool empty() const;
+    size_t size() const;
+
+    // Computes the disjoint, ordered intervals within [t_min, t_max] where the ray is inside at least one capsule.
+    std::vector<ray_interval> intersect(const vec3<double> &origin,
+                                        const vec3<double> &dir,
+                                        double t_min,
+                                        double t_max) const;
+};
+
+// Builds a capsule_bvh from contours. Every contour vertex contributes a sphere, every line segment contributes a
+// cylinder, and closed contours contribute a closing segment.
+capsule_bvh Build_Contour_Capsule_BVH( const std::list<std::reference_wrapper<contour_collection<double>>> &ccs,
+                                       double radius );
+
+
+// Incremental voxel traversal (Amanatides and Woo) of a ray through a single planar image.
+//
+// Pixels are treated as boxes extending half a pixel in each in-plane direction and half of pxl_dz in the orthogonal
+// direction. The callback is invoked once for each pixel the ray passes through within [t_min, t_max], in order,
+// together with the (non-empty) ray parameter interval spent within it.
+//
+// This is exact for the piecewise-constant (nearest-voxel) interpretation of images used by planar_image::value().
+void Traverse_Ray_Through_Image( const planar_image<float,double> &img,
+                                 const vec3<double> &origin,
+                                 const vec3<double> &dir,
+                                 double t_min,
+                                 double t_max,
+                                 const std::function<void(long int row, long int col, double t_enter, double t_exit)> &f );
+
+// Finds the disjoint, ordered intervals along the ray within [t_min, t_max] where voxels of the collection satisfy the
+// given predicate.
+std::vector<ray_interval> Image_Ray_Intervals( const planar_image_collection<float,double> &imagecoll,
+                                               const vec3<double> &origin,
+                                               const vec3<double> &dir,
+                                               double t_min,
+                                               double t_max,
+                                               long int chnl,
+                                               const std::function<bool(float)> &pred );
+
+// Exactly integrates voxel values along the provided intervals of the ray. Voxels are treated as piecewise constant.
+// Voxels from all images that encompass the ray are summed, which mirrors summing over
+// get_images_which_encompass_point() at every point along the ray.
+double Integrate_Image_Along_Ray( const planar_image_collection<float,double> &imagecoll,
+                                  const vec3<double> &origin,
+                                  const vec3<double> &dir,
+                                  const std::vector<ray_interval> &intervals,
+                                  long int chnl );
+
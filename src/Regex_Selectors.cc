@@ -2,10 +2,15 @@
 
 #include "Regex_Selectors.h"
 
+#include <algorithm>
+#include <cctype>
 #include <string>
 #include <list>
 #include <initializer_list>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <optional>
 #include <utility>
@@ -15,6 +20,186 @@
 
 #include "Structs.h"
 
+// -------------------------------- Compiled Selectors ---------------------------------
+
+// A compiled metadata value selector.
+//
+// Regex compilation and matching are expensive relative to the typical metadata comparison, and the vast majority of
+// selectors are either match-everything (e.g., the ubiquitous '.*' default), verbatim (e.g., 'CT' or '^CT$'), or
+// prefix (e.g., '^Body.*') expressions. These are identified once and evaluated without the regex engine. Comparisons
+// are case-insensitive to match the regex engine settings.
+class selector_matcher {
+    public:
+        enum class kind {
+            everything,  // Matches all values.
+            exact,       // Matches values equal to the literal.
+            prefix,      // Matches values beginning with the literal.
+            regex,       // Requires the regex engine.
+        };
+
+    private:
+        kind k = kind::regex;
+        std::string literal; // Lower-case.
+        std::regex theregex;
+
+        static bool is_literal(const std::string &s){
+            return (s.find_first_of(R"***(.[]()*+?{}|^$\)***") == std::string::npos);
+        }
+
+        static bool equal_icase(const char *a, const char *b, size_t N){
+            for(size_t i = 0; i < N; ++i){
+                if( std::tolower(static_cast<unsigned char>(a[i]))
+                 != std::tolower(static_cast<unsigned char>(b[i])) ) return false;
+            }
+            return true;
+        }
+
+    public:
+        explicit selector_matcher(const std::string &pattern){
+            // Note: regex_match() is used for all selectors, so patterns are implicitly anchored at both ends.
+            std::string p = pattern;
+            if(!p.empty() && (p.front() == '^')) p.erase(0, 1);
+            if( (2 <= p.size()) && (p.back() == '$') && (p[p.size() - 2] != '\\') ) p.pop_back();
+
+            const bool trailing_wildcard = ( (2 <= p.size()) && (p.compare(p.size() - 2, 2, ".*") == 0) );
+            const auto stem = (trailing_wildcard) ? p.substr(0, p.size() - 2) : p;
+
+            if(is_literal(stem)){
+                this->literal = stem;
+                std::transform(std::begin(this->literal), std::end(this->literal), std::begin(this->literal),
+                               [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+                this->k = (trailing_wildcard) ? ( (stem.empty()) ? kind::everything : kind::prefix )
+                                              : kind::exact;
+            }else{
+                this->k = kind::regex;
+                this->theregex = Compile_Regex(pattern);
+            }
+        }
+
+        kind get_kind() const {
+            return this->k;
+        }
+
+        bool operator()(const std::string &value) const {
+            switch(this->k){
+                case kind::everything:
+                    return true;
+                case kind::exact:
+                    return (value.size() == this->literal.size())
+                        && equal_icase(value.data(), this->literal.data(), this->literal.size());
+                case kind::prefix:
+                    return (this->literal.size() <= value.size())
+                        && equal_icase(value.data(), this->literal.data(), this->literal.size());
+                case kind::regex:
+                    return std::regex_match(value, this->theregex);
+            }
+            throw std::logic_error("Selector kind not understood. Cannot continue.");
+        }
+};
+
+// Returns a (possibly cached) compiled selector.
+//
+// Selectors are immutable once compiled, so they can be shared between threads and invocations.
+static
+std::shared_ptr<const selector_matcher>
+Compile_Selector(const std::string &pattern){
+    static std::mutex m;
+    static std::map<std::string, std::shared_ptr<const selector_matcher>> cache;
+
+    std::lock_guard<std::mutex> lock(m);
+    auto it = cache.find(pattern);
+    if(it == std::end(cache)){
+        if(1024 <= cache.size()) cache.clear(); // Guard against unbounded growth from generated selectors.
+        it = cache.emplace(pattern, std::make_shared<const selector_matcher>(pattern)).first;
+    }
+    return it->second;
+}
+
+
+// A parsed single-word positional specifier, e.g., "first", "!last", "#2", or "#-0".
+struct positional_specifier {
+    enum class kind {
+        none,
+        all,
+        nth,         // The Nth item (one-based; 'first', 'second', 'third').
+        last,
+        from_front,  // '#N', zero-based from the front.
+        from_back,   // '#-N', zero-based from the back.
+    } k = kind::none;
+
+    bool inverted = false;
+    size_t N = 0;
+};
+
+// Parses positional specifiers, caching the result. Returns an empty optional if the specifier is not positional.
+static
+std::optional<positional_specifier>
+Parse_Positional_Specifier(const std::string &Specifier){
+    static std::mutex m;
+    static std::map<std::string, std::optional<positional_specifier>> cache;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        const auto it = cache.find(Specifier);
+        if(it != std::end(cache)) return it->second;
+    }
+
+    const auto regex_none  = Compile_Regex("^[!]?no?n?e?$");
+    const auto regex_all   = Compile_Regex("^[!]?al?l?$");
+    const auto regex_1st   = Compile_Regex("^[!]?fi?r?s?t?$");
+    const auto regex_2nd   = Compile_Regex("^[!]?se?c?o?n?d?$");
+    const auto regex_3rd   = Compile_Regex("^[!]?th?i?r?d?$");
+    const auto regex_last  = Compile_Regex("^[!]?la?s?t?$");
+    const auto regex_pnum  = Compile_Regex("^[!]?[#][0-9].*$");
+    const auto regex_nnum  = Compile_Regex("^[!]?[#]-[0-9].*$");
+
+    std::optional<positional_specifier> out;
+    positional_specifier ps;
+    ps.inverted = (!Specifier.empty() && (Specifier.front() == '!'));
+
+    if(std::regex_match(Specifier, regex_none)){
+        ps.k = positional_specifier::kind::none;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_all)){
+        ps.k = positional_specifier::kind::all;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_1st)){
+        ps.k = positional_specifier::kind::nth;
+        ps.N = 1;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_2nd)){
+        ps.k = positional_specifier::kind::nth;
+        ps.N = 2;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_3rd)){
+        ps.k = positional_specifier::kind::nth;
+        ps.N = 3;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_last)){
+        ps.k = positional_specifier::kind::last;
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_pnum)){
+        auto pnum_extractor = std::regex("^[!]?[#]([0-9]*).*$", std::regex::icase |
+                                                                std::regex::optimize |
+                                                                std::regex::extended);
+        ps.k = positional_specifier::kind::from_front;
+        ps.N = std::stoul(GetFirstRegex(Specifier, pnum_extractor));
+        out = ps;
+    }else if(std::regex_match(Specifier, regex_nnum)){
+        auto nnum_extractor = std::regex("^[!]?[#]-([0-9]*).*$", std::regex::icase |
+                                                                 std::regex::optimize |
+                                                                 std::regex::extended);
+        ps.k = positional_specifier::kind::from_back;
+        ps.N = std::stoul(GetFirstRegex(Specifier, nnum_extractor));
+        out = ps;
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    if(1024 <= cache.size()) cache.clear();
+    cache.emplace(Specifier, out);
+    return out;
+}
+
+
 // ------------------------------------- Templates -------------------------------------
 
 // Whitelist image arrays or point clouds using a limited vocabulary of specifiers.
@@ -29,10 +214,7 @@ Whitelist_Core( L lops,
 
     // Multiple key-value specifications stringified together.
     // For example, "key1@value1;key2@value2".
-    do{
-        const auto regex_split = Compile_Regex("^.*;.*$");
-        if(!std::regex_match(Specifier, regex_split)) break; // Not a multi-key@value statement.
-
+    if(Specifier.find(';') != std::string::npos){
         auto v_kvs = SplitStringToVector(Specifier, ';', 'd');
         if(v_kvs.size() <= 1) throw std::logic_error("Unable to separate multiple key@value specifiers");
 
@@ -40,13 +222,12 @@ Whitelist_Core( L lops,
             lops = Whitelist(lops, keyvalue, Opts);
         }
         return lops;
-    }while(false);
+    }
 
     // A single key-value specifications stringified together.
     // For example, "key@value".
     do{
-        const auto regex_split = Compile_Regex("^.*@.*$");
-        if(!std::regex_match(Specifier, regex_split)) break; // Not a key@value statement.
+        if(Specifier.find('@') == std::string::npos) break; // Not a key@value statement.
         
         auto v_k_v = SplitStringToVector(Specifier, '@', 'd');
         if(v_k_v.size() <= 1) throw std::logic_error("Unable to separate key@value specifier");
@@ -58,103 +239,51 @@ Whitelist_Core( L lops,
 
     // Single-word positional specifiers, i.e. "all", "none", "first", "last", or zero-based 
     // numerical specifiers, e.g., "#0" (front), "#1" (second), "#-0" (last), and "#-1" (second-from-last).
-    do{
-        const auto regex_none  = Compile_Regex("^no?n?e?$");
-        const auto regex_all   = Compile_Regex("^al?l?$");
-        const auto regex_1st   = Compile_Regex("^fi?r?s?t?$");
-        const auto regex_2nd   = Compile_Regex("^se?c?o?n?d?$");
-        const auto regex_3rd   = Compile_Regex("^th?i?r?d?$");
-        const auto regex_last  = Compile_Regex("^la?s?t?$");
-        const auto regex_pnum  = Compile_Regex("^[#][0-9].*$");
-        const auto regex_nnum  = Compile_Regex("^[#]-[0-9].*$");
-
-        const auto regex_i_none  = Compile_Regex("^[!]no?n?e?$"); // Inverted variants of the above.
-        const auto regex_i_all   = Compile_Regex("^[!]al?l?$");
-        const auto regex_i_1st   = Compile_Regex("^[!]fi?r?s?t?$");
-        const auto regex_i_2nd   = Compile_Regex("^[!]se?c?o?n?d?$");
-        const auto regex_i_3rd   = Compile_Regex("^[!]th?i?r?d?$");
-        const auto regex_i_last  = Compile_Regex("^[!]la?s?t?$");
-        const auto regex_i_pnum  = Compile_Regex("^[!][#][0-9].*$");
-        const auto regex_i_nnum  = Compile_Regex("^[!][#]-[0-9].*$");
-        
-        if(std::regex_match(Specifier, regex_i_none)){
-            return lops;
-        }
-        if(std::regex_match(Specifier, regex_none)){
-            lops.clear();
+    //
+    // Each can be inverted by prefixing with a '!'.
+    const auto ps_opt = Parse_Positional_Specifier(Specifier);
+    if(ps_opt){
+        const auto &ps = ps_opt.value();
+        const auto N = ps.N;
+        using k_t = positional_specifier::kind;
+
+        if(ps.k == k_t::none){
+            if(!ps.inverted) lops.clear();
             return lops;
         }
 
-        if(std::regex_match(Specifier, regex_i_all)){
-            lops.clear();
-            return lops;
-        }
-        if(std::regex_match(Specifier, regex_all)){
+        if(ps.k == k_t::all){
+            if(ps.inverted) lops.clear();
             return lops;
         }
 
-        if( std::regex_match(Specifier, regex_i_1st)
-        ||  std::regex_match(Specifier, regex_i_2nd) 
-        ||  std::regex_match(Specifier, regex_i_3rd)  ){
-            size_t N = 0; // Target.
-            if( std::regex_match(Specifier, regex_i_1st) ){ N = 1;
-            }else if( std::regex_match(Specifier, regex_i_2nd) ){ N = 2;
-            }else if( std::regex_match(Specifier, regex_i_3rd) ){ N = 3;
-            }else{
-                throw std::logic_error("Regex positional specifier not understood. Cannot continue.");
-            }
-
+        if(ps.k == k_t::nth){
             decltype(lops) out;
             size_t i = 1;
-            for(const auto &l : lops) if(N != i++) out.emplace_back(l);
-            return out;
-        }
-
-        if( std::regex_match(Specifier, regex_1st)
-        ||  std::regex_match(Specifier, regex_2nd) 
-        ||  std::regex_match(Specifier, regex_3rd)  ){
-            size_t N = 0; // Target.
-            if( std::regex_match(Specifier, regex_1st) ){ N = 1;
-            }else if( std::regex_match(Specifier, regex_2nd) ){ N = 2;
-            }else if( std::regex_match(Specifier, regex_3rd) ){ N = 3;
-            }else{
-                throw std::logic_error("Regex positional specifier not understood. Cannot continue.");
+            for(const auto &l : lops){
+                if((N == i++) != ps.inverted) out.emplace_back(l);
             }
-
-            decltype(lops) out;
-            size_t i = 1;
-            for(const auto &l : lops) if(N == i++) out.emplace_back(l);
             return out;
         }
 
-        if(std::regex_match(Specifier, regex_i_last)){
-            if(!lops.empty()) lops.pop_back();
-            return lops;
-        }
-        if(std::regex_match(Specifier, regex_last)){
+        if(ps.k == k_t::last){
+            if(ps.inverted){
+                if(!lops.empty()) lops.pop_back();
+                return lops;
+            }
             decltype(lops) out;
             if(!lops.empty()) out.emplace_back(lops.back());
             return out;
         }
 
-        if(std::regex_match(Specifier, regex_i_pnum)){
-            auto pnum_extractor = std::regex("^[!][#]([0-9]*).*$", std::regex::icase |
-                                                                   std::regex::optimize |
-                                                                   std::regex::extended);
-            auto N = std::stoul(GetFirstRegex(Specifier, pnum_extractor));
-
-            if(N < lops.size()){
-                auto l_it = std::next( lops.begin(), N );
-                lops.erase( l_it );
+        if(ps.k == k_t::from_front){
+            if(ps.inverted){
+                if(N < lops.size()){
+                    auto l_it = std::next( lops.begin(), N );
+                    lops.erase( l_it );
+                }
+                return lops;
             }
-            return lops;
-        }
-        if(std::regex_match(Specifier, regex_pnum)){
-            auto pnum_extractor = std::regex("^[#]([0-9]*).*$", std::regex::icase |
-                                                                std::regex::optimize |
-                                                                std::regex::extended);
-            auto N = std::stoul(GetFirstRegex(Specifier, pnum_extractor));
-
             decltype(lops) out;
             if(N < lops.size()){
                 auto l_it = std::next( lops.begin(), N );
@@ -163,29 +292,19 @@ Whitelist_Core( L lops,
             return out;
         }
 
-        if(std::regex_match(Specifier, regex_i_nnum)){
-            auto nnum_extractor = std::regex("^[!][#]-([0-9]*).*$", std::regex::icase |
-                                                                    std::regex::optimize |
-                                                                    std::regex::extended);
-            auto N = std::stoul(GetFirstRegex(Specifier, nnum_extractor));
-
-            if(N < lops.size()) return lops;
+        if(ps.k == k_t::from_back){
+            if(ps.inverted){
+                if(N < lops.size()) return lops;
 
-            // Note: this one is slightly harder than the rest because you cannot directly erase() a reverse iterator.
-            decltype(lops) out;
-            size_t i = lops.size();
-            for(auto l_it = lops.begin(); l_it != lops.end(); ++l_it, --i){
-                if(i == N) continue;
-                out.emplace_back(*l_it);
+                // Note: this one is slightly harder than the rest because you cannot directly erase() a reverse iterator.
+                decltype(lops) out;
+                size_t i = lops.size();
+                for(auto l_it = lops.begin(); l_it != lops.end(); ++l_it, --i){
+                    if(i == N) continue;
+                    out.emplace_back(*l_it);
+                }
+                return out;
             }
-            return out;
-        }
-        if(std::regex_match(Specifier, regex_nnum)){
-            auto nnum_extractor = std::regex("^[#]-([0-9]*).*$", std::regex::icase |
-                                                                 std::regex::optimize |
-                                                                 std::regex::extended);
-            auto N = std::stoul(GetFirstRegex(Specifier, nnum_extractor));
-
             decltype(lops) out;
             if(N < lops.size()){
                 auto l_it = std::next( lops.rbegin(), N );
@@ -194,7 +313,8 @@ Whitelist_Core( L lops,
             return out;
         }
 
-    }while(false);
+        throw std::logic_error("Regex positional specifier not understood. Cannot continue.");
+    }
 
     throw std::invalid_argument("Selection is not valid. Cannot continue.");
     decltype(lops) out;
@@ -219,12 +339,24 @@ Whitelist_Core( L lops,
 // --------------------------------------- Misc. ---------------------------------------
 
 // Compile and return a regex using the application-wide default settings.
+//
+// Compiled regexes are cached, since the same handful of expressions are compiled by nearly every operation
+// invocation. Copying a compiled regex is much cheaper than compiling it anew.
 std::regex
 Compile_Regex(const std::string& input){
-    return std::regex(input, std::regex::icase | 
-                             std::regex::nosubs |
-                             std::regex::optimize |
-                             std::regex::extended);
+    static std::mutex m;
+    static std::map<std::string, std::regex> cache;
+
+    std::lock_guard<std::mutex> lock(m);
+    auto it = cache.find(input);
+    if(it == std::end(cache)){
+        if(1024 <= cache.size()) cache.clear(); // Guard against unbounded growth from generated expressions.
+        it = cache.emplace(input, std::regex(input, std::regex::icase | 
+                                                    std::regex::nosubs |
+                                                    std::regex::optimize |
+                                                    std::regex::extended)).first;
+    }
+    return it->second;
 }
 
 // Human-readable information about how selectors can be specified.
@@ -272,7 +404,8 @@ Whitelist( std::list<std::reference_wrapper<contour_collection<double>>> ccs,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     ccs.remove_if([&](std::reference_wrapper<contour_collection<double>> cc) -> bool {
         if(cc.get().contours.empty()) return true; // Remove collections containing no contours.
@@ -280,13 +413,13 @@ Whitelist( std::list<std::reference_wrapper<contour_collection<double>>> ccs,
         if(Opts.validation == Regex_Selector_Opts::Validation::Representative){
             auto ValueOpt = cc.get().contours.front().GetMetadataValueAs<std::string>(MetadataKey);
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("Regex selector representative->NAs option not understood. Cannot continue.");
 
@@ -303,7 +436,7 @@ Whitelist( std::list<std::reference_wrapper<contour_collection<double>>> ccs,
 
             }else{
                 for(const auto & Value : Values){
-                    if( !std::regex_match(Value,theregex) ) return true;
+                    if( !matches(Value) ) return true;
                 }
                 return false;
             }
@@ -402,7 +535,8 @@ Whitelist( std::list<std::list<std::shared_ptr<Image_Array>>::iterator> ias,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     ias.remove_if([&](std::list<std::shared_ptr<Image_Array>>::iterator iap_it) -> bool {
         if((*iap_it) == nullptr) return true;
@@ -411,13 +545,13 @@ Whitelist( std::list<std::list<std::shared_ptr<Image_Array>>::iterator> ias,
         if(Opts.validation == Regex_Selector_Opts::Validation::Representative){
             auto ValueOpt = (*iap_it)->imagecoll.images.front().GetMetadataValueAs<std::string>(MetadataKey);
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("Regex selector representative->NAs option not understood. Cannot continue.");
 
@@ -434,7 +568,7 @@ Whitelist( std::list<std::list<std::shared_ptr<Image_Array>>::iterator> ias,
 
             }else{
                 for(const auto & Value : Values){
-                    if( !std::regex_match(Value,theregex) ) return true;
+                    if( !matches(Value) ) return true;
                 }
                 return false;
             }
@@ -512,7 +646,8 @@ Whitelist( std::list<std::list<std::shared_ptr<Point_Cloud>>::iterator> pcs,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     pcs.remove_if([&](std::list<std::shared_ptr<Point_Cloud>>::iterator pcp_it) -> bool {
         if((*pcp_it) == nullptr) return true;
@@ -525,13 +660,13 @@ Whitelist( std::list<std::list<std::shared_ptr<Point_Cloud>>::iterator> pcs,
 
             auto ValueOpt = (*pcp_it)->pset.GetMetadataValueAs<std::string>(MetadataKey);
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("NAs option not understood. Cannot continue.");
         }
@@ -611,7 +746,8 @@ Whitelist( std::list<std::list<std::shared_ptr<Surface_Mesh>>::iterator> sms,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     sms.remove_if([&](std::list<std::shared_ptr<Surface_Mesh>>::iterator smp_it) -> bool {
         if((*smp_it) == nullptr) return true;
@@ -630,13 +766,13 @@ Whitelist( std::list<std::list<std::shared_ptr<Surface_Mesh>>::iterator> sms,
                       (*smp_it)->meshes.metadata[MetadataKey] :
                       std::optional<std::string>();
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("NAs option not understood. Cannot continue.");
         }
@@ -716,7 +852,8 @@ Whitelist( std::list<std::list<std::shared_ptr<TPlan_Config>>::iterator> tps,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     tps.remove_if([&](std::list<std::shared_ptr<TPlan_Config>>::iterator tpp_it) -> bool {
         if((*tpp_it) == nullptr) return true;
@@ -736,13 +873,13 @@ Whitelist( std::list<std::list<std::shared_ptr<TPlan_Config>>::iterator> tps,
             // TODO: support selection of Dynamic_Machine_State and Static_Machine_State metadata too.
 
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("NAs option not understood. Cannot continue.");
         }
@@ -821,7 +958,8 @@ Whitelist( std::list<std::list<std::shared_ptr<Line_Sample>>::iterator> lss,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     lss.remove_if([&](std::list<std::shared_ptr<Line_Sample>>::iterator lsp_it) -> bool {
         if((*lsp_it) == nullptr) return true;
@@ -837,13 +975,13 @@ Whitelist( std::list<std::list<std::shared_ptr<Line_Sample>>::iterator> lss,
                       (*lsp_it)->line.metadata[MetadataKey] :
                       std::optional<std::string>();
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("NAs option not understood. Cannot continue.");
         }
@@ -920,7 +1058,8 @@ Whitelist( std::list<std::list<std::shared_ptr<Transform3>>::iterator> t3s,
            std::string MetadataValueRegex,
            Regex_Selector_Opts Opts ){
 
-    auto theregex = Compile_Regex(std::move(MetadataValueRegex));
+    const auto selector = Compile_Selector(MetadataValueRegex);
+    const auto &matches = *selector;
 
     t3s.remove_if([&](std::list<std::shared_ptr<Transform3>>::iterator t3p_it) -> bool {
         if((*t3p_it) == nullptr) return true;
@@ -934,13 +1073,13 @@ Whitelist( std::list<std::list<std::shared_ptr<Transform3>>::iterator> t3s,
                       (*t3p_it)->metadata[MetadataKey] :
                       std::optional<std::string>();
             if(ValueOpt){
-                return !(std::regex_match(ValueOpt.value(),theregex));
+                return !(matches(ValueOpt.value()));
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Include){
                 return false;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::Exclude){
                 return true;
             }else if(Opts.nas == Regex_Selector_Opts::NAs::TreatAsEmpty){
-                return !(std::regex_match("",theregex));
+                return !(matches(""));
             }
             throw std::logic_error("NAs option not understood. Cannot continue.");
         }
@@ -16,6 +16,8 @@
 #include <boost/filesystem.hpp>
 #include <cstdlib>            //Needed for exit() calls.
 
+#include "Mapped_File.h"
+#include "Mesh_IO.h"
 #include "Structs.h"
 #include "YgorMath.h"         //Needed for vec3 class.
 #include "YgorMathIOSTL.h"
@@ -38,98 +40,64 @@ bool Load_Mesh_From_STL_Files( Drover &DICOM_data,
     //
     if(Filenames.empty()) return true;
 
-    // Attempt to read as an ASCII file first.
-    //
-    // It is easier to reject non-matching files this way since the file syntax will rapidly fail to parse.
-    {
-        size_t i = 0;
-        const size_t N = Filenames.size();
-
-        auto bfit = Filenames.begin();
-        while(bfit != Filenames.end()){
-            FUNCINFO("Parsing file #" << i+1 << "/" << N << " = " << 100*(i+1)/N << "%");
-            ++i;
-            const auto Filename = bfit->string();
-
-            DICOM_data.smesh_data.emplace_back( std::make_shared<Surface_Mesh>() );
-
-            try{
-                //////////////////////////////////////////////////////////////
-                // Attempt to load the file.
+    size_t i = 0;
+    const size_t N = Filenames.size();
+
+    auto bfit = Filenames.begin();
+    while(bfit != Filenames.end()){
+        FUNCINFO("Parsing file #" << i+1 << "/" << N << " = " << 100*(i+1)/N << "%");
+        ++i;
+        const auto Filename = bfit->string();
+
+        DICOM_data.smesh_data.emplace_back( std::make_shared<Surface_Mesh>() );
+
+        try{
+            //////////////////////////////////////////////////////////////
+            // Attempt to load the file.
+            //
+            // The memory-mapped parser handles both ASCII and binary files. If it cannot, fall back to the stream
+            // readers, which accept a broader subset of the format. It is easier to reject non-matching files as ASCII
+            // since the file syntax will rapidly fail to parse, so ASCII is attempted first.
+            bool loaded = false;
+            {
+                mapped_file mf(Filename);
+                loaded = Parse_STL_Mesh(DICOM_data.smesh_data.back()->meshes, mf.view());
+            }
+            if(!loaded){
                 std::ifstream FI(Filename.c_str(), std::ios::in);
-                if(!ReadFVSMeshFromASCIISTL(DICOM_data.smesh_data.back()->meshes, FI)){
-                    throw std::runtime_error("Unable to read mesh from file.");
-                }
-                FI.close();
-                //////////////////////////////////////////////////////////////
-
-                // Reject the file if the mesh is not valid.
-                const auto N_verts = DICOM_data.smesh_data.back()->meshes.vertices.size();
-                const auto N_faces = DICOM_data.smesh_data.back()->meshes.faces.size();
-                if( (N_verts == 0)
-                ||  (N_faces == 0) ){
-                    throw std::runtime_error("Unable to read mesh from file.");
-                }
-
-                FUNCINFO("Loaded surface mesh with " 
-                         << N_verts << " vertices and "
-                         << N_faces << " faces");
-                bfit = Filenames.erase( bfit ); 
-                continue;
-            }catch(const std::exception &e){
+                loaded = ReadFVSMeshFromASCIISTL(DICOM_data.smesh_data.back()->meshes, FI);
+            }
+            if(!loaded){
                 FUNCINFO("Unable to load as ASCII STL mesh file");
-                DICOM_data.smesh_data.pop_back();
-            };
-
-            //Skip the file. It might be destined for some other loader.
-            ++bfit;
-        }
-    }
-
-    // Attempt to read as a binary file.
-    {
-        size_t i = 0;
-        const size_t N = Filenames.size();
-
-        auto bfit = Filenames.begin();
-        while(bfit != Filenames.end()){
-            FUNCINFO("Parsing file #" << i+1 << "/" << N << " = " << 100*(i+1)/N << "%");
-            ++i;
-            const auto Filename = bfit->string();
-
-            DICOM_data.smesh_data.emplace_back( std::make_shared<Surface_Mesh>() );
-
-            try{
-                //////////////////////////////////////////////////////////////
-                // Attempt to load the file.
-                std::ifstream FI(Filename.c_str(), std::ios::in);
-                if(!ReadFVSMeshFromBinarySTL(DICOM_data.smesh_data.back()->meshes, FI)){
-                    throw std::runtime_error("Unable to read mesh from file.");
-                }
-                FI.close();
-                //////////////////////////////////////////////////////////////
-
-                // Reject the file if the mesh is not valid.
-                const auto N_verts = DICOM_data.smesh_data.back()->meshes.vertices.size();
-                const auto N_faces = DICOM_data.smesh_data.back()->meshes.faces.size();
-                if( (N_verts == 0)
-                ||  (N_faces == 0) ){
-                    throw std::runtime_error("Unable to read mesh from file.");
-                }
-
-                FUNCINFO("Loaded surface mesh with " 
-                         << N_verts << " vertices and "
-                         << N_faces << " faces");
-                bfit = Filenames.erase( bfit ); 
-                continue;
-            }catch(const std::exception &e){
-                FUNCINFO("Unable to load as binary STL mesh file");
-                DICOM_data.smesh_data.pop_back();
-            };
-
-            //Skip the file. It might be destined for some other loader.
-            ++bfit;
-        }
+                DICOM_data.smesh_data.back() = std::make_shared<Surface_Mesh>();
+                std::ifstream FI(Filename.c_str(), std::ios::in | std::ios::binary);
+                loaded = ReadFVSMeshFromBinarySTL(DICOM_data.smesh_data.back()->meshes, FI);
+            }
+            if(!loaded){
+                throw std::runtime_error("Unable to read mesh from file.");
+            }
+            //////////////////////////////////////////////////////////////
+
+            // Reject the file if the mesh is not valid.
+            const auto N_verts = DICOM_data.smesh_data.back()->meshes.vertices.size();
+            const auto N_faces = DICOM_data.smesh_data.back()->meshes.faces.size();
+            if( (N_verts == 0)
+            ||  (N_faces == 0) ){
+                throw std::runtime_error("Unable to read mesh from file.");
+            }
+
+            FUNCINFO("Loaded surface mesh with " 
+                     << N_verts << " vertices and "
+                     << N_faces << " faces");
+            bfit = Filenames.erase( bfit ); 
+            continue;
+        }catch(const std::exception &e){
+            FUNCINFO("Unable to load as STL mesh file");
+            DICOM_data.smesh_data.pop_back();
+        };
+
+        //Skip the file. It might be destined for some other loader.
+        ++bfit;
     }
 
     return true;
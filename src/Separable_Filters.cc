@@ -0,0 +1,856 @@
+//Separable_Filters.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+
+#include "Thread_Pool.h"
+
+#include "Separable_Filters.h"
+
+
+// -------------------------------------------- filter_volume --------------------------------------------
+
+void
+filter_volume::init_like(const filter_volume &other, float val){
+    this->N_imgs = other.N_imgs;
+    this->N_rows = other.N_rows;
+    this->N_cols = other.N_cols;
+    this->img_spacing = other.img_spacing;
+    this->row_spacing = other.row_spacing;
+    this->col_spacing = other.col_spacing;
+    this->data.assign(static_cast<size_t>(this->N_imgs * this->N_rows * this->N_cols), val);
+    return;
+}
+
+long int
+filter_volume::index(long int img, long int row, long int col) const {
+    return (img * this->N_rows + row) * this->N_cols + col;
+}
+
+float
+filter_volume::value(long int img, long int row, long int col) const {
+    return this->data[ this->index(img, row, col) ];
+}
+
+float &
+filter_volume::reference(long int img, long int row, long int col){
+    return this->data[ this->index(img, row, col) ];
+}
+
+static void
+validate_volume(const filter_volume &vol){
+    if( (vol.N_imgs <= 0) || (vol.N_rows <= 0) || (vol.N_cols <= 0)
+    ||  (static_cast<long int>(vol.data.size()) != (vol.N_imgs * vol.N_rows * vol.N_cols)) ){
+        throw std::invalid_argument("Volume dimensions are invalid");
+    }
+    if( !(0.0 < vol.img_spacing) || !(0.0 < vol.row_spacing) || !(0.0 < vol.col_spacing)
+    ||  !std::isfinite(vol.img_spacing) || !std::isfinite(vol.row_spacing) || !std::isfinite(vol.col_spacing) ){
+        throw std::invalid_argument("Volume spacing is invalid");
+    }
+    return;
+}
+
+static bool
+same_shape(const filter_volume &A, const filter_volume &B){
+    return (A.N_imgs == B.N_imgs)
+        && (A.N_rows == B.N_rows)
+        && (A.N_cols == B.N_cols)
+        && (A.data.size() == B.data.size());
+}
+
+
+// --------------------------------------------- Line filters ---------------------------------------------
+
+static line_filter_stage
+finite_difference_stage(long int derivative_order, double spacing){
+    line_filter_stage s;
+    s.type = line_filter_stage::kind::fir;
+    s.radius = 1;
+    if(derivative_order == 1){
+        const auto w = static_cast<float>(0.5 / spacing);
+        s.taps = { -w, 0.0f, w };
+    }else{
+        const auto w = static_cast<float>(1.0 / (spacing * spacing));
+        s.taps = { w, -2.0f * w, w };
+    }
+    return s;
+}
+
+// Recursion coefficients b1/b0, b2/b0, and b3/b0 for the Young and van Vliet Gaussian approximation.
+static std::array<double,3>
+yvv_coefficients(double q){
+    const double q2 = q * q;
+    const double q3 = q2 * q;
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    const double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    const double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    const double b3 = 0.422205 * q3;
+    return {{ b1 / b0, b2 / b0, b3 / b0 }};
+}
+
+// Variance of the impulse response of the causal and anti-causal recursions combined, from the derivatives of the
+// transfer function denominator D(z) = 1 - b1 z - b2 z^2 - b3 z^3 at z = 1.
+static double
+yvv_variance(const std::array<double,3> &b){
+    const double D   = 1.0 - b[0] - b[1] - b[2];
+    const double Dp  = -(b[0] + 2.0 * b[1] + 3.0 * b[2]);
+    const double Dpp = -(2.0 * b[1] + 6.0 * b[2]);
+    const double m1 = -Dp / D;
+    const double m2 = -Dpp / D + 2.0 * Dp * Dp / (D * D);
+    return 2.0 * (m2 + m1 - m1 * m1);
+}
+
+line_filter
+Gaussian_Line_Filter( double sigma,
+                      double spacing,
+                      long int derivative_order,
+                      gaussian_method method,
+                      filter_boundary boundary ){
+
+    if( !std::isfinite(spacing) || !(0.0 < spacing) ){
+        throw std::invalid_argument("Sample spacing must be positive");
+    }
+    if( !std::isfinite(sigma) || (sigma < 0.0) ){
+        throw std::invalid_argument("Gaussian sigma must be non-negative");
+    }
+    if( (derivative_order < 0) || (2 < derivative_order) ){
+        throw std::invalid_argument("Only zeroth, first, and second derivatives are supported");
+    }
+    if( (0 < derivative_order) && (boundary == filter_boundary::renormalize) ){
+        throw std::invalid_argument("Derivative filters cannot be renormalized");
+    }
+
+    line_filter out;
+    out.boundary = boundary;
+
+    const double sigma_px = sigma / spacing;
+    const bool use_iir = (0.5 <= sigma_px)
+                      && ( (method == gaussian_method::iir)
+                        || ((method == gaussian_method::automatic) && (3.0 <= sigma_px)) );
+
+    if(sigma_px < 0.1){
+        // The kernel is narrower than the sampling, so there is nothing to smooth. An empty filter is an identity.
+        if(0 < derivative_order){
+            out.stages.emplace_back( finite_difference_stage(derivative_order, spacing) );
+        }
+
+    }else if(use_iir){
+        // Coefficients from Young and van Vliet, "Recursive implementation of the Gaussian filter," Signal Processing
+        // 44 (1995) 139-151. Rather than the published fit for q, which overestimates the width by ~10%, q is chosen so
+        // that the variance of the impulse response matches sigma exactly.
+        const double s2 = sigma_px * sigma_px;
+        double q_lo = 0.0;
+        double q_hi = 2.0 * sigma_px + 2.0;
+        for(long int i = 0; i < 60; ++i){
+            const double q = 0.5 * (q_lo + q_hi);
+            (s2 < yvv_variance(yvv_coefficients(q))) ? (q_hi = q) : (q_lo = q);
+        }
+        const auto b = yvv_coefficients(0.5 * (q_lo + q_hi));
+
+        line_filter_stage st;
+        st.type = line_filter_stage::kind::iir;
+        st.b1 = static_cast<float>(b[0]);
+        st.b2 = static_cast<float>(b[1]);
+        st.b3 = static_cast<float>(b[2]);
+        st.B  = 1.0f - (st.b1 + st.b2 + st.b3); // Unit gain, so constant lines are preserved.
+        out.stages.emplace_back(st);
+
+        if(0 < derivative_order){
+            out.stages.emplace_back( finite_difference_stage(derivative_order, spacing) );
+        }
+
+    }else{
+        // Sampled kernel, normalized so that the discrete moments match the continuous derivative.
+        const auto radius = std::max<long int>(1, static_cast<long int>(std::ceil(4.0 * sigma_px)));
+        std::vector<double> g(2 * radius + 1);
+        std::vector<double> x(2 * radius + 1);
+        for(long int k = -radius; k <= radius; ++k){
+            const double l_x = static_cast<double>(k) * spacing;
+            x[k + radius] = l_x;
+            g[k + radius] = std::exp(-0.5 * (l_x * l_x) / (sigma * sigma));
+        }
+
+        std::vector<double> w(g.size(), 0.0);
+        if(derivative_order == 0){
+            double sum = 0.0;
+            for(const auto &l_g : g) sum += l_g;
+            for(size_t i = 0; i < g.size(); ++i) w[i] = g[i] / sum;
+
+        }else if(derivative_order == 1){
+            // Unit response to a unit ramp.
+            double m = 0.0;
+            for(size_t i = 0; i < g.size(); ++i) m += x[i] * x[i] * g[i];
+            for(size_t i = 0; i < g.size(); ++i) w[i] = x[i] * g[i] / m;
+
+        }else{
+            // Zero response to a constant (enforced via the central tap to avoid cancellation for narrow kernels) and
+            // unit response to a unit parabola.
+            const double s2 = sigma * sigma;
+            double sum = 0.0;
+            for(size_t i = 0; i < g.size(); ++i){
+                if(static_cast<long int>(i) == radius) continue;
+                w[i] = (x[i] * x[i] / s2 - 1.0) * g[i];
+                sum += w[i];
+            }
+            w[radius] = -sum;
+            double m = 0.0;
+            for(size_t i = 0; i < g.size(); ++i) m += 0.5 * x[i] * x[i] * w[i];
+            for(auto &l_w : w) l_w /= m;
+        }
+
+        line_filter_stage st;
+        st.type = line_filter_stage::kind::fir;
+        st.radius = radius;
+        for(const auto &l_w : w) st.taps.push_back(static_cast<float>(l_w));
+        out.stages.emplace_back(st);
+    }
+
+    return out;
+}
+
+
+// Filters a block of adjacent lines. Sample 'n' of line 'j' is stored at buf[n * W + j], so the innermost loops run
+// over contiguous lines and can be vectorized.
+static void
+apply_fir_stage( const float *in,
+                 float *out,
+                 long int N,
+                 long int W,
+                 const line_filter_stage &st,
+                 bool extend ){
+    const long int R = st.radius;
+    for(long int n = 0; n < N; ++n){
+        float *o = out + n * W;
+        std::fill(o, o + W, 0.0f);
+        for(long int k = 0; k <= 2 * R; ++k){
+            long int m = n + k - R;
+            if( (m < 0) || (N <= m) ){
+                if(!extend) continue;
+                m = std::clamp<long int>(m, 0, N - 1);
+            }
+            const float w = st.taps[k];
+            const float *x = in + m * W;
+            for(long int j = 0; j < W; ++j){
+                o[j] += w * x[j];
+            }
+        }
+    }
+    return;
+}
+
+static void
+apply_iir_stage( float *buf,
+                 float *edge,
+                 long int N,
+                 long int W,
+                 const line_filter_stage &st,
+                 bool extend ){
+    const float B  = st.B;
+    const float b1 = st.b1;
+    const float b2 = st.b2;
+    const float b3 = st.b3;
+
+    // Virtual samples beyond the line are held in the edge buffer. For extended boundaries the recursion starts in its
+    // steady state, which is the outermost sample since the gain is unity.
+    //
+    // Causal pass.
+    for(long int e = 0; e < 3; ++e){
+        float *l_e = edge + e * W;
+        if(extend){
+            std::copy(buf, buf + W, l_e);
+        }else{
+            std::fill(l_e, l_e + W, 0.0f);
+        }
+    }
+    const auto prior = [&](long int m) -> const float * {
+        return (0 <= m) ? (buf + m * W) : (edge + (-m - 1) * W);
+    };
+    for(long int n = 0; n < N; ++n){
+        float *y = buf + n * W;
+        const float *p1 = prior(n - 1);
+        const float *p2 = prior(n - 2);
+        const float *p3 = prior(n - 3);
+        for(long int j = 0; j < W; ++j){
+            y[j] = B * y[j] + b1 * p1[j] + b2 * p2[j] + b3 * p3[j];
+        }
+    }
+
+    // Anti-causal pass.
+    for(long int e = 0; e < 3; ++e){
+        float *l_e = edge + e * W;
+        if(extend){
+            std::copy(buf + (N - 1) * W, buf + N * W, l_e);
+        }else{
+            std::fill(l_e, l_e + W, 0.0f);
+        }
+    }
+    const auto later = [&](long int m) -> const float * {
+        return (m < N) ? (buf + m * W) : (edge + (m - N) * W);
+    };
+    for(long int n = N - 1; 0 <= n; --n){
+        float *y = buf + n * W;
+        const float *p1 = later(n + 1);
+        const float *p2 = later(n + 2);
+        const float *p3 = later(n + 3);
+        for(long int j = 0; j < W; ++j){
+            y[j] = B * y[j] + b1 * p1[j] + b2 * p2[j] + b3 * p3[j];
+        }
+    }
+    return;
+}
+
+static void
+apply_line_filter( float *buf,
+                   std::vector<float> &scratch,
+                   long int N,
+                   long int W,
+                   const line_filter &filter,
+                   const std::vector<float> &norm ){
+    const bool extend = (filter.boundary == filter_boundary::extend);
+
+    // The second working area is only needed by FIR stages. The edge buffer holds recursion states beyond the line.
+    scratch.resize(static_cast<size_t>(N * W + 3 * W));
+    float *edge = scratch.data() + N * W;
+
+    float *cur = buf;
+    float *alt = scratch.data();
+    for(const auto &st : filter.stages){
+        if(st.type == line_filter_stage::kind::fir){
+            apply_fir_stage(cur, alt, N, W, st, extend);
+            std::swap(cur, alt);
+        }else{
+            apply_iir_stage(cur, edge, N, W, st, extend);
+        }
+    }
+    if(cur != buf){
+        std::copy(cur, cur + N * W, buf);
+    }
+
+    if(!norm.empty()){
+        for(long int n = 0; n < N; ++n){
+            const float f = norm[n];
+            float *y = buf + n * W;
+            for(long int j = 0; j < W; ++j){
+                y[j] *= f;
+            }
+        }
+    }
+    return;
+}
+
+void
+Filter_Axis( filter_volume &vol,
+             filter_axis axis,
+             const line_filter &filter ){
+    validate_volume(vol);
+    if(filter.stages.empty()) return;
+    for(const auto &st : filter.stages){
+        if( (st.type == line_filter_stage::kind::fir)
+        &&  (static_cast<long int>(st.taps.size()) != (2 * st.radius + 1)) ){
+            throw std::invalid_argument("Filter taps are inconsistent with the radius");
+        }
+    }
+
+    // The volume is treated as 'outer' independent slabs, each holding 'inner' contiguous lines of length N with
+    // adjacent samples separated by 'pitch'. Lines along the column axis are not contiguous with one another, so blocks
+    // of them are transposed into the same layout.
+    const bool transpose = (axis == filter_axis::column);
+    const long int N = (axis == filter_axis::image) ? vol.N_imgs
+                     : (axis == filter_axis::row)   ? vol.N_rows
+                                                    : vol.N_cols;
+    const long int inner = (axis == filter_axis::image) ? (vol.N_rows * vol.N_cols)
+                         : (axis == filter_axis::row)   ? vol.N_cols
+                                                        : (vol.N_imgs * vol.N_rows);
+    const long int outer = (axis == filter_axis::row) ? vol.N_imgs : 1;
+    const long int pitch = (axis == filter_axis::column) ? 1 : inner;
+
+    // Renormalized boundaries are implemented by treating missing samples as zeros and then dividing by the response
+    // to a line of ones, which only depends on the position along the line.
+    std::vector<float> norm;
+    if(filter.boundary == filter_boundary::renormalize){
+        std::vector<float> ones(N, 1.0f);
+        std::vector<float> l_scratch;
+        apply_line_filter(ones.data(), l_scratch, N, 1, filter, {});
+        norm.resize(N);
+        for(long int n = 0; n < N; ++n){
+            norm[n] = (0.0f < ones[n]) ? (1.0f / ones[n]) : 0.0f;
+        }
+    }
+
+    // Size blocks so the working buffers stay cache-resident. Transposed blocks are kept narrow to limit the cost of
+    // the strided gather.
+    const long int target_samples = 1L << 15;
+    long int W_block = transpose ? 16
+                                 : std::max<long int>(16, ((target_samples / N) / 16) * 16);
+    W_block = std::min(W_block, inner);
+
+    struct block_t {
+        long int base;   // Index of sample 0 of the first line.
+        long int width;  // Number of lines.
+    };
+    std::vector<block_t> blocks;
+    for(long int o = 0; o < outer; ++o){
+        for(long int j = 0; j < inner; j += W_block){
+            const long int base = transpose ? (j * vol.N_cols)
+                                            : (o * N * pitch + j);
+            blocks.push_back( { base, std::min(W_block, inner - j) } );
+        }
+    }
+
+    auto *data = vol.data.data();
+    const auto process_blocks = [&,data](long int b_begin, long int b_end) -> void {
+        std::vector<float> buf;
+        std::vector<float> scratch;
+        for(long int b = b_begin; b < b_end; ++b){
+            const auto base = blocks[b].base;
+            const auto W = blocks[b].width;
+            buf.resize(static_cast<size_t>(N * W));
+
+            if(transpose){
+                for(long int j = 0; j < W; ++j){
+                    const float *src = data + base + j * N;
+                    for(long int n = 0; n < N; ++n) buf[n * W + j] = src[n];
+                }
+            }else{
+                for(long int n = 0; n < N; ++n){
+                    const float *src = data + base + n * pitch;
+                    std::copy(src, src + W, buf.data() + n * W);
+                }
+            }
+
+            apply_line_filter(buf.data(), scratch, N, W, filter, norm);
+
+            if(transpose){
+                for(long int j = 0; j < W; ++j){
+                    float *dst = data + base + j * N;
+                    for(long int n = 0; n < N; ++n) dst[n] = buf[n * W + j];
+                }
+            }else{
+                for(long int n = 0; n < N; ++n){
+                    float *dst = data + base + n * pitch;
+                    std::copy(buf.data() + n * W, buf.data() + (n + 1) * W, dst);
+                }
+            }
+        }
+    };
+
+    const long int N_blocks = static_cast<long int>(blocks.size());
+    const long int N_threads = std::max<long int>(1, std::thread::hardware_concurrency());
+    if( (N_blocks < 2) || (N_threads < 2) ){
+        process_blocks(0, N_blocks);
+
+    }else{
+        const long int blocks_per_task = std::max<long int>(1, (N_blocks + N_threads * 4 - 1) / (N_threads * 4));
+        asio_thread_pool tp;
+        for(long int b = 0; b < N_blocks; b += blocks_per_task){
+            tp.submit_task([&,b]() -> void {
+                process_blocks(b, std::min(N_blocks, b + blocks_per_task));
+            });
+        }
+    } // Wait for all tasks to complete.
+
+    return;
+}
+
+
+// ----------------------------------------- Gaussian filtering -----------------------------------------
+
+static void
+filter_all_axes( filter_volume &vol,
+                 const gaussian_filter_params &params,
+                 filter_boundary boundary ){
+    Filter_Axis(vol, filter_axis::image,  Gaussian_Line_Filter(params.img_sigma, vol.img_spacing, 0, params.method, boundary));
+    Filter_Axis(vol, filter_axis::row,    Gaussian_Line_Filter(params.row_sigma, vol.row_spacing, 0, params.method, boundary));
+    Filter_Axis(vol, filter_axis::column, Gaussian_Line_Filter(params.col_sigma, vol.col_spacing, 0, params.method, boundary));
+    return;
+}
+
+filter_volume
+Gaussian_Blur( const filter_volume &in,
+               const gaussian_filter_params &params ){
+    validate_volume(in);
+
+    filter_volume out = in;
+    const bool all_finite = std::all_of(std::begin(in.data), std::end(in.data),
+                                        [](float v){ return std::isfinite(v); });
+    if(all_finite){
+        filter_all_axes(out, params, filter_boundary::renormalize);
+        return out;
+    }
+
+    // Normalized convolution: missing voxels are zeroed and the same filter is applied to an indicator volume.
+    filter_volume mask;
+    mask.init_like(in, 0.0f);
+    const auto N = static_cast<long int>(in.data.size());
+    for(long int i = 0; i < N; ++i){
+        const bool finite = std::isfinite(in.data[i]);
+        mask.data[i] = finite ? 1.0f : 0.0f;
+        out.data[i]  = finite ? in.data[i] : 0.0f;
+    }
+    filter_all_axes(out, params, filter_boundary::renormalize);
+    filter_all_axes(mask, params, filter_boundary::renormalize);
+
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    for(long int i = 0; i < N; ++i){
+        out.data[i] = (1E-3f <= mask.data[i]) ? (out.data[i] / mask.data[i]) : nan;
+    }
+    return out;
+}
+
+gaussian_derivative_outputs
+Gaussian_Derivatives( const filter_volume &in,
+                      const gaussian_filter_params &params,
+                      const gaussian_derivative_request &request ){
+    validate_volume(in);
+    gaussian_derivative_outputs out;
+
+    // Fill non-finite voxels so they do not contaminate their neighbours.
+    filter_volume src = in;
+    std::vector<uint8_t> nonfinite;
+    const auto N = static_cast<long int>(in.data.size());
+    if(!std::all_of(std::begin(in.data), std::end(in.data), [](float v){ return std::isfinite(v); })){
+        nonfinite.resize(N, 0);
+        const auto blurred = Gaussian_Blur(in, params);
+        for(long int i = 0; i < N; ++i){
+            if(!std::isfinite(in.data[i])){
+                nonfinite[i] = 1;
+                src.data[i] = std::isfinite(blurred.data[i]) ? blurred.data[i] : 0.0f;
+            }
+        }
+    }
+
+    // Each output is identified by its derivative order along the image, row, and column axes. Outputs sharing the
+    // leading orders share the intermediate volumes, so each distinct partial filtering is only computed once.
+    struct target_t {
+        std::array<long int,3> order;
+        filter_volume *dest;        // Optional.
+        bool to_laplacian;
+    };
+    std::vector<target_t> targets;
+    const auto add_target = [&](std::array<long int,3> order, filter_volume *dest, bool to_laplacian){
+        for(auto &t : targets){
+            if(t.order == order){
+                if(dest != nullptr) t.dest = dest;
+                t.to_laplacian = t.to_laplacian || to_laplacian;
+                return;
+            }
+        }
+        targets.push_back( { order, dest, to_laplacian } );
+    };
+    if(request.smoothed) add_target({0,0,0}, &out.smoothed, false);
+    if(request.gradient){
+        add_target({1,0,0}, &out.d_i, false);
+        add_target({0,1,0}, &out.d_r, false);
+        add_target({0,0,1}, &out.d_c, false);
+    }
+    if(request.hessian){
+        add_target({2,0,0}, &out.d_ii, false);
+        add_target({0,2,0}, &out.d_rr, false);
+        add_target({0,0,2}, &out.d_cc, false);
+        add_target({1,1,0}, &out.d_ir, false);
+        add_target({1,0,1}, &out.d_ic, false);
+        add_target({0,1,1}, &out.d_rc, false);
+    }
+    if(request.laplacian){
+        add_target({2,0,0}, nullptr, true);
+        add_target({0,2,0}, nullptr, true);
+        add_target({0,0,2}, nullptr, true);
+        out.laplacian.init_like(in, 0.0f);
+    }
+
+    const auto make_filter = [&](filter_axis axis, long int order) -> line_filter {
+        const auto sigma   = (axis == filter_axis::image) ? params.img_sigma
+                           : (axis == filter_axis::row)   ? params.row_sigma
+                                                          : params.col_sigma;
+        const auto spacing = (axis == filter_axis::image) ? in.img_spacing
+                           : (axis == filter_axis::row)   ? in.row_spacing
+                                                          : in.col_spacing;
+        return Gaussian_Line_Filter(sigma, spacing, order, params.method, filter_boundary::extend);
+    };
+
+    for(long int oi = 0; oi <= 2; ++oi){
+        if(std::none_of(std::begin(targets), std::end(targets),
+                        [&](const target_t &t){ return (t.order[0] == oi); })) continue;
+        filter_volume A = src;
+        Filter_Axis(A, filter_axis::image, make_filter(filter_axis::image, oi));
+
+        for(long int o_r = 0; o_r <= 2; ++o_r){
+            if(std::none_of(std::begin(targets), std::end(targets),
+                            [&](const target_t &t){ return (t.order[0] == oi) && (t.order[1] == o_r); })) continue;
+            filter_volume B = A;
+            Filter_Axis(B, filter_axis::row, make_filter(filter_axis::row, o_r));
+
+            for(const auto &t : targets){
+                if( (t.order[0] != oi) || (t.order[1] != o_r) ) continue;
+                filter_volume C = B;
+                Filter_Axis(C, filter_axis::column, make_filter(filter_axis::column, t.order[2]));
+
+                if(t.to_laplacian){
+                    auto &L = out.laplacian.data;
+                    for(long int i = 0; i < N; ++i) L[i] += C.data[i];
+                }
+                if(t.dest != nullptr){
+                    *(t.dest) = std::move(C);
+                }
+            }
+        }
+    }
+
+    if(!nonfinite.empty()){
+        const auto nan = std::numeric_limits<float>::quiet_NaN();
+        for(auto *v : { &out.smoothed, &out.d_i, &out.d_r, &out.d_c,
+                        &out.d_ii, &out.d_rr, &out.d_cc, &out.d_ir, &out.d_ic, &out.d_rc, &out.laplacian }){
+            if(v->data.empty()) continue;
+            for(long int i = 0; i < N; ++i){
+                if(nonfinite[i] != 0) v->data[i] = nan;
+            }
+        }
+    }
+    return out;
+}
+
+filter_volume
+Suppress_Non_Maxima( const filter_volume &d_i,
+                     const filter_volume &d_r,
+                     const filter_volume &d_c ){
+    validate_volume(d_i);
+    if(!same_shape(d_i, d_r) || !same_shape(d_i, d_c)){
+        throw std::invalid_argument("Gradient components must have the same dimensions");
+    }
+
+    filter_volume magn;
+    magn.init_like(d_i, 0.0f);
+    const auto N = static_cast<long int>(magn.data.size());
+    for(long int i = 0; i < N; ++i){
+        magn.data[i] = std::hypot(d_i.data[i], d_r.data[i], d_c.data[i]);
+    }
+
+    // Trilinear interpolation in voxel number coordinates. Positions outside the volume are NaN.
+    const auto interpolate = [&](double p_i, double p_r, double p_c) -> float {
+        const std::array<double,3> p = {{ p_i, p_r, p_c }};
+        const std::array<long int,3> n = {{ magn.N_imgs, magn.N_rows, magn.N_cols }};
+        std::array<long int,3> lo;
+        std::array<long int,3> hi;
+        std::array<double,3> f;
+        for(size_t a = 0; a < 3; ++a){
+            if( !std::isfinite(p[a]) || (p[a] < 0.0) || (static_cast<double>(n[a] - 1) < p[a]) ){
+                return std::numeric_limits<float>::quiet_NaN();
+            }
+            lo[a] = std::min<long int>(static_cast<long int>(std::floor(p[a])), n[a] - 1);
+            hi[a] = std::min<long int>(lo[a] + 1, n[a] - 1);
+            f[a] = p[a] - static_cast<double>(lo[a]);
+        }
+        double out = 0.0;
+        for(long int c = 0; c < 8; ++c){
+            const long int ii = (c & 1) ? hi[0] : lo[0];
+            const long int rr = (c & 2) ? hi[1] : lo[1];
+            const long int cc = (c & 4) ? hi[2] : lo[2];
+            const double w = ((c & 1) ? f[0] : 1.0 - f[0])
+                           * ((c & 2) ? f[1] : 1.0 - f[1])
+                           * ((c & 4) ? f[2] : 1.0 - f[2]);
+            if(w == 0.0) continue;
+            out += w * static_cast<double>(magn.value(ii, rr, cc));
+        }
+        return static_cast<float>(out);
+    };
+
+    filter_volume out;
+    out.init_like(d_i, 0.0f);
+    {
+        asio_thread_pool tp;
+        for(long int img = 0; img < magn.N_imgs; ++img){
+            tp.submit_task([&,img]() -> void {
+                for(long int row = 0; row < magn.N_rows; ++row){
+                    for(long int col = 0; col < magn.N_cols; ++col){
+                        const auto i = magn.index(img, row, col);
+                        const auto m = magn.data[i];
+                        if(!(0.0f < m)) continue; // No gradient, or non-finite.
+
+                        // Step one voxel along the direction of the gradient. The gradient is expressed in DICOM units,
+                        // so it is converted to voxel number coordinates by dividing by the voxel spacing before the
+                        // step is normalized. (Otherwise the step direction is skewed for anisotropic voxels.)
+                        const double g_i = d_i.data[i] / magn.img_spacing;
+                        const double g_r = d_r.data[i] / magn.row_spacing;
+                        const double g_c = d_c.data[i] / magn.col_spacing;
+                        const double g = std::hypot(g_i, g_r, g_c);
+                        if(!(0.0 < g) || !std::isfinite(g)) continue;
+                        const double u_i = g_i / g;
+                        const double u_r = g_r / g;
+                        const double u_c = g_c / g;
+                        const auto n_m = interpolate(img - u_i, row - u_r, col - u_c);
+                        const auto n_p = interpolate(img + u_i, row + u_r, col + u_c);
+                        if( std::isfinite(n_m)
+                        &&  std::isfinite(n_p)
+                        &&  (n_m <= m)
+                        &&  (n_p <= m) ){
+                            out.data[i] = m;
+                        }
+                    }
+                }
+            });
+        }
+    } // Wait for all tasks to complete.
+
+    return out;
+}
+
+
+// --------------------------------------------- Image I/O ---------------------------------------------
+
+std::vector<planar_image<float,double> *>
+Order_Images_For_Filtering( const std::list<std::reference_wrapper<planar_image<float,double>>> &imgs,
+                            double &img_spacing ){
+    if(imgs.empty()){
+        throw std::invalid_argument("No images provided");
+    }
+
+    const auto &first = imgs.front().get();
+    if( (first.rows <= 0) || (first.columns <= 0) || (first.channels <= 0)
+    ||  !(0.0 < first.pxl_dx) || !(0.0 < first.pxl_dy) ){
+        throw std::invalid_argument("Images are empty or have invalid voxel dimensions");
+    }
+    const auto origin = first.position(0, 0);
+    const auto row_unit = first.row_unit.unit();
+    const auto col_unit = first.col_unit.unit();
+    const auto normal = row_unit.Cross(col_unit).unit();
+
+    std::vector<std::pair<double, planar_image<float,double> *>> sorted;
+    for(const auto &img_refw : imgs){
+        auto &img = img_refw.get();
+        if( (img.rows != first.rows)
+        ||  (img.columns != first.columns)
+        ||  (img.channels != first.channels)
+        ||  (static_cast<long int>(img.data.size()) != (img.rows * img.columns * img.channels))
+        ||  (first.pxl_dx * 1E-6 < std::abs(img.pxl_dx - first.pxl_dx))
+        ||  (first.pxl_dy * 1E-6 < std::abs(img.pxl_dy - first.pxl_dy))
+        ||  (img.row_unit.unit().Dot(row_unit) < (1.0 - 1E-6))
+        ||  (img.col_unit.unit().Dot(col_unit) < (1.0 - 1E-6)) ){
+            throw std::invalid_argument("Images do not share dimensions and orientation");
+        }
+
+        const auto dR = img.position(0, 0) - origin;
+        if( (first.pxl_dx * 1E-3 < std::abs(dR.Dot(row_unit)))
+        ||  (first.pxl_dy * 1E-3 < std::abs(dR.Dot(col_unit))) ){
+            throw std::invalid_argument("Images are not aligned in-plane");
+        }
+        sorted.emplace_back( dR.Dot(normal), std::addressof(img) );
+    }
+    std::stable_sort(std::begin(sorted), std::end(sorted),
+                     [](const std::pair<double, planar_image<float,double> *> &L,
+                        const std::pair<double, planar_image<float,double> *> &R){
+                         return (L.first < R.first);
+                     });
+
+    const auto N = static_cast<long int>(sorted.size());
+    if(N == 1){
+        img_spacing = (0.0 < first.pxl_dz) ? first.pxl_dz : 1.0;
+
+    }else{
+        img_spacing = (sorted.back().first - sorted.front().first) / static_cast<double>(N - 1);
+        if(!(0.0 < img_spacing)){
+            throw std::invalid_argument("Images overlap");
+        }
+        for(long int i = 1; i < N; ++i){
+            const auto dz = sorted[i].first - sorted[i-1].first;
+            if(img_spacing * 1E-3 < std::abs(dz - img_spacing)){
+                FUNCWARN("Images are not regularly spaced. Using the mean spacing of " << img_spacing);
+                break;
+            }
+        }
+    }
+
+    std::vector<planar_image<float,double> *> out;
+    for(const auto &p : sorted) out.push_back(p.second);
+    return out;
+}
+
+filter_volume
+Extract_Filter_Volume( const std::vector<planar_image<float,double> *> &imgs,
+                       double img_spacing,
+                       long int channel ){
+    if(imgs.empty()){
+        throw std::invalid_argument("No images provided");
+    }
+    const auto &first = *(imgs.front());
+    if( (channel < 0) || (first.channels <= channel) ){
+        throw std::invalid_argument("Requested channel is not present");
+    }
+
+    filter_volume out;
+    out.N_imgs = static_cast<long int>(imgs.size());
+    out.N_rows = first.rows;
+    out.N_cols = first.columns;
+    out.img_spacing = img_spacing;
+    out.row_spacing = first.pxl_dx;
+    out.col_spacing = first.pxl_dy;
+    out.data.resize(static_cast<size_t>(out.N_imgs * out.N_rows * out.N_cols));
+
+    for(long int img = 0; img < out.N_imgs; ++img){
+        const auto *p = imgs[img];
+        for(long int row = 0; row < out.N_rows; ++row){
+            for(long int col = 0; col < out.N_cols; ++col){
+                out.reference(img, row, col) = p->data[ p->index(row, col, channel) ];
+            }
+        }
+    }
+    return out;
+}
+
+void
+Inject_Filter_Volume( const filter_volume &vol,
+                      const std::vector<planar_image<float,double> *> &imgs,
+                      long int channel,
+                      const std::list<std::reference_wrapper<contour_collection<double>>> &ccsl ){
+    if( static_cast<long int>(imgs.size()) != vol.N_imgs ){
+        throw std::invalid_argument("Volume does not match the images");
+    }
+
+    Mutate_Voxels_Opts mv_opts;
+    mv_opts.editstyle      = Mutate_Voxels_Opts::EditStyle::InPlace;
+    mv_opts.inclusivity    = Mutate_Voxels_Opts::Inclusivity::Centre;
+    mv_opts.contouroverlap = Mutate_Voxels_Opts::ContourOverlap::Ignore;
+    mv_opts.aggregate      = Mutate_Voxels_Opts::Aggregate::First;
+    mv_opts.adjacency      = Mutate_Voxels_Opts::Adjacency::SingleVoxel;
+    mv_opts.maskmod        = Mutate_Voxels_Opts::MaskMod::Noop;
+
+    for(const auto *p : imgs){
+        if( (p->rows != vol.N_rows) || (p->columns != vol.N_cols) ){
+            throw std::invalid_argument("Volume does not match the images");
+        }
+    }
+
+    asio_thread_pool tp;
+    for(long int img = 0; img < vol.N_imgs; ++img){
+        auto *p = imgs[img];
+        tp.submit_task([&,img,p]() -> void {
+            auto f_bounded = [&](long int E_row, long int E_col, long int E_chnl,
+                                 std::reference_wrapper<planar_image<float,double>>, float &voxel_val) -> void {
+                if(E_chnl != channel) return;
+                voxel_val = vol.value(img, E_row, E_col);
+                return;
+            };
+            std::reference_wrapper<planar_image<float,double>> img_refw( std::ref(*p) );
+            Mutate_Voxels<float,double>( img_refw,
+                                         { img_refw },
+                                         ccsl,
+                                         mv_opts,
+                                         f_bounded );
+        });
+    }
+    return;
+}
+
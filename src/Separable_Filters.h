@@ -0,0 +1,177 @@
+//Separable_Filters.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"         //Needed for vec3 class.
+
+
+// A single-channel volume stored contiguously. Columns vary fastest, then rows, then images.
+struct filter_volume {
+    long int N_imgs = 0;
+    long int N_rows = 0;
+    long int N_cols = 0;
+
+    // Spacing (in DICOM units; mm) between adjacent samples along each axis.
+    double img_spacing = 1.0;
+    double row_spacing = 1.0;   // Between adjacent rows, i.e., planar_image::pxl_dx.
+    double col_spacing = 1.0;   // Between adjacent columns, i.e., planar_image::pxl_dy.
+
+    std::vector<float> data;
+
+    // Allocates the buffer and copies the dimensions and spacing of another volume.
+    void init_like(const filter_volume &other, float val);
+
+    long int index(long int img, long int row, long int col) const;
+    float value(long int img, long int row, long int col) const;
+    float &reference(long int img, long int row, long int col);
+};
+
+// The axis a one-dimensional filter is applied along.
+enum class filter_axis {
+    image,
+    row,
+    column,
+};
+
+// Treatment of samples beyond the ends of a line.
+enum class filter_boundary {
+    extend,       // Repeat the outermost sample.
+    renormalize,  // Treat them as missing and renormalize the filter response over the available samples.
+};
+
+enum class gaussian_method {
+    automatic,    // FIR for narrow kernels, IIR otherwise.
+    fir,          // Sampled kernel truncated at 4 sigma. Cost grows with sigma.
+    iir,          // Third-order recursive approximation (Young and van Vliet, 1995). Cost is independent of sigma.
+};
+
+
+// A one-dimensional filter, applied as a sequence of stages along each line.
+struct line_filter_stage {
+    enum class kind {
+        fir,      // out[n] = sum_k taps[k] * in[n + k - radius].
+        iir,      // Forward and backward third-order recursions.
+    } type = kind::fir;
+
+    std::vector<float> taps;
+    long int radius = 0;
+
+    // Recursion coefficients, in the notation of Young and van Vliet: out[n] = B*in[n] + b1*out[n-1] + b2*out[n-2] +
+    // b3*out[n-3], with b1, b2, and b3 already divided by b0.
+    float B  = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float b3 = 0.0f;
+};
+
+struct line_filter {
+    std::vector<line_filter_stage> stages;
+    filter_boundary boundary = filter_boundary::extend;
+};
+
+// Creates a Gaussian (derivative_order = 0) or Gaussian derivative (1 or 2) filter. Sigma and the returned derivatives
+// are expressed in DICOM units (mm) using the provided sample spacing. A sigma of zero disables smoothing; derivatives
+// then reduce to centred finite differences.
+//
+// Recursive filters are only accurate for sigma of at least half a sample, so narrower kernels always use FIR. Recursive
+// derivatives are estimated by centred finite differences of the smoothed line.
+line_filter Gaussian_Line_Filter( double sigma,
+                                  double spacing,
+                                  long int derivative_order,
+                                  gaussian_method method,
+                                  filter_boundary boundary );
+
+// Applies a filter along one axis of the volume, in-place.
+//
+// Lines are processed in cache-sized blocks of adjacent lines so that the innermost loops operate on contiguous memory
+// and can be vectorized. Blocks are processed in parallel.
+void Filter_Axis( filter_volume &vol,
+                  filter_axis axis,
+                  const line_filter &filter );
+
+
+// Per-axis Gaussian widths, in DICOM units (mm). Voxel dimensions are accounted for separately along each axis, so an
+// isotropic sigma produces an isotropic blur even with anisotropic voxels. A sigma of zero disables filtering along
+// the axis.
+struct gaussian_filter_params {
+    double img_sigma = 1.0;
+    double row_sigma = 1.0;
+    double col_sigma = 1.0;
+
+    gaussian_method method = gaussian_method::automatic;
+};
+
+// Gaussian blur. Non-finite voxels and voxels beyond the volume are treated as missing, and the remaining voxels are
+// reweighted. Voxels where the available weight is negligible become NaN.
+filter_volume Gaussian_Blur( const filter_volume &in,
+                             const gaussian_filter_params &params );
+
+// Selects which Gaussian derivative outputs are computed.
+struct gaussian_derivative_request {
+    bool smoothed  = false;
+    bool gradient  = false;
+    bool hessian   = false;
+    bool laplacian = false;
+};
+
+// Gaussian derivatives (in units per mm or per mm^2). Outputs that were not requested are left empty.
+struct gaussian_derivative_outputs {
+    filter_volume smoothed;
+
+    // First derivatives along the image, row, and column axes.
+    filter_volume d_i;
+    filter_volume d_r;
+    filter_volume d_c;
+
+    // Second derivatives.
+    filter_volume d_ii;
+    filter_volume d_rr;
+    filter_volume d_cc;
+    filter_volume d_ir;
+    filter_volume d_ic;
+    filter_volume d_rc;
+
+    // Laplacian-of-Gaussian, d_ii + d_rr + d_cc.
+    filter_volume laplacian;
+};
+
+// Computes all requested outputs at once, sharing the partially-filtered intermediates between outputs. Beyond the
+// volume the outermost voxels are repeated. Non-finite voxels are first filled using a Gaussian blur of their
+// neighbours, and are NaN in all outputs.
+gaussian_derivative_outputs Gaussian_Derivatives( const filter_volume &in,
+                                                  const gaussian_filter_params &params,
+                                                  const gaussian_derivative_request &request );
+
+// Edge thinning. Voxels are retained if their gradient magnitude is not exceeded by the magnitude one voxel away in
+// either direction along the gradient (accounting for voxel spacing). Retained voxels hold the magnitude, others are
+// zero.
+filter_volume Suppress_Non_Maxima( const filter_volume &d_i,
+                                   const filter_volume &d_r,
+                                   const filter_volume &d_c );
+
+
+// Orders a rectilinear set of images along their common normal for use as a volume. Throws if the images do not share
+// row and column counts, voxel dimensions, and orientation, or are not aligned in-plane.
+//
+// If the images are not regularly spaced, the mean spacing is used.
+std::vector<planar_image<float,double> *>
+Order_Images_For_Filtering( const std::list<std::reference_wrapper<planar_image<float,double>>> &imgs,
+                            double &img_spacing );
+
+// Copies a single channel of the ordered images into a volume.
+filter_volume Extract_Filter_Volume( const std::vector<planar_image<float,double> *> &imgs,
+                                     double img_spacing,
+                                     long int channel );
+
+// Overwrites a single channel of the ordered images using the volume. Only voxels with centres bounded by the
+// contours are altered.
+void Inject_Filter_Volume( const filter_volume &vol,
+                           const std::vector<planar_image<float,double> *> &imgs,
+                           long int channel,
+                           const std::list<std::reference_wrapper<contour_collection<double>>> &ccsl );
+
@@ -0,0 +1,335 @@
+//Slice_Renderer.cc - A part of DICOMautomaton 2020. Written by hal clark.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
+
+#include "Colour_Maps.h"
+#include "Thread_Pool.h"
+
+#include "Slice_Renderer.h"
+
+
+// ------------------------------------------ window_colour_lut ------------------------------------------
+
+window_colour_lut::window_colour_lut( const std::function<ClampedColourRGB(double)> &colour_map,
+                                      double low,
+                                      double high,
+                                      std::array<uint8_t,4> nan_colour,
+                                      long int N_entries ){
+    if(!std::isfinite(low) || !std::isfinite(high)){
+        throw std::invalid_argument("Window bounds must be finite");
+    }
+    this->lut = Colour_Map_LUT(colour_map, N_entries);
+    this->window.low = low;
+    this->window.high = high;
+    this->window.nan_colour = nan_colour;
+}
+
+double
+window_colour_lut::get_low() const {
+    return this->window.low;
+}
+
+double
+window_colour_lut::get_high() const {
+    return this->window.high;
+}
+
+void
+window_colour_lut::map( const float *in,
+                        long int N,
+                        long int in_stride,
+                        uint8_t *out_rgba ) const {
+    this->lut->map_rgba(in, N, in_stride, this->window, out_rgba);
+    return;
+}
+
+std::array<uint8_t,4>
+window_colour_lut::map( float val ) const {
+    std::array<uint8_t,4> out;
+    this->map(&val, 1, 1, out.data());
+    return out;
+}
+
+
+// ---------------------------------------- slice_render_settings ----------------------------------------
+
+bool
+slice_render_settings::same_as(const slice_render_settings &rhs) const {
+    return (this->colour_map_name == rhs.colour_map_name)
+        && (this->window_centre == rhs.window_centre)
+        && (this->window_width == rhs.window_width)
+        && (this->nan_colour == rhs.nan_colour)
+        && (this->lut_entries == rhs.lut_entries)
+        && (this->channel == rhs.channel);
+}
+
+
+// ----------------------------------------------- Rendering -----------------------------------------------
+
+std::pair<double,double>
+Select_Render_Window( const planar_image<float,double> &img,
+                      const slice_render_settings &settings ){
+
+    // Use an explicit window if one was provided.
+    if(settings.window_centre && settings.window_width){
+        const auto c = settings.window_centre.value();
+        const auto r = 0.5 * settings.window_width.value();
+        return { c - r, c + r };
+    }
+
+    // Apply a window to the data if it seems like the WindowCenter or WindowWidth specified in the image metadata
+    // are applicable. Note that it is likely that pixels will be clipped or truncated. This is intentional.
+    const auto img_win_valid = img.GetMetadataValueAs<std::string>("WindowValidFor");
+    const auto img_desc      = img.GetMetadataValueAs<std::string>("Description");
+    const auto img_win_c     = img.GetMetadataValueAs<double>("WindowCenter");
+    const auto img_win_fw    = img.GetMetadataValueAs<double>("WindowWidth"); //Full width or range. (Diameter, not radius.)
+    if( img_win_valid && img_desc && img_win_c && img_win_fw
+    &&  (img_win_valid.value() == img_desc.value()) ){
+        const auto c = img_win_c.value();
+        const auto r = 0.5 * img_win_fw.value();
+        return { c - r, c + r };
+    }
+
+    // Otherwise scale pixels to fill the full range. None will be clipped or truncated.
+    const auto minmax = img.minmax();
+    auto low  = static_cast<double>(std::get<0>(minmax));
+    auto high = static_cast<double>(std::get<1>(minmax));
+    if(!std::isfinite(low) || !std::isfinite(high)){
+        low = 0.0;
+        high = 1.0;
+    }
+    return { low, high };
+}
+
+rendered_slice
+Render_Slice( const planar_image<float,double> &img,
+              const window_colour_lut &lut,
+              long int channel ){
+
+    if( (channel < 0) || (img.channels <= channel) ){
+        throw std::invalid_argument("Requested channel is not present");
+    }
+
+    rendered_slice out;
+    out.rows = img.rows;
+    out.columns = img.columns;
+    out.rgba.resize(static_cast<size_t>(out.rows * out.columns * 4));
+    if( (out.rows <= 0) || (out.columns <= 0) ) return out;
+
+    const auto convert_rows = [&](long int row_begin, long int row_end) -> void {
+        for(long int row = row_begin; row < row_end; ++row){
+            lut.map( img.data.data() + img.index(row, 0, channel),
+                     img.columns,
+                     img.channels,
+                     out.rgba.data() + row * img.columns * 4 );
+        }
+    };
+
+    // Small images are not worth the overhead of dispatching to a thread pool.
+    const long int parallel_threshold = 1L << 18;
+    if((out.rows * out.columns) < parallel_threshold){
+        convert_rows(0, out.rows);
+
+    }else{
+        const long int N_threads = std::max<long int>(1, std::thread::hardware_concurrency());
+        const long int rows_per_task = std::max<long int>(1, (out.rows + N_threads * 4 - 1) / (N_threads * 4));
+
+        asio_thread_pool tp;
+        for(long int row = 0; row < out.rows; row += rows_per_task){
+            tp.submit_task([&,row]() -> void {
+                convert_rows(row, std::min(out.rows, row + rows_per_task));
+            });
+        }
+    } // Wait for all tasks to complete.
+
+    return out;
+}
+
+rendered_slice
+Render_Slice( const planar_image<float,double> &img,
+              const slice_render_settings &settings ){
+    const auto window = Select_Render_Window(img, settings);
+    const window_colour_lut lut( settings.colour_map,
+                                 window.first,
+                                 window.second,
+                                 settings.nan_colour,
+                                 settings.lut_entries );
+    return Render_Slice(img, lut, settings.channel);
+}
+
+
+// ------------------------------------------ slice_render_cache ------------------------------------------
+
+slice_render_cache::slice_render_cache(long int capacity) : capacity(std::max<long int>(1, capacity)) {
+    this->worker = std::thread([this](){ this->work(); });
+}
+
+slice_render_cache::~slice_render_cache(){
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        this->quit = true;
+        this->pending.clear();
+    }
+    this->cv.notify_all();
+    this->worker.join();
+}
+
+// Note: the mutex must be held.
+void
+slice_render_cache::touch(key_t img){
+    this->recency.remove(img);
+    this->recency.push_front(img);
+    return;
+}
+
+// Note: the mutex must be held.
+void
+slice_render_cache::insert(key_t img, std::shared_ptr<const rendered_slice> rs){
+    this->cache[img] = std::move(rs);
+    this->touch(img);
+    while(this->capacity < static_cast<long int>(this->cache.size())){
+        this->cache.erase(this->recency.back());
+        this->recency.pop_back();
+    }
+    return;
+}
+
+// Renders an image without holding the mutex. Colour map tables are shared, so this only converts pixels.
+std::shared_ptr<const rendered_slice>
+slice_render_cache::render(key_t img, const slice_render_settings &s){
+    return std::make_shared<const rendered_slice>( Render_Slice(*img, s) );
+}
+
+void
+slice_render_cache::work(){
+    while(true){
+        key_t img = nullptr;
+        slice_render_settings s;
+        long int gen = 0;
+        {
+            std::unique_lock<std::mutex> lock(this->m);
+            this->cv.wait(lock, [&](){ return this->quit || !this->pending.empty(); });
+            if(this->quit) return;
+
+            img = this->pending.front();
+            this->pending.pop_front();
+            if(this->cache.count(img) != 0) continue;
+
+            s = this->settings;
+            gen = this->generation;
+            this->busy = true;
+        }
+
+        std::shared_ptr<const rendered_slice> rs;
+        try{
+            rs = this->render(img, s);
+        }catch(const std::exception &e){
+            FUNCWARN("Unable to render slice in the background: " << e.what());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->m);
+            if( (rs != nullptr) && (gen == this->generation) ){
+                this->insert(img, rs);
+            }
+            this->busy = false;
+        }
+        this->idle_cv.notify_all();
+    }
+}
+
+std::shared_ptr<const rendered_slice>
+slice_render_cache::get( const planar_image<float,double> &img,
+                         const slice_render_settings &s ){
+    const key_t key = &img;
+    long int gen = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        if(!this->settings_valid || !this->settings.same_as(s)){
+            this->settings = s;
+            this->settings_valid = true;
+            ++(this->generation);
+            this->cache.clear();
+            this->recency.clear();
+            this->pending.clear();
+        }
+
+        auto c_it = this->cache.find(key);
+        if(c_it != std::end(this->cache)){
+            this->touch(key);
+            return c_it->second;
+        }
+        gen = this->generation;
+    }
+
+    auto rs = this->render(key, s);
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        if(gen == this->generation) this->insert(key, rs);
+    }
+    return rs;
+}
+
+void
+slice_render_cache::prefetch( const std::list<const planar_image<float,double> *> &imgs ){
+    {
+        std::lock_guard<std::mutex> lock(this->m);
+        if(!this->settings_valid) return;
+        for(const auto &img : imgs){
+            if(img == nullptr) continue;
+            if(this->cache.count(img) != 0) continue;
+            if(std::find(std::begin(this->pending), std::end(this->pending), img) != std::end(this->pending)) continue;
+            this->pending.push_back(img);
+        }
+    }
+    this->cv.notify_one();
+    return;
+}
+
+bool
+slice_render_cache::contains( const planar_image<float,double> &img ){
+    std::lock_guard<std::mutex> lock(this->m);
+    return (this->cache.count(&img) != 0);
+}
+
+void
+slice_render_cache::invalidate( const planar_image<float,double> &img ){
+    std::unique_lock<std::mutex> lock(this->m);
+    this->pending.remove(&img);
+    this->idle_cv.wait(lock, [&](){ return !this->busy; });
+    this->cache.erase(&img);
+    this->recency.remove(&img);
+    return;
+}
+
+void
+slice_render_cache::clear(){
+    std::unique_lock<std::mutex> lock(this->m);
+    ++(this->generation);
+    this->pending.clear();
+    this->idle_cv.wait(lock, [&](){ return !this->busy; });
+    this->cache.clear();
+    this->recency.clear();
+    return;
+}
+
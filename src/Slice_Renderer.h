@@ -0,0 +1,156 @@
+//Slice_Renderer.h - A part of DICOMautomaton 2020. Written by hal clark.
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+
+#include "Colour_Maps.h"
+
+
+// Headless rendering of image slices to packed 8-bit RGBA buffers.
+//
+// This is the display-independent core shared by the interactive viewer and image exporters. Nothing here depends on a
+// windowing system, so it can be used (and tested) without a display.
+
+
+// A row-major buffer of packed 8-bit RGBA pixels, suitable for uploading directly into a texture.
+struct rendered_slice {
+    long int rows    = 0;
+    long int columns = 0;
+    std::vector<uint8_t> rgba; // rows * columns * 4 bytes.
+};
+
+
+// A window (linear ramp clamped to [low,high]) composed with a colour map.
+//
+// The colour map is sampled into a shared table (see Colour_Map_LUT), so it is only evaluated when the table is first
+// built. Non-finite values are mapped to a dedicated colour. If high <= low the window degenerates to a step at 'low'.
+class window_colour_lut {
+  private:
+    std::shared_ptr<const colour_map_lut> lut;
+    colour_lut_window window;
+
+  public:
+    window_colour_lut( const std::function<ClampedColourRGB(double)> &colour_map,
+                       double low,
+                       double high,
+                       std::array<uint8_t,4> nan_colour,
+                       long int N_entries = 4096 );
+
+    double get_low() const;
+    double get_high() const;
+
+    // Maps 'N' values read with the given stride into packed RGBA pixels.
+    void map( const float *in,
+              long int N,
+              long int in_stride,
+              uint8_t *out_rgba ) const;
+
+    std::array<uint8_t,4> map( float val ) const;
+};
+
+
+// Parameters that control how slices are rendered.
+struct slice_render_settings {
+    // Identifies the colour map for caching. Settings with the same name are assumed to use the same colour map.
+    std::string colour_map_name;
+    std::function<ClampedColourRGB(double)> colour_map;
+
+    // An explicit window. If not provided, the window from the image metadata is used when it is applicable, and the
+    // full range of pixel values is used otherwise.
+    std::optional<double> window_centre;
+    std::optional<double> window_width; // Full width.
+
+    std::array<uint8_t,4> nan_colour = {{ 60, 0, 0, 255 }}; // Dark red. Should not be very distracting.
+    long int lut_entries = 4096;
+    long int channel = 0;
+
+    bool same_as(const slice_render_settings &rhs) const;
+};
+
+
+// Determines the window [low,high] that will be used to render an image.
+std::pair<double,double>
+Select_Render_Window( const planar_image<float,double> &img,
+                      const slice_render_settings &settings );
+
+
+// Renders a single channel of an image. Rows are converted in parallel for large images.
+rendered_slice
+Render_Slice( const planar_image<float,double> &img,
+              const window_colour_lut &lut,
+              long int channel = 0 );
+
+rendered_slice
+Render_Slice( const planar_image<float,double> &img,
+              const slice_render_settings &settings );
+
+
+// A cache of rendered slices that renders neighbouring slices in the background.
+//
+// Images are identified by address, so images must outlive the cache or be removed with invalidate() (or clear())
+// before they are destroyed or their pixels are altered. Changing the render settings discards all cached slices.
+class slice_render_cache {
+  private:
+    using key_t = const planar_image<float,double> *;
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::condition_variable idle_cv;
+
+    slice_render_settings settings;
+    bool settings_valid = false;
+    long int generation = 0;
+
+    long int capacity;
+    std::map<key_t, std::shared_ptr<const rendered_slice>> cache;
+    std::list<key_t> recency; // Most recently used at the front.
+
+    std::list<key_t> pending;
+    bool busy = false;
+    bool quit = false;
+    std::thread worker;
+
+    void touch(key_t img);
+    void insert(key_t img, std::shared_ptr<const rendered_slice> rs);
+    std::shared_ptr<const rendered_slice> render(key_t img, const slice_render_settings &s);
+    void work();
+
+  public:
+    explicit slice_render_cache(long int capacity = 16);
+    ~slice_render_cache();
+
+    slice_render_cache(const slice_render_cache &) = delete;
+    slice_render_cache & operator=(const slice_render_cache &) = delete;
+
+    // Returns the rendered slice, rendering it immediately if it is not already cached.
+    std::shared_ptr<const rendered_slice> get( const planar_image<float,double> &img,
+                                               const slice_render_settings &settings );
+
+    // Queues the given images for rendering in the background using the current settings.
+    void prefetch( const std::list<const planar_image<float,double> *> &imgs );
+
+    // Whether the image has been rendered using the current settings.
+    bool contains( const planar_image<float,double> &img );
+
+    // Removes a single image. Waits for any in-flight rendering to complete.
+    void invalidate( const planar_image<float,double> &img );
+
+    // Removes all images and pending work. Waits for any in-flight rendering to complete.
+    void clear();
+};
+
@@ -615,5 +615,8 @@ struct OperationDoc {
     std::string desc; // Documentation for the operation itself.
     std::list<std::string> notes; // Special notes concerning the operation, usually caveats or notices.
 
+    // Whether the operation writes files directly, interacts with the user, or otherwise has effects beyond the Drover.
+    // Such operations are never invoked concurrently by Operation_Dispatcher().
+    bool has_external_side_effects = false;
 };
 
@@ -13,6 +13,8 @@
 #include <mutex>
 #include <limits>
 #include <cmath>
+#include <numeric>
+#include <unordered_map>
 
 #include <utility>            //Needed for std::pair.
 #include <algorithm>
@@ -44,6 +46,7 @@
 #include <CGAL/minkowski_sum_3.h>
 
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
+#include <CGAL/boost/graph/copy_face_graph.h>
 
 #include <CGAL/Mesh_triangulation_3.h>
 #include <CGAL/Mesh_complex_3_in_triangulation_3.h>
@@ -61,9 +64,11 @@
 #include "YgorImages.h"
 
 #include "Structs.h"
+#include "Thread_Pool.h"
 
 #include "YgorImages_Functors/Grouping/Misc_Functors.h"
 #include "YgorImages_Functors/Processing/Partitioned_Image_Voxel_Visitor_Mutator.h"
+#include "YgorImages_Functors/Compute/Signed_Distance_Transform.h"
 
 #include "Surface_Meshes.h"
 
@@ -1679,6 +1684,30 @@ SaveAsOFF(Polyhedron &mesh,
 
 
 
+// Convert a Polyhedron (with EPIC kernel) to a Nef_Polyhedron (typically with EPEC kernel).
+//
+// Closed meshes are converted directly by copying the halfedge structure into an exact-kernel Polyhedron. Meshes with
+// boundaries are not accepted by the Nef_Polyhedron Polyhedron constructor, so they are converted via OFF instead.
+template <class NefKernel>
+static
+CGAL::Nef_polyhedron_3<NefKernel>
+Polyhedron_To_Nef_Polyhedron(const Polyhedron &mesh){
+    using Nef_polyhedron = CGAL::Nef_polyhedron_3<NefKernel>;
+
+    if(mesh.is_closed()){
+        CGAL::Polyhedron_3<NefKernel> exact_mesh;
+        CGAL::copy_face_graph(mesh, exact_mesh);
+        return Nef_polyhedron(exact_mesh);
+    }
+
+    Nef_polyhedron nef_mesh;
+    std::stringstream ss_off;
+    ss_off << mesh;
+    CGAL::OFF_to_nef_3(ss_off, nef_mesh);
+    return nef_mesh;
+}
+
+
 // This routine uses the divide-and-conquer strategy to compute full 3D Minkowski sum of arbitrary nef polyhedra,
 // breaking them into sets of connected convex sub-polyhedra and performing a convex Minkowski sum for every pair. 
 // It has bad algorithmic complexity: O(m^{3} n^{3}) where n and m are the complexity of the input polyhedra.
@@ -1698,21 +1727,9 @@ void Dilate( Polyhedron &mesh,
     using NefKernel = CGAL::Exact_predicates_exact_constructions_kernel;
     using Nef_polyhedron = CGAL::Nef_polyhedron_3<NefKernel>;
 
-    // Convert between Polyhedra (with EPIC kernel) and Nef_Polyhedra (with EPEC kernel) via conversion to OFF and back.
-    //
-    // Note: This is obviously not ideal, but it severs the coupling between polyhedra and it was not possible to have
-    //       a uniform kernel for both.
-    Nef_polyhedron nef_mesh;
-    std::stringstream ss_mesh_off;
-    ss_mesh_off << mesh;
-    CGAL::OFF_to_nef_3(ss_mesh_off, nef_mesh);
-    ss_mesh_off.clear();
-
-    Nef_polyhedron nef_sphere;
-    std::stringstream ss_sphere_off;
-    ss_sphere_off << sphere;
-    CGAL::OFF_to_nef_3(ss_sphere_off, nef_sphere);
-    ss_sphere_off.clear();
+    // Convert between Polyhedra (with EPIC kernel) and Nef_Polyhedra (with EPEC kernel).
+    Nef_polyhedron nef_mesh = Polyhedron_To_Nef_Polyhedron<NefKernel>(mesh);
+    Nef_polyhedron nef_sphere = Polyhedron_To_Nef_Polyhedron<NefKernel>(sphere);
 
     FUNCINFO("About to compute 3D Minkowski sum");
     Nef_polyhedron result = CGAL::minkowski_sum_3(nef_mesh, nef_sphere);
@@ -1750,15 +1767,8 @@ void Dilate( Polyhedron &output_mesh,
     };
 
 
-    // Convert between Polyhedra (with EPIC kernel) and Nef_Polyhedra (with EPEC kernel) via conversion to OFF and back.
-    //
-    // Note: This is obviously not ideal, but it severs the coupling between polyhedra and it was not possible to have
-    //       a uniform kernel for both.
-    Nef_polyhedron nef_sphere;
-    std::stringstream ss_sphere_off;
-    ss_sphere_off << sphere;
-    CGAL::OFF_to_nef_3(ss_sphere_off, nef_sphere);
-    ss_sphere_off.clear();
+    // Convert between Polyhedra (with EPIC kernel) and Nef_Polyhedra (with EPEC kernel).
+    Nef_polyhedron nef_sphere = Polyhedron_To_Nef_Polyhedron<NefKernel>(sphere);
 
 
 /*
@@ -1923,13 +1933,7 @@ Transform( Polyhedron &output_mesh,
 
 
     const auto Poly_to_NefPoly = [=]( const Polyhedron &poly ) -> Nef_polyhedron {
-        Nef_polyhedron nef_poly;
-        std::stringstream ss_off;
-        ss_off << poly;
-
-        CGAL::OFF_to_nef_3(ss_off, nef_poly);
-        ss_off.clear();
-        return nef_poly;
+        return Polyhedron_To_Nef_Polyhedron<NefKernel>(poly);
     };
 
     const auto NefPoly_to_Poly = [=]( const Nef_polyhedron &nef_poly ) -> Polyhedron {
@@ -2014,6 +2018,175 @@ Transform( Polyhedron &output_mesh,
     return;
 }
 
+// Approximate dilation, erosion, or core/peel computed on a voxel grid rather than with Nef polyhedra.
+//
+// The ROIs are rasterized onto a grid fitted to the ROIs (plus a margin that accommodates the offset surface), an exact
+// signed Euclidean distance transform is computed, the distance field is thresholded at the requested distance, and a
+// surface is extracted using Marching Cubes. In-plane voxels are isotropic with sides no larger than 'voxel_size'.
+// Images are aligned with the contour planes and are separated by the contour plane separation, so each contour plane
+// is rasterized exactly once.
+//
+// The distance transform is exact on the grid, so the error is dominated by rasterization and surface extraction. The
+// Hausdorff distance between the extracted surface and the exact offset surface is expected to be no greater than one
+// voxel diagonal, i.e., sqrt(dx^2 + dy^2 + dz^2) where dz is the contour plane separation. The bound is reported when
+// the routine runs.
+Polyhedron
+Transform_Via_Distance_Field( const std::list<std::reference_wrapper<contour_collection<double>>> &cc_ROIs,
+                              double distance,
+                              double voxel_size,
+                              TransformOp op ){
+
+    if(cc_ROIs.empty()){
+        throw std::invalid_argument("No contours provided. Cannot continue.");
+    }
+    if(!std::isfinite(distance)){
+        throw std::invalid_argument("Distance is not finite. Cannot continue.");
+    }
+    if(!std::isfinite(voxel_size) || (voxel_size <= 0.0)){
+        throw std::invalid_argument("Voxel size must be positive. Cannot continue.");
+    }
+    distance = std::abs(distance);
+
+    // Figure out plane alignment and work out spacing.
+    const auto est_cont_normal = Average_Contour_Normals(cc_ROIs);
+    const auto unique_planar_separation_threshold = 0.005; // Contours separated by less are considered to be on the same plane.
+    const auto ucp = Unique_Contour_Planes(cc_ROIs, est_cont_normal, unique_planar_separation_threshold);
+
+    const auto pi = std::acos(-1.0);
+    const auto GridZ = est_cont_normal.unit();
+    vec3<double> GridX = GridZ.rotate_around_z(pi * 0.5); // Try Z. Will often be idempotent.
+    if(GridX.Dot(GridZ) > 0.25){
+        GridX = GridZ.rotate_around_y(pi * 0.5);  //Should always work since GridZ is parallel to Z.
+    }
+    vec3<double> GridY = GridZ.Cross(GridX);
+    if(!GridZ.GramSchmidt_orthogonalize(GridX, GridY)){
+        throw std::runtime_error("Unable to find grid orientation vectors.");
+    }
+    GridX = GridX.unit();
+    GridY = GridY.unit();
+
+    double sep_per_plane = voxel_size;
+    if(ucp.size() > 1){
+        std::vector<double> seps;
+        for(auto itA = std::begin(ucp); ; ++itA){
+            auto itB = std::next(itA);
+            if(itB == std::end(ucp)) break;
+            seps.emplace_back( std::abs(itA->Get_Signed_Distance_To_Point(itB->R_0)) );
+        }
+        sep_per_plane = Stats::Median(seps);
+        if(RELATIVE_DIFF(Stats::Min(seps), Stats::Max(seps)) > 0.01){
+            FUNCWARN("Planar separations are not consistent. Assuming the median separation for all contours.");
+        }
+    }else{
+        FUNCWARN("Only a single contour plane was detected. Assuming it is " << sep_per_plane << " thick");
+    }
+
+    // Only dilation extends the surface beyond the ROIs. A small buffer of exterior voxels is always included so
+    // the extracted surface is closed.
+    const double offset_margin = (op == TransformOp::Dilate) ? distance : 0.0;
+    const double xy_margin = offset_margin + 2.0 * voxel_size;
+    const auto extra_imgs = static_cast<long int>( std::ceil( (offset_margin + sep_per_plane) / sep_per_plane ) );
+    const long int N_imgs = static_cast<long int>(ucp.size()) + 2 * extra_imgs;
+    const double z_margin = sep_per_plane * (static_cast<double>(extra_imgs) + 0.5);
+
+    // Pad the shorter in-plane extent so the grid is square, which makes in-plane voxels isotropic.
+    const auto inf = std::numeric_limits<double>::infinity();
+    double x_min = inf, x_max = -inf, y_min = inf, y_max = -inf;
+    for(const auto &cc_refw : cc_ROIs){
+        for(const auto &c : cc_refw.get().contours){
+            for(const auto &p : c.points){
+                const auto x = p.Dot(GridX);
+                const auto y = p.Dot(GridY);
+                x_min = std::min(x_min, x);
+                x_max = std::max(x_max, x);
+                y_min = std::min(y_min, y);
+                y_max = std::max(y_max, y);
+            }
+        }
+    }
+    if(!std::isfinite(x_min) || !std::isfinite(y_min)){
+        throw std::invalid_argument("Contours contain no vertices. Cannot continue.");
+    }
+    const double extent = std::max(x_max - x_min, y_max - y_min);
+    const double x_margin = xy_margin + 0.5 * (extent - (x_max - x_min));
+    const double y_margin = xy_margin + 0.5 * (extent - (y_max - y_min));
+    const auto N_inplane = std::max<long int>(2, static_cast<long int>( std::ceil( (extent + 2.0 * xy_margin) / voxel_size ) ));
+
+    const long int NumberOfChannels = 1;
+    const double PixelFill = 0.0;
+    const bool OnlyExtremeSlices = false;
+    auto grid_image_collection = Contiguously_Grid_Volume<float,double>(
+             cc_ROIs,
+             x_margin, y_margin, z_margin,
+             N_inplane, N_inplane,
+             NumberOfChannels, N_imgs,
+             GridX, GridY, GridZ,
+             PixelFill, OnlyExtremeSlices );
+
+    std::vector<std::reference_wrapper<planar_image<float,double>>> ordered_imgs;
+    for(auto &img : grid_image_collection.images){
+        ordered_imgs.emplace_back( std::ref(img) );
+    }
+    std::sort( std::begin(ordered_imgs), std::end(ordered_imgs),
+               [&](const std::reference_wrapper<planar_image<float,double>> &A,
+                   const std::reference_wrapper<planar_image<float,double>> &B){
+                   return (A.get().center().Dot(GridZ) < B.get().center().Dot(GridZ));
+               });
+
+    // Rasterize and compute the signed distance to the ROI boundary.
+    Dense_Voxel_Grid_Geometry geom;
+    const auto mask = Rasterize_Contours(ordered_imgs, cc_ROIs, geom);
+    if(std::none_of(std::begin(mask), std::end(mask), [](uint8_t m){ return (m != 0); })){
+        throw std::runtime_error("ROIs did not cover any voxels. Try a smaller voxel size.");
+    }
+    const auto sdt = Signed_Euclidean_Distance_Transform(mask, geom);
+
+    const auto accuracy_bound = std::sqrt( geom.row_spacing * geom.row_spacing
+                                         + geom.col_spacing * geom.col_spacing
+                                         + geom.img_spacing * geom.img_spacing );
+    FUNCINFO("Computing offset surface on a " << geom.rows << "x" << geom.columns << "x" << geom.imgs << " grid."
+             " Surface error is expected to be within " << accuracy_bound);
+
+    // Distances are measured between voxel centres, so shift them by half a voxel to place the ROI boundary midway
+    // between interior and exterior voxels. Then offset the field so that the surface is the zero level set.
+    const double half_voxel = 0.5 * std::min(geom.row_spacing, geom.col_spacing);
+    {
+        asio_thread_pool tp;
+        for(long int img_num = 0; img_num < geom.imgs; ++img_num){
+            tp.submit_task([&,img_num]() -> void {
+                auto &img = ordered_imgs[img_num].get();
+                for(long int row = 0; row < geom.rows; ++row){
+                    for(long int col = 0; col < geom.columns; ++col){
+                        const auto d = static_cast<double>( sdt[ geom.index(img_num, row, col) ] );
+                        const auto phi = (d < 0.0) ? (d + half_voxel) : (d - half_voxel);
+
+                        double val = phi;
+                        if(op == TransformOp::Dilate){
+                            val = phi - distance;
+                        }else if(op == TransformOp::Erode){
+                            val = phi + distance;
+                        }else if(op == TransformOp::Shell){
+                            val = std::max(phi, -(phi + distance));
+                        }
+                        img.reference(row, col, 0) = static_cast<float>(val);
+                    }
+                }
+            });
+        }
+    } // Wait for all tasks to complete.
+
+    // Extract the zero level set.
+    std::list<std::reference_wrapper<planar_image<float,double>>> grid_imgs( std::begin(ordered_imgs),
+                                                                             std::end(ordered_imgs) );
+    const double inclusion_threshold = 0.0;
+    const bool below_is_interior = true;
+    dcma_surface_meshes::Parameters meshing_params;
+    return dcma_surface_meshes::Estimate_Surface_Mesh_Marching_Cubes( grid_imgs,
+                                                                      inclusion_threshold,
+                                                                      below_is_interior,
+                                                                      meshing_params );
+}
+
 // This routine returns contours generated by slicing a mesh along the given planes.
 contour_collection<double> Slice_Polyhedron(
         const Polyhedron &mesh,
@@ -2075,6 +2248,273 @@ contour_collection<double> Slice_Polyhedron(
 }        
 
 
+// This routine slices a mesh along many planes at once, returning one contour collection per plane (in the same order
+// as the planes were provided).
+//
+// Rather than constructing a CGAL slicer (and its internal AABB tree) and walking the whole mesh for every plane, the
+// extent of every face along each distinct plane normal is computed once and swept so that each plane only visits the
+// faces that straddle it. Planes are then sliced in parallel and the resulting segments are chained into contours by
+// matching the mesh edges they cross using a hash map.
+//
+// Contours are oriented using the face normals, so outer boundaries are counter-clockwise and holes clockwise when
+// viewed looking down the plane normal (i.e., the mesh must be consistently oriented, as a Polyhedron normally is).
+// Vertices lying exactly on a plane are symbolically perturbed to the positive side, so every contour vertex lies on
+// a mesh edge and closed meshes produce closed contours.
+std::vector<contour_collection<double>>
+Slice_Polyhedron_Planes(
+        const Polyhedron &mesh,
+        const std::vector<plane<double>> &planes ){
+
+    std::vector<contour_collection<double>> out(planes.size());
+    if(planes.empty()) return out;
+
+    // Flatten the polyhedron into indexed face-vertex arrays so vertices can be referred to by integer ID.
+    std::vector<vec3<double>> verts;
+    std::vector<std::vector<size_t>> faces;
+    {
+        std::unordered_map<const void*, size_t> v_index;
+        verts.reserve(mesh.size_of_vertices());
+        v_index.reserve(mesh.size_of_vertices());
+        for(auto v_it = mesh.vertices_begin(); v_it != mesh.vertices_end(); ++v_it){
+            const auto &p = v_it->point();
+            v_index[ static_cast<const void*>(&*v_it) ] = verts.size();
+            verts.emplace_back( static_cast<double>(CGAL::to_double(p.x())),
+                                static_cast<double>(CGAL::to_double(p.y())),
+                                static_cast<double>(CGAL::to_double(p.z())) );
+        }
+
+        faces.reserve(mesh.size_of_facets());
+        for(auto f_it = mesh.facets_begin(); f_it != mesh.facets_end(); ++f_it){
+            faces.emplace_back();
+            auto h = f_it->facet_begin();
+            do{
+                faces.back().push_back( v_index.at( static_cast<const void*>(&*(h->vertex())) ) );
+            }while(++h != f_it->facet_begin());
+        }
+    }
+
+    // Pre-compute face normals (via Newell's method, which is robust to non-triangular faces).
+    std::vector<vec3<double>> face_normals;
+    face_normals.reserve(faces.size());
+    for(const auto &f : faces){
+        vec3<double> n(0.0, 0.0, 0.0);
+        const auto N_f = f.size();
+        for(size_t i = 0; i < N_f; ++i){
+            const auto &A = verts[ f[i] ];
+            const auto &B = verts[ f[(i + 1) % N_f] ];
+            n.x += (A.y - B.y) * (A.z + B.z);
+            n.y += (A.z - B.z) * (A.x + B.x);
+            n.z += (A.x - B.x) * (A.y + B.y);
+        }
+        face_normals.emplace_back(n);
+    }
+
+    // Group planes that share a common normal. Image planes within an image array are typically all parallel, so
+    // there is typically only a single group.
+    struct plane_group_t {
+        vec3<double> N;
+        std::vector<size_t> plane_indices;
+    };
+    std::vector<plane_group_t> groups;
+    for(size_t i = 0; i < planes.size(); ++i){
+        const auto N = planes[i].N_0.unit();
+        auto g_it = std::find_if(groups.begin(), groups.end(), [&](const plane_group_t &g){
+                                     return (1.0 - std::abs(g.N.Dot(N))) < 1.0E-9;
+                                 });
+        if(g_it == groups.end()){
+            groups.emplace_back();
+            groups.back().N = N;
+            g_it = std::prev(groups.end());
+        }
+        g_it->plane_indices.push_back(i);
+    }
+
+    // For each plane, the list of faces whose extent along the plane normal straddles the plane.
+    std::vector<std::vector<size_t>> candidates(planes.size());
+    for(auto &g : groups){
+        // Face extents along the group normal.
+        std::vector<std::pair<double,double>> extents;
+        extents.reserve(faces.size());
+        for(const auto &f : faces){
+            auto lo = std::numeric_limits<double>::infinity();
+            auto hi = -lo;
+            for(const auto &v_i : f){
+                const auto d = g.N.Dot(verts[v_i]);
+                lo = std::min(lo, d);
+                hi = std::max(hi, d);
+            }
+            extents.emplace_back(lo, hi);
+        }
+
+        std::vector<size_t> faces_by_lo(faces.size());
+        std::iota(faces_by_lo.begin(), faces_by_lo.end(), 0);
+        std::sort(faces_by_lo.begin(), faces_by_lo.end(), [&](size_t a, size_t b){
+                      return extents[a].first < extents[b].first;
+                  });
+
+        // Plane offsets along the group normal, with a small tolerance so that faces which merely touch a plane are
+        // still considered.
+        std::vector<std::pair<double,size_t>> offsets;
+        for(const auto &p_i : g.plane_indices){
+            offsets.emplace_back( g.N.Dot(planes[p_i].R_0), p_i );
+        }
+        std::sort(offsets.begin(), offsets.end());
+
+        // Sweep the planes in order of increasing offset. Faces enter the active set when the plane passes their lower
+        // extent and are retired (lazily) once the plane passes their upper extent.
+        const auto cmp_hi = [&](size_t a, size_t b){ return extents[a].second > extents[b].second; };
+        std::vector<size_t> active; // Min-heap on upper extent.
+        auto next_face = faces_by_lo.begin();
+        const double eps = 1.0E-9;
+        for(const auto &o : offsets){
+            const auto d = o.first;
+            while( (next_face != faces_by_lo.end()) && (extents[*next_face].first <= (d + eps)) ){
+                active.push_back(*next_face);
+                std::push_heap(active.begin(), active.end(), cmp_hi);
+                ++next_face;
+            }
+            while( !active.empty() && (extents[active.front()].second < (d - eps)) ){
+                std::pop_heap(active.begin(), active.end(), cmp_hi);
+                active.pop_back();
+            }
+            candidates[o.second] = active;
+        }
+    }
+
+    // Slice each plane independently.
+    const auto slice_plane = [&](size_t p_i) -> void {
+        const auto &P = planes[p_i];
+        const auto N = P.N_0.unit();
+        const auto d_0 = N.Dot(P.R_0);
+
+        // Signed distance with symbolic perturbation: vertices on the plane are treated as lying above it.
+        const auto above = [&](size_t v_i) -> bool {
+            return ((N.Dot(verts[v_i]) - d_0) >= 0.0);
+        };
+
+        using edge_key_t = std::pair<size_t,size_t>;
+        struct edge_key_hash {
+            size_t operator()(const edge_key_t &k) const {
+                return std::hash<size_t>()(k.first) ^ (std::hash<size_t>()(k.second) * 0x9E3779B97F4A7C15ULL);
+            }
+        };
+        struct segment_t {
+            edge_key_t A;
+            edge_key_t B;
+            bool used = false;
+        };
+        std::vector<segment_t> segments;
+        std::unordered_map<edge_key_t, vec3<double>, edge_key_hash> crossings;
+        std::unordered_multimap<edge_key_t, size_t, edge_key_hash> segments_by_start;
+
+        std::vector<std::pair<edge_key_t, vec3<double>>> face_crossings;
+        for(const auto &f_i : candidates[p_i]){
+            const auto &f = faces[f_i];
+            const auto N_f = f.size();
+
+            face_crossings.clear();
+            for(size_t i = 0; i < N_f; ++i){
+                const auto v_a = f[i];
+                const auto v_b = f[(i + 1) % N_f];
+                const auto a_above = above(v_a);
+                if(a_above == above(v_b)) continue;
+
+                // Compute the intersection using a canonical edge ordering so that neighbouring faces produce
+                // bitwise-identical vertices.
+                const auto key = std::make_pair( std::min(v_a, v_b), std::max(v_a, v_b) );
+                auto c_it = crossings.find(key);
+                if(c_it == crossings.end()){
+                    const auto &R_lo = verts[key.first];
+                    const auto &R_hi = verts[key.second];
+                    const auto d_lo = N.Dot(R_lo) - d_0;
+                    const auto d_hi = N.Dot(R_hi) - d_0;
+                    const auto t = d_lo / (d_lo - d_hi);
+                    c_it = crossings.emplace(key, R_lo + (R_hi - R_lo) * t).first;
+                }
+                face_crossings.emplace_back(key, c_it->second);
+
+                // Keep the crossing where the boundary passes from above to below first. For a convex face wound
+                // counter-clockwise around its outward normal, the segment then runs along N x face_normal, keeping
+                // the solid on the left. This is decided topologically so that zero-length segments (i.e., where the
+                // plane passes through a vertex) are oriented consistently too.
+                if(a_above && (face_crossings.size() == 2)) std::swap(face_crossings[0], face_crossings[1]);
+            }
+            if(face_crossings.size() < 2) continue;
+
+            // Non-convex faces can cross the plane more than twice. Order the crossings geometrically along the
+            // intersection line and pair them up.
+            if(face_crossings.size() > 2){
+                const auto dir = N.Cross(face_normals[f_i]);
+                std::sort(face_crossings.begin(), face_crossings.end(),
+                          [&](const auto &a, const auto &b){ return dir.Dot(a.second) < dir.Dot(b.second); });
+            }
+            for(size_t i = 0; (i + 1) < face_crossings.size(); i += 2){
+                const auto &A = face_crossings[i];
+                const auto &B = face_crossings[i + 1];
+                if(A.first == B.first) continue;
+
+                segments_by_start.emplace(A.first, segments.size());
+                segments.push_back( segment_t{ A.first, B.first } );
+            }
+        }
+
+        // Chain the segments into contours by following shared edges.
+        auto &cc = out[p_i];
+        for(size_t s_i = 0; s_i < segments.size(); ++s_i){
+            if(segments[s_i].used) continue;
+
+            contour_of_points<double> cop;
+            const auto start = segments[s_i].A;
+            auto curr = s_i;
+            bool closed = false;
+            while(true){
+                segments[curr].used = true;
+
+                // Skip duplicate vertices, which occur when the plane passes through a mesh vertex.
+                const auto &R = crossings.at(segments[curr].A);
+                if(cop.points.empty() || !(cop.points.back() == R)) cop.points.emplace_back(R);
+
+                const auto next_key = segments[curr].B;
+                if(next_key == start){
+                    closed = true;
+                    break;
+                }
+                bool found = false;
+                const auto range = segments_by_start.equal_range(next_key);
+                for(auto it = range.first; it != range.second; ++it){
+                    if(!segments[it->second].used){
+                        curr = it->second;
+                        found = true;
+                        break;
+                    }
+                }
+                if(!found){
+                    cop.points.emplace_back( crossings.at(next_key) );
+                    break;
+                }
+            }
+
+            if(closed && (cop.points.size() > 1) && (cop.points.front() == cop.points.back())) cop.points.pop_back();
+            if(cop.points.size() < 3) continue; // Disregard degenerate cases.
+            cop.closed = closed;
+            cc.contours.emplace_back(std::move(cop));
+        }
+        return;
+    };
+
+    {
+        asio_thread_pool tp;
+        for(size_t p_i = 0; p_i < planes.size(); ++p_i){
+            tp.submit_task([&,p_i]() -> void {
+                slice_plane(p_i);
+            });
+        }
+    } // Wait for all tasks to complete.
+
+    return out;
+}
+
+
 double
 Volume(const Polyhedron &mesh){
     double volume = std::numeric_limits<double>::quiet_NaN();
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #ifdef DCMA_USE_CGAL
 #else
@@ -141,12 +142,28 @@ Transform( Polyhedron &output_mesh,
            double distance,
            TransformOp op);
 
+// Approximate dilation, erosion, or core/peel of contours using a signed distance transform on a voxel grid.
+// This is much faster and more robust than the Nef polyhedron approaches, but is only accurate to within roughly one
+// voxel diagonal. In-plane voxels are no larger than 'voxel_size'; the out-of-plane spacing matches the contours.
+Polyhedron
+Transform_Via_Distance_Field( const std::list<std::reference_wrapper<contour_collection<double>>> &cc_ROIs,
+                              double distance,
+                              double voxel_size,
+                              TransformOp op );
+
 // Slice a polyhedron to produce planar contours on the given planes.
 contour_collection<double> 
 Slice_Polyhedron(
         const Polyhedron &mesh,
         std::list<plane<double>> planes );
 
+// Slice a polyhedron on many planes at once, producing one contour collection per plane (in the same order).
+// Faces are indexed by their extent along the plane normal(s) and planes are sliced in parallel.
+std::vector<contour_collection<double>>
+Slice_Polyhedron_Planes(
+        const Polyhedron &mesh,
+        const std::vector<plane<double>> &planes );
+
 double
 Volume(const Polyhedron &mesh);
 
@@ -1,21 +1,137 @@
 //Write_File.cc - A part of DICOMautomaton 2018. Written by hal clark.
 
+#include <boost/filesystem.hpp>
 #include <boost/interprocess/creation_tags.hpp>
 #include <boost/interprocess/sync/named_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <string>    
+#include <vector>
 
 #include "YgorFilesDirs.h"
+#include "YgorMisc.h"         //Needed for FUNCINFO, FUNCWARN, FUNCERR macros.
 
 #include "Write_File.h"
 
+// Shards begin with a line recording the length of the header, so that the header and body can be separated when
+// merging, and the named mutex that writers of the target file use.
+static const std::string shard_header_prefix = "#dcma_result_shard header_bytes=";
+static const std::string shard_mutex_prefix = " mutex=";
+
+result_sink_mode Get_Result_Sink_Mode(){
+    const char *env = std::getenv("DCMA_RESULT_SINK");
+    if( (env != nullptr) && (std::string(env) == "sharded") ){
+        return result_sink_mode::sharded;
+    }
+    return result_sink_mode::locked;
+}
+
+// Buffers rows per target file until they are flushed to shards.
+class result_sink_registry {
+  private:
+    struct pending_t {
+        std::string mutex_name;
+        std::string header;
+        std::string body;
+    };
+
+    std::mutex m;
+    std::map<std::string, pending_t> pending; // file_name --> buffered text.
+    std::string process_token;
+    long int shard_count = 0;
+
+  public:
+    result_sink_registry(){
+        // A random token distinguishes shards from different processes, including processes on other hosts writing to
+        // a shared filesystem.
+        std::random_device rd;
+        std::mt19937_64 gen( (static_cast<uint64_t>(rd()) << 32) ^ static_cast<uint64_t>(rd()) );
+        std::stringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << gen();
+        this->process_token = ss.str();
+    }
+
+    ~result_sink_registry(){
+        try{
+            this->flush();
+        }catch(const std::exception &e){
+            FUNCWARN("Unable to write buffered results: '" << e.what() << "'");
+        }
+    }
+
+    void append( const std::function<std::string(void)>& gen_file_name,
+                 const std::string& mutex_name,
+                 const std::string& iff_newfile,
+                 const std::string& body ){
+        std::lock_guard<std::mutex> lock(this->m);
+
+        // The file name is generated for every call, as with the named-mutex path, since writers can direct rows to
+        // different files using the same mutex.
+        auto &p = this->pending[gen_file_name()];
+        p.mutex_name = mutex_name;
+        p.header = iff_newfile;
+        p.body += body;
+        return;
+    }
+
+    void flush(){
+        std::lock_guard<std::mutex> lock(this->m);
+        for(auto &fp : this->pending){
+            const auto &file_name = fp.first;
+            auto &p = fp.second;
+            if(p.body.empty()) continue;
+
+            // The sequence number is zero-padded so that sorting shard names preserves the order they were written.
+            std::stringstream ss;
+            ss << file_name << ".shard-" << this->process_token << "-" << std::setw(8) << std::setfill('0') << this->shard_count++;
+            const auto shard_name = ss.str();
+            const auto tmp_name = shard_name + ".tmp";
+            {
+                std::ofstream FO(tmp_name, std::ios::out | std::ios::trunc | std::ios::binary);
+                if(!FO){
+                    throw std::runtime_error("Unable to open shard file '" + tmp_name + "' for writing");
+                }
+                FO << shard_header_prefix << p.header.size() << shard_mutex_prefix << p.mutex_name << "\n";
+                FO.write(p.header.data(), static_cast<std::streamsize>(p.header.size()));
+                FO.write(p.body.data(), static_cast<std::streamsize>(p.body.size()));
+                FO.flush();
+                if(!FO){
+                    throw std::runtime_error("Unable to write shard file '" + tmp_name + "'");
+                }
+            }
+            boost::filesystem::rename(tmp_name, shard_name);
+            p.body.clear();
+        }
+        return;
+    }
+};
+
+static result_sink_registry & Get_Result_Sink_Registry(){
+    static result_sink_registry registry;
+    return registry;
+}
+
+
 void Append_File( const std::function<std::string(void)>& gen_file_name,
                   const std::string& mutex_name,
                   const std::string& iff_newfile,
                   const std::string& body ){
+
+    if(Get_Result_Sink_Mode() == result_sink_mode::sharded){
+        Get_Result_Sink_Registry().append(gen_file_name, mutex_name, iff_newfile, body);
+        return;
+    }
                  
     //File-based locking is used so this program can be run over many patients concurrently.
     // Try open a named mutex. Probably created in /dev/shm/ if you need to clear it manually...
@@ -39,3 +155,95 @@ void Append_File( const std::function<std::string(void)>& gen_file_name,
 
     return;
 }
+
+void Flush_Result_Sinks(){
+    if(Get_Result_Sink_Mode() != result_sink_mode::sharded) return;
+    Get_Result_Sink_Registry().flush();
+    return;
+}
+
+// Finds the shards of the given file. Temporary files belong to shards that are still being written and are ignored.
+static std::vector<boost::filesystem::path> Find_Result_Shards( const std::string& file_name ){
+    const boost::filesystem::path target(file_name);
+    auto dir = target.parent_path();
+    if(dir.empty()) dir = boost::filesystem::current_path();
+    const auto prefix = target.filename().string() + ".shard-";
+
+    std::vector<boost::filesystem::path> shards;
+    for(const auto &e : boost::filesystem::directory_iterator(dir)){
+        if(!boost::filesystem::is_regular_file(e.status())) continue;
+        const auto name = e.path().filename().string();
+        if(name.compare(0, prefix.size(), prefix) != 0) continue;
+        if( (4 <= name.size()) && (name.compare(name.size() - 4, 4, ".tmp") == 0) ) continue;
+        shards.emplace_back(e.path());
+    }
+    std::sort(std::begin(shards), std::end(shards));
+    return shards;
+}
+
+long int Merge_Result_Shards( const std::string& file_name,
+                              const std::string& mutex_name ){
+
+    // If no mutex is provided, use the one recorded by the writers.
+    std::string merge_mutex_name = mutex_name;
+    if(merge_mutex_name.empty()){
+        for(const auto &shard : Find_Result_Shards(file_name)){
+            std::ifstream FI(shard.string(), std::ios::in | std::ios::binary);
+            std::string first_line;
+            if(!FI || !std::getline(FI, first_line)) continue;
+            const auto pos = first_line.find(shard_mutex_prefix);
+            if( (first_line.compare(0, shard_header_prefix.size(), shard_header_prefix) != 0)
+            ||  (pos == std::string::npos) ) continue;
+            merge_mutex_name = first_line.substr(pos + shard_mutex_prefix.size());
+            break;
+        }
+        if(merge_mutex_name.empty()) return 0;
+    }
+
+    boost::interprocess::named_mutex mutex(boost::interprocess::open_or_create, merge_mutex_name.c_str());
+    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> lock(mutex);
+
+    const auto shards = Find_Result_Shards(file_name);
+    if(shards.empty()) return 0;
+
+    bool FirstWrite = !Does_File_Exist_And_Can_Be_Read(file_name);
+    std::fstream FO(file_name, std::fstream::out | std::fstream::app | std::fstream::binary);
+    if(!FO){
+        throw std::runtime_error("Unable to open file for writing. Cannot continue.");
+    }
+
+    long int merged = 0;
+    for(const auto &shard : shards){
+        std::ifstream FI(shard.string(), std::ios::in | std::ios::binary);
+        std::string first_line;
+        if(!FI || !std::getline(FI, first_line)
+        || (first_line.compare(0, shard_header_prefix.size(), shard_header_prefix) != 0) ){
+            FUNCWARN("Ignoring malformed result shard '" << shard.string() << "'");
+            continue;
+        }
+        const auto header_bytes = std::stoull(first_line.substr(shard_header_prefix.size()));
+        std::string header(header_bytes, '\0');
+        FI.read(&header[0], static_cast<std::streamsize>(header_bytes));
+        if(static_cast<size_t>(FI.gcount()) != header_bytes){
+            FUNCWARN("Ignoring truncated result shard '" << shard.string() << "'");
+            continue;
+        }
+        const std::string body( (std::istreambuf_iterator<char>(FI)), std::istreambuf_iterator<char>() );
+        FI.close();
+
+        if(FirstWrite){
+            FO << header;
+            FirstWrite = false;
+        }
+        FO << body;
+        FO.flush();
+        if(!FO){
+            throw std::runtime_error("Unable to write merged results. Cannot continue.");
+        }
+        boost::filesystem::remove(shard);
+        ++merged;
+    }
+    FO.close();
+
+    return merged;
+}
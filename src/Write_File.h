@@ -7,7 +7,35 @@
 
 // This routine will write text to a file, protecting the write with a semaphore from concurrrent processes.
 // The filename is claimed after the semaphore is acquired to avoid a race condition.
+//
+// If result sharding is enabled (see below), the text is instead buffered in memory, per generated filename, and later
+// written to a per-process shard file.
 void Append_File( const std::function<std::string(void)>& gen_file_name,
                   const std::string& mutex_name,
                   const std::string& iff_newfile,
                   const std::string& body );
+
+
+// Result sinks.
+//
+// When many processes report to the same file, the named mutex in Append_File() serializes them. Setting the
+// environment variable DCMA_RESULT_SINK=sharded makes Append_File() buffer rows in memory instead. Buffered rows are
+// written to shard files named '<file>.shard-<process token>-<sequence>' next to the target file, each written to a
+// temporary file and then renamed into place. The shards can be concatenated into the target file with
+// Merge_Result_Shards() or the MergeResultShards operation. Any other value (or no value) uses the named-mutex path.
+enum class result_sink_mode {
+    locked,   // Append directly to the target file while holding a named mutex.
+    sharded,  // Buffer in memory and write per-process shard files.
+};
+
+result_sink_mode Get_Result_Sink_Mode();
+
+// Writes all buffered rows to shard files. This is called automatically when operations finish and at process exit.
+void Flush_Result_Sinks();
+
+// Concatenates all shards of the given file into the file, writing the header only if the file is new. Merged shards
+// are removed. The named mutex is held while merging, so this can run concurrently with writers using the
+// named-mutex path. If the mutex name is empty, the mutex recorded in the shards by their writer is used. Returns the
+// number of shards merged.
+long int Merge_Result_Shards( const std::string& file_name,
+                              const std::string& mutex_name );
@@ -12,10 +12,12 @@
 #include <memory>
 #include <stdexcept>
 #include <string>    
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <cstdlib>            //Needed for exit() calls.
 
+#include "Mapped_File.h"
 #include "Structs.h"
 #include "YgorMath.h"         //Needed for vec3 class.
 #include "YgorMathIOXYZ.h"
@@ -74,11 +76,30 @@ bool Load_From_XYZ_Files( Drover &DICOM_data,
         try{
             //////////////////////////////////////////////////////////////
             // Attempt to load the file.
-            std::ifstream FI(Filename.c_str(), std::ios::in);
-            if(!ReadPointSetFromXYZ(DICOM_data.point_data.back()->pset, FI)){
-                throw std::runtime_error("Unable to read mesh from file.");
+            //
+            // Files consisting solely of points (and comments) are parsed directly from a memory mapping. Otherwise the
+            // more permissive stream reader is used.
+            bool read_ok = false;
+            {
+                mapped_file mf(Filename);
+                std::vector<double> coords;
+                if( Parse_Number_Rows(mf.view(), 3, ",;", '#', coords)
+                &&  !coords.empty() ){
+                    auto &points = DICOM_data.point_data.back()->pset.points;
+                    points.reserve(coords.size() / 3);
+                    for(size_t j = 0; (j + 2) < coords.size(); j += 3){
+                        points.emplace_back( coords[j], coords[j + 1], coords[j + 2] );
+                    }
+                    read_ok = true;
+                }
+            }
+            if(!read_ok){
+                std::ifstream FI(Filename.c_str(), std::ios::in);
+                if(!ReadPointSetFromXYZ(DICOM_data.point_data.back()->pset, FI)){
+                    throw std::runtime_error("Unable to read mesh from file.");
+                }
+                FI.close();
             }
-            FI.close();
             //////////////////////////////////////////////////////////////
 
             // Reject the file if the point cloud is not valid.
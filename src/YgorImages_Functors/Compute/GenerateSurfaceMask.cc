@@ -11,15 +11,111 @@
 #include <stdexcept>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "../../Thread_Pool.h"
 #include "../Grouping/Misc_Functors.h"
 #include "GenerateSurfaceMask.h"
+#include "Signed_Distance_Transform.h"
 #include "YgorImages.h"
 #include "YgorMath.h"
 #include "YgorMisc.h"
 
 
+// Rasterize-and-classify approach for images that form a rectilinear grid.
+//
+// Voxels are classified exactly as in the general approach: a voxel is on the surface if any in-plane neighbour
+// (including diagonals) or the corresponding voxel on an adjacent image differs in ROI inclusion. However, inclusion
+// is computed once per voxel with a scanline rasterization rather than once per neighbour per contour.
+static
+bool
+Generate_Surface_Mask_Rectilinear(planar_image_collection<float,double> &imagecoll,
+                                  const std::list<std::reference_wrapper<contour_collection<double>>> &ccsl,
+                                  GenerateSurfaceMaskUserData *user_data_s ){
+
+    //Order the images by adjacency.
+    const auto &first_img = imagecoll.images.front();
+    const auto ortho_unit = first_img.row_unit.Cross( first_img.col_unit ).unit();
+    planar_image_adjacency<float,double> img_adj( {}, { { std::ref(imagecoll) } }, ortho_unit );
+
+    const long int N_imgs = static_cast<long int>(imagecoll.images.size());
+    std::vector<std::reference_wrapper<planar_image<float,double>>> ordered_imgs;
+    for(long int i = 0; i < N_imgs; ++i){
+        if(!img_adj.index_present(i)){
+            FUNCWARN("Unable to determine image adjacency. Cannot continue with computation");
+            return false;
+        }
+        ordered_imgs.emplace_back( img_adj.index_to_image(i) );
+    }
+
+    Dense_Voxel_Grid_Geometry geom;
+    const auto mask = Rasterize_Contours(ordered_imgs, ccsl, geom);
+
+    //Classify voxels.
+    {
+        asio_thread_pool tp;
+        for(long int img_num = 0; img_num < geom.imgs; ++img_num){
+            tp.submit_task([&,img_num]() -> void {
+                auto &img = ordered_imgs[img_num].get();
+                for(long int row = 0; row < geom.rows; ++row){
+                    for(long int col = 0; col < geom.columns; ++col){
+                        const auto is_in_an_roi = mask[ geom.index(img_num, row, col) ];
+
+                        bool is_surface = false;
+                        for(long int brow = std::max<long int>(0, row - 1);
+                                     !is_surface && (brow <= std::min<long int>(geom.rows - 1, row + 1)); ++brow){
+                            for(long int bcol = std::max<long int>(0, col - 1);
+                                         bcol <= std::min<long int>(geom.columns - 1, col + 1); ++bcol){
+                                if(mask[ geom.index(img_num, brow, bcol) ] != is_in_an_roi){
+                                    is_surface = true;
+                                    break;
+                                }
+                            }
+                        }
+                        if( !is_surface && (0 < img_num)
+                        &&  (mask[ geom.index(img_num - 1, row, col) ] != is_in_an_roi) ){
+                            is_surface = true;
+                        }
+                        if( !is_surface && ((img_num + 1) < geom.imgs)
+                        &&  (mask[ geom.index(img_num + 1, row, col) ] != is_in_an_roi) ){
+                            is_surface = true;
+                        }
+
+                        img.reference(row, col, 0) = (is_surface)   ? user_data_s->surface_val
+                                                   : (is_in_an_roi) ? user_data_s->interior_val
+                                                                    : user_data_s->background_val;
+                    }
+                }
+            });
+        }
+    } //Finish tasks and terminate thread pool.
+
+    //Optionally compute a signed distance map.
+    if(user_data_s->signed_distance_map != nullptr){
+        auto &sdm = *(user_data_s->signed_distance_map);
+        if(sdm.images.size() != imagecoll.images.size()){
+            FUNCWARN("Signed distance map images do not match mask images. Cannot continue with computation");
+            return false;
+        }
+
+        const auto sdt = Signed_Euclidean_Distance_Transform(mask, geom);
+
+        auto sdm_img_it = sdm.images.begin();
+        for(auto &img : imagecoll.images){
+            const auto img_num = img_adj.image_to_index( std::ref(img) );
+            for(long int row = 0; row < geom.rows; ++row){
+                for(long int col = 0; col < geom.columns; ++col){
+                    sdm_img_it->reference(row, col, 0) = sdt[ geom.index(img_num, row, col) ];
+                }
+            }
+            ++sdm_img_it;
+        }
+    }
+
+    return true;
+}
+
+
 bool ComputeGenerateSurfaceMask(planar_image_collection<float,double> &imagecoll,
                           std::list<std::reference_wrapper<planar_image_collection<float,double>>>,
                           std::list<std::reference_wrapper<contour_collection<double>>> ccsl,
@@ -64,6 +160,23 @@ bool ComputeGenerateSurfaceMask(planar_image_collection<float,double> &imagecoll
         return false;
     }
 
+    //If the images form a rectilinear grid, rasterize the contours once and classify voxels on the dense mask. This is
+    // linear in the number of voxels, whereas the general approach below re-tests each voxel's neighbourhood against
+    // every contour.
+    {
+        std::list<std::reference_wrapper<planar_image<float,double>>> selected_imgs;
+        for(auto &img : imagecoll.images){
+            selected_imgs.push_back( std::ref(img) );
+        }
+        if( !selected_imgs.empty() && Images_Form_Rectilinear_Grid(selected_imgs) ){
+            return Generate_Surface_Mask_Rectilinear(imagecoll, ccsl, user_data_s);
+        }
+    }
+    if(user_data_s->signed_distance_map != nullptr){
+        FUNCWARN("Images do not form a rectilinear grid. Cannot compute a signed distance map");
+        return false;
+    }
+
     //Generate a comprehensive list of iterators to all as-of-yet-unused images. This list will be
     // pruned after images have been successfully operated on.
     auto all_images = imagecoll.get_all_images();
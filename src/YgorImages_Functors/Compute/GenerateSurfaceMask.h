@@ -15,6 +15,11 @@ struct GenerateSurfaceMaskUserData {
     float surface_val    = 1.0;
     float interior_val   = 2.0;
 
+    // If provided, a signed Euclidean distance map (in DICOM units, negative inside the ROI(s)) is written into the
+    // first channel of these images. It must be a copy of the mask image collection (i.e., identical geometry and
+    // ordering). Only supported when the mask images form a rectilinear grid.
+    planar_image_collection<float,double> *signed_distance_map = nullptr;
+
 //    bool assume_boundary_is_surface = false; //If the ROI overshoots an image boundary, assume the boundary is the 
 //    long int voxel_neighbour_family = 1; 
 };
@@ -11,6 +11,7 @@
 #include <ostream>
 #include <stdexcept>
 
+#include "../../Image_Resampling.h"
 #include "../../Thread_Pool.h"
 #include "../Grouping/Misc_Functors.h"
 #include "../ConvenienceRoutines.h"
@@ -125,6 +126,19 @@ bool ComputeInterpolateImageSlices(planar_image_collection<float,double> &imagec
 
 
 
+    // When the reference images form a rectilinear stack and share orientation with the images being edited, the
+    // interpolation is separable. Index and weight tables can then be computed once per grid and applied to whole rows
+    // of voxels rather than locating and interpolating each voxel individually.
+    const resampling_stack ref_stack(reference_imgs);
+    if(user_data_s->kernel != resampling_kernel::linear){
+        for(const auto &img : imagecoll.images){
+            if(!ref_stack.is_compatible(img)){
+                FUNCWARN("Only linear interpolation is supported for these images. Cannot continue");
+                return false;
+            }
+        }
+    }
+
     asio_thread_pool tp;
     std::mutex saver_printer; // Who gets to save generated contours, print to the console, and iterate the counter.
     long int completed = 0;
@@ -135,6 +149,11 @@ bool ComputeInterpolateImageSlices(planar_image_collection<float,double> &imagec
 
         tp.submit_task([&,img_refw]() -> void {
 
+            const bool resampled = ref_stack.resample( img_refw.get(),
+                                                       ud_channel,
+                                                       user_data_s->kernel,
+                                                       resampling_boundary::nan );
+
             const auto N_rows = img_refw.get().rows;
             const auto N_columns = img_refw.get().columns;
             const auto N_channels = img_refw.get().channels;
@@ -185,9 +204,12 @@ bool ComputeInterpolateImageSlices(planar_image_collection<float,double> &imagec
             };
 
             
+            if(resampled){
+                // Nothing more to do.
+
             // If all images are rectilinear, then no in-plane interpolation is needed and we can avoid adjacency lookup
             // for each voxel.
-            if(ImagesAreRectilinear){
+            }else if(ImagesAreRectilinear){
                 const auto v_pos = img_refw.get().position(0, 0); // Pick any point...
                 identify_nearest_adjacent_neighbours(v_pos);
 
@@ -247,7 +269,7 @@ bool ComputeInterpolateImageSlices(planar_image_collection<float,double> &imagec
 
                             if( (nearest_above != nullptr) && (nearest_below != nullptr) ){
                                 const auto val_a = project_and_interpolate(nearest_above,v_pos);
-                                const auto val_b = project_and_interpolate(nearest_above,v_pos);
+                                const auto val_b = project_and_interpolate(nearest_below,v_pos);
                                 newval = ( val_a * below_dist
                                          + val_b * above_dist ) / total_dist;  // Note: Not a typo! Weights should be anti-paired.
                                 
@@ -6,6 +6,8 @@
 #include <list>
 #include <string>
 
+#include "../../Image_Resampling.h"
+
 
 template <class T, class R> class planar_image_collection;
 template <class T> class contour_collection;
@@ -21,6 +23,14 @@ struct ComputeInterpolateImageSlicesUserData {
     } interpolation_method = InterpolationMethod::LinearExtrapolation;
 
 
+    // -----------------------------
+    // The interpolation kernel to use within and between image planes.
+    //
+    // Note: Kernels other than linear are only available when the images share an orientation with the reference
+    //       images and the reference images form a rectilinear grid.
+    resampling_kernel kernel = resampling_kernel::linear;
+
+
     // -----------------------------
     // The channel to consider. 
     //
@@ -0,0 +1,259 @@
+//Signed_Distance_Transform.cc.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+#include "YgorMisc.h"
+
+#include "../../Thread_Pool.h"
+
+#include "Signed_Distance_Transform.h"
+
+
+std::vector<uint8_t>
+Rasterize_Contours(const std::vector<std::reference_wrapper<planar_image<float,double>>> &ordered_imgs,
+                   const std::list<std::reference_wrapper<contour_collection<double>>> &ccsl,
+                   Dense_Voxel_Grid_Geometry &geom ){
+
+    if(ordered_imgs.empty()){
+        throw std::invalid_argument("No images provided. Cannot rasterize contours.");
+    }
+
+    const auto &first_img = ordered_imgs.front().get();
+    geom.imgs    = static_cast<long int>(ordered_imgs.size());
+    geom.rows    = first_img.rows;
+    geom.columns = first_img.columns;
+    geom.row_spacing = first_img.pxl_dx;
+    geom.col_spacing = first_img.pxl_dy;
+    geom.img_spacing = first_img.pxl_dz;
+    if(2 <= ordered_imgs.size()){
+        const auto ortho_unit = first_img.row_unit.Cross( first_img.col_unit ).unit();
+        const auto dR = ordered_imgs[1].get().position(0, 0) - first_img.position(0, 0);
+        geom.img_spacing = std::abs( dR.Dot(ortho_unit) );
+    }
+
+    std::vector<uint8_t> mask(geom.size(), 0);
+
+    asio_thread_pool tp;
+    for(long int img_num = 0; img_num < geom.imgs; ++img_num){
+        tp.submit_task([&,img_num]() -> void {
+            const auto &img = ordered_imgs[img_num].get();
+            const auto row_unit = img.row_unit.unit();
+            const auto col_unit = img.col_unit.unit();
+            const auto P_0 = img.position(0, 0);
+
+            // Project the contours encompassed by this image into fractional (row, column) coordinates.
+            std::vector<std::vector<std::pair<double,double>>> polygons;
+            for(const auto &cc_refw : ccsl){
+                for(const auto &contour : cc_refw.get().contours){
+                    if(contour.points.size() < 3) continue;
+                    if(!img.encompasses_contour_of_points(contour)) continue;
+
+                    polygons.emplace_back();
+                    polygons.back().reserve(contour.points.size());
+                    for(const auto &p : contour.points){
+                        const auto dP = p - P_0;
+                        polygons.back().emplace_back( dP.Dot(row_unit) / img.pxl_dx,
+                                                      dP.Dot(col_unit) / img.pxl_dy );
+                    }
+                }
+            }
+            if(polygons.empty()) return;
+
+            // Scanline fill. Each row's centreline is intersected with the polygon edges and the voxel centres between
+            // alternating crossings are interior (even-odd rule). Contours are combined via union.
+            std::vector<double> crossings;
+            for(long int row = 0; row < geom.rows; ++row){
+                const auto r = static_cast<double>(row);
+                for(const auto &poly : polygons){
+                    crossings.clear();
+                    const auto N = poly.size();
+                    for(size_t i = 0; i < N; ++i){
+                        const auto &A = poly[i];
+                        const auto &B = poly[(i + 1) % N];
+                        // Half-open rule so that vertices lying on the centreline are only counted once.
+                        if((A.first <= r) == (B.first <= r)) continue;
+                        const auto t = (r - A.first) / (B.first - A.first);
+                        crossings.push_back( A.second + t * (B.second - A.second) );
+                    }
+                    std::sort(crossings.begin(), crossings.end());
+
+                    for(size_t i = 0; (i + 1) < crossings.size(); i += 2){
+                        const auto col_begin = std::max<long int>(0, static_cast<long int>(std::ceil(crossings[i])));
+                        const auto col_end = std::min<long int>(geom.columns - 1,
+                                                                static_cast<long int>(std::floor(crossings[i + 1])));
+                        for(long int col = col_begin; col <= col_end; ++col){
+                            mask[ geom.index(img_num, row, col) ] = 1;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    return mask;
+}
+
+
+// Lower envelope of parabolas for a single line of samples. 'f' holds the squared distance for each sample (or
+// infinity), and 'd' receives the transformed squared distances. 'v' and 'z' are scratch space of size n and n+1.
+static
+void
+Distance_Transform_1D(const std::vector<double> &f,
+                      std::vector<double> &d,
+                      std::vector<long int> &v,
+                      std::vector<double> &z,
+                      long int n,
+                      double spacing ){
+
+    const auto inf = std::numeric_limits<double>::infinity();
+    const auto s2 = spacing * spacing;
+
+    long int k = -1;
+    for(long int q = 0; q < n; ++q){
+        if(!std::isfinite(f[q])) continue;
+        const auto q_pos2 = static_cast<double>(q) * static_cast<double>(q) * s2;
+        while(true){
+            if(k < 0){
+                k = 0;
+                v[0] = q;
+                z[0] = -inf;
+                z[1] = inf;
+                break;
+            }
+            const auto p = v[k];
+            const auto p_pos2 = static_cast<double>(p) * static_cast<double>(p) * s2;
+            const auto s = ((f[q] + q_pos2) - (f[p] + p_pos2))
+                         / (2.0 * spacing * static_cast<double>(q - p));
+            if(s <= z[k]){
+                --k;
+                continue;
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = inf;
+            break;
+        }
+    }
+
+    if(k < 0){
+        std::fill(d.begin(), d.begin() + n, inf);
+        return;
+    }
+
+    k = 0;
+    for(long int q = 0; q < n; ++q){
+        while(z[k + 1] < static_cast<double>(q) * spacing){
+            ++k;
+        }
+        const auto dq = static_cast<double>(q - v[k]) * spacing;
+        d[q] = dq * dq + f[v[k]];
+    }
+    return;
+}
+
+
+std::vector<double>
+Squared_Euclidean_Distance_Transform(const std::vector<uint8_t> &feature,
+                                     const Dense_Voxel_Grid_Geometry &geom ){
+
+    if(static_cast<long int>(feature.size()) != geom.size()){
+        throw std::invalid_argument("Feature mask does not match the grid geometry.");
+    }
+
+    const auto inf = std::numeric_limits<double>::infinity();
+    std::vector<double> D(feature.size(), inf);
+    for(size_t i = 0; i < feature.size(); ++i){
+        if(feature[i] != 0) D[i] = 0.0;
+    }
+
+    // Perform a 1D transform along every line parallel to the given axis. Lines are independent, so they are
+    // partitioned into contiguous blocks and processed in parallel.
+    const auto transform_axis = [&](long int n, long int stride, double spacing,
+                                    const std::vector<long int> &line_starts) -> void {
+        if(n <= 1) return; // Nothing to propagate along this axis.
+
+        const long int N_lines = static_cast<long int>(line_starts.size());
+        const long int N_threads = std::max<long int>(1, std::thread::hardware_concurrency());
+        const long int block = std::max<long int>(1, (N_lines + N_threads * 4 - 1) / (N_threads * 4));
+
+        asio_thread_pool tp;
+        for(long int b = 0; b < N_lines; b += block){
+            tp.submit_task([&,b]() -> void {
+                std::vector<double> f(n), d(n), z(n + 1);
+                std::vector<long int> v(n);
+                const auto b_end = std::min(N_lines, b + block);
+                for(long int l = b; l < b_end; ++l){
+                    const auto start = line_starts[l];
+                    for(long int q = 0; q < n; ++q) f[q] = D[start + q * stride];
+                    Distance_Transform_1D(f, d, v, z, n, spacing);
+                    for(long int q = 0; q < n; ++q) D[start + q * stride] = d[q];
+                }
+            });
+        }
+    };
+
+    std::vector<long int> line_starts;
+
+    // Along columns (contiguous).
+    line_starts.clear();
+    for(long int img = 0; img < geom.imgs; ++img){
+        for(long int row = 0; row < geom.rows; ++row){
+            line_starts.push_back( geom.index(img, row, 0) );
+        }
+    }
+    transform_axis(geom.columns, 1, geom.col_spacing, line_starts);
+
+    // Along rows.
+    line_starts.clear();
+    for(long int img = 0; img < geom.imgs; ++img){
+        for(long int col = 0; col < geom.columns; ++col){
+            line_starts.push_back( geom.index(img, 0, col) );
+        }
+    }
+    transform_axis(geom.rows, geom.columns, geom.row_spacing, line_starts);
+
+    // Along images.
+    line_starts.clear();
+    for(long int row = 0; row < geom.rows; ++row){
+        for(long int col = 0; col < geom.columns; ++col){
+            line_starts.push_back( geom.index(0, row, col) );
+        }
+    }
+    transform_axis(geom.imgs, geom.rows * geom.columns, geom.img_spacing, line_starts);
+
+    return D;
+}
+
+
+std::vector<float>
+Signed_Euclidean_Distance_Transform(const std::vector<uint8_t> &mask,
+                                    const Dense_Voxel_Grid_Geometry &geom ){
+
+    std::vector<uint8_t> exterior(mask.size());
+    for(size_t i = 0; i < mask.size(); ++i){
+        exterior[i] = (mask[i] == 0) ? 1 : 0;
+    }
+
+    const auto D_to_interior = Squared_Euclidean_Distance_Transform(mask, geom);
+    const auto D_to_exterior = Squared_Euclidean_Distance_Transform(exterior, geom);
+
+    std::vector<float> out(mask.size());
+    for(size_t i = 0; i < mask.size(); ++i){
+        out[i] = (mask[i] != 0) ? static_cast<float>( -std::sqrt(D_to_exterior[i]) )
+                                : static_cast<float>(  std::sqrt(D_to_interior[i]) );
+    }
+    return out;
+}
+
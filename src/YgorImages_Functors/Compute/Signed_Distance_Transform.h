@@ -0,0 +1,66 @@
+//Signed_Distance_Transform.h.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <vector>
+
+
+template <class T, class R> class planar_image;
+template <class T> class contour_collection;
+
+
+// A dense, regular 3D voxel grid. Voxels are stored contiguously in (image, row, column) order, i.e., the linear
+// index of voxel (img, row, col) is ((img * rows) + row) * columns + col.
+struct Dense_Voxel_Grid_Geometry {
+    long int imgs    = 0;
+    long int rows    = 0;
+    long int columns = 0;
+
+    double img_spacing = 1.0; // Centre-to-centre separation between adjacent images (in DICOM units).
+    double row_spacing = 1.0; // Centre-to-centre separation between adjacent rows (in DICOM units).
+    double col_spacing = 1.0; // Centre-to-centre separation between adjacent columns (in DICOM units).
+
+    long int
+    index(long int img, long int row, long int col) const {
+        return ((img * this->rows) + row) * this->columns + col;
+    }
+
+    long int
+    size() const {
+        return this->imgs * this->rows * this->columns;
+    }
+};
+
+
+// Rasterize the given contours onto a stack of images using a single scanline pass per image row. Voxels whose
+// centres are interior to any contour that the image encompasses are set to 1, all others are set to 0. Images must
+// be provided in spatially-adjacent order and form a rectilinear grid.
+//
+// The returned mask is indexed using the geometry returned via 'geom'.
+std::vector<uint8_t>
+Rasterize_Contours(const std::vector<std::reference_wrapper<planar_image<float,double>>> &ordered_imgs,
+                   const std::list<std::reference_wrapper<contour_collection<double>>> &ccsl,
+                   Dense_Voxel_Grid_Geometry &geom );
+
+
+// Exact squared Euclidean distance transform (Felzenszwalb and Huttenlocher, 2012) in linear time.
+//
+// Each voxel is assigned the squared physical distance to the nearest voxel with a non-zero 'feature' value, using
+// the anisotropic voxel spacing provided. Separable 1D passes are performed along each axis in turn, and lines along
+// each axis are processed in parallel. If there are no features, all distances are infinite.
+std::vector<double>
+Squared_Euclidean_Distance_Transform(const std::vector<uint8_t> &feature,
+                                     const Dense_Voxel_Grid_Geometry &geom );
+
+
+// Signed Euclidean distance map for a binary mask (non-zero = interior).
+//
+// Exterior voxels are assigned the (positive) distance to the nearest interior voxel and interior voxels are assigned
+// the negated distance to the nearest exterior voxel. Distances are measured between voxel centres, so the implied
+// zero level set lies between the outermost interior and innermost exterior voxels.
+std::vector<float>
+Signed_Euclidean_Distance_Transform(const std::vector<uint8_t> &mask,
+                                    const Dense_Voxel_Grid_Geometry &geom );
+
@@ -6,10 +6,12 @@
 #include <functional>
 #include <list>
 #include <map>
+#include <mutex>
 #include <algorithm>
 #include <random>
 #include <ostream>
 #include <stdexcept>
+#include <vector>
 
 #include "../../Thread_Pool.h"
 #include "../Grouping/Misc_Functors.h"
@@ -36,11 +38,10 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
     //
     // Note: The provided image collection must be rectilinear.
     //
-    // Note: The image collection will be duplicated so that voxel modification can be accomplished directly, without
-    //       worrying about modifications to the neighbourhood of adjacent voxels. Be aware that the copy is consulted
-    //       as the pristine image collection so the provided image collection can be updated in-place. In particular,
-    //       un-modified voxel values will be bit-stable. THIS WILL RUIN ADJACENCY COMPUTATION in the sense that any
-    //       pre-computed or externally-computed image adjacency information will refer to the images being edited!
+    // Note: Voxel modifications are not written to the provided image collection until all voxels have been sampled,
+    //       so neighbourhoods always consist of pristine voxel values. Each image's pixel buffer is detached (copied)
+    //       only when one of its voxels is first modified, and the detached buffers replace the originals at the end.
+    //       Images without modified voxels are never copied, and un-modified voxel values will be bit-stable.
     //
     // Note: Because walking all voxels in 3D will inevitably be costly, contours are used to limit the computation.
     //
@@ -64,10 +65,8 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
     }
 
     // Ensure the images form a regular grid.
-    auto ref_imagecoll = imagecoll;
-    
     std::list<std::reference_wrapper<planar_image<float,double>>> selected_imgs;
-    for(auto &img : ref_imagecoll.images){
+    for(auto &img : imagecoll.images){
         selected_imgs.push_back( std::ref(img) );
     }
 
@@ -78,7 +77,7 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
     const bool is_regular_grid = Images_Form_Regular_Grid(selected_imgs);
 
     const auto orientation_normal = Average_Contour_Normals(ccsl);
-    planar_image_adjacency<float,double> img_adj( {}, { { std::ref(ref_imagecoll) } }, orientation_normal );
+    planar_image_adjacency<float,double> img_adj( {}, { { std::ref(imagecoll) } }, orientation_normal );
 
     Mutate_Voxels_Opts mv_opts;
     mv_opts.editstyle      = Mutate_Voxels_Opts::EditStyle::InPlace;
@@ -89,14 +88,20 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
     mv_opts.maskmod        = Mutate_Voxels_Opts::MaskMod::Noop;
 
 
-    asio_thread_pool tp;
     std::mutex saver_printer; // Who gets to save generated contours, print to the console, and iterate the counter.
     long int completed = 0;
     const long int img_count = imagecoll.images.size();
 
+    // Detached pixel buffers, one per image. These remain empty unless a voxel in the corresponding image is modified.
+    std::vector<std::vector<float>> detached( img_count );
+
+    {
+    asio_thread_pool tp;
+    long int img_num = 0;
     for(auto &img : imagecoll.images){
         std::reference_wrapper< planar_image<float, double>> img_refw( std::ref(img) );
-        tp.submit_task([&,img_refw]() -> void {
+        auto *detached_ptr = &( detached.at(img_num++) );
+        tp.submit_task([&,img_refw,detached_ptr]() -> void {
 
             // Identify the reference image which overlaps the whole image, if any.
             //
@@ -116,7 +121,7 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
             std::vector<float> shtl;
             shtl.reserve(100); // An arbitrary guess.
 
-            auto f_bounded = [&,ref_img_refw](long int E_row, long int E_col, long int channel, std::reference_wrapper<planar_image<float,double>> /*img_refw*/, float &voxel_val) {
+            auto f_bounded = [&,ref_img_refw](long int E_row, long int E_col, long int channel, std::reference_wrapper<planar_image<float,double>> /*img_refw*/, float &/*voxel_val*/) {
                 // No-op if this is the wrong channel.
                 if( (user_data_s->channel >= 0) && (channel != user_data_s->channel) ){
                     return;
@@ -267,8 +272,11 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
 
                 }
 
-                // Assign the voxel a value.
-                voxel_val = user_data_s->f_reduce(E_val, shtl, E_pos);
+                // Assign the voxel a value in the detached buffer, leaving the shared buffer pristine.
+                if(detached_ptr->empty()){
+                    *detached_ptr = img_refw.get().data;
+                }
+                detached_ptr->at( img_refw.get().index(E_row, E_col, channel) ) = user_data_s->f_reduce(E_val, shtl, E_pos);
 
                 return;
             };
@@ -279,11 +287,6 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
                                          mv_opts, 
                                          f_bounded );
 
-            if(!(user_data_s->description.empty())){
-                UpdateImageDescription( img_refw, user_data_s->description );
-            }
-            UpdateImageWindowCentreWidth( img_refw );
-
             //Report operation progress.
             {
                 std::lock_guard<std::mutex> lock(saver_printer);
@@ -294,6 +297,28 @@ bool ComputeVolumetricNeighbourhoodSampler(planar_image_collection<float,double>
         }); // thread pool task closure.
 
     }
+    } // Wait for all sampling to complete before committing any modifications.
+
+    // Commit the detached buffers.
+    {
+    asio_thread_pool tp;
+    long int img_num = 0;
+    for(auto &img : imagecoll.images){
+        std::reference_wrapper< planar_image<float, double>> img_refw( std::ref(img) );
+        auto *detached_ptr = &( detached.at(img_num++) );
+        tp.submit_task([&,img_refw,detached_ptr]() -> void {
+            if(!detached_ptr->empty()){
+                img_refw.get().data.swap(*detached_ptr);
+                *detached_ptr = std::vector<float>();
+            }
+
+            if(!(user_data_s->description.empty())){
+                UpdateImageDescription( img_refw, user_data_s->description );
+            }
+            UpdateImageWindowCentreWidth( img_refw );
+        }); // thread pool task closure.
+    }
+    }
 
 
     return true;
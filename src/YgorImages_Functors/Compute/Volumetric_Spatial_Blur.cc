@@ -10,6 +10,8 @@
 #include <random>
 #include <ostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "YgorImages.h"
 #include "YgorMath.h"
@@ -20,6 +22,7 @@
 #include "../../Thread_Pool.h"
 #include "../Grouping/Misc_Functors.h"
 #include "../ConvenienceRoutines.h"
+#include "../../Separable_Filters.h"
 #include "Volumetric_Neighbourhood_Sampler.h"
 
 #include "Volumetric_Spatial_Blur.h"
@@ -30,13 +33,18 @@ bool ComputeVolumetricSpatialBlur(planar_image_collection<float,double> &imageco
                       std::list<std::reference_wrapper<contour_collection<double>>> ccsl,
                       std::any user_data ){
 
-    // This routine computes 3D blurs. Currently, only Gaussians are supported. Specifically, a 1-sigma Gaussian (in
-    // pixel units, not DICOM units) with a fixed 3*sigma extent. This blur is separable and is thus applied in three
+    // This routine computes 3D blurs. Currently, only Gaussians are supported. The 'Gaussian' estimator is a 1-sigma
+    // Gaussian (in pixel units, not DICOM units) with a fixed 3*sigma extent. This blur is separable and is thus applied in three
     // directions successively. The spacing between adjacent voxels is not taken into account, so voxels should have
     // isotropic dimensions (or the blur will be non-isotropic). The effective window considered by this Gaussian is
     // 7x7x7 voxels. If voxels are inaccessible or non-finite they will be ignored and other voxels in the neighbourhood
     // will be more heavily weighted.
     //
+    // The 'SeparableGaussian' estimator uses the separable filter engine instead, which accepts any sigma in DICOM units
+    // and accounts for the voxel dimensions along each axis. Narrow kernels are sampled, and wide kernels are applied
+    // recursively so the cost does not depend on sigma. Voxels are blurred using the whole volume, but only voxels
+    // within the contours are overwritten.
+    //
     // Note: The provided image collection must be rectilinear. This requirement comes foremost from a limitation of the
     // implementation. 
     //
@@ -168,6 +176,35 @@ bool ComputeVolumetricSpatialBlur(planar_image_collection<float,double> &imageco
             }
         }
 
+    }else if(user_data_s->estimator == VolumetricSpatialBlurEstimator::SeparableGaussian){
+        std::list<std::reference_wrapper<planar_image<float,double>>> selected_imgs;
+        for(auto &img : imagecoll.images){
+            selected_imgs.push_back( std::ref(img) );
+        }
+
+        double img_spacing = 0.0;
+        std::vector<planar_image<float,double> *> ordered_imgs;
+        try{
+            ordered_imgs = Order_Images_For_Filtering(selected_imgs, img_spacing);
+        }catch(const std::exception &e){
+            FUNCWARN("Images do not form a rectilinear grid: " << e.what() << ". Cannot continue");
+            return false;
+        }
+
+        gaussian_filter_params params;
+        params.img_sigma = user_data_s->sigma;
+        params.row_sigma = user_data_s->sigma;
+        params.col_sigma = user_data_s->sigma;
+        params.method = user_data_s->method;
+
+        const long int N_chnls = ordered_imgs.front()->channels;
+        for(long int chnl = 0; chnl < N_chnls; ++chnl){
+            if( (0 <= user_data_s->channel) && (chnl != user_data_s->channel) ) continue;
+            FUNCINFO("Blurring channel " << chnl << " now..");
+            const auto blurred = Gaussian_Blur( Extract_Filter_Volume(ordered_imgs, img_spacing, chnl), params );
+            Inject_Filter_Volume(blurred, ordered_imgs, chnl, ccsl);
+        }
+
     }else{
         throw std::invalid_argument("Unrecognized user-provided estimator argument.");
     }
@@ -177,13 +214,16 @@ bool ComputeVolumetricSpatialBlur(planar_image_collection<float,double> &imageco
     std::string img_desc;
     if(user_data_s->estimator == VolumetricSpatialBlurEstimator::Gaussian){
         img_desc += "volumetric Gaussian blurred";
+        img_desc += " (in pixel coord.s)";
+
+    }else if(user_data_s->estimator == VolumetricSpatialBlurEstimator::SeparableGaussian){
+        img_desc += "volumetric Gaussian blurred";
+        img_desc += " (sigma = " + std::to_string(user_data_s->sigma) + " DICOM units)";
 
     }else{
         throw std::invalid_argument("Unrecognized user-provided estimator");
     }
 
-    img_desc += " (in pixel coord.s)";
-
     for(auto &img : imagecoll.images){
         UpdateImageDescription( std::ref(img), img_desc );
         UpdateImageWindowCentreWidth( std::ref(img) );
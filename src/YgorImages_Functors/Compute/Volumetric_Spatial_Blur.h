@@ -5,13 +5,17 @@
 #include <functional>
 #include <list>
 
+#include "../../Separable_Filters.h"
+
 
 template <class T, class R> class planar_image_collection;
 template <class T> class contour_collection;
 
 typedef enum { // Controls which blur is computed.
 
-    Gaussian // Numerically-approximated Gaussian with fixed (3-sigma) extent.
+    Gaussian, // Numerically-approximated Gaussian with fixed (3-sigma) extent.
+
+    SeparableGaussian // Gaussian with user-specified sigma (in DICOM units) using the separable filter engine.
 
 } VolumetricSpatialBlurEstimator;
 
@@ -22,6 +26,10 @@ struct ComputeVolumetricSpatialBlurUserData {
     // The channel to analyze. If negative, all channels are analyzed.
     long int channel = -1;
 
+    // Parameters for the separable Gaussian estimator. Sigma is in DICOM units (mm) and applies along every axis.
+    double sigma = 1.0;
+    gaussian_method method = gaussian_method::automatic;
+
 };
 
 bool ComputeVolumetricSpatialBlur(planar_image_collection<float,double> &,
@@ -1,5 +1,6 @@
 //Volumetric_Spatial_Derivative.cc.
 
+#include <cmath>
 #include <exception>
 #include <any>
 #include <optional>
@@ -10,6 +11,8 @@
 #include <random>
 #include <ostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "YgorImages.h"
 #include "YgorMath.h"
@@ -20,13 +23,154 @@
 #include "../../Thread_Pool.h"
 #include "../Grouping/Misc_Functors.h"
 #include "../ConvenienceRoutines.h"
+#include "../../Separable_Filters.h"
 #include "Volumetric_Neighbourhood_Sampler.h"
 
 #include "Volumetric_Spatial_Derivative.h"
 
 
+// Computes Gaussian derivatives for the whole volume using the separable filter engine. All requested derivatives are
+// computed together from the same partially-filtered intermediates.
+static bool
+ComputeVolumetricSpatialDerivativeGaussian(planar_image_collection<float,double> &imagecoll,
+                      std::list<std::reference_wrapper<planar_image_collection<float,double>>> external_imgs,
+                      std::list<std::reference_wrapper<contour_collection<double>>> ccsl,
+                      const ComputeVolumetricSpatialDerivativeUserData &ud ){
+
+    const auto to_refws = [](planar_image_collection<float,double> &ic){
+        std::list<std::reference_wrapper<planar_image<float,double>>> out;
+        for(auto &img : ic.images){
+            out.push_back( std::ref(img) );
+        }
+        return out;
+    };
+
+    double img_spacing = 0.0;
+    std::vector<planar_image<float,double> *> ordered_imgs;
+    std::vector<std::vector<planar_image<float,double> *>> hessian_imgs;
+    try{
+        ordered_imgs = Order_Images_For_Filtering(to_refws(imagecoll), img_spacing);
+
+        // Hessian components are written to external image collections, which must share the geometry of the source.
+        if(ud.method == VolumetricSpatialDerivativeMethod::hessian){
+            if(external_imgs.size() != 6){
+                FUNCWARN("Hessian components require six external image collections. Cannot continue");
+                return false;
+            }
+            for(auto &ic_refw : external_imgs){
+                double l_img_spacing = 0.0;
+                hessian_imgs.emplace_back( Order_Images_For_Filtering(to_refws(ic_refw.get()), l_img_spacing) );
+                if( (hessian_imgs.back().size() != ordered_imgs.size())
+                ||  (hessian_imgs.back().front()->channels != ordered_imgs.front()->channels) ){
+                    FUNCWARN("External image collections do not match the source images. Cannot continue");
+                    return false;
+                }
+            }
+        }
+    }catch(const std::exception &e){
+        FUNCWARN("Images do not form a rectilinear grid: " << e.what() << ". Cannot continue");
+        return false;
+    }
+
+    gaussian_filter_params params;
+    params.img_sigma = ud.sigma;
+    params.row_sigma = ud.sigma;
+    params.col_sigma = ud.sigma;
+    params.method = ud.filter_method;
+
+    gaussian_derivative_request req;
+    if(ud.method == VolumetricSpatialDerivativeMethod::laplacian){
+        req.laplacian = true;
+    }else if(ud.method == VolumetricSpatialDerivativeMethod::hessian){
+        req.hessian = true;
+    }else{
+        req.gradient = true;
+    }
+
+    const long int N_chnls = ordered_imgs.front()->channels;
+    for(long int chnl = 0; chnl < N_chnls; ++chnl){
+        if( (0 <= ud.channel) && (chnl != ud.channel) ) continue;
+        FUNCINFO("Computing Gaussian derivatives for channel " << chnl << " now..");
+
+        auto d = Gaussian_Derivatives( Extract_Filter_Volume(ordered_imgs, img_spacing, chnl), params, req );
+
+        // Note: 'row-aligned' derivatives are taken along the rows, i.e., across columns.
+        if(ud.method == VolumetricSpatialDerivativeMethod::row_aligned){
+            Inject_Filter_Volume(d.d_c, ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::column_aligned){
+            Inject_Filter_Volume(d.d_r, ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::image_aligned){
+            Inject_Filter_Volume(d.d_i, ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::magnitude){
+            auto &magn = d.smoothed;
+            magn.init_like(d.d_i, 0.0f);
+            for(size_t i = 0; i < magn.data.size(); ++i){
+                magn.data[i] = std::hypot(d.d_i.data[i], d.d_r.data[i], d.d_c.data[i]);
+            }
+            Inject_Filter_Volume(magn, ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::non_maximum_suppression){
+            Inject_Filter_Volume(Suppress_Non_Maxima(d.d_i, d.d_r, d.d_c), ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::laplacian){
+            Inject_Filter_Volume(d.laplacian, ordered_imgs, chnl, ccsl);
+
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::hessian){
+            const std::vector<const filter_volume *> components = {{ &d.d_cc, &d.d_rr, &d.d_ii,
+                                                                     &d.d_rc, &d.d_ic, &d.d_ir }};
+            for(size_t k = 0; k < components.size(); ++k){
+                Inject_Filter_Volume(*(components[k]), hessian_imgs[k], chnl, ccsl);
+            }
+
+        }else{
+            throw std::invalid_argument("Selected method not applicable to selected order or estimator.");
+        }
+    }
+
+    //Update the image metadata. 
+    const std::string img_desc = "Gaussian (sigma = " + std::to_string(ud.sigma) + ") spatial deriv.,";
+    if(ud.method == VolumetricSpatialDerivativeMethod::hessian){
+        const std::vector<std::string> names = {{ "row-row", "column-column", "image-image",
+                                                  "row-column", "row-image", "column-image" }};
+        auto name_it = std::begin(names);
+        for(auto &ic_refw : external_imgs){
+            for(auto &img : ic_refw.get().images){
+                UpdateImageDescription( std::ref(img), img_desc + " Hessian " + *name_it + " (in DICOM units)" );
+                UpdateImageWindowCentreWidth( std::ref(img) );
+            }
+            ++name_it;
+        }
+
+    }else{
+        std::string l_desc = img_desc;
+        if(ud.method == VolumetricSpatialDerivativeMethod::row_aligned){
+            l_desc += " row-aligned";
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::column_aligned){
+            l_desc += " column-aligned";
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::image_aligned){
+            l_desc += " image-aligned";
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::magnitude){
+            l_desc += " magnitude";
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::non_maximum_suppression){
+            l_desc += " magnitude (thinned)";
+        }else if(ud.method == VolumetricSpatialDerivativeMethod::laplacian){
+            l_desc += " Laplacian";
+        }
+        l_desc += " (in DICOM units)";
+
+        for(auto &img : imagecoll.images){
+            UpdateImageDescription( std::ref(img), l_desc );
+            UpdateImageWindowCentreWidth( std::ref(img) );
+        }
+    }
+    return true;
+}
+
 bool ComputeVolumetricSpatialDerivative(planar_image_collection<float,double> &imagecoll,
-                      std::list<std::reference_wrapper<planar_image_collection<float,double>>> /*external_imgs*/,
+                      std::list<std::reference_wrapper<planar_image_collection<float,double>>> external_imgs,
                       std::list<std::reference_wrapper<contour_collection<double>>> ccsl,
                       std::any user_data ){
 
@@ -40,6 +184,10 @@ bool ComputeVolumetricSpatialDerivative(planar_image_collection<float,double> &i
     //       the implementation. However, since derivatives are based on pixel coordinates, it is not clear how the
     //       derivative could be computed with non-rectilinear adjacency.
     //
+    // The Gaussian estimator instead computes derivatives of the Gaussian-smoothed image in DICOM units using the
+    // separable filter engine. It also supports the Laplacian-of-Gaussian and Hessian. Hessian components are written to
+    // six external image collections, which should be copies of the source images; the source images are not altered.
+    //
 
     //We require a valid ComputeVolumetricSpatialDerivativeUserData struct packed into the user_data.
     ComputeVolumetricSpatialDerivativeUserData *user_data_s;
@@ -60,6 +208,10 @@ bool ComputeVolumetricSpatialDerivative(planar_image_collection<float,double> &i
         return false;
     }
 
+    if(user_data_s->order == VolumetricSpatialDerivativeEstimator::Gaussian){
+        return ComputeVolumetricSpatialDerivativeGaussian(imagecoll, external_imgs, ccsl, *user_data_s);
+    }
+
     // Estimate the typical image pxl_dx, pxl_dy, and pxl_dz in case it is needed for thinning later.
     //
     // Note: this routine assumes the first image is representative of all images.
@@ -5,6 +5,8 @@
 #include <functional>
 #include <list>
 
+#include "../../Separable_Filters.h"
+
 
 template <class T, class R> class planar_image_collection;
 template <class T> class contour_collection;
@@ -14,7 +16,11 @@ typedef enum { // Controls which image derivatives are computed.
     // Centered first-order finite-difference derivatives.
     first, //Simple cartesian-aligned.
 
-    Sobel_3x3x3
+    Sobel_3x3x3,
+
+    // Gaussian derivatives (i.e., derivatives of the Gaussian-smoothed image) using the separable filter engine.
+    // Derivatives are expressed in DICOM units rather than pixel coordinates.
+    Gaussian
 
 } VolumetricSpatialDerivativeEstimator;
 
@@ -25,7 +31,13 @@ typedef enum { // Controls how image derivatives are computed and combined.
 
     magnitude,  //Magnitude of the gradient vector.
 
-    non_maximum_suppression //Edge-thinning technique to erode thick edges.
+    non_maximum_suppression, //Edge-thinning technique to erode thick edges.
+
+    laplacian, //Sum of the unmixed second derivatives. Gaussian estimator only.
+
+    hessian    //All second derivatives, written to six external image collections. Gaussian estimator only.
+               //Components are ordered like: row-row, column-column, image-image, row-column, row-image, and
+               //column-image, using the same axis naming as the row-, column-, and image-aligned methods.
 
 } VolumetricSpatialDerivativeMethod;
 
@@ -38,6 +50,10 @@ struct ComputeVolumetricSpatialDerivativeUserData {
     // The channel to analyze. If negative, all channels are analyzed.
     long int channel = -1;
 
+    // Parameters for the Gaussian estimator. Sigma is in DICOM units (mm) and applies along every axis.
+    double sigma = 1.0;
+    gaussian_method filter_method = gaussian_method::automatic;
+
 };
 
 bool ComputeVolumetricSpatialDerivative(planar_image_collection<float,double> &,
@@ -5,6 +5,7 @@
 #include <map>
 #include <string>
 
+#include "../../Image_Resampling.h"
 #include "../ConvenienceRoutines.h"
 #include "In_Image_Plane_Bicubic_Supersample.h"
 #include "YgorImages.h"
@@ -22,7 +23,8 @@ bool InImagePlaneBicubicSupersample(
 
     //This routine supersamples images, making them have a greater number of pixels. It uses an
     // in-plane bicubic supersampling technique that is completely oblivious to the pixel dimensions.
-    // Only nearest-neighbour adjacent pixels are used. "Mirror" boundaries are used.
+    // Catmull-Rom cubic convolution over the four nearest pixels along each axis is used. Edge pixels are extended
+    // at the boundaries.
 
     if(selected_img_its.size() != 1) FUNCERR("This routine operates on individual images only");
  
@@ -82,19 +84,28 @@ bool InImagePlaneBicubicSupersample(
     //Record the min and max actual pixel values for windowing purposes.
     Stats::Running_MinMax<float> minmax_pixel;
 
-    //Loop over the rows, columns, and channels.
-    for(auto row = 0; row < working.rows; ++row){
-        for(auto col = 0; col < working.columns; ++col){
-            for(auto chan = 0; chan < working.channels; ++chan){
-                const double row_sample_pos = (2.0*row + 1.0 - RowScaleFactorR)/(2.0*RowScaleFactorR);
-                const double col_sample_pos = (2.0*col + 1.0 - ColumnScaleFactorR)/(2.0*ColumnScaleFactorR);
-                const auto newval = first_img_it->bicubically_interpolate_in_pixel_number_space(row_sample_pos, col_sample_pos, chan);
-
-                working.reference(row, col, chan) = newval;
-                minmax_pixel.Digest(newval);
-            }//Loop over channels.
-        } //Loop over cols
-    } //Loop over rows
+    //Sample at (2*row + 1 - RowScaleFactor)/(2*RowScaleFactor) in pixel number space, and similarly for columns.
+    // The sampling is separable, so index and weight tables are computed once per axis and shared by all images with
+    // the same dimensions.
+    const auto row_table = Get_Resampling_Axis_Table( first_img_it->rows, working.rows,
+                                                      1.0 / RowScaleFactorR,
+                                                      (1.0 - RowScaleFactorR) / (2.0 * RowScaleFactorR),
+                                                      resampling_kernel::cubic,
+                                                      resampling_boundary::extend );
+    const auto col_table = Get_Resampling_Axis_Table( first_img_it->columns, working.columns,
+                                                      1.0 / ColumnScaleFactorR,
+                                                      (1.0 - ColumnScaleFactorR) / (2.0 * ColumnScaleFactorR),
+                                                      resampling_kernel::cubic,
+                                                      resampling_boundary::extend );
+    Resample_Plane( first_img_it->data.data(),
+                    first_img_it->channels,
+                    *row_table,
+                    *col_table,
+                    working.data.data(),
+                    -1 );
+    for(const auto &newval : working.data){
+        minmax_pixel.Digest(newval);
+    }
 
     //Replace the old image data with the new image data.
     *first_img_it = working;
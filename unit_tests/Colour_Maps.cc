@@ -0,0 +1,59 @@
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+#include "doctest/doctest.h"
+
+#include "Colour_Maps.h"
+
+
+TEST_CASE( "colour_map_lut class" ){
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    const auto inf = std::numeric_limits<float>::infinity();
+
+    const auto lut = Colour_Map_LUT(ColourMap_Linear, 4096);
+    REQUIRE( lut->size() == 4096 );
+    REQUIRE( Colour_Map_LUT(ColourMap_Linear, 4096) == lut ); // Built once and shared.
+
+    colour_lut_window w;
+    w.low = 0.0;
+    w.high = 10.0;
+    w.nan_colour = {{ 1, 2, 3, 4 }};
+
+    SUBCASE("agrees with direct evaluation"){
+        std::array<float, 11> in;
+        for(size_t i = 0; i < in.size(); ++i) in[i] = static_cast<float>(i);
+        std::array<uint8_t, 11 * 3> out;
+        lut->map_rgb(in.data(), in.size(), 1, w, out.data());
+        for(size_t i = 0; i < in.size(); ++i){
+            const auto c = ColourMap_Linear(in[i] / 10.0);
+            const auto expected = static_cast<long int>(c.R * 255.0);
+            REQUIRE( std::abs(static_cast<long int>(out[i * 3]) - expected) <= 1 );
+        }
+        REQUIRE( out[0] == 0 );
+        REQUIRE( out[10 * 3] == 255 );
+    }
+
+    SUBCASE("non-finite and out-of-range values"){
+        const std::array<float, 5> in = {{ nan, inf, -inf, -5.0f, 15.0f }};
+        std::array<uint8_t, 5 * 4> out;
+
+        lut->map_rgba(in.data(), in.size(), 1, w, out.data());
+        for(size_t i = 0; i < 3; ++i){
+            REQUIRE( out[i * 4 + 0] == 1 );
+            REQUIRE( out[i * 4 + 3] == 4 );
+        }
+        REQUIRE( out[3 * 4] == 0 );   // Clamped.
+        REQUIRE( out[4 * 4] == 255 ); // Clamped.
+        REQUIRE( out[4 * 4 + 3] == 255 );
+
+        w.below_colour = std::array<uint8_t,4>{{ 10, 10, 10, 10 }};
+        w.above_colour = std::array<uint8_t,4>{{ 20, 20, 20, 20 }};
+        lut->map_rgba(in.data(), in.size(), 1, w, out.data());
+        REQUIRE( out[3 * 4] == 10 );
+        REQUIRE( out[4 * 4] == 20 );
+    }
+}
+
@@ -0,0 +1,75 @@
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "Dose_Influence_Matrix.h"
+
+
+TEST_CASE( "Build_Dose_Influence_Matrix" ){
+    const std::vector<std::vector<float>> beams = { { 1.0f, 0.0f, 2.0f },
+                                                    { 0.0f, 0.0f, 3.0f } };
+    const auto A = Build_Dose_Influence_Matrix(beams);
+    REQUIRE( A.N_voxels == 3 );
+    REQUIRE( A.N_beams == 2 );
+    REQUIRE( A.nnz() == 3 );
+    const std::vector<long int> expected_offsets = { 0, 1, 1, 3 };
+    const std::vector<int32_t> expected_beams = { 0, 0, 1 };
+    REQUIRE( A.row_offsets == expected_offsets );
+    REQUIRE( A.beam_indices == expected_beams );
+
+    dose_influence_objective obj(A, 1.0, 0.5, 1.0);
+    std::vector<double> dose;
+    obj.Multiply({ 2.0, 10.0 }, dose);
+    const std::vector<double> expected_dose = { 2.0, 0.0, 34.0 };
+    REQUIRE( dose == expected_dose );
+
+    std::vector<double> t;
+    obj.Multiply_Transpose({ 1.0, 5.0, 2.0 }, t);
+    const std::vector<double> expected_t = { 5.0, 6.0 };
+    REQUIRE( t == expected_t );
+
+    REQUIRE_THROWS( Build_Dose_Influence_Matrix({ { 1.0f, 2.0f }, { 1.0f } }) );
+}
+
+TEST_CASE( "dose_influence_objective gradient" ){
+    const long int N_beams = 7;
+    const long int N_voxels = 500;
+    std::mt19937 re(12345);
+    std::uniform_real_distribution<float> rd(0.0f, 2.0f);
+    std::vector<std::vector<float>> beams(N_beams, std::vector<float>(N_voxels));
+    for(auto &b : beams){
+        for(auto &v : b) v = (rd(re) < 0.5f) ? 0.0f : rd(re);
+    }
+    dose_influence_objective obj(Build_Dose_Influence_Matrix(beams), 66.5, 0.95, 70.0);
+
+    const std::vector<double> w = { 0.1, 0.5, 0.3, 0.9, 0.2, 0.7, 0.4 };
+    std::vector<double> grad(N_beams, 0.0);
+    const auto cost = obj.Evaluate(w, grad);
+    REQUIRE( std::isfinite(cost) );
+
+    // Scaling the weights does not alter the cost, so the gradient is orthogonal to the weights.
+    std::vector<double> none;
+    std::vector<double> w2(w);
+    for(auto &x : w2) x *= 3.0;
+    REQUIRE( std::abs(obj.Evaluate(w2, none) - cost) < 1E-6 * cost );
+
+    double g_dot_w = 0.0;
+    for(long int b = 0; b < N_beams; ++b) g_dot_w += grad[b] * w[b];
+    REQUIRE( std::abs(g_dot_w) < 1E-6 * cost );
+
+    // Compare with centred finite differences. The step is small enough that the voxels at the normalization
+    // percentile do not change.
+    const double h = 1E-7;
+    for(long int b = 0; b < N_beams; ++b){
+        auto w_p = w;
+        auto w_m = w;
+        w_p[b] += h;
+        w_m[b] -= h;
+        const auto fd = (obj.Evaluate(w_p, none) - obj.Evaluate(w_m, none)) / (2.0 * h);
+        REQUIRE( std::abs(fd - grad[b]) < 1E-4 * std::abs(grad[b]) + 1E-2 );
+    }
+}
+
@@ -0,0 +1,151 @@
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "FFT_Correlation.h"
+
+
+// Directly evaluates the kernel at every voxel, mirroring the neighbourhood sampler.
+static std::vector<double>
+direct_apply_kernel( const std::vector<double> &vol,
+                     const volume_dims &vol_dims,
+                     const std::vector<double> &kernel,
+                     const volume_dims &k_dims,
+                     const volume_dims &offset,
+                     volume_kernel_reduction reduction ){
+    const auto vol_index = [&](long int r, long int c, long int i) -> long int {
+        return (i * vol_dims[0] + r) * vol_dims[1] + c;
+    };
+    std::vector<double> out(vol.size(), std::numeric_limits<double>::quiet_NaN());
+    for(long int i = 0; i < vol_dims[2]; ++i){
+        for(long int r = 0; r < vol_dims[0]; ++r){
+            for(long int c = 0; c < vol_dims[1]; ++c){
+                double acc = 0.0;
+                bool valid = true;
+                for(long int ki = 0; valid && (ki < k_dims[2]); ++ki){
+                    for(long int kr = 0; valid && (kr < k_dims[0]); ++kr){
+                        for(long int kc = 0; valid && (kc < k_dims[1]); ++kc){
+                            const auto vr = r + kr - offset[0];
+                            const auto vc = c + kc - offset[1];
+                            const auto vi = i + ki - offset[2];
+                            if( (vr < 0) || (vol_dims[0] <= vr)
+                            ||  (vc < 0) || (vol_dims[1] <= vc)
+                            ||  (vi < 0) || (vol_dims[2] <= vi) ){
+                                valid = false;
+                                break;
+                            }
+                            const auto v = vol[vol_index(vr, vc, vi)];
+                            const auto k = kernel[(ki * k_dims[0] + kr) * k_dims[1] + kc];
+                            if(!std::isfinite(v)){
+                                valid = false;
+                                break;
+                            }
+                            acc += (reduction == volume_kernel_reduction::inner_product) ? k * v
+                                                                                         : (v - k) * (v - k);
+                        }
+                    }
+                }
+                if(valid){
+                    out[vol_index(r, c, i)] = (reduction == volume_kernel_reduction::inner_product) ? acc
+                                                                                                    : std::sqrt(acc);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+
+TEST_CASE( "fft_plan" ){
+    const size_t N = 16;
+    const fft_plan plan(N);
+    REQUIRE( plan.size() == N );
+
+    std::vector<std::complex<double>> x(N);
+    for(size_t j = 0; j < N; ++j) x[j] = std::complex<double>(std::sin(0.3 * j) + 0.1 * j, std::cos(0.7 * j));
+
+    auto X = x;
+    plan.forward(X.data());
+
+    // Compare against the textbook discrete Fourier transform.
+    const double pi = std::acos(-1.0);
+    for(size_t k = 0; k < N; ++k){
+        std::complex<double> s(0.0, 0.0);
+        for(size_t j = 0; j < N; ++j){
+            s += x[j] * std::polar(1.0, -2.0 * pi * static_cast<double>(j * k) / static_cast<double>(N));
+        }
+        REQUIRE( std::abs(X[k] - s) < 1E-9 );
+    }
+
+    plan.inverse(X.data());
+    for(size_t j = 0; j < N; ++j){
+        REQUIRE( std::abs(X[j] - x[j]) < 1E-12 );
+    }
+}
+
+TEST_CASE( "Apply_Kernel_Via_FFT" ){
+    // The volume spans several tiles along the row and column axes, and no dimension is a power of two.
+    const volume_dims vol_dims = {{ 37, 23, 9 }};
+    std::vector<double> vol(static_cast<size_t>(vol_dims[0] * vol_dims[1] * vol_dims[2]));
+    for(size_t j = 0; j < vol.size(); ++j){
+        vol[j] = std::sin(0.37 * static_cast<double>(j)) + 0.01 * static_cast<double>(j % 17);
+    }
+
+    const volume_dims k_dims = {{ 3, 4, 2 }};
+    std::vector<double> kernel(static_cast<size_t>(k_dims[0] * k_dims[1] * k_dims[2]));
+    for(size_t j = 0; j < kernel.size(); ++j){
+        kernel[j] = std::cos(1.3 * static_cast<double>(j)) - 0.2;
+    }
+
+    const auto require_equivalent = [&](const std::vector<double> &in,
+                                        const volume_dims &offset,
+                                        volume_kernel_reduction reduction){
+        const auto expected = direct_apply_kernel(in, vol_dims, kernel, k_dims, offset, reduction);
+        const auto actual = Apply_Kernel_Via_FFT(in, vol_dims, kernel, k_dims, offset, reduction);
+        REQUIRE( actual.size() == expected.size() );
+
+        long int N_finite = 0;
+        for(size_t j = 0; j < expected.size(); ++j){
+            REQUIRE( std::isfinite(actual[j]) == std::isfinite(expected[j]) );
+            if(std::isfinite(expected[j])){
+                REQUIRE( std::abs(actual[j] - expected[j]) < 1E-9 );
+                ++N_finite;
+            }
+        }
+        REQUIRE( 0 < N_finite );
+    };
+
+    SUBCASE("correlation matches direct evaluation for centred, corner, and asymmetric offsets"){
+        for(const auto &offset : { volume_dims{{ 1, 2, 1 }},
+                                   volume_dims{{ 0, 0, 0 }},
+                                   volume_dims{{ 2, 3, 1 }},
+                                   volume_dims{{ -1, 5, 0 }} }){
+            require_equivalent(vol, offset, volume_kernel_reduction::inner_product);
+        }
+    }
+
+    SUBCASE("Euclidean distance matches direct evaluation"){
+        for(const auto &offset : { volume_dims{{ 1, 2, 1 }},
+                                   volume_dims{{ 2, 0, 0 }} }){
+            require_equivalent(vol, offset, volume_kernel_reduction::euclidean_distance);
+        }
+    }
+
+    SUBCASE("windows overlapping non-finite voxels are NaN"){
+        auto vol_nan = vol;
+        vol_nan[(4 * vol_dims[0] + 20) * vol_dims[1] + 11] = std::numeric_limits<double>::quiet_NaN();
+        require_equivalent(vol_nan, volume_dims{{ 1, 2, 1 }}, volume_kernel_reduction::inner_product);
+        require_equivalent(vol_nan, volume_dims{{ 1, 2, 1 }}, volume_kernel_reduction::euclidean_distance);
+    }
+
+    SUBCASE("kernels larger than the volume produce only NaN"){
+        const volume_dims small_dims = {{ 2, 23, 9 }};
+        const std::vector<double> small(vol.begin(), vol.begin() + small_dims[0] * small_dims[1] * small_dims[2]);
+        const auto out = Apply_Kernel_Via_FFT(small, small_dims, kernel, k_dims, volume_dims{{ 1, 2, 1 }},
+                                              volume_kernel_reduction::inner_product);
+        for(const auto &v : out) REQUIRE( std::isnan(v) );
+    }
+}
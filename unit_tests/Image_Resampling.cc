@@ -0,0 +1,67 @@
+
+#include <cmath>
+#include <functional>
+#include <list>
+
+#include "doctest/doctest.h"
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+
+#include "Image_Resampling.h"
+
+
+// A linear function of position, which linear interpolation reproduces exactly.
+static double
+test_field(const vec3<double> &p){
+    return 3.0 * p.x - 2.0 * p.y + 0.5 * p.z + 1.0;
+}
+
+static planar_image<float,double>
+make_test_image(long int rows, long int cols, double pxl_dx, double pxl_dy, const vec3<double> &offset){
+    planar_image<float,double> img;
+    img.init_orientation( vec3<double>(1.0, 0.0, 0.0), vec3<double>(0.0, 1.0, 0.0) );
+    img.init_buffer(rows, cols, 1);
+    img.init_spatial( pxl_dx, pxl_dy, 1.0, vec3<double>(0.0, 0.0, 0.0), offset );
+    for(long int r = 0; r < img.rows; ++r){
+        for(long int c = 0; c < img.columns; ++c){
+            img.reference(r, c, 0) = static_cast<float>(test_field(img.position(r, c)));
+        }
+    }
+    return img;
+}
+
+
+TEST_CASE( "resampling_stack" ){
+    // Non-square source images with anisotropic pixels, separated along the normal.
+    auto src_A = make_test_image(4, 6, 2.0, 1.0, vec3<double>(0.0, 0.0, 0.0));
+    auto src_B = make_test_image(4, 6, 2.0, 1.0, vec3<double>(0.0, 0.0, 2.0));
+    std::list<std::reference_wrapper<planar_image<float,double>>> src_imgs = { std::ref(src_A), std::ref(src_B) };
+    const resampling_stack stack(src_imgs);
+    REQUIRE( stack.is_valid() );
+
+    SUBCASE("a destination with different offset and spacing samples the correct positions"){
+        auto dst = make_test_image(3, 5, 1.5, 0.7, vec3<double>(0.5, 0.3, 0.5));
+        for(auto &v : dst.data) v = -1.0f;
+        REQUIRE( stack.is_compatible(dst) );
+        REQUIRE( stack.resample(dst, 0, resampling_kernel::linear, resampling_boundary::nan) );
+
+        for(long int r = 0; r < dst.rows; ++r){
+            for(long int c = 0; c < dst.columns; ++c){
+                const auto expected = test_field(dst.position(r, c));
+                const auto actual = static_cast<double>(dst.value(r, c, 0));
+                REQUIRE( std::abs(actual - expected) < 1E-4 );
+            }
+        }
+    }
+
+    SUBCASE("samples beyond the source extent are NaN"){
+        // Rows extend to x = 6 and columns to y = 5 in the source, so the last row here (x = 8) is outside.
+        auto dst = make_test_image(2, 2, 8.0, 1.0, vec3<double>(0.0, 0.0, 1.0));
+        REQUIRE( stack.resample(dst, 0, resampling_kernel::linear, resampling_boundary::nan) );
+        const auto inside = static_cast<double>(dst.value(0, 1, 0));
+        REQUIRE( std::abs(inside - test_field(dst.position(0, 1))) < 1E-4 );
+        REQUIRE( std::isnan(dst.value(1, 0, 0)) );
+    }
+}
+
@@ -0,0 +1,74 @@
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "Mapped_File.h"
+
+
+TEST_CASE( "text_cursor" ){
+    const std::string text = "  1.5 +2\tword\n3e2 4x\n";
+    text_cursor tc(text);
+
+    double x = 0.0;
+    REQUIRE( tc.next_number(x) );
+    REQUIRE( x == 1.5 );
+    REQUIRE( tc.next_number_on_line(x) );
+    REQUIRE( x == 2.0 );
+    REQUIRE( !tc.next_number_on_line(x) );
+    REQUIRE( tc.next_token_on_line() == "word" );
+    REQUIRE( tc.at_line_end() );
+    REQUIRE( tc.next_number(x) );
+    REQUIRE( x == 300.0 );
+    REQUIRE( !tc.next_number(x) ); // Trailing characters are rejected.
+    REQUIRE( tc.next_token() == "4x" );
+    REQUIRE( tc.next_token().empty() );
+    REQUIRE( tc.at_end() );
+}
+
+TEST_CASE( "Next_Text_Line" ){
+    const std::string text = "a b # comment\n\nc";
+    const char *pos = text.data();
+    const char *end = pos + text.size();
+    REQUIRE( Next_Text_Line(pos, end, '#') == "a b " );
+    REQUIRE( Next_Text_Line(pos, end, '#').empty() );
+    REQUIRE( Next_Text_Line(pos, end, '#') == "c" );
+    REQUIRE( pos == end );
+}
+
+TEST_CASE( "Split_Text_At_Whitespace and Count_Text_Tokens" ){
+    std::string text;
+    for(int i = 0; i < 1000; ++i) text += std::to_string(i) + ((i % 10 == 9) ? "\n" : " ");
+
+    const auto chunks = Split_Text_At_Whitespace(text, 8, 100);
+    REQUIRE( chunks.size() == 8 );
+
+    std::string joined;
+    size_t N_tokens = 0;
+    for(const auto &c : chunks){
+        joined += std::string(c);
+        N_tokens += Count_Text_Tokens(c);
+    }
+    REQUIRE( joined == text );
+    REQUIRE( N_tokens == 1000 ); // Tokens are never divided between chunks.
+}
+
+TEST_CASE( "Parse_Number_Rows" ){
+    SUBCASE("conforming rows are parsed in order"){
+        std::vector<double> out;
+        REQUIRE( Parse_Number_Rows("# comment\n1 2 3\n\n4,5;6 # trailing\n", 3, ",;", '#', out) );
+        const std::vector<double> expected = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+        REQUIRE( out == expected );
+    }
+
+    SUBCASE("non-conforming rows are rejected"){
+        std::vector<double> out;
+        REQUIRE( !Parse_Number_Rows("1 2 3\n4 5\n", 3, "", '#', out) );
+        REQUIRE( !Parse_Number_Rows("1 2 3\n4 5 six\n", 3, "", '#', out) );
+        REQUIRE( !Parse_Number_Rows("1 2 3 # comment\n", 3, "", '\0', out) );
+        REQUIRE( out.empty() );
+    }
+}
+
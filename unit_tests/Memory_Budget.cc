@@ -0,0 +1,90 @@
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+
+#include "Structs.h"
+#include "Memory_Budget.h"
+
+
+TEST_CASE( "Parse_Memory_Size" ){
+    const uint64_t KiB = 1024;
+    REQUIRE( Parse_Memory_Size("4096") == 4096 );
+    REQUIRE( Parse_Memory_Size("2k") == 2 * KiB );
+    REQUIRE( Parse_Memory_Size("512M") == 512 * KiB * KiB );
+    REQUIRE( Parse_Memory_Size(" 48G ") == 48 * KiB * KiB * KiB );
+    REQUIRE( Parse_Memory_Size("1.5TiB") == 3 * KiB * KiB * KiB * KiB / 2 );
+    REQUIRE( Parse_Memory_Size("64 mb") == 64 * KiB * KiB );
+    REQUIRE( Parse_Memory_Size(".5K") == KiB / 2 );
+
+    REQUIRE_THROWS( Parse_Memory_Size("") );
+    REQUIRE_THROWS( Parse_Memory_Size("G") );
+    REQUIRE_THROWS( Parse_Memory_Size("-5G") );
+    REQUIRE_THROWS( Parse_Memory_Size("1.2.3") );
+    REQUIRE_THROWS( Parse_Memory_Size("5.") );
+    REQUIRE_THROWS( Parse_Memory_Size("12Q") );
+    REQUIRE_THROWS( Parse_Memory_Size("12Gi") );
+}
+
+TEST_CASE( "Enforce_Memory_Budget and Make_Resident" ){
+    Drover DICOM_data;
+
+    auto ia = std::make_shared<Image_Array>();
+    for(long int n = 0; n < 2; ++n){
+        ia->imagecoll.images.emplace_back();
+        auto &img = ia->imagecoll.images.back();
+        img.init_orientation( vec3<double>(1.0, 0.0, 0.0), vec3<double>(0.0, 1.0, 0.0) );
+        img.init_buffer(4, 5, 1);
+        img.init_spatial( 1.0, 1.0, 1.0, vec3<double>(0.0, 0.0, 0.0), vec3<double>(0.0, 0.0, static_cast<double>(n)) );
+        for(long int r = 0; r < img.rows; ++r){
+            for(long int c = 0; c < img.columns; ++c){
+                img.reference(r, c, 0) = static_cast<float>(100 * n + 10 * r + c);
+            }
+        }
+    }
+    DICOM_data.image_data.push_back(ia);
+
+    auto sm = std::make_shared<Surface_Mesh>();
+    sm->meshes.vertices = { vec3<double>(0.0, 0.0, 0.0),
+                            vec3<double>(1.0, 0.0, 0.0),
+                            vec3<double>(0.0, 1.0, 0.5) };
+    sm->meshes.faces = { { 0, 1, 2 } };
+    sm->meshes.recreate_involved_face_index();
+    DICOM_data.smesh_data.push_back(sm);
+
+    std::vector<std::vector<float>> orig_pixels;
+    for(const auto &img : ia->imagecoll.images) orig_pixels.push_back(img.data);
+    const auto orig_vertices = sm->meshes.vertices;
+    const auto orig_faces = sm->meshes.faces;
+    const auto orig_involved_faces = sm->meshes.involved_faces;
+
+    // A tiny budget forces everything to be spilled.
+    const auto metrics_before = Get_Memory_Budget_Metrics();
+    Set_Memory_Budget(1);
+    Enforce_Memory_Budget(DICOM_data);
+    const auto metrics_spilled = Get_Memory_Budget_Metrics();
+    REQUIRE( (metrics_spilled.spill_count - metrics_before.spill_count) == 2 );
+    for(const auto &img : ia->imagecoll.images){
+        REQUIRE( img.data.empty() );
+    }
+    REQUIRE( sm->meshes.vertices.empty() );
+    REQUIRE( sm->meshes.faces.empty() );
+
+    Make_Resident(DICOM_data);
+    Set_Memory_Budget(0);
+    const auto metrics_reloaded = Get_Memory_Budget_Metrics();
+    REQUIRE( (metrics_reloaded.reload_count - metrics_spilled.reload_count) == 2 );
+
+    std::vector<std::vector<float>> pixels;
+    for(const auto &img : ia->imagecoll.images) pixels.push_back(img.data);
+    REQUIRE( pixels == orig_pixels );
+    REQUIRE( sm->meshes.vertices == orig_vertices );
+    REQUIRE( sm->meshes.faces == orig_faces );
+    REQUIRE( sm->meshes.involved_faces == orig_involved_faces );
+}
+
@@ -0,0 +1,125 @@
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "doctest/doctest.h"
+
+#include "YgorMath.h"
+
+#include "Mesh_IO.h"
+
+
+// A unit square in the z=0 plane with both a triangle and a quad face.
+static fv_surface_mesh<double, uint64_t>
+make_test_mesh(){
+    fv_surface_mesh<double, uint64_t> mesh;
+    mesh.vertices = { vec3<double>(0.0, 0.0, 0.0),
+                      vec3<double>(1.0, 0.0, 0.0),
+                      vec3<double>(1.0, 1.0, 0.0),
+                      vec3<double>(0.0, 1.0, 0.0),
+                      vec3<double>(0.5, 0.5, 1.25) };
+    mesh.faces = { { 0, 1, 2, 3 },
+                   { 0, 1, 4 } };
+    return mesh;
+}
+
+
+TEST_CASE( "Parse_OFF_Mesh" ){
+    const std::string off = "OFF\n"
+                            "# A comment.\n"
+                            "5 2 0\n"
+                            "0 0 0\n"
+                            "1 0 0\n"
+                            "\n"
+                            "1 1 0\n"
+                            "0 1 0\n"
+                            "0.5 0.5 1.25\n"
+                            "4 0 1 2 3\n"
+                            "3 0 1 4\n";
+    const auto ref = make_test_mesh();
+    fv_surface_mesh<double, uint64_t> mesh;
+    REQUIRE( Parse_OFF_Mesh(mesh, off) );
+    REQUIRE( mesh.vertices == ref.vertices );
+    REQUIRE( mesh.faces == ref.faces );
+
+    SUBCASE("unsupported features are rejected"){
+        fv_surface_mesh<double, uint64_t> other;
+        REQUIRE( !Parse_OFF_Mesh(other, "COFF\n3 1 0\n0 0 0 1 1 1 1\n1 0 0 1 1 1 1\n0 1 0 1 1 1 1\n3 0 1 2\n") );
+        REQUIRE( !Parse_OFF_Mesh(other, "OFF\n3 1 0\n0 0 0\n1 0 0\n0 1 0\n3 0 1 2 255 0 0\n") );
+        REQUIRE( !Parse_OFF_Mesh(other, "OFF\n3 1 0\n0 0 0\n1 0 0\n0 1 0\n3 0 1 3\n") );
+        REQUIRE( other.vertices.empty() );
+    }
+}
+
+TEST_CASE( "Parse_OBJ_Mesh" ){
+    const std::string obj = "# A comment.\n"
+                            "o square\n"
+                            "v 0 0 0\n"
+                            "v 1 0 0\n"
+                            "v 1 1 0\n"
+                            "v 0 1 0\n"
+                            "vt 0.5 0.5\n"
+                            "f 1/1 2/1 3/1 4/1\n"
+                            "v 0.5 0.5 1.25\n"
+                            "f -5 -4 -1\n";
+    const auto ref = make_test_mesh();
+    fv_surface_mesh<double, uint64_t> mesh;
+    REQUIRE( Parse_OBJ_Mesh(mesh, obj) );
+    REQUIRE( mesh.vertices == ref.vertices );
+    REQUIRE( mesh.faces == ref.faces );
+}
+
+TEST_CASE( "Parse_STL_Mesh" ){
+    const auto ref = make_test_mesh();
+
+    SUBCASE("ASCII files with shared vertices are merged"){
+        const std::string stl = "solid test\n"
+                                "  facet normal 0 0 1\n"
+                                "    outer loop\n"
+                                "      vertex 0 0 0\n"
+                                "      vertex 1 0 0\n"
+                                "      vertex 1 1 0\n"
+                                "    endloop\n"
+                                "  endfacet\n"
+                                "  facet normal 0 0 1\n"
+                                "    outer loop\n"
+                                "      vertex 0 0 0\n"
+                                "      vertex 1 1 0\n"
+                                "      vertex 0 1 0\n"
+                                "    endloop\n"
+                                "  endfacet\n"
+                                "endsolid test\n";
+        fv_surface_mesh<double, uint64_t> mesh;
+        REQUIRE( Parse_STL_Mesh(mesh, stl) );
+        REQUIRE( mesh.vertices.size() == 4 );
+        REQUIRE( mesh.faces.size() == 2 );
+        REQUIRE( mesh.faces[1][0] == mesh.faces[0][0] );
+        REQUIRE( mesh.faces[1][1] == mesh.faces[0][2] );
+    }
+
+    SUBCASE("binary files round-trip"){
+        std::stringstream ss;
+        REQUIRE( Write_Binary_STL_Mesh(ref, ss) );
+        const auto bin = ss.str();
+        REQUIRE( bin.size() == (84 + 50 * 3) );
+
+        fv_surface_mesh<double, uint64_t> mesh;
+        REQUIRE( Parse_STL_Mesh(mesh, bin) );
+        REQUIRE( mesh.vertices == ref.vertices );
+        REQUIRE( mesh.faces.size() == 3 ); // The quad is split into two triangles.
+    }
+}
+
+TEST_CASE( "Write_Binary_PLY_Mesh" ){
+    const auto ref = make_test_mesh();
+    std::stringstream ss;
+    REQUIRE( Write_Binary_PLY_Mesh(ref, ss) );
+    const auto ply = ss.str();
+    const std::string end_header = "end_header\n";
+    const auto data_start = ply.find(end_header) + end_header.size();
+    REQUIRE( ply.find("element vertex 5\n") != std::string::npos );
+    REQUIRE( ply.find("element face 2\n") != std::string::npos );
+    REQUIRE( ply.size() == (data_start + 5 * 24 + (1 + 4 * 4) + (1 + 4 * 3)) );
+}
+
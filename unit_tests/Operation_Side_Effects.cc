@@ -0,0 +1,67 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "doctest/doctest.h"
+
+
+// Operations that write files or interact with the user directly must declare it in their documentation so that
+// Operation_Dispatcher() does not invoke them concurrently. This test guards against new or modified operations
+// forgetting to do so by scanning the operation sources for direct output.
+TEST_CASE( "Operations declare external side-effects" ){
+    const char *reporoot = std::getenv("REPOROOT");
+    REQUIRE( reporoot != nullptr );
+    const auto ops_dir = boost::filesystem::path(reporoot) / "src" / "Operations";
+    REQUIRE( boost::filesystem::is_directory(ops_dir) );
+
+    // Calls that write to files or displays. Writers that target caller-provided streams (e.g., WriteFVSMeshToOFF)
+    // are not listed since the stream is usually in-memory; opening a file stream is caught instead.
+    const std::vector<std::string> direct_output = {
+        "std::ofstream",
+        "std::fstream",
+        "fopen(",
+        "WriteToFITS(",
+        "WriteStringToFile(",
+        "Write_To_File(",
+        "Write_XYZ(",
+        "Write_PLY(",
+        "Write_Cube_OBJ(",
+        "SaveAsOFF(",
+        "Write_Dose_Array(",
+        "Write_CT_Images(",
+        "Write_Contours(",
+        "Write_Binary_STL_Mesh(",
+        "Write_Binary_PLY_Mesh(",
+        "YgorMathPlottingGnuplot::Plot<",
+    };
+    const std::string declaration = "has_external_side_effects = true;";
+
+    long int N_scanned = 0;
+    for(const auto &entry : boost::filesystem::directory_iterator(ops_dir)){
+        const auto &p = entry.path();
+        if(p.extension() != ".cc") continue;
+        ++N_scanned;
+
+        std::ifstream is(p.string());
+        std::string line;
+        std::string first_output;
+        bool declared = false;
+        while(std::getline(is, line)){
+            if(line.find(declaration) != std::string::npos) declared = true;
+
+            // Ignore comments and disabled code.
+            const auto code = line.substr(0, line.find("//"));
+            if(code.find("if(false)") != std::string::npos) continue;
+            for(const auto &o : direct_output){
+                if(first_output.empty() && (code.find(o) != std::string::npos)) first_output = o;
+            }
+        }
+
+        INFO( p.filename().string() << " uses " << first_output );
+        REQUIRE( (first_output.empty() || declared) );
+    }
+    REQUIRE( 100 < N_scanned );
+}
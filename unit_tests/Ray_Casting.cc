@@ -0,0 +1,89 @@
+
+#include <cmath>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+
+#include "Ray_Casting.h"
+
+
+// A non-square image with anisotropic pixels. Rows are spaced by pxl_dx along row_unit and columns by pxl_dy along
+// col_unit, so pixel (row, col) is centred at (2*row, col, 0).
+static planar_image<float,double>
+make_test_image(){
+    planar_image<float,double> img;
+    img.init_orientation( vec3<double>(1.0, 0.0, 0.0), vec3<double>(0.0, 1.0, 0.0) );
+    img.init_buffer(3, 5, 1);
+    img.init_spatial( 2.0, 1.0, 1.0, vec3<double>(0.0, 0.0, 0.0), vec3<double>(0.0, 0.0, 0.0) );
+    for(long int r = 0; r < img.rows; ++r){
+        for(long int c = 0; c < img.columns; ++c){
+            img.reference(r, c, 0) = static_cast<float>(10 * r + c);
+        }
+    }
+    return img;
+}
+
+
+TEST_CASE( "Traverse_Ray_Through_Image" ){
+    const auto img = make_test_image();
+
+    SUBCASE("a ray along row_unit crosses every row of a single column"){
+        std::vector<long int> rows;
+        double length = 0.0;
+        bool same_col = true;
+        Traverse_Ray_Through_Image(img, vec3<double>(-10.0, 3.0, 0.0), vec3<double>(1.0, 0.0, 0.0), 0.0, 30.0,
+            [&](long int row, long int col, double t_enter, double t_exit) -> void {
+                rows.push_back(row);
+                same_col = same_col && (col == 3);
+                length += t_exit - t_enter;
+                REQUIRE( std::abs((t_exit - t_enter) - img.pxl_dx) < 1E-9 );
+            });
+        const std::vector<long int> expected = { 0, 1, 2 };
+        REQUIRE( rows == expected );
+        REQUIRE( same_col );
+        REQUIRE( std::abs(length - 3.0 * img.pxl_dx) < 1E-9 );
+    }
+
+    SUBCASE("a ray along col_unit crosses every column of a single row"){
+        std::vector<long int> cols;
+        double length = 0.0;
+        bool same_row = true;
+        Traverse_Ray_Through_Image(img, vec3<double>(2.0, -10.0, 0.0), vec3<double>(0.0, 1.0, 0.0), 0.0, 30.0,
+            [&](long int row, long int col, double t_enter, double t_exit) -> void {
+                cols.push_back(col);
+                same_row = same_row && (row == 1);
+                length += t_exit - t_enter;
+            });
+        const std::vector<long int> expected = { 0, 1, 2, 3, 4 };
+        REQUIRE( cols == expected );
+        REQUIRE( same_row );
+        REQUIRE( std::abs(length - 5.0 * img.pxl_dy) < 1E-9 );
+    }
+
+    SUBCASE("visited pixels contain the ray"){
+        const auto dir = vec3<double>(2.0, 1.0, 0.0).unit();
+        const auto origin = vec3<double>(-1.0, -0.5, 0.0);
+        Traverse_Ray_Through_Image(img, origin, dir, 0.0, 30.0,
+            [&](long int row, long int col, double t_enter, double t_exit) -> void {
+                const auto mid = origin + dir * (0.5 * (t_enter + t_exit));
+                const auto centre = img.position(row, col);
+                REQUIRE( std::abs(mid.x - centre.x) <= (0.5 * img.pxl_dx + 1E-9) );
+                REQUIRE( std::abs(mid.y - centre.y) <= (0.5 * img.pxl_dy + 1E-9) );
+            });
+    }
+}
+
+TEST_CASE( "Integrate_Image_Along_Ray" ){
+    planar_image_collection<float,double> imagecoll;
+    imagecoll.images.push_back( make_test_image() );
+
+    // Column 4 holds 4, 14, 24 over rows 0-2, each traversed for pxl_dx = 2.
+    const std::vector<ray_interval> intervals = { ray_interval{ 0.0, 30.0 } };
+    const auto integral = Integrate_Image_Along_Ray(imagecoll, vec3<double>(-10.0, 4.0, 0.0), vec3<double>(1.0, 0.0, 0.0),
+                                                    intervals, 0);
+    REQUIRE( std::abs(integral - 2.0 * (4.0 + 14.0 + 24.0)) < 1E-6 );
+}
+
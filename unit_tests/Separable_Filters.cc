@@ -0,0 +1,106 @@
+
+#include <cmath>
+#include <limits>
+
+#include "doctest/doctest.h"
+
+#include "Separable_Filters.h"
+
+
+static filter_volume
+make_test_volume(long int imgs, long int rows, long int cols){
+    filter_volume vol;
+    vol.N_imgs = imgs;
+    vol.N_rows = rows;
+    vol.N_cols = cols;
+    vol.img_spacing = 2.0;
+    vol.row_spacing = 0.8;
+    vol.col_spacing = 1.0;
+    vol.data.assign(imgs * rows * cols, 0.0f);
+    return vol;
+}
+
+
+TEST_CASE( "Gaussian_Blur" ){
+    gaussian_filter_params p;
+    p.img_sigma = 5.0;
+    p.row_sigma = 5.0;
+    p.col_sigma = 5.0;
+
+    SUBCASE("impulse response is normalized and has the requested width in DICOM units"){
+        for(const auto method : { gaussian_method::fir, gaussian_method::iir }){
+            p.method = method;
+            auto vol = make_test_volume(41, 81, 81);
+            vol.reference(20, 40, 40) = 1.0f;
+            const auto out = Gaussian_Blur(vol, p);
+
+            double sum = 0.0;
+            double var_r = 0.0;
+            for(long int i = 0; i < out.N_imgs; ++i){
+                for(long int r = 0; r < out.N_rows; ++r){
+                    for(long int c = 0; c < out.N_cols; ++c){
+                        const double w = out.value(i, r, c);
+                        const double d_r = (r - 40) * vol.row_spacing;
+                        sum += w;
+                        var_r += w * d_r * d_r;
+                    }
+                }
+            }
+            REQUIRE( std::abs(sum - 1.0) < 5E-3 );
+            REQUIRE( std::abs(std::sqrt(var_r / sum) - 5.0) < 0.1 ); // The recursive filter is approximate.
+        }
+    }
+
+    SUBCASE("non-finite voxels are ignored"){
+        auto vol = make_test_volume(5, 6, 7);
+        for(auto &v : vol.data) v = 2.0f;
+        vol.reference(2, 3, 3) = std::numeric_limits<float>::quiet_NaN();
+        const auto out = Gaussian_Blur(vol, p);
+        for(const auto &v : out.data){
+            REQUIRE( std::abs(v - 2.0f) < 1E-4f );
+        }
+    }
+}
+
+TEST_CASE( "Gaussian_Derivatives" ){
+    // f = 0.01 x^2 + 0.02 y z + 0.3 z, where x, y, and z are the column, row, and image positions.
+    auto vol = make_test_volume(30, 40, 40);
+    for(long int i = 0; i < vol.N_imgs; ++i){
+        for(long int r = 0; r < vol.N_rows; ++r){
+            for(long int c = 0; c < vol.N_cols; ++c){
+                const double x = c * vol.col_spacing;
+                const double y = r * vol.row_spacing;
+                const double z = i * vol.img_spacing;
+                vol.reference(i, r, c) = static_cast<float>(0.01 * x * x + 0.02 * y * z + 0.3 * z);
+            }
+        }
+    }
+
+    gaussian_filter_params p;
+    p.img_sigma = 3.0;
+    p.row_sigma = 3.0;
+    p.col_sigma = 3.0;
+    p.method = gaussian_method::fir;
+
+    gaussian_derivative_request req;
+    req.gradient = true;
+    req.hessian = true;
+    req.laplacian = true;
+    const auto out = Gaussian_Derivatives(vol, p, req);
+    REQUIRE( out.smoothed.data.empty() );
+
+    const long int i = 15;
+    const long int r = 20;
+    const long int c = 20;
+    const double x = c * vol.col_spacing;
+    const double y = r * vol.row_spacing;
+    const double z = i * vol.img_spacing;
+    REQUIRE( std::abs(out.d_c.value(i, r, c) - (0.02 * x)) < 1E-4 );
+    REQUIRE( std::abs(out.d_r.value(i, r, c) - (0.02 * z)) < 1E-4 );
+    REQUIRE( std::abs(out.d_i.value(i, r, c) - (0.02 * y + 0.3)) < 1E-4 );
+    REQUIRE( std::abs(out.d_cc.value(i, r, c) - (0.02)) < 1E-4 );
+    REQUIRE( std::abs(out.d_ir.value(i, r, c) - (0.02)) < 1E-4 );
+    REQUIRE( std::abs(out.d_rc.value(i, r, c)) < 1E-5 );
+    REQUIRE( std::abs(out.laplacian.value(i, r, c) - (0.02)) < 1E-4 );
+}
+
@@ -0,0 +1,150 @@
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <utility>
+
+#include "YgorImages.h"
+#include "YgorMath.h"
+
+#include "doctest/doctest.h"
+
+#include "Colour_Maps.h"
+#include "Slice_Renderer.h"
+
+
+static planar_image<float,double>
+make_test_image(long int rows, long int cols, long int chnls){
+    planar_image<float,double> img;
+    img.init_orientation( vec3<double>(1.0, 0.0, 0.0), vec3<double>(0.0, 1.0, 0.0) );
+    img.init_buffer(rows, cols, chnls);
+    img.init_spatial(1.0, 1.0, 1.0, vec3<double>(0.0, 0.0, 0.0), vec3<double>(0.0, 0.0, 0.0));
+    return img;
+}
+
+
+TEST_CASE( "window_colour_lut class" ){
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    const auto inf = std::numeric_limits<float>::infinity();
+    const std::array<uint8_t,4> nan_colour = {{ 60, 0, 0, 255 }};
+    const std::array<uint8_t,4> black = {{ 0, 0, 0, 255 }};
+    const std::array<uint8_t,4> white = {{ 255, 255, 255, 255 }};
+
+    SUBCASE("window endpoints and clamping"){
+        const window_colour_lut lut(ColourMap_Linear, 0.0, 100.0, nan_colour);
+        REQUIRE( lut.get_low() == 0.0 );
+        REQUIRE( lut.get_high() == 100.0 );
+
+        REQUIRE( lut.map(0.0f) == black );
+        REQUIRE( lut.map(-50.0f) == black );
+        REQUIRE( lut.map(100.0f) == white );
+        REQUIRE( lut.map(150.0f) == white );
+
+        const auto mid = lut.map(50.0f);
+        REQUIRE( mid[0] == mid[1] );
+        REQUIRE( 126 <= mid[0] );
+        REQUIRE( mid[0] <= 128 );
+    }
+
+    SUBCASE("non-finite values"){
+        const window_colour_lut lut(ColourMap_Linear, 0.0, 100.0, nan_colour);
+        REQUIRE( lut.map(nan) == nan_colour );
+        REQUIRE( lut.map(inf) == nan_colour );
+        REQUIRE( lut.map(-inf) == nan_colour );
+    }
+
+    SUBCASE("degenerate window is a step"){
+        const window_colour_lut lut(ColourMap_Linear, 10.0, 10.0, nan_colour);
+        REQUIRE( lut.map(9.0f) == black );
+        REQUIRE( lut.map(10.0f) == black );
+        REQUIRE( lut.map(11.0f) == white );
+    }
+
+    SUBCASE("strided input"){
+        const window_colour_lut lut(ColourMap_Linear, 0.0, 1.0, nan_colour);
+        const std::array<float,6> in = {{ 0.0f, 9.0f, 1.0f, 9.0f, nan, 9.0f }};
+        std::array<uint8_t,12> out;
+        lut.map(in.data(), 3, 2, out.data());
+        REQUIRE( out[0] == 0 );
+        REQUIRE( out[4] == 255 );
+        REQUIRE( out[8] == 60 );
+    }
+}
+
+TEST_CASE( "Render_Slice" ){
+    auto img = make_test_image(2, 3, 2);
+    for(long int r = 0; r < img.rows; ++r){
+        for(long int c = 0; c < img.columns; ++c){
+            img.reference(r, c, 0) = static_cast<float>(r * img.columns + c);
+            img.reference(r, c, 1) = -1.0f;
+        }
+    }
+
+    slice_render_settings s;
+    s.colour_map_name = "LinearRamp";
+    s.colour_map = ColourMap_Linear;
+
+    SUBCASE("full range is used when no window is available"){
+        const auto w = Select_Render_Window(img, s);
+        REQUIRE( w.first == -1.0 );
+        REQUIRE( w.second == 5.0 );
+    }
+
+    SUBCASE("explicit window and row-major layout"){
+        s.window_centre = 2.5;
+        s.window_width = 5.0;
+        const auto rs = Render_Slice(img, s);
+        REQUIRE( rs.rows == 2 );
+        REQUIRE( rs.columns == 3 );
+        REQUIRE( rs.rgba.size() == 24 );
+        REQUIRE( rs.rgba[0] == 0 );     // (row 0, col 0) = 0.
+        REQUIRE( rs.rgba[5 * 4] == 255 ); // (row 1, col 2) = 5.
+        REQUIRE( rs.rgba[3] == 255 );
+    }
+
+    SUBCASE("invalid channel"){
+        s.channel = 2;
+        REQUIRE_THROWS( Render_Slice(img, s) );
+    }
+}
+
+TEST_CASE( "slice_render_cache class" ){
+    auto img_A = make_test_image(4, 4, 1);
+    auto img_B = make_test_image(4, 4, 1);
+
+    slice_render_settings s;
+    s.colour_map_name = "LinearRamp";
+    s.colour_map = ColourMap_Linear;
+
+    slice_render_cache cache(4);
+
+    SUBCASE("cached slices are reused"){
+        const auto rs_1 = cache.get(img_A, s);
+        const auto rs_2 = cache.get(img_A, s);
+        REQUIRE( rs_1 == rs_2 );
+        REQUIRE( cache.contains(img_A) );
+        REQUIRE( !cache.contains(img_B) );
+
+        cache.invalidate(img_A);
+        REQUIRE( !cache.contains(img_A) );
+    }
+
+    SUBCASE("changing settings discards cached slices"){
+        cache.get(img_A, s);
+        s.colour_map_name = "Viridis";
+        s.colour_map = ColourMap_Viridis;
+        cache.get(img_B, s);
+        REQUIRE( !cache.contains(img_A) );
+        REQUIRE( cache.contains(img_B) );
+    }
+
+    SUBCASE("prefetched slices are rendered in the background"){
+        cache.get(img_A, s);
+        cache.prefetch({ &img_B });
+        const auto rs = cache.get(img_B, s); // Either already rendered or rendered now.
+        REQUIRE( rs->rgba.size() == 64 );
+        REQUIRE( cache.contains(img_B) );
+    }
+}
+
@@ -26,9 +26,25 @@ fi
 g++ -std=c++17 -Wall -I. -I"${REPOROOT}/src" \
   Main.cc \
   {,"${REPOROOT}/src/"}Alignment_TPSRPM.cc \
+  {,"${REPOROOT}/src/"}Slice_Renderer.cc \
+  {,"${REPOROOT}/src/"}Colour_Maps.cc \
+  {,"${REPOROOT}/src/"}Separable_Filters.cc \
+  {,"${REPOROOT}/src/"}Image_Resampling.cc \
+  {,"${REPOROOT}/src/"}Dose_Influence_Matrix.cc \
+  {,"${REPOROOT}/src/"}Mesh_IO.cc \
+  {,"${REPOROOT}/src/"}Ray_Casting.cc \
+  {,"${REPOROOT}/src/"}Mapped_File.cc \
+  {,"${REPOROOT}/src/"}Memory_Budget.cc \
+  {,"${REPOROOT}/src/"}FFT_Correlation.cc \
+  Operation_Side_Effects.cc \
+  "${REPOROOT}/src/"Structs.cc \
+  "${REPOROOT}/src/"Dose_Meld.cc \
+  "${REPOROOT}/src/"Regex_Selectors.cc \
   -o run_tests \
   -pthread \
   -lboost_system \
+  -lboost_filesystem \
+  -lboost_thread \
   -lygor
 
 ./run_tests #--success